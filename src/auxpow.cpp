@@ -10,14 +10,21 @@
 #include <consensus/consensus.h>
 #include <consensus/merkle.h>
 #include <consensus/params.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+#include <cuckoocache.h>
 #include <hash.h>
 #include <primitives/block.h>
+#include <random.h>
 #include <script/script.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 
+#include <boost/thread.hpp>
+
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 
 namespace
 {
@@ -37,11 +44,216 @@ DecodeLE32 (const unsigned char* bytes)
   return res;
 }
 
+/**
+ * Positions of the merge-mining data in the parent coinbase script, as
+ * found by ScanCoinbase.
+ */
+struct CoinbaseScan
+{
+
+  static constexpr size_t NOT_FOUND = static_cast<size_t> (-1);
+
+  /** Offset of the first merged-mining header.  */
+  size_t header = NOT_FOUND;
+
+  /** Whether there is more than one merged-mining header.  */
+  bool multipleHeaders = false;
+
+  /** Offset of the first occurrence of the chain merkle root.  */
+  size_t root = NOT_FOUND;
+
+};
+
+constexpr size_t CoinbaseScan::NOT_FOUND;
+
+/**
+ * Locates the merged-mining header and the chain merkle root in the parent
+ * coinbase script.  This walks the script only once, instead of searching
+ * it separately for each of them.
+ */
+CoinbaseScan
+ScanCoinbase (const CScript& script, const unsigned char* root,
+              const size_t rootLen)
+{
+  const unsigned char* const data = script.data ();
+  const size_t len = script.size ();
+  const size_t headerLen = sizeof (pchMergedMiningHeader);
+
+  CoinbaseScan res;
+  for (size_t i = 0; i < len; ++i)
+    {
+      const size_t left = len - i;
+
+      if (data[i] == pchMergedMiningHeader[0] && left >= headerLen
+            && memcmp (data + i, pchMergedMiningHeader, headerLen) == 0)
+        {
+          if (res.header == CoinbaseScan::NOT_FOUND)
+            res.header = i;
+          else
+            res.multipleHeaders = true;
+        }
+
+      if (res.root == CoinbaseScan::NOT_FOUND && data[i] == root[0]
+            && left >= rootLen && memcmp (data + i, root, rootLen) == 0)
+        res.root = i;
+
+      /* Nothing can change the outcome anymore.  */
+      if (res.root != CoinbaseScan::NOT_FOUND && res.multipleHeaders)
+        break;
+    }
+
+  return res;
+}
+
+/**
+ * Hasher for the cache entries.  They are salted hashes already, so their
+ * bytes can be used directly (as with the signature cache).
+ */
+class AuxpowCacheHasher
+{
+public:
+  template <uint8_t hash_select>
+    uint32_t
+    operator() (const uint256& key) const
+  {
+    static_assert (hash_select < 8, "only 8 hashes available");
+    uint32_t u;
+    memcpy (&u, key.begin () + 4 * hash_select, 4);
+    return u;
+  }
+};
+
+/**
+ * Cache of auxpows that have been verified successfully, so that the merkle
+ * branches and coinbase are not checked again each time the same header
+ * is seen (e.g. on header receipt, block receipt and when reading the block
+ * back from disk).  Entries are a salted hash of everything that
+ * CAuxPow::check depends on.
+ */
+class CAuxpowCache
+{
+
+private:
+
+  uint256 nonce;
+  typedef CuckooCache::cache<uint256, AuxpowCacheHasher> map_type;
+  map_type setValid;
+  bool initialised = false;
+  boost::shared_mutex cs;
+
+public:
+
+  CAuxpowCache ()
+  {
+    GetRandBytes (nonce.begin (), 32);
+  }
+
+  void
+  ComputeEntry (uint256& entry, const uint256& hashAuxBlock,
+                const int nChainId, const CBaseMerkleTx& coinbaseTx,
+                const std::vector<uint256>& vChainMerkleBranch,
+                const int nChainIndex, const uint256& parentMerkleRoot) const
+  {
+    unsigned char buf[4];
+    CSHA256 hasher;
+    hasher.Write (nonce.begin (), 32);
+    hasher.Write (hashAuxBlock.begin (), 32);
+    WriteLE32 (buf, nChainId);
+    hasher.Write (buf, 4);
+
+    hasher.Write (coinbaseTx.GetHash ().begin (), 32);
+    WriteLE32 (buf, coinbaseTx.nIndex);
+    hasher.Write (buf, 4);
+    WriteLE32 (buf, coinbaseTx.vMerkleBranch.size ());
+    hasher.Write (buf, 4);
+    for (const auto& h : coinbaseTx.vMerkleBranch)
+      hasher.Write (h.begin (), 32);
+
+    WriteLE32 (buf, nChainIndex);
+    hasher.Write (buf, 4);
+    WriteLE32 (buf, vChainMerkleBranch.size ());
+    hasher.Write (buf, 4);
+    for (const auto& h : vChainMerkleBranch)
+      hasher.Write (h.begin (), 32);
+
+    hasher.Write (parentMerkleRoot.begin (), 32);
+    hasher.Finalize (entry.begin ());
+  }
+
+  bool
+  IsEnabled ()
+  {
+    boost::shared_lock<boost::shared_mutex> lock(cs);
+    return initialised;
+  }
+
+  bool
+  Get (const uint256& entry)
+  {
+    boost::shared_lock<boost::shared_mutex> lock(cs);
+    return initialised && setValid.contains (entry, false);
+  }
+
+  void
+  Set (uint256& entry)
+  {
+    boost::unique_lock<boost::shared_mutex> lock(cs);
+    if (initialised)
+      setValid.insert (entry);
+  }
+
+  uint32_t
+  setup_bytes (const size_t n)
+  {
+    boost::unique_lock<boost::shared_mutex> lock(cs);
+    initialised = true;
+    return setValid.setup_bytes (n);
+  }
+
+};
+
+CAuxpowCache auxpowCache;
+
 } // anonymous namespace
 
+void
+InitAuxpowCache ()
+{
+  const int64_t arg
+    = gArgs.GetArg ("-maxauxpowcachesize", DEFAULT_MAX_AUXPOW_CACHE_SIZE);
+  const size_t nMaxCacheSize
+    = std::min (std::max<int64_t> (0, arg), MAX_MAX_AUXPOW_CACHE_SIZE)
+        * (static_cast<size_t> (1) << 20);
+  const size_t nElems = auxpowCache.setup_bytes (nMaxCacheSize);
+  LogPrintf ("Using %zu MiB out of %zu requested for auxpow cache,"
+             " able to store %zu elements\n",
+             (nElems * sizeof (uint256)) >> 20, nMaxCacheSize >> 20, nElems);
+}
+
 bool
 CAuxPow::check (const uint256& hashAuxBlock, int nChainId,
                 const Consensus::Params& params) const
+{
+  if (!auxpowCache.IsEnabled ())
+    return checkUncached (hashAuxBlock, nChainId, params);
+
+  uint256 entry;
+  auxpowCache.ComputeEntry (entry, hashAuxBlock, nChainId, coinbaseTx,
+                            vChainMerkleBranch, nChainIndex,
+                            parentBlock.hashMerkleRoot);
+  if (auxpowCache.Get (entry))
+    return true;
+
+  if (!checkUncached (hashAuxBlock, nChainId, params))
+    return false;
+
+  auxpowCache.Set (entry);
+  return true;
+}
+
+bool
+CAuxPow::checkUncached (const uint256& hashAuxBlock, int nChainId,
+                        const Consensus::Params& params) const
 {
     if (coinbaseTx.nIndex != 0)
         return error("AuxPow is not a generate");
@@ -52,8 +264,8 @@ CAuxPow::check (const uint256& hashAuxBlock, int nChainId,
     // Check that the chain merkle root is in the coinbase
     const uint256 nRootHash
       = CheckMerkleBranch (hashAuxBlock, vChainMerkleBranch, nChainIndex);
-    valtype vchRootHash(nRootHash.begin (), nRootHash.end ());
-    std::reverse (vchRootHash.begin (), vchRootHash.end ()); // correct endian
+    unsigned char vchRootHash[32];
+    std::reverse_copy (nRootHash.begin (), nRootHash.end (), vchRootHash); // correct endian
 
     // Check that we are in the parent block merkle tree
     if (CheckMerkleBranch(coinbaseTx.GetHash(), coinbaseTx.vMerkleBranch,
@@ -61,31 +273,24 @@ CAuxPow::check (const uint256& hashAuxBlock, int nChainId,
           != parentBlock.hashMerkleRoot)
         return error("Aux POW merkle root incorrect");
 
-    const CScript script = coinbaseTx.tx->vin[0].scriptSig;
+    const CScript& script = coinbaseTx.tx->vin[0].scriptSig;
 
     // Check that the same work is not submitted twice to our chain.
     //
 
-    const unsigned char* const mmHeaderBegin = pchMergedMiningHeader;
-    const unsigned char* const mmHeaderEnd
-        = mmHeaderBegin + sizeof (pchMergedMiningHeader);
-    CScript::const_iterator pcHead =
-        std::search(script.begin(), script.end(), mmHeaderBegin, mmHeaderEnd);
-
-    CScript::const_iterator pc =
-        std::search(script.begin(), script.end(), vchRootHash.begin(), vchRootHash.end());
+    const CoinbaseScan scan
+        = ScanCoinbase (script, vchRootHash, sizeof (vchRootHash));
 
-    if (pc == script.end())
+    if (scan.root == CoinbaseScan::NOT_FOUND)
         return error("Aux POW missing chain merkle root in parent coinbase");
 
-    if (pcHead != script.end())
+    if (scan.header != CoinbaseScan::NOT_FOUND)
     {
         // Enforce only one chain merkle root by checking that a single instance of the merged
         // mining header exists just before.
-        if (script.end() != std::search(pcHead + 1, script.end(),
-                                        mmHeaderBegin, mmHeaderEnd))
+        if (scan.multipleHeaders)
             return error("Multiple merged mining headers in coinbase");
-        if (pcHead + sizeof(pchMergedMiningHeader) != pc)
+        if (scan.header + sizeof(pchMergedMiningHeader) != scan.root)
             return error("Merged mining header is not just before chain merkle root");
     }
     else
@@ -93,16 +298,17 @@ CAuxPow::check (const uint256& hashAuxBlock, int nChainId,
         // For backward compatibility.
         // Enforce only one chain merkle root by checking that it starts early in the coinbase.
         // 8-12 bytes are enough to encode extraNonce and nBits.
-        if (pc - script.begin() > 20)
+        if (scan.root > 20)
             return error("Aux POW chain merkle root must start in the first 20 bytes of the parent coinbase");
     }
 
 
     // Ensure we are at a deterministic point in the merkle leaves by hashing
     // a nonce and our chain ID and comparing to the index.
-    pc += vchRootHash.size();
-    if (script.end() - pc < 8)
+    const size_t pos = scan.root + sizeof (vchRootHash);
+    if (script.size() - pos < 8)
         return error("Aux POW missing chain merkle tree size and nonce in parent coinbase");
+    const unsigned char* pc = script.data() + pos;
 
     const uint32_t nSize = DecodeLE32 (&pc[0]);
     const unsigned merkleHeight = vChainMerkleBranch.size ();
@@ -35,6 +35,18 @@ namespace powdata_tests
 class CAuxPowForTest;
 }
 
+/** Default size of the auxpow verification cache in MiB.  */
+static const unsigned DEFAULT_MAX_AUXPOW_CACHE_SIZE = 4;
+/** Maximum size of the auxpow verification cache in MiB.  */
+static const int64_t MAX_MAX_AUXPOW_CACHE_SIZE = 1024;
+
+/**
+ * Sets up the cache of successfully verified auxpows, with the size given
+ * by -maxauxpowcachesize.  Until this is called, CAuxPow::check does not
+ * use a cache at all.
+ */
+void InitAuxpowCache ();
+
 /** Header for merge-mining data in the coinbase.  */
 static const unsigned char pchMergedMiningHeader[] = { 0xfa, 0xbe, 'm', 'm' };
 
@@ -165,6 +177,13 @@ public:
   bool check (const uint256& hashAuxBlock, int nChainId,
               const Consensus::Params& params) const;
 
+  /**
+   * Performs the same check, but without consulting or updating the
+   * cache of previously verified auxpows.
+   */
+  bool checkUncached (const uint256& hashAuxBlock, int nChainId,
+                      const Consensus::Params& params) const;
+
   /**
    * Returns the parent block hash.  This is used to validate the PoW.
    */
@@ -0,0 +1,107 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <auxpow.h>
+#include <chainparams.h>
+#include <hash.h>
+#include <primitives/pureheader.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <streams.h>
+#include <version.h>
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace
+{
+
+/**
+ * Constructs a merge-mined auxpow for hashAux that looks like one from a
+ * typical pool:  The parent coinbase has some extra data before the
+ * merge-mining commitment and a merkle branch into a block with a few
+ * thousand transactions.
+ */
+CAuxPow
+BuildAuxpow (const uint256& hashAux)
+{
+    FastRandomContext rng(true);
+
+    std::vector<unsigned char> commitment(pchMergedMiningHeader, pchMergedMiningHeader + sizeof(pchMergedMiningHeader));
+    commitment.insert(commitment.end(), hashAux.begin(), hashAux.end());
+    std::reverse(commitment.end() - 32, commitment.end());
+    // Merkle tree size 1 and nonce 0, i.e. no chain merkle branch.
+    const unsigned char sizeAndNonce[] = {1, 0, 0, 0, 0, 0, 0, 0};
+    commitment.insert(commitment.end(), sizeAndNonce, sizeAndNonce + sizeof(sizeAndNonce));
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << 580000 << rng.randbytes(8) << rng.randbytes(60) << commitment;
+    coinbase.vout.emplace_back(1250000000, CScript() << OP_DUP << OP_HASH160 << rng.randbytes(20) << OP_EQUALVERIFY << OP_CHECKSIG);
+    const CTransactionRef tx = MakeTransactionRef(std::move(coinbase));
+
+    std::vector<uint256> branch;
+    uint256 root = tx->GetHash();
+    for (int i = 0; i < 12; ++i) {
+        branch.push_back(rng.rand256());
+        root = Hash(root.begin(), root.end(), branch.back().begin(), branch.back().end());
+    }
+
+    CPureBlockHeader parent;
+    parent.nVersion = 0x20000000;
+    parent.hashPrevBlock = rng.rand256();
+    parent.hashMerkleRoot = root;
+    parent.nTime = 1560000000;
+    parent.nBits = 0x17000000;
+    parent.nNonce = 0;
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << tx << uint256() << branch << 0;
+    stream << std::vector<uint256>() << 0 << parent;
+
+    CAuxPow auxpow;
+    stream >> auxpow;
+    return auxpow;
+}
+
+} // anonymous namespace
+
+// Checks the same auxpow repeatedly, as happens when a header is received
+// and later its block is received and read back from disk.
+static void AuxpowCheck(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    InitAuxpowCache();
+    const Consensus::Params& params = Params().GetConsensus();
+
+    const uint256 hashAux = GetRandHash();
+    const CAuxPow auxpow = BuildAuxpow(hashAux);
+
+    while (state.KeepRunning()) {
+        bool ok = auxpow.check(hashAux, params.nAuxpowChainId, params);
+        assert(ok);
+    }
+}
+
+static void AuxpowCheckUncached(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = Params().GetConsensus();
+
+    const uint256 hashAux = GetRandHash();
+    const CAuxPow auxpow = BuildAuxpow(hashAux);
+
+    while (state.KeepRunning()) {
+        bool ok = auxpow.checkUncached(hashAux, params.nAuxpowChainId, params);
+        assert(ok);
+    }
+}
+
+BENCHMARK(AuxpowCheck, 50000);
+BENCHMARK(AuxpowCheckUncached, 50000);
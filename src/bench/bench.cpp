@@ -2,47 +2,154 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
 #include <bench/bench.h>
 
+#include <tinyformat.h>
+
 #include <assert.h>
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <new>
 #include <regex>
 #include <numeric>
 
-void benchmark::ConsolePrinter::header()
+namespace {
+std::atomic<bool> g_count_allocations{false};
+std::atomic<uint64_t> g_allocated_bytes{0};
+} // namespace
+
+#ifdef ENABLE_BENCH_ALLOCSTATS
+// Replace the global allocation functions, so that allocations can be
+// counted.  The array and nothrow versions forward to these by default.
+// This applies to the whole binary and adds an atomic load to every
+// allocation even without -allocstats, which is why it is only compiled in
+// with --enable-bench-allocstats.
+void* operator new(std::size_t size)
 {
-    std::cout << "# Benchmark, evals, iterations, total, min, max, median" << std::endl;
+    if (g_count_allocations.load(std::memory_order_relaxed)) {
+        g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    void* p = std::malloc(size > 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
 }
 
-void benchmark::ConsolePrinter::result(const State& state)
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+#endif // ENABLE_BENCH_ALLOCSTATS
+
+void benchmark::SetCountAllocations(bool count)
+{
+    g_count_allocations = count;
+}
+
+bool benchmark::IsCountingAllocations()
+{
+    return g_count_allocations;
+}
+
+uint64_t benchmark::GetAllocatedBytes()
+{
+    return g_allocated_bytes.load(std::memory_order_relaxed);
+}
+
+benchmark::Result::Result(const State& state)
+    : name(state.m_name), num_evals(state.m_num_evals), num_iters(state.m_num_iters),
+      total(0), min(0), max(0), median(0), bytes_per_op(-1)
 {
     auto results = state.m_elapsed_results;
     std::sort(results.begin(), results.end());
 
-    double total = state.m_num_iters * std::accumulate(results.begin(), results.end(), 0.0);
-
-    double front = 0;
-    double back = 0;
-    double median = 0;
+    total = num_iters * std::accumulate(results.begin(), results.end(), 0.0);
 
     if (!results.empty()) {
-        front = results.front();
-        back = results.back();
+        min = results.front();
+        max = results.back();
 
         size_t mid = results.size() / 2;
         median = results[mid];
         if (0 == results.size() % 2) {
-            median = (results[mid] + results[mid + 1]) / 2;
+            median = (results[mid - 1] + results[mid]) / 2;
+        }
+
+        if (IsCountingAllocations()) {
+            bytes_per_op = static_cast<double>(state.m_alloc_bytes) / (results.size() * num_iters);
         }
     }
+}
+
+void benchmark::ConsolePrinter::header()
+{
+    std::cout << "# Benchmark, evals, iterations, total, min, max, median" << std::endl;
+}
 
+void benchmark::ConsolePrinter::result(const State& state)
+{
+    const Result result(state);
     std::cout << std::setprecision(6);
-    std::cout << state.m_name << ", " << state.m_num_evals << ", " << state.m_num_iters << ", " << total << ", " << front << ", " << back << ", " << median << std::endl;
+    std::cout << result.name << ", " << result.num_evals << ", " << result.num_iters << ", " << result.total << ", " << result.min << ", " << result.max << ", " << result.median << std::endl;
 }
 
 void benchmark::ConsolePrinter::footer() {}
+
+void benchmark::CsvPrinter::header()
+{
+    std::cout << "name,evals,iterations,total,min,median,max,ns_per_op,bytes_per_op" << std::endl;
+}
+
+void benchmark::CsvPrinter::result(const State& state)
+{
+    const Result result(state);
+    std::cout << std::setprecision(6);
+    std::cout << result.name << "," << result.num_evals << "," << result.num_iters << "," << result.total << ","
+              << result.min << "," << result.median << "," << result.max << "," << result.median * 1e9 << ",";
+    if (result.bytes_per_op >= 0) {
+        std::cout << result.bytes_per_op;
+    }
+    std::cout << std::endl;
+}
+
+void benchmark::CsvPrinter::footer() {}
+
+benchmark::JsonPrinter::JsonPrinter() : m_results(UniValue::VARR) {}
+
+void benchmark::JsonPrinter::header() {}
+
+void benchmark::JsonPrinter::result(const State& state)
+{
+    const Result result(state);
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("name", result.name);
+    obj.pushKV("evals", result.num_evals);
+    obj.pushKV("iterations", result.num_iters);
+    obj.pushKV("total", result.total);
+    obj.pushKV("min", result.min);
+    obj.pushKV("median", result.median);
+    obj.pushKV("max", result.max);
+    obj.pushKV("ns_per_op", result.median * 1e9);
+    if (result.bytes_per_op >= 0) {
+        obj.pushKV("bytes_per_op", result.bytes_per_op);
+    }
+    m_results.push_back(obj);
+}
+
+void benchmark::JsonPrinter::footer()
+{
+    UniValue res(UniValue::VOBJ);
+    res.pushKV("benchmarks", m_results);
+    std::cout << res.write(2) << std::endl;
+}
 benchmark::PlotlyPrinter::PlotlyPrinter(std::string plotly_url, int64_t width, int64_t height)
     : m_plotly_url(plotly_url), m_width(width), m_height(height)
 {
@@ -93,8 +200,10 @@ benchmark::BenchRunner::BenchRunner(std::string name, benchmark::BenchFunction f
     benchmarks().insert(std::make_pair(name, Bench{func, num_iters_for_one_second}));
 }
 
-void benchmark::BenchRunner::RunAll(Printer& printer, uint64_t num_evals, double scaling, const std::string& filter, bool is_list_only)
+std::vector<benchmark::Result> benchmark::BenchRunner::RunAll(Printer& printer, uint64_t num_evals, double scaling, const std::string& filter, bool is_list_only)
 {
+    std::vector<Result> results;
+
     if (!std::ratio_less_equal<benchmark::clock::period, std::micro>::value) {
         std::cerr << "WARNING: Clock precision is worse than microsecond - benchmarks may be less accurate!\n";
     }
@@ -119,11 +228,50 @@ void benchmark::BenchRunner::RunAll(Printer& printer, uint64_t num_evals, double
         State state(p.first, num_evals, num_iters, printer);
         if (!is_list_only) {
             p.second.func(state);
+            results.emplace_back(state);
         }
         printer.result(state);
     }
 
     printer.footer();
+
+    return results;
+}
+
+int benchmark::CompareResults(const UniValue& baseline, const std::vector<Result>& results, double threshold)
+{
+    std::map<std::string, double> baseline_medians;
+    const UniValue& benchmarks = find_value(baseline, "benchmarks");
+    if (benchmarks.isArray()) {
+        for (const UniValue& entry : benchmarks.getValues()) {
+            const UniValue& name = find_value(entry, "name");
+            const UniValue& median = find_value(entry, "median");
+            if (name.isStr() && median.isNum()) {
+                baseline_medians[name.get_str()] = median.get_real();
+            }
+        }
+    }
+
+    int regressions = 0;
+    std::cerr << "# Benchmark, baseline median, median, change" << std::endl;
+    std::cerr << std::setprecision(6);
+    for (const auto& result : results) {
+        const auto it = baseline_medians.find(result.name);
+        if (it == baseline_medians.end() || it->second <= 0) {
+            std::cerr << result.name << ", -, " << result.median << ", new" << std::endl;
+            continue;
+        }
+
+        const double change = result.median / it->second - 1;
+        std::cerr << result.name << ", " << it->second << ", " << result.median << ", " << strprintf("%+.1f%%", change * 100);
+        if (change > threshold) {
+            std::cerr << " REGRESSION";
+            ++regressions;
+        }
+        std::cerr << std::endl;
+    }
+
+    return regressions;
 }
 
 bool benchmark::State::UpdateTimer(const benchmark::time_point current_time)
@@ -131,6 +279,7 @@ bool benchmark::State::UpdateTimer(const benchmark::time_point current_time)
     if (m_start_time != time_point()) {
         std::chrono::duration<double> diff = current_time - m_start_time;
         m_elapsed_results.push_back(diff.count() / m_num_iters);
+        m_alloc_bytes += GetAllocatedBytes() - m_alloc_start;
 
         if (m_elapsed_results.size() == m_num_evals) {
             return false;
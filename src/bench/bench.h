@@ -12,6 +12,8 @@
 #include <vector>
 #include <chrono>
 
+#include <univalue.h>
+
 #include <boost/preprocessor/cat.hpp>
 #include <boost/preprocessor/stringize.hpp>
 
@@ -51,6 +53,12 @@ using duration = clock::duration;
 
 class Printer;
 
+// Counting of the bytes allocated on the heap (through operator new), used
+// to report bytes per iteration.  Allocations of all threads are counted.
+void SetCountAllocations(bool count);
+bool IsCountingAllocations();
+uint64_t GetAllocatedBytes();
+
 class State
 {
 public:
@@ -60,10 +68,13 @@ public:
     const uint64_t m_num_evals;
     std::vector<double> m_elapsed_results;
     time_point m_start_time;
+    // heap bytes allocated in the timed sections (if counted)
+    uint64_t m_alloc_start;
+    uint64_t m_alloc_bytes;
 
     bool UpdateTimer(time_point finish_time);
 
-    State(std::string name, uint64_t num_evals, double num_iters, Printer& printer) : m_name(name), m_num_iters_left(0), m_num_iters(num_iters), m_num_evals(num_evals)
+    State(std::string name, uint64_t num_evals, double num_iters, Printer& printer) : m_name(name), m_num_iters_left(0), m_num_iters(num_iters), m_num_evals(num_evals), m_alloc_start(0), m_alloc_bytes(0)
     {
     }
 
@@ -75,11 +86,27 @@ public:
 
         bool result = UpdateTimer(clock::now());
         // measure again so runtime of UpdateTimer is not included
+        m_alloc_start = GetAllocatedBytes();
         m_start_time = clock::now();
         return result;
     }
 };
 
+// summary statistics of a benchmark run; times are in seconds per iteration
+struct Result {
+    std::string name;
+    uint64_t num_evals;
+    uint64_t num_iters;
+    double total;
+    double min;
+    double max;
+    double median;
+    // heap bytes allocated per iteration, negative if not counted
+    double bytes_per_op;
+
+    explicit Result(const State& state);
+};
+
 typedef std::function<void(State&)> BenchFunction;
 
 class BenchRunner
@@ -94,9 +121,14 @@ class BenchRunner
 public:
     BenchRunner(std::string name, BenchFunction func, uint64_t num_iters_for_one_second);
 
-    static void RunAll(Printer& printer, uint64_t num_evals, double scaling, const std::string& filter, bool is_list_only);
+    static std::vector<Result> RunAll(Printer& printer, uint64_t num_evals, double scaling, const std::string& filter, bool is_list_only);
 };
 
+// Compares results to a baseline written by JsonPrinter and prints a report
+// to stderr.  Returns the number of benchmarks whose median time per
+// iteration got worse by more than the threshold (e.g. 0.1 for 10%).
+int CompareResults(const UniValue& baseline, const std::vector<Result>& results, double threshold);
+
 // interface to output benchmark results.
 class Printer
 {
@@ -116,6 +148,29 @@ public:
     void footer() override;
 };
 
+// prints one line of comma-separated values per benchmark
+class CsvPrinter : public Printer
+{
+public:
+    void header() override;
+    void result(const State& state) override;
+    void footer() override;
+};
+
+// prints all results as one JSON object, which can be used as baseline
+// for CompareResults
+class JsonPrinter : public Printer
+{
+public:
+    JsonPrinter();
+    void header() override;
+    void result(const State& state) override;
+    void footer() override;
+
+private:
+    UniValue m_results;
+};
+
 // creates box plot with plotly.js
 class PlotlyPrinter : public Printer
 {
@@ -2,6 +2,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
 #include <bench/bench.h>
 
 #include <crypto/sha256.h>
@@ -11,6 +15,8 @@
 #include <util/strencodings.h>
 #include <validation.h>
 
+#include <fstream>
+#include <iterator>
 #include <memory>
 
 const std::function<std::string(const char*)> G_TRANSLATION_FUN = nullptr;
@@ -22,6 +28,7 @@ static const char* DEFAULT_BENCH_PRINTER = "console";
 static const char* DEFAULT_PLOT_PLOTLYURL = "https://cdn.plot.ly/plotly-latest.min.js";
 static const int64_t DEFAULT_PLOT_WIDTH = 1024;
 static const int64_t DEFAULT_PLOT_HEIGHT = 768;
+static const char* DEFAULT_COMPARE_THRESHOLD = "10";
 
 static void SetupBenchArgs()
 {
@@ -30,7 +37,10 @@ static void SetupBenchArgs()
     gArgs.AddArg("-evals=<n>", strprintf("Number of measurement evaluations to perform. (default: %u)", DEFAULT_BENCH_EVALUATIONS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-filter=<regex>", strprintf("Regular expression filter to select benchmark by name (default: %s)", DEFAULT_BENCH_FILTER), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-scaling=<n>", strprintf("Scaling factor for benchmark's runtime (default: %u)", DEFAULT_BENCH_SCALING), false, OptionsCategory::OPTIONS);
-    gArgs.AddArg("-printer=(console|plot)", strprintf("Choose printer format. console: print data to console. plot: Print results as HTML graph (default: %s)", DEFAULT_BENCH_PRINTER), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-printer=(console|plot|csv|json)", strprintf("Choose printer format. console: print data to console. plot: Print results as HTML graph. csv: Print comma-separated values. json: Print results as JSON, which can be used with -compare (default: %s)", DEFAULT_BENCH_PRINTER), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-allocstats", "Count heap allocations and report bytes per iteration (csv and json printers only, requires building with --enable-bench-allocstats)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-compare=<file>", "Compare the results to a baseline written with -printer=json, and fail if a benchmark got slower by more than -compare-threshold", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-compare-threshold=<n>", strprintf("Slowdown of the median time in percent that is reported as regression by -compare (default: %s)", DEFAULT_COMPARE_THRESHOLD), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-plot-plotlyurl=<uri>", strprintf("URL to use for plotly.js (default: %s)", DEFAULT_PLOT_PLOTLYURL), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-plot-width=<x>", strprintf("Plot width in pixel (default: %u)", DEFAULT_PLOT_WIDTH), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-plot-height=<x>", strprintf("Plot height in pixel (default: %u)", DEFAULT_PLOT_HEIGHT), false, OptionsCategory::OPTIONS);
@@ -50,11 +60,6 @@ static fs::path SetDataDir()
 
 int main(int argc, char** argv)
 {
-    /* FIXME: Re-enable benchmarking after it has been fixed for auxpow.
-       See https://github.com/namecoin/namecoin-core/issues/273.  */
-    fprintf(stderr, "bench_bitcoin is disabled in Namecoin/Auxpow\n");
-    return EXIT_SUCCESS;
-
     SetupBenchArgs();
     std::string error;
     if (!gArgs.ParseParameters(argc, argv, error)) {
@@ -87,6 +92,23 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
+    UniValue baseline;
+    const std::string compare_file = gArgs.GetArg("-compare", "");
+    double compare_threshold = 0;
+    if (!compare_file.empty()) {
+        fsbridge::ifstream file{fs::path(compare_file)};
+        const std::string content{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        if (!file.is_open() || !baseline.read(content) || !baseline.isObject()) {
+            fprintf(stderr, "Error reading baseline results from %s\n", compare_file.c_str());
+            return EXIT_FAILURE;
+        }
+        const std::string threshold_str = gArgs.GetArg("-compare-threshold", DEFAULT_COMPARE_THRESHOLD);
+        if (!ParseDouble(threshold_str, &compare_threshold)) {
+            fprintf(stderr, "Error parsing comparison threshold as double: %s\n", threshold_str.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
     std::unique_ptr<benchmark::Printer> printer = MakeUnique<benchmark::ConsolePrinter>();
     std::string printer_arg = gArgs.GetArg("-printer", DEFAULT_BENCH_PRINTER);
     if ("plot" == printer_arg) {
@@ -94,13 +116,34 @@ int main(int argc, char** argv)
             gArgs.GetArg("-plot-plotlyurl", DEFAULT_PLOT_PLOTLYURL),
             gArgs.GetArg("-plot-width", DEFAULT_PLOT_WIDTH),
             gArgs.GetArg("-plot-height", DEFAULT_PLOT_HEIGHT)));
+    } else if ("csv" == printer_arg) {
+        printer.reset(new benchmark::CsvPrinter());
+    } else if ("json" == printer_arg) {
+        printer.reset(new benchmark::JsonPrinter());
     }
 
-    benchmark::BenchRunner::RunAll(*printer, evaluations, scaling_factor, regex_filter, is_list_only);
+#ifndef ENABLE_BENCH_ALLOCSTATS
+    if (gArgs.GetBoolArg("-allocstats", false)) {
+        fprintf(stderr, "-allocstats requires building with --enable-bench-allocstats\n");
+        return EXIT_FAILURE;
+    }
+#endif
+
+    benchmark::SetCountAllocations(gArgs.GetBoolArg("-allocstats", false));
+    const std::vector<benchmark::Result> results = benchmark::BenchRunner::RunAll(*printer, evaluations, scaling_factor, regex_filter, is_list_only);
+    benchmark::SetCountAllocations(false);
 
     fs::remove_all(bench_datadir);
 
     ECC_Stop();
 
+    if (!compare_file.empty()) {
+        const int regressions = benchmark::CompareResults(baseline, results, compare_threshold / 100);
+        if (regressions > 0) {
+            fprintf(stderr, "%d benchmark(s) slower than the baseline by more than %g%%\n", regressions, compare_threshold);
+            return EXIT_FAILURE;
+        }
+    }
+
     return EXIT_SUCCESS;
 }
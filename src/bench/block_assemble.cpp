@@ -67,7 +67,6 @@ static void AssembleBlock(benchmark::State& state)
     const CScript SCRIPT_PUB{CScript(OP_0) << std::vector<unsigned char>{witness_program.begin(), witness_program.end()}};
 
     // Switch to regtest so we can mine faster
-    // Also segwit is active, so we can include witness transactions
     SelectParams(CBaseChainParams::REGTEST);
 
     InitScriptExecutionCache();
@@ -76,7 +75,7 @@ static void AssembleBlock(benchmark::State& state)
     CScheduler scheduler;
     {
         ::pblocktree.reset(new CBlockTreeDB(1 << 20, true));
-        ::pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+        ::pcoinsdbview.reset(new CCoinsViewDB(1 << 23, 1 << 20, true));
         ::pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
 
         const CChainParams& chainparams = Params();
@@ -86,8 +85,13 @@ static void AssembleBlock(benchmark::State& state)
         CValidationState state;
         ActivateBestChain(state, chainparams);
         assert(::chainActive.Tip() != nullptr);
-        const bool witness_enabled{IsWitnessEnabled(::chainActive.Tip(), chainparams.GetConsensus())};
-        assert(witness_enabled);
+    }
+
+    // Segwit is only enabled from BIP16Height on regtest, so mine up to
+    // there before the blocks whose coinbases are spent by witness
+    // transactions below.
+    while (!IsWitnessEnabled(::chainActive.Tip(), Params().GetConsensus())) {
+        MineBlock(SCRIPT_PUB);
     }
 
     // Collect some loose transactions that spend the coinbases of our mined blocks
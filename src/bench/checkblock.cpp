@@ -5,39 +5,127 @@
 #include <bench/bench.h>
 
 #include <chainparams.h>
+#include <consensus/consensus.h>
+#include <consensus/merkle.h>
+#include <powdata.h>
+#include <primitives/blockview.h>
 #include <validation.h>
 #include <streams.h>
+#include <support/allocators/monotonic.h>
 #include <consensus/validation.h>
 
+#include <boost/thread/thread.hpp>
+
 namespace block_bench {
 #include <bench/data/block413567.raw.h>
 } // namespace block_bench
 
+// The raw block is a Bitcoin block, whose header does not have the PoW data
+// of Xaya and which is too large for Xaya's block weight limit.  It is
+// converted once into a full Xaya block with the leading transactions and an
+// (unmined) fake header, which the benchmarks below then deserialise.
+static const std::vector<unsigned char>& GetBlockData()
+{
+    static const std::vector<unsigned char> data = [] {
+        CDataStream stream((const char*)block_bench::block413567,
+                (const char*)block_bench::block413567 + sizeof(block_bench::block413567),
+                SER_NETWORK, PROTOCOL_VERSION);
+        CBlock block;
+        std::vector<CTransactionRef> vtx;
+        stream >> static_cast<CPureBlockHeader&>(block) >> vtx;
+        // Leave some room for the header.
+        int64_t weight = 1000 * WITNESS_SCALE_FACTOR;
+        for (auto& tx : vtx) {
+            weight += GetTransactionWeight(*tx);
+            if (weight > MAX_BLOCK_WEIGHT)
+                break;
+            block.vtx.push_back(std::move(tx));
+        }
+        block.hashMerkleRoot = BlockMerkleRoot(block);
+        block.pow.setCoreAlgo(PowAlgo::NEOSCRYPT);
+        block.pow.initFakeHeader(block);
+
+        std::vector<unsigned char> result;
+        CVectorWriter(SER_NETWORK, PROTOCOL_VERSION, result, 0) << block;
+        return result;
+    }();
+    return data;
+}
+
 // These are the two major time-sinks which happen after we have fully received
 // a block off the wire, but before we can relay the block on to peers using
 // compact block relay.
 
 static void DeserializeBlockTest(benchmark::State& state)
 {
-    CDataStream stream((const char*)block_bench::block413567,
-            (const char*)block_bench::block413567 + sizeof(block_bench::block413567),
-            SER_NETWORK, PROTOCOL_VERSION);
+    const std::vector<unsigned char>& data = GetBlockData();
+    CDataStream stream(data, SER_NETWORK, PROTOCOL_VERSION);
     char a = '\0';
     stream.write(&a, 1); // Prevent compaction
 
     while (state.KeepRunning()) {
         CBlock block;
         stream >> block;
-        bool rewound = stream.Rewind(sizeof(block_bench::block413567));
+        bool rewound = stream.Rewind(data.size());
         assert(rewound);
     }
 }
 
-static void DeserializeAndCheckBlockTest(benchmark::State& state)
+// Deserializes the same block, but with the transaction hashes computed one
+// by one instead of batched, for comparison with DeserializeBlockTest.
+static void DeserializeBlockUnbatchedTest(benchmark::State& state)
 {
-    CDataStream stream((const char*)block_bench::block413567,
-            (const char*)block_bench::block413567 + sizeof(block_bench::block413567),
-            SER_NETWORK, PROTOCOL_VERSION);
+    const std::vector<unsigned char>& data = GetBlockData();
+    CDataStream stream(data, SER_NETWORK, PROTOCOL_VERSION);
+    char a = '\0';
+    stream.write(&a, 1); // Prevent compaction
+
+    while (state.KeepRunning()) {
+        CBlockHeader header;
+        std::vector<CTransactionRef> vtx;
+        stream >> header >> vtx;
+        bool rewound = stream.Rewind(data.size());
+        assert(rewound);
+    }
+}
+
+static void DeserializeBlockArenaTest(benchmark::State& state)
+{
+    const std::vector<unsigned char>& data = GetBlockData();
+    CDataStream stream(data, SER_NETWORK, PROTOCOL_VERSION);
+    char a = '\0';
+    stream.write(&a, 1); // Prevent compaction
+
+    while (state.KeepRunning()) {
+        CBlock block;
+        UnserializeBlock(stream, block, std::make_shared<MonotonicArena>());
+        bool rewound = stream.Rewind(data.size());
+        assert(rewound);
+    }
+}
+
+// Scans all outputs through a CBlockView, which is what consumers that only
+// look at the block content need instead of DeserializeBlockTest.
+static void ScanBlockViewTest(benchmark::State& state)
+{
+    const Span<const unsigned char> data = MakeSpan(GetBlockData());
+
+    while (state.KeepRunning()) {
+        const CBlockView view(data);
+        CAmount total = 0;
+        for (const auto& tx : view.GetTransactions()) {
+            for (const auto& out : tx.Outputs()) {
+                total += out.nValue;
+            }
+        }
+        assert(total > 0);
+    }
+}
+
+static void DeserializeAndCheck(benchmark::State& state)
+{
+    const std::vector<unsigned char>& data = GetBlockData();
+    CDataStream stream(data, SER_NETWORK, PROTOCOL_VERSION);
     char a = '\0';
     stream.write(&a, 1); // Prevent compaction
 
@@ -46,14 +134,40 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
     while (state.KeepRunning()) {
         CBlock block; // Note that CBlock caches its checked state, so we need to recreate it here
         stream >> block;
-        bool rewound = stream.Rewind(sizeof(block_bench::block413567));
+        bool rewound = stream.Rewind(data.size());
         assert(rewound);
 
         CValidationState validationState;
-        bool checked = CheckBlock(block, validationState, chainParams->GetConsensus());
+        // The converted block has no valid PoW.
+        bool checked = CheckBlock(block, validationState, chainParams->GetConsensus(), false);
         assert(checked);
     }
 }
 
+static void DeserializeAndCheckBlockTest(benchmark::State& state)
+{
+    DeserializeAndCheck(state);
+}
+
+// Same as DeserializeAndCheckBlockTest, but with the transactions checked in
+// parallel on block check threads.
+static void DeserializeAndCheckBlockParallelTest(benchmark::State& state)
+{
+    boost::thread_group threads;
+    nBlockCheckThreads = 4;
+    for (int i = 0; i < nBlockCheckThreads - 1; ++i)
+        threads.create_thread(&ThreadBlockCheck);
+
+    DeserializeAndCheck(state);
+
+    threads.interrupt_all();
+    threads.join_all();
+    nBlockCheckThreads = 0;
+}
+
 BENCHMARK(DeserializeBlockTest, 130);
+BENCHMARK(DeserializeBlockUnbatchedTest, 130);
+BENCHMARK(DeserializeBlockArenaTest, 130);
+BENCHMARK(ScanBlockViewTest, 130);
 BENCHMARK(DeserializeAndCheckBlockTest, 160);
+BENCHMARK(DeserializeAndCheckBlockParallelTest, 160);
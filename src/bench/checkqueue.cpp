@@ -21,7 +21,7 @@ static const unsigned int QUEUE_BATCH_SIZE = 128;
 // This Benchmark tests the CheckQueue with a slightly realistic workload,
 // where checks all contain a prevector that is indirect 50% of the time
 // and there is a little bit of work done between calls to Add.
-static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
+static void RunCheckQueuePrevectorJob(benchmark::State& state, int threads)
 {
     struct PrevectorJob {
         prevector<PREVECTOR_SIZE, uint8_t> p;
@@ -38,7 +38,7 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     };
     CCheckQueue<PrevectorJob> queue {QUEUE_BATCH_SIZE};
     boost::thread_group tg;
-    for (auto x = 0; x < std::max(MIN_CORES, GetNumCores()); ++x) {
+    for (auto x = 0; x < threads; ++x) {
        tg.create_thread([&]{queue.Thread();});
     }
     while (state.KeepRunning()) {
@@ -59,4 +59,31 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     tg.interrupt_all();
     tg.join_all();
 }
+
+static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
+{
+    RunCheckQueuePrevectorJob(state, std::max(MIN_CORES, GetNumCores()));
+}
+
+// With the maximum number of threads allowed by -par, to see how the queue
+// scales beyond the number of cores.
+static void CCheckQueueSpeedPrevectorJob_MaxThreads(benchmark::State& state)
+{
+    RunCheckQueuePrevectorJob(state, MAX_SCRIPTCHECK_THREADS);
+}
+
+// Fixed thread counts above MAX_SCRIPTCHECK_THREADS, to check whether
+// raising the limit would pay off.
+static void CCheckQueueSpeedPrevectorJob_24Threads(benchmark::State& state)
+{
+    RunCheckQueuePrevectorJob(state, 24);
+}
+static void CCheckQueueSpeedPrevectorJob_32Threads(benchmark::State& state)
+{
+    RunCheckQueuePrevectorJob(state, 32);
+}
+
 BENCHMARK(CCheckQueueSpeedPrevectorJob, 1400);
+BENCHMARK(CCheckQueueSpeedPrevectorJob_MaxThreads, 1400);
+BENCHMARK(CCheckQueueSpeedPrevectorJob_24Threads, 1400);
+BENCHMARK(CCheckQueueSpeedPrevectorJob_32Threads, 1400);
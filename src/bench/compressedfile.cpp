@@ -0,0 +1,96 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <compressedfile.h>
+#include <fs.h>
+#include <random.h>
+#include <tinyformat.h>
+#include <util/time.h>
+
+#include <cassert>
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+
+/** Size of the test file (a bit more than a typical Xaya block file).  */
+constexpr size_t FILE_SIZE = 16 << 20;
+/** Size of the "blocks" read at random positions.  */
+constexpr size_t RECORD_SIZE = 20 << 10;
+
+/**
+ * Writes a plain test file and its compressed version to a temporary
+ * directory, and removes them again when destructed.
+ */
+class TestFiles
+{
+public:
+    fs::path dir;
+    fs::path plain;
+    fs::path compressed;
+
+    TestFiles()
+    {
+        FastRandomContext rng(true);
+        dir = fs::temp_directory_path() / strprintf("bench_compressedfile_%lu", static_cast<unsigned long>(GetTime()));
+        fs::create_directories(dir);
+        plain = dir / "blk00000.dat";
+        compressed = dir / "blk00000.cdat";
+
+        // Roughly as compressible as real block data, which is mostly
+        // hashes and signatures with repeated scripts in between:  records
+        // of 128 bytes, half random and half copied from the one before.
+        std::vector<unsigned char> data(FILE_SIZE);
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = i < 128 || i % 128 < 64 ? rng.randbits(8) : data[i - 128];
+        }
+        FILE* file = fsbridge::fopen(plain, "wb");
+        assert(file != nullptr);
+        fwrite(data.data(), 1, data.size(), file);
+        fclose(file);
+
+        bool ok = CCompressedFile::Create(plain, compressed);
+        assert(ok);
+    }
+
+    ~TestFiles()
+    {
+        fs::remove_all(dir);
+    }
+};
+
+} // anonymous namespace
+
+static void BlockFileReadPlain(benchmark::State& state)
+{
+    const TestFiles files;
+    FastRandomContext rng(true);
+    std::vector<unsigned char> record(RECORD_SIZE);
+    while (state.KeepRunning()) {
+        FILE* file = fsbridge::fopen(files.plain, "rb");
+        assert(file != nullptr);
+        fseek(file, rng.randrange(FILE_SIZE - RECORD_SIZE), SEEK_SET);
+        size_t n = fread(record.data(), 1, record.size(), file);
+        assert(n == record.size());
+        fclose(file);
+    }
+}
+
+static void BlockFileReadCompressed(benchmark::State& state)
+{
+    const TestFiles files;
+    FastRandomContext rng(true);
+    std::vector<unsigned char> record(RECORD_SIZE);
+    while (state.KeepRunning()) {
+        CCompressedFile file(files.compressed);
+        bool ok = file.Read(rng.randrange(FILE_SIZE - RECORD_SIZE), record.data(), record.size());
+        assert(ok);
+    }
+}
+
+BENCHMARK(BlockFileReadPlain, 5000);
+BENCHMARK(BlockFileReadCompressed, 5000);
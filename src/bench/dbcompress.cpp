@@ -0,0 +1,102 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <dbcompress/snappy.h>
+#include <dbwrapper.h>
+#include <random.h>
+#include <tinyformat.h>
+
+#include <cassert>
+#include <memory>
+#include <string>
+
+namespace
+{
+
+constexpr uint32_t NUM_NAMES = 10000;
+
+/** Returns a name value as typically sent for a game move.  */
+std::string GetMoveValue(const uint32_t i)
+{
+    return strprintf("{\"g\":{\"smc\":{\"m\":{\"c\":%u,\"d\":[%u,%u,%u],\"x\":\"sword\"}}}}",
+                     i, i % 7, i % 13, i % 29);
+}
+
+/** Returns a table block's worth of concatenated name values.  */
+std::string GetBlockData()
+{
+    std::string res;
+    for (uint32_t i = 0; res.size() < 4096; ++i) {
+        res += strprintf("p/player%u", i);
+        res += GetMoveValue(i);
+    }
+    return res;
+}
+
+std::unique_ptr<CDBWrapper> FillDB(const bool compression)
+{
+    DBTuning tuning;
+    tuning.compression = compression;
+    // Use a small block cache, so that most reads need to load (and
+    // possibly decompress) a block.
+    std::unique_ptr<CDBWrapper> db = MakeUnique<CDBWrapper>("bench-dbcompress", 1 << 16, true, false, false, tuning);
+    for (uint32_t i = 0; i < NUM_NAMES; ++i) {
+        db->Write(std::make_pair('n', i), GetMoveValue(i));
+    }
+    db->CompactRange(std::make_pair('n', uint32_t(0)), std::make_pair('n', NUM_NAMES));
+    return db;
+}
+
+void ReadDB(benchmark::State& state, const bool compression)
+{
+    const std::unique_ptr<CDBWrapper> db = FillDB(compression);
+    FastRandomContext rng(true);
+    std::string value;
+    while (state.KeepRunning()) {
+        bool ok = db->Read(std::make_pair('n', static_cast<uint32_t>(rng.randrange(NUM_NAMES))), value);
+        assert(ok);
+    }
+}
+
+} // anonymous namespace
+
+static void SnappyCompress(benchmark::State& state)
+{
+    const std::string input = GetBlockData();
+    std::string output(snappy::MaxCompressedLength(input.size()), '\0');
+    size_t len;
+    while (state.KeepRunning()) {
+        snappy::RawCompress(input.data(), input.size(), &output[0], &len);
+    }
+}
+
+static void SnappyUncompress(benchmark::State& state)
+{
+    const std::string input = GetBlockData();
+    std::string compressed(snappy::MaxCompressedLength(input.size()), '\0');
+    size_t len;
+    snappy::RawCompress(input.data(), input.size(), &compressed[0], &len);
+    std::string output(input.size(), '\0');
+    while (state.KeepRunning()) {
+        bool ok = snappy::RawUncompress(compressed.data(), len, &output[0]);
+        assert(ok);
+    }
+}
+
+static void DBReadUncompressed(benchmark::State& state)
+{
+    ReadDB(state, false);
+}
+
+static void DBReadCompressed(benchmark::State& state)
+{
+    ReadDB(state, true);
+}
+
+BENCHMARK(SnappyCompress, 20000);
+BENCHMARK(SnappyUncompress, 50000);
+BENCHMARK(DBReadUncompressed, 100000);
+BENCHMARK(DBReadCompressed, 100000);
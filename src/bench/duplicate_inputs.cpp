@@ -28,7 +28,6 @@ static void DuplicateInputs(benchmark::State& state)
     const CScript SCRIPT_PUB{CScript(OP_TRUE)};
 
     // Switch to regtest so we can mine faster
-    // Also segwit is active, so we can include witness transactions
     SelectParams(CBaseChainParams::REGTEST);
 
     InitScriptExecutionCache();
@@ -38,7 +37,7 @@ static void DuplicateInputs(benchmark::State& state)
     const CChainParams& chainparams = Params();
     {
         ::pblocktree.reset(new CBlockTreeDB(1 << 20, true));
-        ::pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+        ::pcoinsdbview.reset(new CCoinsViewDB(1 << 23, 1 << 20, true));
         ::pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
 
         thread_group.create_thread(std::bind(&CScheduler::serviceQueue, &scheduler));
@@ -47,8 +46,6 @@ static void DuplicateInputs(benchmark::State& state)
         CValidationState cvstate;
         ActivateBestChain(cvstate, chainparams);
         assert(::chainActive.Tip() != nullptr);
-        const bool witness_enabled{IsWitnessEnabled(::chainActive.Tip(), chainparams.GetConsensus())};
-        assert(witness_enabled);
     }
 
     CBlock block{};
@@ -84,6 +81,7 @@ static void DuplicateInputs(benchmark::State& state)
     block.vtx.push_back(MakeTransactionRef(std::move(naughtyTx)));
 
     block.hashMerkleRoot = BlockMerkleRoot(block);
+    block.pow.initFakeHeader(block);
 
     while (state.KeepRunning()) {
         CValidationState cvstate{};
@@ -0,0 +1,295 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <chainparams.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <dbwrapper.h>
+#include <names/common.h>
+#include <names/main.h>
+#include <primitives/transaction.h>
+#include <script/names.h>
+#include <tinyformat.h>
+#include <txdb.h>
+#include <txmempool.h>
+#include <undo.h>
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/** Number of name updates in the synthetic blocks.  */
+constexpr unsigned NUM_MOVES = 1000;
+/** Number of names in the populated name database.  */
+constexpr unsigned NUM_NAMES = 10000;
+/** Height at which the synthetic block is.  */
+constexpr unsigned BLOCK_HEIGHT = 100000;
+
+valtype ToValtype(const std::string& str)
+{
+    return valtype(str.begin(), str.end());
+}
+
+CScript GetTestAddress()
+{
+    return CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0x42) << OP_EQUALVERIFY << OP_CHECKSIG;
+}
+
+valtype GetPlayerName(const unsigned i)
+{
+    return ToValtype(strprintf("p/player%u", i));
+}
+
+/** Returns a name value as typically sent for a game move.  */
+valtype GetMoveValue(const unsigned i)
+{
+    return ToValtype(strprintf("{\"g\":{\"smc\":{\"m\":{\"c\":%u,\"d\":[%u,%u,%u],\"x\":\"sword\"}}}}",
+                               i, i % 7, i % 13, i % 29));
+}
+
+/**
+ * Name updates of distinct p/ names, as they are found in blocks that are
+ * mostly game moves.  The view holds the previous name outputs and the
+ * names' current state.
+ */
+struct MoveBlock {
+    CCoinsView dummy;
+    CCoinsViewCache view;
+    std::vector<CTransactionRef> txs;
+
+    MoveBlock() : view(&dummy)
+    {
+        const CScript addr = GetTestAddress();
+        for (unsigned i = 0; i < NUM_MOVES; ++i) {
+            const valtype name = GetPlayerName(i);
+
+            CMutableTransaction prev;
+            prev.vout.emplace_back(NAME_LOCKED_AMOUNT, CNameScript::buildNameUpdate(addr, name, GetMoveValue(0)));
+            const COutPoint prevOut(prev.GetHash(), 0);
+            view.AddCoin(prevOut, Coin(prev.vout[0], 1, false), false);
+
+            CNameData data;
+            data.fromScript(1, prevOut, CNameScript(prev.vout[0].scriptPubKey));
+            view.SetName(name, data, false);
+
+            CMutableTransaction mtx;
+            mtx.vin.emplace_back(prevOut);
+            mtx.vout.emplace_back(NAME_LOCKED_AMOUNT, CNameScript::buildNameUpdate(addr, name, GetMoveValue(i + 1)));
+            txs.push_back(MakeTransactionRef(mtx));
+        }
+    }
+};
+
+/** Returns a name cache with updates for the given number of names.  */
+CNameCache GetNameCache(const unsigned num, const unsigned offset)
+{
+    const CScript addr = GetTestAddress();
+    CNameCache cache;
+    for (unsigned i = 0; i < num; ++i) {
+        const valtype name = GetPlayerName(i + offset);
+        CNameData data;
+        data.fromScript(BLOCK_HEIGHT, COutPoint(), CNameScript(CNameScript::buildNameUpdate(addr, name, GetMoveValue(i))));
+        cache.set(name, data);
+    }
+    return cache;
+}
+
+} // anonymous namespace
+
+static void NameCheckTransactions(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    MoveBlock block;
+    while (state.KeepRunning()) {
+        for (const auto& tx : block.txs) {
+            CValidationState valState;
+            bool ok = CheckNameTransaction(*tx, BLOCK_HEIGHT, block.view, valState);
+            assert(ok);
+        }
+    }
+}
+
+static void NameApplyTransactions(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    MoveBlock block;
+    while (state.KeepRunning()) {
+        CCoinsViewCache view(&block.view);
+        CBlockUndo undo;
+        for (const auto& tx : block.txs) {
+            ApplyNameTransaction(*tx, BLOCK_HEIGHT, view, undo);
+        }
+        assert(undo.vnameundo.size() == NUM_MOVES);
+    }
+}
+
+static void NameCacheWriteBatch(benchmark::State& state)
+{
+    const CNameCache cache = GetNameCache(NUM_NAMES, 0);
+    CDBWrapper db("bench-names", 1 << 20, true, false, false);
+    while (state.KeepRunning()) {
+        CDBBatch batch(db);
+        cache.writeBatch(batch);
+        assert(batch.SizeEstimate() > 0);
+    }
+}
+
+static void NameCacheApply(benchmark::State& state)
+{
+    // Changes of one block applied to the chainstate's cache, which holds
+    // the changes of many blocks since the last flush.
+    CNameCache cache = GetNameCache(NUM_NAMES, 0);
+    const CNameCache changes = GetNameCache(NUM_MOVES, NUM_NAMES - NUM_MOVES / 2);
+    while (state.KeepRunning()) {
+        cache.apply(changes);
+    }
+}
+
+static void NameIterate(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    CCoinsViewDB db(1 << 23, 1 << 20, true, true);
+    CCoinsMap coins;
+    bool ok = db.BatchWrite(coins, uint256S("01"), GetNameCache(NUM_NAMES, 0));
+    assert(ok);
+
+    // Some changes on top, so that the iterator has to merge them in.
+    CCoinsViewCache view(&db);
+    view.BatchWrite(coins, uint256S("02"), GetNameCache(NUM_MOVES, NUM_NAMES - NUM_MOVES / 2));
+
+    while (state.KeepRunning()) {
+        std::unique_ptr<CNameIterator> iter(view.IterateNames());
+        iter->seek(valtype());
+        unsigned count = 0;
+        valtype name;
+        CNameData data;
+        while (iter->next(name, data)) {
+            ++count;
+        }
+        assert(count == NUM_NAMES + NUM_MOVES / 2);
+    }
+}
+
+static void NameIterateFiltered(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    CCoinsViewDB db(1 << 23, 1 << 20, true, true);
+    CCoinsMap coins;
+    bool ok = db.BatchWrite(coins, uint256S("01"), GetNameCache(NUM_NAMES, 0));
+    assert(ok);
+
+    CCoinsViewCache view(&db);
+    view.BatchWrite(coins, uint256S("02"), GetNameCache(NUM_MOVES, NUM_NAMES - NUM_MOVES / 2));
+
+    // A selective scan as done by name_scan with a prefix.
+    const valtype prefix = ToValtype("p/player99");
+    while (state.KeepRunning()) {
+        std::unique_ptr<CNameIterator> iter(view.IterateNames());
+        iter->setFilter([&prefix](const valtype& name, unsigned height) {
+            return name.size() >= prefix.size() && std::equal(prefix.begin(), prefix.end(), name.begin());
+        });
+        iter->seek(valtype());
+        unsigned count = 0;
+        valtype name;
+        CNameData data;
+        while (iter->next(name, data)) {
+            ++count;
+        }
+        assert(count == 111);
+    }
+}
+
+static void NameValueValidity(benchmark::State& state)
+{
+    // Roughly the mix seen on the Xaya mainnet:  mostly moves of players
+    // and some game-level names and larger admin commands.  Some of the
+    // payloads are invalid, which must be detected as well.
+    std::vector<valtype> names;
+    std::vector<valtype> values;
+    for (unsigned i = 0; i < 100; ++i) {
+        names.push_back(GetPlayerName(i));
+        values.push_back(GetMoveValue(i));
+    }
+    names.push_back(ToValtype(u8"p/Spieler äöü"));
+    names.push_back(ToValtype("g/smc"));
+    names.push_back(ToValtype("g/" + std::string(200, 'x')));
+    names.push_back(ToValtype("invalid"));
+    names.push_back(ToValtype("p/\xff\xfe"));
+    values.push_back(ToValtype("{}"));
+    values.push_back(ToValtype("{\"cmd\":{\"addons\":[" + std::string(1500, '1') + "]}}"));
+    values.push_back(ToValtype("{\"g\":{\"smc\":\"unterminated"));
+    values.push_back(ToValtype("[1,2,3]"));
+
+    while (state.KeepRunning()) {
+        for (const auto& name : names) {
+            CValidationState valState;
+            IsNameValid(name, valState);
+        }
+        for (const auto& value : values) {
+            CValidationState valState;
+            IsValueValid(value, valState);
+        }
+    }
+}
+
+static void NameMempool(benchmark::State& state)
+{
+    const CScript addr = GetTestAddress();
+    std::vector<CTransactionRef> registrations;
+    std::vector<CTransactionRef> conflicts;
+    std::vector<CTransactionRef> updates;
+    for (unsigned i = 0; i < 100; ++i) {
+        const valtype name = ToValtype(strprintf("p/new%u", i));
+        CMutableTransaction mtx;
+        mtx.vout.emplace_back(NAME_LOCKED_AMOUNT, CNameScript::buildNameRegister(addr, name, ToValtype("{}")));
+        registrations.push_back(MakeTransactionRef(mtx));
+        // A different registration of the same name, as found in a block.
+        mtx.vout.emplace_back(COIN, addr);
+        conflicts.push_back(MakeTransactionRef(mtx));
+    }
+    for (unsigned i = 0; i < 500; ++i) {
+        CMutableTransaction mtx;
+        mtx.vout.emplace_back(NAME_LOCKED_AMOUNT, CNameScript::buildNameUpdate(addr, GetPlayerName(i), GetMoveValue(i)));
+        updates.push_back(MakeTransactionRef(mtx));
+    }
+
+    CTxMemPool pool;
+    LOCK(pool.cs);
+    const LockPoints lp;
+    while (state.KeepRunning()) {
+        for (const auto& tx : registrations) {
+            pool.addUnchecked(CTxMemPoolEntry(tx, 0, 0, 1, false, 1, lp));
+        }
+        for (const auto& tx : updates) {
+            bool ok = pool.checkNameOps(*tx);
+            assert(ok);
+            pool.addUnchecked(CTxMemPoolEntry(tx, 0, 0, 1, false, 1, lp));
+        }
+        for (const auto& tx : conflicts) {
+            bool ok = pool.checkNameOps(*tx);
+            assert(!ok);
+            pool.removeConflicts(*tx);
+        }
+        for (const auto& tx : updates) {
+            pool.removeRecursive(*tx);
+        }
+        assert(pool.size() == 0);
+    }
+}
+
+BENCHMARK(NameCheckTransactions, 100);
+BENCHMARK(NameApplyTransactions, 100);
+BENCHMARK(NameCacheWriteBatch, 50);
+BENCHMARK(NameCacheApply, 500);
+BENCHMARK(NameIterate, 50);
+BENCHMARK(NameIterateFiltered, 50);
+BENCHMARK(NameValueValidity, 1000);
+BENCHMARK(NameMempool, 100);
@@ -197,6 +197,17 @@ bool GCSFilter::MatchAny(const ElementSet& elements) const
     return MatchInternal(queries.data(), queries.size());
 }
 
+static void AddUndoElements(GCSFilter::ElementSet& elements, const CBlockUndo& block_undo)
+{
+    for (const CTxUndo& tx_undo : block_undo.vtxundo) {
+        for (const Coin& prevout : tx_undo.vprevout) {
+            const CScript& script = prevout.out.scriptPubKey;
+            if (script.empty()) continue;
+            elements.emplace(script.begin(), script.end());
+        }
+    }
+}
+
 static GCSFilter::ElementSet BasicFilterElements(const CBlock& block,
                                                  const CBlockUndo& block_undo)
 {
@@ -210,14 +221,24 @@ static GCSFilter::ElementSet BasicFilterElements(const CBlock& block,
         }
     }
 
-    for (const CTxUndo& tx_undo : block_undo.vtxundo) {
-        for (const Coin& prevout : tx_undo.vprevout) {
-            const CScript& script = prevout.out.scriptPubKey;
-            if (script.empty()) continue;
+    AddUndoElements(elements, block_undo);
+    return elements;
+}
+
+static GCSFilter::ElementSet BasicFilterElements(const CBlockView& block,
+                                                 const CBlockUndo& block_undo)
+{
+    GCSFilter::ElementSet elements;
+
+    for (const CTransactionView& tx : block.GetTransactions()) {
+        for (const CTxOutView& txout : tx.Outputs()) {
+            const Span<const unsigned char>& script = txout.scriptPubKey;
+            if (script.size() == 0 || script[0] == OP_RETURN) continue;
             elements.emplace(script.begin(), script.end());
         }
     }
 
+    AddUndoElements(elements, block_undo);
     return elements;
 }
 
@@ -242,6 +263,16 @@ BlockFilter::BlockFilter(BlockFilterType filter_type, const CBlock& block, const
     m_filter = GCSFilter(params, BasicFilterElements(block, block_undo));
 }
 
+BlockFilter::BlockFilter(BlockFilterType filter_type, const CBlockView& block, const CBlockUndo& block_undo)
+    : m_filter_type(filter_type), m_block_hash(block.GetHeader().GetHash())
+{
+    GCSFilter::Params params;
+    if (!BuildParams(params)) {
+        throw std::invalid_argument("unknown filter_type");
+    }
+    m_filter = GCSFilter(params, BasicFilterElements(block, block_undo));
+}
+
 bool BlockFilter::BuildParams(GCSFilter::Params& params) const
 {
     switch (m_filter_type) {
@@ -10,6 +10,7 @@
 #include <vector>
 
 #include <primitives/block.h>
+#include <primitives/blockview.h>
 #include <serialize.h>
 #include <uint256.h>
 #include <undo.h>
@@ -111,6 +112,7 @@ public:
 
     //! Construct a new BlockFilter of the specified type from a block.
     BlockFilter(BlockFilterType filter_type, const CBlock& block, const CBlockUndo& block_undo);
+    BlockFilter(BlockFilterType filter_type, const CBlockView& block, const CBlockUndo& block_undo);
 
     BlockFilterType GetFilterType() const { return m_filter_type; }
     const uint256& GetBlockHash() const { return m_block_hash; }
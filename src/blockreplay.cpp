@@ -0,0 +1,240 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockreplay.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <consensus/consensus.h>
+#include <primitives/block.h>
+#include <protocol.h>
+#include <rpc/blockchain.h>
+#include <streams.h>
+#include <util/system.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationstats.h>
+
+#include <boost/thread.hpp>
+
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+
+namespace
+{
+
+/** Blocks whose parent has not been processed yet, by the parent's hash.  */
+using PendingBlocks = std::multimap<uint256, std::shared_ptr<const CBlock>>;
+
+/** Returns true if the block's parent is known to the block index.  */
+bool HaveParent(const CChainParams& chainparams, const CBlock& block)
+{
+    if (block.GetHash() == chainparams.GetConsensus().hashGenesisBlock)
+        return true;
+
+    LOCK(cs_main);
+    return LookupBlockIndex(block.hashPrevBlock) != nullptr;
+}
+
+/** Passes the block to ProcessNewBlock, followed by all pending blocks that
+ *  build on it.  */
+void ProcessBlock(const CChainParams& chainparams, std::shared_ptr<const CBlock> pblock, PendingBlocks& pending, BlockReplayStats& stats)
+{
+    std::deque<std::shared_ptr<const CBlock>> queue;
+    queue.push_back(std::move(pblock));
+    while (!queue.empty()) {
+        const std::shared_ptr<const CBlock> block = std::move(queue.front());
+        queue.pop_front();
+        const uint256 hash = block->GetHash();
+
+        bool fNewBlock = false;
+        if (!ProcessNewBlock(chainparams, block, true, &fNewBlock)) {
+            LogPrintf("%s: block %s was rejected\n", __func__, hash.ToString());
+            ++stats.rejected;
+            continue;
+        }
+        if (fNewBlock)
+            ++stats.accepted;
+
+        auto range = pending.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+            queue.push_back(std::move(it->second));
+        pending.erase(range.first, range.second);
+    }
+}
+
+/** Replays the blocks of one file.  The logic to find them is the same as
+ *  in LoadExternalBlockFile.  */
+bool ReplayFile(const CChainParams& chainparams, const fs::path& path, PendingBlocks& pending, BlockReplayStats& stats)
+{
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file)
+        return error("%s: failed to open %s", __func__, path.string());
+    LogPrintf("Replaying blocks from %s...\n", path.string());
+
+    // This takes over file and calls fclose() on it in the destructor.
+    CBufferedFile blkdat(file, 2 * MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE + 8, SER_DISK, CLIENT_VERSION);
+    uint64_t nRewind = blkdat.GetPos();
+    while (!blkdat.eof()) {
+        boost::this_thread::interruption_point();
+
+        blkdat.SetPos(nRewind);
+        nRewind++; // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        try {
+            // locate a header
+            unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+            blkdat.FindByte(chainparams.MessageStart()[0]);
+            nRewind = blkdat.GetPos() + 1;
+            blkdat >> buf;
+            if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                continue;
+            // read size
+            blkdat >> nSize;
+            if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                continue;
+        } catch (const std::exception&) {
+            // no valid block header found; don't complain
+            break;
+        }
+
+        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+        try {
+            const int64_t nTime1 = GetTimeMicros();
+            std::vector<unsigned char> data(nSize);
+            blkdat.read(reinterpret_cast<char*>(data.data()), data.size());
+            nRewind = blkdat.GetPos();
+            const int64_t nTime2 = GetTimeMicros();
+            g_validation_stats.Record(ValidationStage::REPLAY_READ, nTime2 - nTime1);
+
+            VectorReader reader(SER_DISK, CLIENT_VERSION, data, 0);
+            reader >> *pblock;
+            g_validation_stats.Record(ValidationStage::REPLAY_DESERIALIZE, GetTimeMicros() - nTime2);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+            continue;
+        }
+        ++stats.blocks;
+        stats.bytes += nSize;
+
+        if (!HaveParent(chainparams, *pblock)) {
+            LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__,
+                     pblock->GetHash().ToString(), pblock->hashPrevBlock.ToString());
+            pending.emplace(pblock->hashPrevBlock, std::move(pblock));
+            continue;
+        }
+        ProcessBlock(chainparams, std::move(pblock), pending, stats);
+    }
+
+    return true;
+}
+
+/** Returns the current tip's height and hash.  */
+void GetTip(int& height, uint256& hash)
+{
+    LOCK(cs_main);
+    const CBlockIndex* tip = chainActive.Tip();
+    height = tip == nullptr ? -1 : tip->nHeight;
+    hash = tip == nullptr ? uint256() : tip->GetBlockHash();
+}
+
+} // anonymous namespace
+
+std::vector<fs::path> GetBlockReplayFiles(const fs::path& path)
+{
+    if (!fs::is_directory(path))
+        return {path};
+
+    std::map<std::string, fs::path> mapFiles;
+    for (fs::directory_iterator it(path); it != fs::directory_iterator(); ++it) {
+        const std::string name = it->path().filename().string();
+        if (fs::is_regular_file(*it) && name.length() == 12 && name.substr(0, 3) == "blk" && name.substr(8, 4) == ".dat")
+            mapFiles.emplace(name, it->path());
+    }
+
+    std::vector<fs::path> res;
+    for (const auto& entry : mapFiles)
+        res.push_back(entry.second);
+    return res;
+}
+
+bool ReplayBlockFiles(const CChainParams& chainparams, const std::vector<fs::path>& files, BlockReplayStats& stats)
+{
+    stats = BlockReplayStats();
+    stats.chain = chainparams.NetworkIDString();
+    stats.files = files;
+    uint256 startTip;
+    GetTip(stats.start_height, startTip);
+
+    g_validation_stats.Reset();
+    const int64_t nStart = GetTimeMicros();
+
+    PendingBlocks pending;
+    bool fOk = true;
+    for (const fs::path& path : files) {
+        if (!ReplayFile(chainparams, path, pending, stats)) {
+            fOk = false;
+            break;
+        }
+    }
+    stats.orphans = pending.size();
+
+    const int64_t nFlushStart = GetTimeMicros();
+    FlushStateToDisk();
+    const int64_t nEnd = GetTimeMicros();
+    stats.flush_us = nEnd - nFlushStart;
+    stats.total_us = nEnd - nStart;
+
+    GetTip(stats.end_height, stats.end_tip);
+    LogPrintf("Replayed %u blocks (%u accepted, %u rejected, %u orphans) in %.2fs, tip is now at height %d\n",
+              stats.blocks, stats.accepted, stats.rejected, stats.orphans, stats.total_us * 0.000001, stats.end_height);
+
+    return fOk;
+}
+
+UniValue BlockReplayReport(const BlockReplayStats& stats)
+{
+    UniValue files(UniValue::VARR);
+    for (const fs::path& path : stats.files)
+        files.push_back(path.string());
+
+    const double seconds = stats.total_us * 0.000001;
+
+    UniValue res(UniValue::VOBJ);
+    res.pushKV("version", FormatFullVersion());
+    res.pushKV("chain", stats.chain);
+    res.pushKV("time", GetTime());
+    res.pushKV("files", files);
+    res.pushKV("blocks", stats.blocks);
+    res.pushKV("bytes", stats.bytes);
+    res.pushKV("accepted", stats.accepted);
+    res.pushKV("rejected", stats.rejected);
+    res.pushKV("orphans", stats.orphans);
+    res.pushKV("startheight", stats.start_height);
+    res.pushKV("endheight", stats.end_height);
+    res.pushKV("endtip", stats.end_tip.GetHex());
+    res.pushKV("totaltime", stats.total_us);
+    res.pushKV("flushtime", stats.flush_us);
+    res.pushKV("blockspersec", seconds > 0 ? stats.blocks / seconds : 0.0);
+    res.pushKV("bytespersec", seconds > 0 ? stats.bytes / seconds : 0.0);
+    res.pushKV("stages", validationStatsToJSON());
+
+    return res;
+}
+
+bool WriteBlockReplayReport(const fs::path& path, const UniValue& report)
+{
+    fsbridge::ofstream file(path);
+    if (!file.is_open())
+        return error("%s: failed to open %s", __func__, path.string());
+    file << report.write(4) << std::endl;
+    file.close();
+    if (file.fail())
+        return error("%s: failed to write %s", __func__, path.string());
+    return true;
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKREPLAY_H
+#define BITCOIN_BLOCKREPLAY_H
+
+#include <fs.h>
+#include <uint256.h>
+
+#include <univalue.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CChainParams;
+
+/** Summary of a run of ReplayBlockFiles, besides the stage timings.  */
+struct BlockReplayStats
+{
+    std::string chain;
+    std::vector<fs::path> files;
+
+    /** Blocks read from the files, and their total serialised size.  */
+    uint64_t blocks = 0;
+    uint64_t bytes = 0;
+    /** Blocks that were new and accepted by ProcessNewBlock.  */
+    uint64_t accepted = 0;
+    /** Blocks rejected by ProcessNewBlock.  */
+    uint64_t rejected = 0;
+    /** Blocks whose parent was never found in the files.  */
+    uint64_t orphans = 0;
+
+    int start_height = -1;
+    int end_height = -1;
+    uint256 end_tip;
+
+    /** Wall-clock time of the whole run and of the final flush.  */
+    int64_t total_us = 0;
+    int64_t flush_us = 0;
+};
+
+/**
+ * Returns the block files to replay for the given path, which is either a
+ * single file or a directory.  For a directory, these are all blk?????.dat
+ * files in it, in the order of their numbers.
+ */
+std::vector<fs::path> GetBlockReplayFiles(const fs::path& path);
+
+/**
+ * Replays all blocks from the given files (in the format written to the
+ * blocks directory) through ProcessNewBlock on top of the current chainstate,
+ * and flushes the chainstate at the end.  Blocks that come before their
+ * parent are kept in memory until the parent is processed.
+ *
+ * The validation stage timings are reset at the start, so that afterwards
+ * they cover just the replayed blocks.  Returns false if a file could not
+ * be read.
+ */
+bool ReplayBlockFiles(const CChainParams& chainparams, const std::vector<fs::path>& files, BlockReplayStats& stats);
+
+/** Returns the JSON report for a replay run with the current stage timings.  */
+UniValue BlockReplayReport(const BlockReplayStats& stats);
+
+/** Writes a replay report to the given file.  */
+bool WriteBlockReplayReport(const fs::path& path, const UniValue& report);
+
+#endif // BITCOIN_BLOCKREPLAY_H
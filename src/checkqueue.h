@@ -8,6 +8,9 @@
 #include <sync.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -25,12 +28,44 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Verifications are stored in a shared array and distributed as ranges of
+  * indices.  Every worker (and the master) owns such a range, from whose end
+  * it takes batches for itself.  Workers that run out of work steal half of
+  * the range of another worker from its beginning.  Both operations are
+  * lock-free; the mutex is only used when threads go to sleep or wake up.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! Number of verifications per storage segment
+    static constexpr uint32_t SEGMENT_SIZE = 1024;
+
+    //! Maximum number of storage segments, bounding the verifications per round
+    static constexpr uint32_t MAX_SEGMENTS = 1024;
+
+    //! Maximum number of threads (including the master) working on the queue
+    static constexpr int MAX_WORKERS = 256;
+
+    /**
+     * Range [begin, end) of verification indices owned by one worker.  Both
+     * ends are packed into a single atomic word, so that the owner and
+     * thieves can update them with one compare-and-swap.
+     */
+    struct WorkRange
+    {
+        std::atomic<uint64_t> range{0};
+        //! Keep the ranges of different workers in separate cache lines
+        char padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    static uint64_t Pack(uint32_t begin, uint32_t end) { return (uint64_t{begin} << 32) | end; }
+    static uint32_t Begin(uint64_t range) { return range >> 32; }
+    static uint32_t End(uint64_t range) { return range & 0xffffffff; }
+    static uint32_t Size(uint64_t range) { return End(range) - Begin(range); }
+
+    //! Mutex used by threads going to sleep and those waking them up
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,88 +74,117 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! Storage of the verifications, allocated in segments as needed.
+    //! Slots not belonging to the current round hold default-constructed T's.
+    std::unique_ptr<T[]> segments[MAX_SEGMENTS];
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! The work ranges, index 0 belongs to the master.
+    WorkRange ranges[MAX_WORKERS];
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The number of worker threads (excluding the master).
+    std::atomic<int> nWorkers{0};
 
-    //! The temporary evaluation result.
-    bool fAllOk;
+    //! The number of worker threads that are sleeping or about to sleep.
+    std::atomic<int> nIdle{0};
+
+    //! The number of verifications added in the current round (master only).
+    uint32_t nAdded{0};
 
     /**
      * Number of verifications that haven't completed yet.
-     * This includes elements that are no longer queued, but still in the
-     * worker's own batches.
+     * This includes elements that are no longer in any range, but still
+     * being processed by a worker.
      */
-    unsigned int nTodo;
+    std::atomic<uint32_t> nTodo{0};
+
+    //! The temporary evaluation result.
+    std::atomic<bool> fAllOk{true};
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
-    /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    T& Slot(uint32_t index) { return segments[index / SEGMENT_SIZE][index % SEGMENT_SIZE]; }
+
+    //! Takes a batch from the end of the given (own) range.
+    bool Pop(WorkRange& own, uint32_t& first, uint32_t& count)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
-        std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
-        do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
-            }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
-        } while (true);
+        uint64_t range = own.range.load();
+        while (Size(range) > 0) {
+            // Do not take everything at once, so that others can steal part of
+            // it, but don't do batches smaller than 1 or larger than nBatchSize.
+            count = std::max(1U, std::min<uint32_t>(nBatchSize, Size(range) / (nWorkers + 1)));
+            first = End(range) - count;
+            if (own.range.compare_exchange_weak(range, Pack(Begin(range), first)))
+                return true;
+        }
+        return false;
+    }
+
+    //! Steals the first half of the victim's range.
+    static bool Steal(WorkRange& victim, uint32_t& first, uint32_t& count)
+    {
+        uint64_t range = victim.range.load();
+        while (Size(range) > 0) {
+            count = (Size(range) + 1) / 2;
+            first = Begin(range);
+            if (victim.range.compare_exchange_weak(range, Pack(first + count, End(range))))
+                return true;
+        }
+        return false;
+    }
+
+    //! Returns true if any range holds work that can be taken.
+    bool HasWork() const
+    {
+        const int n = nWorkers;
+        for (int i = 0; i <= n; ++i)
+            if (Size(ranges[i].range.load()) > 0)
+                return true;
+        return false;
+    }
+
+    /**
+     * Finds the next batch of work for the worker with the given index,
+     * either from its own range or by stealing from others.
+     */
+    bool FindWork(int self, uint32_t& first, uint32_t& count)
+    {
+        WorkRange& own = ranges[self];
+        if (Pop(own, first, count))
+            return true;
+
+        // Start with the next worker, so that thieves spread out.
+        const int n = nWorkers + 1;
+        for (int i = 1; i < n; ++i) {
+            if (!Steal(ranges[(self + i) % n], first, count))
+                continue;
+            // Keep all but one batch in our own range, where others
+            // can steal it again.
+            own.range.store(Pack(first, first + count));
+            return Pop(own, first, count);
+        }
+        return false;
+    }
+
+    //! Runs and then destroys the given verifications.
+    void Execute(uint32_t first, uint32_t count)
+    {
+        // Check whether we need to do work at all
+        bool fOk = fAllOk;
+        for (uint32_t i = first; i < first + count; ++i) {
+            T check;
+            check.swap(Slot(i));
+            if (fOk)
+                fOk = check();
+        }
+        if (!fOk)
+            fAllOk = false;
+
+        if (nTodo.fetch_sub(count) == count) {
+            // We processed the last element; inform the master it can exit and return the result
+            boost::unique_lock<boost::mutex> lock(mutex);
+            condMaster.notify_one();
+        }
     }
 
 public:
@@ -128,33 +192,89 @@ public:
     boost::mutex ControlMutex;
 
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
+    explicit CCheckQueue(unsigned int nBatchSizeIn) : nBatchSize(nBatchSizeIn) {}
 
     //! Worker thread
     void Thread()
     {
-        Loop();
+        const int self = ++nWorkers;
+        assert(self < MAX_WORKERS);
+
+        uint32_t first, count;
+        while (true) {
+            if (FindWork(self, first, count)) {
+                Execute(first, count);
+                continue;
+            }
+
+            boost::unique_lock<boost::mutex> lock(mutex);
+            ++nIdle;
+            try {
+                while (!HasWork())
+                    condWorker.wait(lock);
+            } catch (...) {
+                --nIdle;
+                throw;
+            }
+            --nIdle;
+        }
     }
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait()
     {
-        return Loop(true);
+        uint32_t first, count;
+        while (true) {
+            if (FindWork(0, first, count)) {
+                Execute(first, count);
+                continue;
+            }
+
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (nTodo == 0)
+                break;
+            // Workers are busy with the remaining verifications.
+            if (!HasWork())
+                condMaster.wait(lock);
+        }
+
+        // reset the status for new work later
+        const bool fRet = fAllOk;
+        fAllOk = true;
+        nAdded = 0;
+        ranges[0].range.store(0);
+        return fRet;
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
+        if (vChecks.empty())
+            return;
+
+        const uint32_t nBegin = nAdded;
+        assert(vChecks.size() <= SEGMENT_SIZE * MAX_SEGMENTS - nBegin);
         for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+            if (nAdded % SEGMENT_SIZE == 0 && !segments[nAdded / SEGMENT_SIZE])
+                segments[nAdded / SEGMENT_SIZE].reset(new T[SEGMENT_SIZE]);
+            check.swap(Slot(nAdded++));
         }
         nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
-            condWorker.notify_all();
+
+        // Extend the master's range; workers may steal from its beginning
+        // concurrently, but only the master changes its end.
+        WorkRange& own = ranges[0];
+        uint64_t range = own.range.load();
+        assert(End(range) == nBegin);
+        while (!own.range.compare_exchange_weak(range, Pack(Begin(range), nAdded))) {}
+
+        if (nIdle > 0) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (vChecks.size() == 1)
+                condWorker.notify_one();
+            else
+                condWorker.notify_all();
+        }
     }
 
     ~CCheckQueue()
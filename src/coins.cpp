@@ -157,10 +157,13 @@ bool CCoinsViewCache::GetName(const valtype &name, CNameData& data) const {
     if (cacheNames.get(name, data))
         return true;
 
-    /* Note: This does not attempt to cache name queries.  The cache
-       only keeps track of changes!  */
+    bool found;
+    if (readNames.get(name, found, data))
+        return found;
 
-    return base->GetName(name, data);
+    found = base->GetName(name, data);
+    readNames.add(name, found ? &data : nullptr);
+    return found;
 }
 
 bool CCoinsViewCache::GetNameHistory(const valtype &name, CNameHistory& data) const {
@@ -211,6 +214,7 @@ void CCoinsViewCache::SetName(const valtype &name, const CNameData& data, bool u
     } else
         assert (!undo);
 
+    readNames.invalidate(name);
     cacheNames.set(name, data);
 }
 
@@ -225,6 +229,7 @@ void CCoinsViewCache::DeleteName(const valtype &name) {
         assert (!GetNameHistory(name, history) || history.empty());
     }
 
+    readNames.invalidate(name);
     cacheNames.remove(name);
 }
 
@@ -283,6 +288,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
         }
     }
     hashBlock = hashBlockIn;
+    readNames.invalidate(names);
     cacheNames.apply(names);
     return true;
 }
@@ -232,6 +232,18 @@ protected:
     /** Name changes cache.  */
     CNameCache cacheNames;
 
+    /**
+     * Clean names read from the base view.  This is only enabled for the
+     * chainstate cache itself (the base view must not be changed other
+     * than through this cache while it is).  It is not flushed and not
+     * counted in DynamicMemoryUsage(), but bounded on its own.
+     *
+     * Since lookups through GetName modify it even though GetName is const,
+     * it must not be accessed concurrently.  For pcoinsTip, this means that
+     * GetName must be called with cs_main held, like all other accesses.
+     */
+    mutable CNameReadCache readNames;
+
 public:
     CCoinsViewCache(CCoinsView *baseIn);
 
@@ -257,6 +269,10 @@ public:
     void SetName(const valtype &name, const CNameData &data, bool undo);
     void DeleteName(const valtype &name);
 
+    /** Sets the memory limit of the name read cache (zero disables it).  */
+    void SetNameReadCacheSize(size_t nSize) { readNames.setMaxUsage(nSize); }
+    CNameReadCache::Stats GetNameReadCacheStats() const { return readNames.getStats(); }
+
     /**
      * Check if we have the given utxo already loaded in this cache.
      * The semantics are the same as HaveCoin(), but no calls to
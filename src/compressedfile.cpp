@@ -0,0 +1,223 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <compressedfile.h>
+
+#include <clientversion.h>
+#include <dbcompress/snappy.h>
+#include <hash.h>
+#include <util/system.h>
+
+#include <algorithm>
+#include <ios>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+
+const uint32_t CONTAINER_MAGIC = 0x46424358; // "XCBF" in little endian
+const uint32_t CONTAINER_VERSION = 1;
+
+uint64_t GetNumFrames(const uint64_t nSize)
+{
+    return (nSize + CCompressedFile::FRAME_SIZE - 1) / CCompressedFile::FRAME_SIZE;
+}
+
+/** Returns the uncompressed size of frame n in a file of size nSize.  */
+size_t GetFrameSize(const uint64_t nSize, const uint64_t n)
+{
+    return std::min<uint64_t>(CCompressedFile::FRAME_SIZE, nSize - n * CCompressedFile::FRAME_SIZE);
+}
+
+template <typename Stream, typename Offsets>
+void SerializeHeader(Stream& s, uint64_t nSize, Offsets& vOffsets, uint256& hash)
+{
+    s << CONTAINER_MAGIC << CONTAINER_VERSION << nSize << vOffsets << hash;
+}
+
+} // anonymous namespace
+
+CCompressedFile::CCompressedFile(const fs::path& path)
+    : file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION), nSize(0), nFrame(std::numeric_limits<uint64_t>::max())
+{
+    if (file.IsNull()) {
+        return;
+    }
+
+    try {
+        uint32_t nMagic, nVersion;
+        file >> nMagic >> nVersion >> nSize >> vOffsets >> hash;
+        if (nMagic != CONTAINER_MAGIC || nVersion != CONTAINER_VERSION) {
+            throw std::runtime_error("unknown container format");
+        }
+        if (vOffsets.size() != GetNumFrames(nSize) + 1) {
+            throw std::runtime_error("frame index does not match the size");
+        }
+        for (size_t i = 1; i < vOffsets.size(); ++i) {
+            if (vOffsets[i] < vOffsets[i - 1]) {
+                throw std::runtime_error("frame offsets are not ordered");
+            }
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("%s: Invalid compressed file %s: %s\n", __func__, path.string(), e.what());
+        file.fclose();
+    }
+}
+
+bool CCompressedFile::LoadFrame(const uint64_t n)
+{
+    if (nFrame == n) {
+        return true;
+    }
+    const size_t nExpected = GetFrameSize(nSize, n);
+
+    const uint64_t nCompressed = vOffsets[n + 1] - vOffsets[n];
+    if (nCompressed > snappy::MaxCompressedLength(FRAME_SIZE)) {
+        return error("%s: frame %u is too large", __func__, n);
+    }
+    std::vector<char> compressed(nCompressed);
+    if (fseek(file.Get(), vOffsets[n], SEEK_SET) != 0) {
+        return error("%s: failed to seek to frame %u", __func__, n);
+    }
+    try {
+        file.read(compressed.data(), compressed.size());
+    } catch (const std::exception& e) {
+        return error("%s: failed to read frame %u: %s", __func__, n, e.what());
+    }
+
+    size_t nUncompressed;
+    if (!snappy::GetUncompressedLength(compressed.data(), compressed.size(), &nUncompressed) || nUncompressed != nExpected) {
+        return error("%s: frame %u has the wrong size", __func__, n);
+    }
+    nFrame = std::numeric_limits<uint64_t>::max();
+    vFrame.resize(nUncompressed);
+    if (!snappy::RawUncompress(compressed.data(), compressed.size(), reinterpret_cast<char*>(vFrame.data()))) {
+        return error("%s: frame %u is corrupt", __func__, n);
+    }
+    nFrame = n;
+
+    return true;
+}
+
+bool CCompressedFile::Read(uint64_t offset, unsigned char* out, size_t len)
+{
+    if (IsNull() || offset > nSize || len > nSize - offset) {
+        return false;
+    }
+
+    while (len > 0) {
+        const uint64_t n = offset / FRAME_SIZE;
+        if (!LoadFrame(n)) {
+            return false;
+        }
+        const size_t nStart = offset - n * FRAME_SIZE;
+        const size_t nNow = std::min(len, vFrame.size() - nStart);
+        memcpy(out, vFrame.data() + nStart, nNow);
+        out += nNow;
+        offset += nNow;
+        len -= nNow;
+    }
+
+    return true;
+}
+
+bool CCompressedFile::Extract(FILE* out)
+{
+    if (IsNull()) {
+        return false;
+    }
+
+    CHash256 hasher;
+    for (uint64_t n = 0; n + 1 < vOffsets.size(); ++n) {
+        if (!LoadFrame(n)) {
+            return false;
+        }
+        hasher.Write(vFrame.data(), vFrame.size());
+        if (out != nullptr && fwrite(vFrame.data(), 1, vFrame.size(), out) != vFrame.size()) {
+            return error("%s: failed to write the extracted data", __func__);
+        }
+    }
+
+    uint256 actual;
+    hasher.Finalize(actual.begin());
+    if (actual != hash) {
+        return error("%s: checksum mismatch", __func__);
+    }
+
+    return true;
+}
+
+bool CCompressedFile::Create(const fs::path& src, const fs::path& dest)
+{
+    CAutoFile filein(fsbridge::fopen(src, "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        return error("%s: failed to open %s", __func__, src.string());
+    }
+    if (fseek(filein.Get(), 0, SEEK_END) != 0) {
+        return error("%s: failed to seek in %s", __func__, src.string());
+    }
+    const long nFileSize = ftell(filein.Get());
+    if (nFileSize < 0 || fseek(filein.Get(), 0, SEEK_SET) != 0) {
+        return error("%s: failed to get the size of %s", __func__, src.string());
+    }
+    const uint64_t nSize = nFileSize;
+
+    const fs::path tmp = dest.string() + ".new";
+    try {
+        CAutoFile fileout(fsbridge::fopen(tmp, "wb"), SER_DISK, CLIENT_VERSION);
+        if (fileout.IsNull()) {
+            return error("%s: failed to open %s", __func__, tmp.string());
+        }
+
+        // The header is written with placeholder offsets first, and rewritten
+        // once they are known.  It has the same size either way.
+        std::vector<uint64_t> vOffsets(GetNumFrames(nSize) + 1);
+        uint256 hash;
+        SerializeHeader(fileout, nSize, vOffsets, hash);
+        vOffsets[0] = ftell(fileout.Get());
+
+        CHash256 hasher;
+        std::vector<char> frame(FRAME_SIZE);
+        std::vector<char> compressed(snappy::MaxCompressedLength(FRAME_SIZE));
+        for (uint64_t n = 0; n + 1 < vOffsets.size(); ++n) {
+            const size_t len = GetFrameSize(nSize, n);
+            filein.read(frame.data(), len);
+            hasher.Write(reinterpret_cast<const unsigned char*>(frame.data()), len);
+
+            size_t nCompressed;
+            snappy::RawCompress(frame.data(), len, compressed.data(), &nCompressed);
+            fileout.write(compressed.data(), nCompressed);
+            vOffsets[n + 1] = vOffsets[n] + nCompressed;
+        }
+        hasher.Finalize(hash.begin());
+
+        // Failures throw, so that the partial file is removed below after
+        // fileout has been closed.
+        if (fseek(fileout.Get(), 0, SEEK_SET) != 0) {
+            throw std::ios_base::failure("failed to seek in " + tmp.string());
+        }
+        SerializeHeader(fileout, nSize, vOffsets, hash);
+        if (!FileCommit(fileout.Get())) {
+            throw std::ios_base::failure("failed to flush " + tmp.string());
+        }
+    } catch (const std::exception& e) {
+        fs::remove(tmp);
+        return error("%s: failed to compress %s: %s", __func__, src.string(), e.what());
+    }
+
+    // Make sure that the data can be read back before the caller removes
+    // the original file.
+    if (!CCompressedFile(tmp).Extract(nullptr)) {
+        fs::remove(tmp);
+        return error("%s: failed to verify %s", __func__, tmp.string());
+    }
+
+    if (!RenameOver(tmp, dest)) {
+        fs::remove(tmp);
+        return error("%s: failed to rename %s", __func__, tmp.string());
+    }
+
+    return true;
+}
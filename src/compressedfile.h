@@ -0,0 +1,74 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COMPRESSEDFILE_H
+#define BITCOIN_COMPRESSEDFILE_H
+
+#include <fs.h>
+#include <streams.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/**
+ * Seekable container holding a compressed copy of a block or undo file.
+ *
+ * The original file is split into frames of FRAME_SIZE bytes, which are
+ * compressed independently (in the Snappy format).  The header holds the
+ * offsets of all frames in the container, so that any byte range of the
+ * original file can be read by decompressing just the frames it overlaps.
+ * This keeps random block reads cheap, while files that are consumed as a
+ * whole (e.g. for -reindex) can still be extracted completely.
+ */
+class CCompressedFile
+{
+public:
+    /** Size of the uncompressed frames.  */
+    static const uint32_t FRAME_SIZE = 1 << 16;
+
+    /** Opens the container at path for reading.  Use IsNull() to check
+     *  whether that was successful.  */
+    explicit CCompressedFile(const fs::path& path);
+
+    CCompressedFile(const CCompressedFile&) = delete;
+    CCompressedFile& operator=(const CCompressedFile&) = delete;
+
+    bool IsNull() const { return file.IsNull(); }
+
+    /** Returns the size of the original file.  */
+    uint64_t GetSize() const { return nSize; }
+
+    /** Reads len bytes of the original file starting at offset.  */
+    bool Read(uint64_t offset, unsigned char* out, size_t len);
+
+    /** Writes the whole original file to out and verifies its checksum.  */
+    bool Extract(FILE* out);
+
+    /**
+     * Compresses the file at src into a container at dest.  The container
+     * is written to a temporary file, verified and then moved into place,
+     * so that dest is either missing or complete.
+     */
+    static bool Create(const fs::path& src, const fs::path& dest);
+
+private:
+    CAutoFile file;
+
+    uint64_t nSize;
+    /** Offsets of the frames in the container, plus the end of the last.  */
+    std::vector<uint64_t> vOffsets;
+    /** Double-SHA256 of the original data.  */
+    uint256 hash;
+
+    /** The most recently decompressed frame, which is kept around since
+     *  consecutive reads often touch the same frame.  */
+    std::vector<unsigned char> vFrame;
+    uint64_t nFrame;
+
+    bool LoadFrame(uint64_t n);
+};
+
+#endif // BITCOIN_COMPRESSEDFILE_H
@@ -15,6 +15,9 @@
 #include <coins.h>
 #include <util/moneystr.h>
 
+#include <algorithm>
+#include <vector>
+
 bool IsFinalTx(const CTransaction &tx, int nBlockHeight, int64_t nBlockTime)
 {
     if (tx.nLockTime == 0)
@@ -182,13 +185,16 @@ bool CheckTransaction(const CTransaction& tx, CValidationState &state, bool fChe
     }
 
     // Check for duplicate inputs - note that this check is slow so we skip it in CheckBlock
+    // (sorting a flat copy of the outpoints is much faster than a std::set for
+    // transactions with many inputs)
     if (fCheckDuplicateInputs) {
-        std::set<COutPoint> vInOutPoints;
+        std::vector<COutPoint> vInOutPoints;
+        vInOutPoints.reserve(tx.vin.size());
         for (const auto& txin : tx.vin)
-        {
-            if (!vInOutPoints.insert(txin.prevout).second)
-                return state.DoS(100, false, REJECT_INVALID, "bad-txns-inputs-duplicate");
-        }
+            vInOutPoints.push_back(txin.prevout);
+        std::sort(vInOutPoints.begin(), vInOutPoints.end());
+        if (std::adjacent_find(vInOutPoints.begin(), vInOutPoints.end()) != vInOutPoints.end())
+            return state.DoS(100, false, REJECT_INVALID, "bad-txns-inputs-duplicate");
     }
 
     if (tx.IsCoinBase())
@@ -27,6 +27,7 @@ void Transform_4way(unsigned char* out, const unsigned char* in);
 namespace sha256d64_avx2
 {
 void Transform_8way(unsigned char* out, const unsigned char* in);
+void Transform_8way_multi(uint32_t* s, const unsigned char* const* chunks);
 }
 
 namespace sha256d64_shani
@@ -416,6 +417,7 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -461,6 +463,9 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+/** Compresses one independent block into each of 8 interleaved states
+ *  (word i of lane j is at s[8 * i + j]). */
+TransformMultiType TransformMulti_8way = nullptr;
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -544,6 +549,23 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformMulti_8way, if available. Lane i continues from the state
+    // after i blocks and should end up at the state after i + 1 blocks.
+    if (TransformMulti_8way) {
+        uint32_t states[64];
+        const unsigned char* chunks[8];
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 8; ++j) states[8 * j + i] = result[i][j];
+            chunks[i] = data + 1 + 64 * i;
+        }
+        TransformMulti_8way(states, chunks);
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 8; ++j) {
+                if (states[8 * j + i] != result[i + 1][j]) return false;
+            }
+        }
+    }
+
     return true;
 }
 
@@ -629,6 +651,7 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformMulti_8way = sha256d64_avx2::Transform_8way_multi;
         ret += ",avx2(8way)";
     }
 #endif
@@ -728,3 +751,169 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+namespace
+{
+
+/** One lane of the multi-buffer double-SHA256 in SHA256DMulti. */
+struct MultiLane
+{
+    bool active = false;
+    /** Index of the message in this lane. */
+    size_t msg = 0;
+    /** True while computing the outer hash (of the 32-byte inner digest). */
+    bool outer = false;
+    /** Next full block that is read directly from the message. */
+    const unsigned char* data = nullptr;
+    size_t full_blocks = 0;
+    /** The final, padded blocks. */
+    unsigned char tail[128];
+    size_t tail_blocks = 0;
+    size_t tail_pos = 0;
+
+    const unsigned char* NextBlock() const
+    {
+        return full_blocks > 0 ? data : tail + 64 * tail_pos;
+    }
+
+    /** Advances past the block returned by NextBlock, and returns true if
+     *  the current (inner or outer) hash is complete afterwards. */
+    bool Advance()
+    {
+        if (full_blocks > 0) {
+            data += 64;
+            --full_blocks;
+            return false;
+        }
+        return ++tail_pos == tail_blocks;
+    }
+
+    void StartInner(size_t index, const unsigned char* in, size_t len)
+    {
+        active = true;
+        msg = index;
+        outer = false;
+        data = in;
+        full_blocks = len / 64;
+        const size_t rem = len % 64;
+        tail_blocks = rem + 9 <= 64 ? 1 : 2;
+        tail_pos = 0;
+        memcpy(tail, in + 64 * full_blocks, rem);
+        memset(tail + rem, 0, 64 * tail_blocks - rem);
+        tail[rem] = 0x80;
+        WriteBE64(tail + 64 * tail_blocks - 8, static_cast<uint64_t>(len) << 3);
+    }
+
+    /** Starts the outer hash; tail must already hold the inner digest. */
+    void StartOuter()
+    {
+        outer = true;
+        full_blocks = 0;
+        tail_blocks = 1;
+        tail_pos = 0;
+        memset(tail + 32, 0, 32);
+        tail[32] = 0x80;
+        WriteBE64(tail + 56, 256);
+    }
+};
+
+void GetLaneState(const uint32_t* states, int lane, uint32_t* s)
+{
+    for (int i = 0; i < 8; ++i) s[i] = states[8 * i + lane];
+}
+
+void SetLaneState(uint32_t* states, int lane, const uint32_t* s)
+{
+    for (int i = 0; i < 8; ++i) states[8 * i + lane] = s[i];
+}
+
+void WriteState(unsigned char* out, const uint32_t* s)
+{
+    for (int i = 0; i < 8; ++i) WriteBE32(out + 4 * i, s[i]);
+}
+
+/** Finishes the message in a lane with the single-buffer Transform. */
+void FinishLane(MultiLane& lane, uint32_t* s, unsigned char* out)
+{
+    while (true) {
+        if (lane.full_blocks > 0) Transform(s, lane.data, lane.full_blocks);
+        Transform(s, lane.tail + 64 * lane.tail_pos, lane.tail_blocks - lane.tail_pos);
+        if (lane.outer) break;
+        WriteState(lane.tail, s);
+        lane.StartOuter();
+        sha256::Initialize(s);
+    }
+    WriteState(out + 32 * lane.msg, s);
+    lane.active = false;
+}
+
+/** Below this many busy lanes, the remaining messages are finished one by
+ *  one, which is cheaper than an 8-way transform with mostly idle lanes. */
+constexpr int MIN_BUSY_LANES = 3;
+
+void SHA256DMulti_8way(unsigned char* out, const unsigned char* const* in, const size_t* lens, size_t count)
+{
+    static const unsigned char idle_block[64] = {};
+    uint32_t init[8];
+    sha256::Initialize(init);
+
+    MultiLane lanes[8];
+    uint32_t states[64];
+    size_t next = 0;
+    int busy = 0;
+
+    while (true) {
+        const unsigned char* chunks[8];
+        for (int i = 0; i < 8; ++i) {
+            MultiLane& lane = lanes[i];
+            if (!lane.active && next < count) {
+                lane.StartInner(next, in[next], lens[next]);
+                SetLaneState(states, i, init);
+                ++next;
+                ++busy;
+            }
+            chunks[i] = !lane.active ? idle_block : lane.NextBlock();
+        }
+
+        if (busy < MIN_BUSY_LANES) break;
+        TransformMulti_8way(states, chunks);
+
+        for (int i = 0; i < 8; ++i) {
+            MultiLane& lane = lanes[i];
+            if (!lane.active || !lane.Advance()) continue;
+            uint32_t s[8];
+            GetLaneState(states, i, s);
+            if (lane.outer) {
+                WriteState(out + 32 * lane.msg, s);
+                lane.active = false;
+                --busy;
+            } else {
+                WriteState(lane.tail, s);
+                lane.StartOuter();
+                SetLaneState(states, i, init);
+            }
+        }
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        if (!lanes[i].active) continue;
+        uint32_t s[8];
+        GetLaneState(states, i, s);
+        FinishLane(lanes[i], s, out);
+    }
+}
+
+} // namespace
+
+void SHA256DMulti(unsigned char* out, const unsigned char* const* in, const size_t* lens, size_t count)
+{
+    if (TransformMulti_8way && count >= MIN_BUSY_LANES) {
+        SHA256DMulti_8way(out, in, lens, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        unsigned char inner[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(in[i], lens[i]).Finalize(inner);
+        CSHA256().Write(inner, sizeof(inner)).Finalize(out + 32 * i);
+    }
+}
@@ -38,4 +38,14 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute the double-SHA256's of multiple messages of arbitrary length,
+ *  interleaving them over the SIMD lanes if a multi-buffer implementation
+ *  is available.
+ *  output:  pointer to a count*32 byte output buffer
+ *  inputs:  pointers to the count messages
+ *  lengths: the length in bytes of each message
+ *  count:   the number of hashes to compute.
+ */
+void SHA256DMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
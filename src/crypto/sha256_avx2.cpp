@@ -320,6 +320,82 @@ void Transform_8way(unsigned char* out, const unsigned char* in)
     Write8(out, 28, Add(h, K(0x5be0cd19ul)));
 }
 
+
+namespace {
+
+const uint32_t ROUND_CONSTANTS[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul,
+};
+
+/** Reads word i of the 8 independent chunks, one per lane. */
+__m256i inline ReadLanes(const unsigned char* const* chunks, int i) {
+    __m256i ret = _mm256_set_epi32(
+        ReadLE32(chunks[7] + 4 * i),
+        ReadLE32(chunks[6] + 4 * i),
+        ReadLE32(chunks[5] + 4 * i),
+        ReadLE32(chunks[4] + 4 * i),
+        ReadLE32(chunks[3] + 4 * i),
+        ReadLE32(chunks[2] + 4 * i),
+        ReadLE32(chunks[1] + 4 * i),
+        ReadLE32(chunks[0] + 4 * i)
+    );
+    return _mm256_shuffle_epi8(ret, _mm256_set_epi32(0x0C0D0E0FUL, 0x08090A0BUL, 0x04050607UL, 0x00010203UL, 0x0C0D0E0FUL, 0x08090A0BUL, 0x04050607UL, 0x00010203UL));
+}
+
+/** Returns message schedule word i, expanding it in place for i >= 16. */
+__m256i inline __attribute__((always_inline)) Schedule(__m256i* w, int i) {
+    if (i >= 16) {
+        Inc(w[i & 15], sigma1(w[(i - 2) & 15]), w[(i - 7) & 15], sigma0(w[(i - 15) & 15]));
+    }
+    return w[i & 15];
+}
+
+}
+
+void Transform_8way_multi(uint32_t* s, const unsigned char* const* chunks)
+{
+    __m256i a = _mm256_loadu_si256((const __m256i*)(s + 0));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(s + 8));
+    __m256i c = _mm256_loadu_si256((const __m256i*)(s + 16));
+    __m256i d = _mm256_loadu_si256((const __m256i*)(s + 24));
+    __m256i e = _mm256_loadu_si256((const __m256i*)(s + 32));
+    __m256i f = _mm256_loadu_si256((const __m256i*)(s + 40));
+    __m256i g = _mm256_loadu_si256((const __m256i*)(s + 48));
+    __m256i h = _mm256_loadu_si256((const __m256i*)(s + 56));
+
+    __m256i w[16];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = ReadLanes(chunks, i);
+    }
+
+    for (int i = 0; i < 64; i += 8) {
+        Round(a, b, c, d, e, f, g, h, Add(K(ROUND_CONSTANTS[i + 0]), Schedule(w, i + 0)));
+        Round(h, a, b, c, d, e, f, g, Add(K(ROUND_CONSTANTS[i + 1]), Schedule(w, i + 1)));
+        Round(g, h, a, b, c, d, e, f, Add(K(ROUND_CONSTANTS[i + 2]), Schedule(w, i + 2)));
+        Round(f, g, h, a, b, c, d, e, Add(K(ROUND_CONSTANTS[i + 3]), Schedule(w, i + 3)));
+        Round(e, f, g, h, a, b, c, d, Add(K(ROUND_CONSTANTS[i + 4]), Schedule(w, i + 4)));
+        Round(d, e, f, g, h, a, b, c, Add(K(ROUND_CONSTANTS[i + 5]), Schedule(w, i + 5)));
+        Round(c, d, e, f, g, h, a, b, Add(K(ROUND_CONSTANTS[i + 6]), Schedule(w, i + 6)));
+        Round(b, c, d, e, f, g, h, a, Add(K(ROUND_CONSTANTS[i + 7]), Schedule(w, i + 7)));
+    }
+
+    _mm256_storeu_si256((__m256i*)(s + 0), Add(a, _mm256_loadu_si256((const __m256i*)(s + 0))));
+    _mm256_storeu_si256((__m256i*)(s + 8), Add(b, _mm256_loadu_si256((const __m256i*)(s + 8))));
+    _mm256_storeu_si256((__m256i*)(s + 16), Add(c, _mm256_loadu_si256((const __m256i*)(s + 16))));
+    _mm256_storeu_si256((__m256i*)(s + 24), Add(d, _mm256_loadu_si256((const __m256i*)(s + 24))));
+    _mm256_storeu_si256((__m256i*)(s + 32), Add(e, _mm256_loadu_si256((const __m256i*)(s + 32))));
+    _mm256_storeu_si256((__m256i*)(s + 40), Add(f, _mm256_loadu_si256((const __m256i*)(s + 40))));
+    _mm256_storeu_si256((__m256i*)(s + 48), Add(g, _mm256_loadu_si256((const __m256i*)(s + 48))));
+    _mm256_storeu_si256((__m256i*)(s + 56), Add(h, _mm256_loadu_si256((const __m256i*)(s + 56))));
+}
+
 }
 
 #endif
@@ -0,0 +1,293 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <dbcompress/snappy.h>
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * The Snappy format consists of the uncompressed length as varint, followed
+ * by a sequence of elements.  The low two bits of each element's tag byte
+ * determine its type:
+ *
+ *  00: Literal.  The upper six bits hold length-1 for lengths up to 60.
+ *      Values 60..63 mean that length-1 follows in 1..4 little-endian bytes.
+ *  01: Copy of 4..11 bytes with an 11-bit offset.  Bits 2..4 hold length-4,
+ *      bits 5..7 the upper bits of the offset and one byte follows with its
+ *      lower bits.
+ *  10: Copy of 1..64 bytes (length-1 in the upper six bits) with a 16-bit
+ *      little-endian offset following.
+ *  11: Like 10, but with a 32-bit offset.
+ *
+ * Offsets count back from the current end of the output; copies may overlap
+ * with the bytes they produce.
+ */
+
+namespace {
+
+/** The input is compressed in independent fragments of this size, so that
+ *  positions and offsets fit into 16 bits.  */
+constexpr size_t FRAGMENT_SIZE = 1 << 16;
+
+constexpr int HASH_BITS = 14;
+
+/** Matches shorter than this are not worth a copy element.  */
+constexpr size_t MIN_MATCH = 4;
+
+/** Maximal length of a single copy element.  */
+constexpr size_t MAX_COPY = 64;
+
+enum ElementType : uint8_t {
+    LITERAL = 0,
+    COPY_1_BYTE_OFFSET = 1,
+    COPY_2_BYTE_OFFSET = 2,
+    COPY_4_BYTE_OFFSET = 3,
+};
+
+uint32_t Load32(const char* p)
+{
+    uint32_t res;
+    memcpy(&res, p, sizeof(res));
+    return res;
+}
+
+uint32_t HashBytes(const uint32_t bytes)
+{
+    return (bytes * 0x1e35a7bd) >> (32 - HASH_BITS);
+}
+
+char* EmitVarint32(char* out, uint32_t value)
+{
+    while (value >= 0x80) {
+        *out++ = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<char>(value);
+    return out;
+}
+
+char* EmitLiteral(char* out, const char* literal, const size_t len)
+{
+    const uint32_t n = len - 1;
+    if (n < 60) {
+        *out++ = static_cast<char>(LITERAL | (n << 2));
+    } else {
+        int bytes = 1;
+        while (bytes < 4 && (n >> (8 * bytes)) != 0) {
+            ++bytes;
+        }
+        *out++ = static_cast<char>(LITERAL | ((59 + bytes) << 2));
+        for (int i = 0; i < bytes; ++i) {
+            *out++ = static_cast<char>(n >> (8 * i));
+        }
+    }
+    memcpy(out, literal, len);
+    return out + len;
+}
+
+char* EmitCopyUpTo64(char* out, const size_t offset, const size_t len)
+{
+    if (len >= 4 && len < 12 && offset < 2048) {
+        *out++ = static_cast<char>(COPY_1_BYTE_OFFSET | ((len - 4) << 2) | ((offset >> 8) << 5));
+        *out++ = static_cast<char>(offset & 0xff);
+    } else {
+        *out++ = static_cast<char>(COPY_2_BYTE_OFFSET | ((len - 1) << 2));
+        *out++ = static_cast<char>(offset & 0xff);
+        *out++ = static_cast<char>(offset >> 8);
+    }
+    return out;
+}
+
+char* EmitCopy(char* out, const size_t offset, size_t len)
+{
+    // Split long copies into elements of at most 64 bytes, keeping the last
+    // one at least four bytes long so that it can use the short form.
+    while (len >= MAX_COPY + MIN_MATCH) {
+        out = EmitCopyUpTo64(out, offset, MAX_COPY);
+        len -= MAX_COPY;
+    }
+    if (len > MAX_COPY) {
+        out = EmitCopyUpTo64(out, offset, MAX_COPY - MIN_MATCH);
+        len -= MAX_COPY - MIN_MATCH;
+    }
+    return EmitCopyUpTo64(out, offset, len);
+}
+
+/** Compresses a single fragment of at most FRAGMENT_SIZE bytes.  */
+char* CompressFragment(const char* input, const size_t len, char* out)
+{
+    uint16_t table[1 << HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    size_t lit_start = 0;
+    size_t pos = 0;
+    // After 32 consecutive misses, start skipping ahead faster through
+    // data that does not seem to compress.
+    uint32_t misses = 0;
+    while (len >= MIN_MATCH && pos <= len - MIN_MATCH) {
+        const uint32_t bytes = Load32(input + pos);
+        const uint32_t hash = HashBytes(bytes);
+        const size_t candidate = table[hash];
+        table[hash] = static_cast<uint16_t>(pos);
+
+        if (candidate >= pos || Load32(input + candidate) != bytes) {
+            pos += 1 + (misses++ >> 5);
+            continue;
+        }
+        misses = 0;
+
+        size_t match = MIN_MATCH;
+        while (pos + match < len && input[candidate + match] == input[pos + match]) {
+            ++match;
+        }
+
+        if (lit_start < pos) {
+            out = EmitLiteral(out, input + lit_start, pos - lit_start);
+        }
+        out = EmitCopy(out, pos - candidate, match);
+        pos += match;
+        lit_start = pos;
+    }
+
+    if (lit_start < len) {
+        out = EmitLiteral(out, input + lit_start, len - lit_start);
+    }
+    return out;
+}
+
+bool ParseVarint32(const uint8_t*& in, const uint8_t* end, uint32_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift <= 28; shift += 7) {
+        if (in == end) {
+            return false;
+        }
+        const uint8_t byte = *in++;
+        if (shift == 28 && byte > 0x0f) {
+            return false;
+        }
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+namespace snappy {
+
+size_t MaxCompressedLength(const size_t source_bytes)
+{
+    return 32 + source_bytes + source_bytes / 6;
+}
+
+void RawCompress(const char* input, size_t input_length, char* compressed, size_t* compressed_length)
+{
+    char* out = EmitVarint32(compressed, static_cast<uint32_t>(input_length));
+    while (input_length > 0) {
+        const size_t len = input_length < FRAGMENT_SIZE ? input_length : FRAGMENT_SIZE;
+        out = CompressFragment(input, len, out);
+        input += len;
+        input_length -= len;
+    }
+    *compressed_length = out - compressed;
+}
+
+bool GetUncompressedLength(const char* compressed, const size_t compressed_length, size_t* result)
+{
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(compressed);
+    uint32_t value;
+    if (!ParseVarint32(in, in + compressed_length, value)) {
+        return false;
+    }
+    *result = value;
+    return true;
+}
+
+bool RawUncompress(const char* compressed, const size_t compressed_length, char* uncompressed)
+{
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(compressed);
+    const uint8_t* const in_end = in + compressed_length;
+    uint32_t total;
+    if (!ParseVarint32(in, in_end, total)) {
+        return false;
+    }
+
+    char* out = uncompressed;
+    char* const out_end = uncompressed + total;
+    while (in < in_end) {
+        const uint8_t tag = *in++;
+        uint64_t len;
+        uint64_t offset;
+        switch (tag & 3) {
+        case LITERAL: {
+            len = tag >> 2;
+            if (len >= 60) {
+                const size_t bytes = len - 59;
+                if (static_cast<size_t>(in_end - in) < bytes) {
+                    return false;
+                }
+                len = 0;
+                for (size_t i = 0; i < bytes; ++i) {
+                    len |= static_cast<uint64_t>(in[i]) << (8 * i);
+                }
+                in += bytes;
+            }
+            ++len;
+            if (static_cast<uint64_t>(in_end - in) < len || static_cast<uint64_t>(out_end - out) < len) {
+                return false;
+            }
+            memcpy(out, in, len);
+            in += len;
+            out += len;
+            continue;
+        }
+
+        case COPY_1_BYTE_OFFSET:
+            if (in_end - in < 1) {
+                return false;
+            }
+            len = 4 + ((tag >> 2) & 7);
+            offset = (static_cast<uint64_t>(tag >> 5) << 8) | in[0];
+            in += 1;
+            break;
+
+        case COPY_2_BYTE_OFFSET:
+            if (in_end - in < 2) {
+                return false;
+            }
+            len = 1 + (tag >> 2);
+            offset = in[0] | (static_cast<uint64_t>(in[1]) << 8);
+            in += 2;
+            break;
+
+        default:
+            if (in_end - in < 4) {
+                return false;
+            }
+            len = 1 + (tag >> 2);
+            offset = in[0] | (static_cast<uint64_t>(in[1]) << 8) | (static_cast<uint64_t>(in[2]) << 16) | (static_cast<uint64_t>(in[3]) << 24);
+            in += 4;
+            break;
+        }
+
+        if (offset == 0 || offset > static_cast<uint64_t>(out - uncompressed) || static_cast<uint64_t>(out_end - out) < len) {
+            return false;
+        }
+        // The source may overlap with the bytes being written (e.g. for runs
+        // of a repeated byte), so this has to go byte by byte.
+        const char* src = out - offset;
+        for (uint64_t i = 0; i < len; ++i) {
+            out[i] = src[i];
+        }
+        out += len;
+    }
+
+    return out == out_end;
+}
+
+} // namespace snappy
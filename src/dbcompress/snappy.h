@@ -0,0 +1,43 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_DBCOMPRESS_SNAPPY_H
+#define BITCOIN_DBCOMPRESS_SNAPPY_H
+
+#include <stddef.h>
+
+/**
+ * In-tree implementation of the Snappy compression format, providing the
+ * subset of the snappy library's interface that LevelDB's port layer uses
+ * for kSnappyCompression.  The compressor is a simple greedy matcher; its
+ * output is valid Snappy data and can be read by any Snappy decoder (and
+ * the decoder accepts data written by the reference implementation).
+ */
+namespace snappy {
+
+/** Returns the maximal size of the compressed representation of input
+ *  data that is source_bytes long.  */
+size_t MaxCompressedLength(size_t source_bytes);
+
+/**
+ * Compresses input[0..input_length-1] into compressed, which must have
+ * room for at least MaxCompressedLength(input_length) bytes.  The actual
+ * length of the output is stored in compressed_length.
+ */
+void RawCompress(const char* input, size_t input_length, char* compressed, size_t* compressed_length);
+
+/** Reads the uncompressed length from the header of compressed data.
+ *  Returns false if the header is malformed.  */
+bool GetUncompressedLength(const char* compressed, size_t compressed_length, size_t* result);
+
+/**
+ * Decompresses compressed[0..compressed_length-1] into uncompressed, which
+ * must have room for GetUncompressedLength bytes.  Returns false if the
+ * data is corrupt.
+ */
+bool RawUncompress(const char* compressed, size_t compressed_length, char* uncompressed);
+
+} // namespace snappy
+
+#endif // BITCOIN_DBCOMPRESS_SNAPPY_H
@@ -43,6 +43,24 @@ const std::vector<unsigned char>& GetObfuscateKey(const CDBWrapper &w);
 
 };
 
+/**
+ * Tuning of a LevelDB instance beyond what is derived from its cache size.
+ * Zero values keep LevelDB's (or our) defaults.
+ */
+struct DBTuning
+{
+    //! Size of the block cache in bytes (default: half the cache size)
+    size_t block_cache_size = 0;
+    //! Size of the memtable in bytes (default: a quarter of the cache size)
+    size_t write_buffer_size = 0;
+    //! Approximate size of uncompressed data per block in bytes
+    size_t block_size = 0;
+    //! Size of the table files in bytes, which bounds the work per compaction
+    size_t max_file_size = 0;
+    //! Whether to Snappy-compress the table blocks
+    bool compression = false;
+};
+
 /** Batch of changes queued to be written to a CDBWrapper */
 class CDBBatch
 {
@@ -114,6 +132,57 @@ public:
     size_t SizeEstimate() const { return size_estimate; }
 };
 
+/**
+ * Stream that deserialises a database value directly from the LevelDB slice.
+ * Only the bytes that are actually read are de-obfuscated, and skipped bytes
+ * are neither copied nor de-obfuscated.
+ */
+class CDBValueReader
+{
+private:
+    const leveldb::Slice data;
+    const std::vector<unsigned char>& obfuscate_key;
+    size_t pos;
+
+public:
+    CDBValueReader(const leveldb::Slice& _data, const std::vector<unsigned char>& _obfuscate_key) :
+        data(_data), obfuscate_key(_obfuscate_key), pos(0) { };
+
+    int GetType() const { return SER_DISK; }
+    int GetVersion() const { return CLIENT_VERSION; }
+
+    void read(char* dst, size_t n)
+    {
+        if (n > data.size() - pos) {
+            throw std::ios_base::failure("CDBValueReader::read(): end of data");
+        }
+        memcpy(dst, data.data() + pos, n);
+        if (!obfuscate_key.empty()) {
+            for (size_t i = 0, j = pos % obfuscate_key.size(); i < n; ++i) {
+                dst[i] ^= obfuscate_key[j++];
+                if (j == obfuscate_key.size())
+                    j = 0;
+            }
+        }
+        pos += n;
+    }
+
+    void ignore(size_t n)
+    {
+        if (n > data.size() - pos) {
+            throw std::ios_base::failure("CDBValueReader::ignore(): end of data");
+        }
+        pos += n;
+    }
+
+    template<typename T>
+    CDBValueReader& operator>>(T&& obj)
+    {
+        ::Unserialize(*this, obj);
+        return *this;
+    }
+};
+
 class CDBIterator
 {
 private:
@@ -167,6 +236,21 @@ public:
         return true;
     }
 
+    /**
+     * Like GetValue, but deserialises the value in place through
+     * CDBValueReader instead of copying and de-obfuscating all of it first.
+     * This is cheaper if only the start of a large value is read.
+     */
+    template<typename V> bool GetValueInPlace(V& value) {
+        try {
+            CDBValueReader reader(piter->value(), dbwrapper_private::GetObfuscateKey(parent));
+            reader >> value;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
     unsigned int GetValueSize() {
         return piter->value().size();
     }
@@ -220,8 +304,9 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] tuning      Overrides for individual LevelDB options.
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, const DBTuning& tuning = DBTuning());
     ~CDBWrapper();
 
     CDBWrapper(const CDBWrapper&) = delete;
@@ -347,6 +432,20 @@ public:
         pdb->CompactRange(&slKey1, &slKey2);
     }
 
+    /**
+     * Compact all keys whose serialization starts with the given byte.
+     * Unlike compacting the whole database at once, this allows to do it
+     * in steps that can be interrupted in between.
+     */
+    void CompactPrefix(const unsigned char prefix) const
+    {
+        const char begin = static_cast<char>(prefix);
+        const char end = static_cast<char>(prefix + 1);
+        leveldb::Slice slKey1(&begin, 1);
+        leveldb::Slice slKey2(&end, 1);
+        pdb->CompactRange(&slKey1, prefix < 0xff ? &slKey2 : nullptr);
+    }
+
 };
 
 #endif // BITCOIN_DBWRAPPER_H
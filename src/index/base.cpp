@@ -5,6 +5,7 @@
 #include <chainparams.h>
 #include <index/base.h>
 #include <shutdown.h>
+#include <support/allocators/monotonic.h>
 #include <tinyformat.h>
 #include <ui_interface.h>
 #include <util/system.h>
@@ -28,8 +29,9 @@ static void FatalError(const char* fmt, const Args&... args)
     StartShutdown();
 }
 
-BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate) :
-    CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate)
+BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate,
+                  const DBTuning& tuning) :
+    CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate, tuning)
 {}
 
 bool BaseIndex::DB::ReadBestBlock(CBlockLocator& locator) const
@@ -124,7 +126,7 @@ void BaseIndex::ThreadSync()
             }
 
             CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
+            if (!ReadBlockFromDisk(block, pindex, consensus_params, std::make_shared<MonotonicArena>())) {
                 FatalError("%s: Failed to read block %s from disk",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
@@ -263,7 +265,7 @@ void BaseIndex::Start()
 {
     // Need to register this ValidationInterface before running Init(), so that
     // callbacks are not missed if Init sets m_synced to true.
-    RegisterValidationInterface(this);
+    RegisterValidationInterface(this, GetName());
     if (!Init()) {
         FatalError("%s: %s failed to initialize", __func__, GetName());
         return;
@@ -0,0 +1,191 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/blockstatsindex.h>
+
+#include <consensus/consensus.h>
+#include <consensus/validation.h>
+#include <names/main.h>
+#include <script/names.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <univalue.h>
+
+#include <algorithm>
+#include <vector>
+
+constexpr char DB_BLOCK_STATS = 's';
+
+std::unique_ptr<BlockStatsIndex> g_blockstatsindex;
+
+void AddNameStats(const CTransaction& tx, CBlockStats& stats)
+{
+    for (const CTxOut& out : tx.vout) {
+        const CNameScriptView nameOp(out.scriptPubKey);
+        if (!nameOp.isNameOp()) {
+            continue;
+        }
+
+        if (nameOp.getNameOp() == OP_NAME_REGISTER) {
+            ++stats.name_registrations;
+        } else {
+            ++stats.name_updates;
+        }
+
+        // Moves are updates of p/ names with a "g" object in their value.
+        // They are extracted in the same way as for -zmqpubgameblocks, so a
+        // game is counted only once even if its ID appears repeatedly.
+        const Span<const unsigned char> name = nameOp.getOpName();
+        if (name.size() < 2 || name[0] != 'p' || name[1] != '/') {
+            continue;
+        }
+        const Span<const unsigned char> valueBytes = nameOp.getOpValue();
+        UniValue value;
+        if (!value.read(std::string(valueBytes.begin(), valueBytes.end()))) {
+            continue;
+        }
+        for (const auto& entry : GetMovesPerGame(value)) {
+            ++stats.game_moves[entry.first];
+        }
+    }
+}
+
+bool ComputeBlockStats(const CBlock& block, const CBlockUndo& undo, CBlockStats& stats)
+{
+    // This follows getblockstats, except that the spent coins are taken
+    // from the undo data instead of the transaction index.
+    stats = CBlockStats();
+    stats.txs = block.vtx.size();
+    stats.algo = block.pow.getCoreAlgo();
+
+    CAmount minfee = MAX_MONEY;
+    CAmount minfeerate = MAX_MONEY;
+    int64_t mintxsize = MAX_BLOCK_SERIALIZED_SIZE;
+    std::vector<CAmount> fee_array;
+    std::vector<std::pair<CAmount, int64_t>> feerate_array;
+    std::vector<int64_t> txsize_array;
+
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        AddNameStats(tx, stats);
+
+        stats.outputs += tx.vout.size();
+        CAmount tx_total_out = 0;
+        for (const CTxOut& out : tx.vout) {
+            tx_total_out += out.nValue;
+            stats.utxo_size_inc += GetSerializeSize(out, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
+        }
+
+        if (tx.IsCoinBase()) {
+            continue;
+        }
+
+        stats.inputs += tx.vin.size();
+        stats.total_out += tx_total_out;
+
+        const int64_t tx_size = tx.GetTotalSize();
+        txsize_array.push_back(tx_size);
+        stats.maxtxsize = std::max(stats.maxtxsize, tx_size);
+        mintxsize = std::min(mintxsize, tx_size);
+        stats.total_size += tx_size;
+
+        const int64_t weight = GetTransactionWeight(tx);
+        stats.total_weight += weight;
+
+        if (tx.HasWitness()) {
+            ++stats.swtxs;
+            stats.swtotal_size += tx_size;
+            stats.swtotal_weight += weight;
+        }
+
+        if (i - 1 >= undo.vtxundo.size() || undo.vtxundo[i - 1].vprevout.size() != tx.vin.size()) {
+            return error("%s: undo data does not match block", __func__);
+        }
+        const CTxUndo& txundo = undo.vtxundo[i - 1];
+        CAmount tx_total_in = 0;
+        for (const Coin& coin : txundo.vprevout) {
+            tx_total_in += coin.out.nValue;
+            stats.utxo_size_inc -= GetSerializeSize(coin.out, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
+        }
+
+        const CAmount txfee = tx_total_in - tx_total_out;
+        assert(MoneyRange(txfee));
+        fee_array.push_back(txfee);
+        stats.maxfee = std::max(stats.maxfee, txfee);
+        minfee = std::min(minfee, txfee);
+        stats.totalfee += txfee;
+
+        // New feerate uses satoshis per virtual byte instead of per serialized byte
+        const CAmount feerate = weight ? (txfee * WITNESS_SCALE_FACTOR) / weight : 0;
+        feerate_array.emplace_back(feerate, weight);
+        stats.maxfeerate = std::max(stats.maxfeerate, feerate);
+        minfeerate = std::min(minfeerate, feerate);
+    }
+
+    CalculatePercentilesByWeight(stats.feerate_percentiles, feerate_array, stats.total_weight);
+    stats.medianfee = CalculateTruncatedMedian(fee_array);
+    stats.mediantxsize = CalculateTruncatedMedian(txsize_array);
+    stats.minfee = (minfee == MAX_MONEY) ? 0 : minfee;
+    stats.minfeerate = (minfeerate == MAX_MONEY) ? 0 : minfeerate;
+    stats.mintxsize = (mintxsize == MAX_BLOCK_SERIALIZED_SIZE) ? 0 : mintxsize;
+    return true;
+}
+
+/**
+ * Access to the block stats index database (indexes/blockstats/).  Besides
+ * the best block locator, it holds the CBlockStats of each indexed block
+ * keyed by block hash.  Entries of blocks that were disconnected are not
+ * removed, which is harmless since lookups go through the active chain.
+ */
+class BlockStatsIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadStats(const uint256& hash, CBlockStats& stats) const;
+    bool WriteStats(const uint256& hash, const CBlockStats& stats);
+};
+
+BlockStatsIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "blockstats", n_cache_size, f_memory, f_wipe)
+{}
+
+bool BlockStatsIndex::DB::ReadStats(const uint256& hash, CBlockStats& stats) const
+{
+    return Read(std::make_pair(DB_BLOCK_STATS, hash), stats);
+}
+
+bool BlockStatsIndex::DB::WriteStats(const uint256& hash, const CBlockStats& stats)
+{
+    return Write(std::make_pair(DB_BLOCK_STATS, hash), stats);
+}
+
+BlockStatsIndex::BlockStatsIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<BlockStatsIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+BlockStatsIndex::~BlockStatsIndex() {}
+
+bool BlockStatsIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CBlockUndo undo;
+    if (pindex->pprev != nullptr && !UndoReadFromDisk(undo, pindex)) {
+        return error("%s: failed to read undo data for block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    CBlockStats stats;
+    if (!ComputeBlockStats(block, undo, stats)) {
+        return false;
+    }
+    return m_db->WriteStats(pindex->GetBlockHash(), stats);
+}
+
+BaseIndex::DB& BlockStatsIndex::GetDB() const { return *m_db; }
+
+bool BlockStatsIndex::LookupStats(const CBlockIndex* pindex, CBlockStats& stats) const
+{
+    return m_db->ReadStats(pindex->GetBlockHash(), stats);
+}
@@ -0,0 +1,148 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_BLOCKSTATSINDEX_H
+#define BITCOIN_INDEX_BLOCKSTATSINDEX_H
+
+#include <amount.h>
+#include <chain.h>
+#include <index/base.h>
+#include <powdata.h>
+#include <rpc/blockchain.h>
+#include <serialize.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+class CBlockUndo;
+class CTransaction;
+
+static const bool DEFAULT_BLOCKSTATSINDEX = false;
+/** Maximum cache size for the block stats index database in MiB.  */
+static const int64_t MAX_BLOCKSTATSINDEX_CACHE = 64;
+
+/**
+ * Statistics about a single block, as returned by getblockstats.  Only the
+ * values that need the block data itself are stored; everything that can be
+ * taken from the block index (height, time, subsidy, ...) is not.
+ */
+struct CBlockStats
+{
+    /** Number of transactions including the coinbase.  */
+    int64_t txs = 0;
+    int64_t inputs = 0;
+    int64_t outputs = 0;
+
+    CAmount total_out = 0;
+    CAmount totalfee = 0;
+    CAmount minfee = 0;
+    CAmount maxfee = 0;
+    CAmount medianfee = 0;
+    CAmount minfeerate = 0;
+    CAmount maxfeerate = 0;
+    CAmount feerate_percentiles[NUM_GETBLOCKSTATS_PERCENTILES] = {0};
+
+    int64_t total_size = 0;
+    int64_t mintxsize = 0;
+    int64_t maxtxsize = 0;
+    int64_t mediantxsize = 0;
+    int64_t total_weight = 0;
+
+    int64_t swtxs = 0;
+    int64_t swtotal_size = 0;
+    int64_t swtotal_weight = 0;
+
+    int64_t utxo_size_inc = 0;
+
+    /* Xaya-specific statistics.  */
+    PowAlgo algo = PowAlgo::INVALID;
+    int64_t name_registrations = 0;
+    int64_t name_updates = 0;
+    /** Number of moves sent to each game.  */
+    std::map<std::string, int64_t> game_moves;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(txs);
+        READWRITE(inputs);
+        READWRITE(outputs);
+        READWRITE(total_out);
+        READWRITE(totalfee);
+        READWRITE(minfee);
+        READWRITE(maxfee);
+        READWRITE(medianfee);
+        READWRITE(minfeerate);
+        READWRITE(maxfeerate);
+        for (CAmount& feerate : feerate_percentiles) {
+            READWRITE(feerate);
+        }
+        READWRITE(total_size);
+        READWRITE(mintxsize);
+        READWRITE(maxtxsize);
+        READWRITE(mediantxsize);
+        READWRITE(total_weight);
+        READWRITE(swtxs);
+        READWRITE(swtotal_size);
+        READWRITE(swtotal_weight);
+        READWRITE(utxo_size_inc);
+        READWRITE(algo);
+        READWRITE(name_registrations);
+        READWRITE(name_updates);
+        READWRITE(game_moves);
+    }
+};
+
+/**
+ * Counts the name registrations, updates and game moves of one transaction
+ * into the Xaya-specific fields of stats.
+ */
+void AddNameStats(const CTransaction& tx, CBlockStats& stats);
+
+/**
+ * Computes the statistics of a block.  The undo data provides the coins
+ * spent by its transactions; for the genesis block, it is empty.  Returns
+ * false if the undo data does not match the block.
+ */
+bool ComputeBlockStats(const CBlock& block, const CBlockUndo& undo, CBlockStats& stats);
+
+/**
+ * BlockStatsIndex stores the precomputed CBlockStats of each block in the
+ * main chain (keyed by block hash), so that getblockstats does not have to
+ * read and analyse blocks and undo data on every call.
+ */
+class BlockStatsIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "blockstatsindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit BlockStatsIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~BlockStatsIndex() override;
+
+    /// Looks up the stats of the given block.  Returns false if the block
+    /// has not been indexed (yet).
+    bool LookupStats(const CBlockIndex* pindex, CBlockStats& stats) const;
+};
+
+/// The global block stats index.  May be null.
+extern std::unique_ptr<BlockStatsIndex> g_blockstatsindex;
+
+#endif // BITCOIN_INDEX_BLOCKSTATSINDEX_H
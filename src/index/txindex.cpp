@@ -2,8 +2,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chainparams.h>
 #include <index/txindex.h>
 #include <shutdown.h>
+#include <txdb.h>
 #include <ui_interface.h>
 #include <util/system.h>
 #include <validation.h>
@@ -67,8 +69,15 @@ public:
     bool MigrateData(CBlockTreeDB& block_tree_db, const CBlockLocator& best_locator);
 };
 
+static DBTuning GetTxIndexTuning()
+{
+    DBTuning tuning;
+    tuning.compression = gArgs.GetBoolArg("-dbcompression", DEFAULT_DB_COMPRESSION);
+    return tuning;
+}
+
 TxIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
-    BaseIndex::DB(GetDataDir() / "indexes" / "txindex", n_cache_size, f_memory, f_wipe)
+    BaseIndex::DB(GetDataDir() / "indexes" / "txindex", n_cache_size, f_memory, f_wipe, false, GetTxIndexTuning())
 {}
 
 bool TxIndex::DB::ReadTxPos(const uint256 &txid, CDiskTxPos& pos) const
@@ -267,6 +276,23 @@ bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRe
         return false;
     }
 
+    // For compressed block files, reading the whole block is much cheaper
+    // than extracting the file.
+    if (IsBlockFileCompressed(postx)) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, postx, Params().GetConsensus())) {
+            return error("%s: ReadBlockFromDisk failed", __func__);
+        }
+        for (const auto& block_tx : block.vtx) {
+            if (block_tx->GetHash() == tx_hash) {
+                tx = block_tx;
+                block_hash = block.GetHash();
+                return true;
+            }
+        }
+        return error("%s: txid not found in block", __func__);
+    }
+
     CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
     if (file.IsNull()) {
         return error("%s: OpenBlockFile failed", __func__);
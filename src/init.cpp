@@ -11,6 +11,8 @@
 
 #include <addrman.h>
 #include <amount.h>
+#include <auxpow.h>
+#include <blockreplay.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
@@ -20,6 +22,7 @@
 #include <httpserver.h>
 #include <httprpc.h>
 #include <interfaces/chain.h>
+#include <index/blockstatsindex.h>
 #include <index/txindex.h>
 #include <key.h>
 #include <validation.h>
@@ -73,6 +76,7 @@
 #endif
 
 bool fFeeEstimatesInitialized = false;
+static bool fValidationCachesInitialized = false;
 static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
 static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
@@ -160,6 +164,9 @@ void Interrupt()
     if (g_txindex) {
         g_txindex->Interrupt();
     }
+    if (g_blockstatsindex) {
+        g_blockstatsindex->Interrupt();
+    }
     if (g_send_updates_worker != nullptr) {
         g_send_updates_worker->interrupt();
     }
@@ -197,6 +204,7 @@ void Shutdown(InitInterfaces& interfaces)
     if (peerLogic) UnregisterValidationInterface(peerLogic.get());
     if (g_connman) g_connman->Stop();
     if (g_txindex) g_txindex->Stop();
+    if (g_blockstatsindex) g_blockstatsindex->Stop();
 
     if (g_auxpow_miner != nullptr) {
         g_auxpow_miner.reset();
@@ -214,11 +222,16 @@ void Shutdown(InitInterfaces& interfaces)
     peerLogic.reset();
     g_connman.reset();
     g_txindex.reset();
+    g_blockstatsindex.reset();
 
     if (g_is_mempool_loaded && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool();
     }
 
+    if (fValidationCachesInitialized && gArgs.GetBoolArg("-persistsigcache", DEFAULT_PERSIST_SIGCACHE)) {
+        DumpValidationCaches();
+    }
+
     if (fFeeEstimatesInitialized)
     {
         ::feeEstimator.FlushUnconfirmed();
@@ -282,6 +295,7 @@ void Shutdown(InitInterfaces& interfaces)
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    g_logger->StopAsync();
 }
 
 /**
@@ -361,6 +375,8 @@ void SetupServerArgs()
     gArgs.AddArg("-datadir=<dir>", "Specify data directory", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbcache=<n>", strprintf("Set database cache size in megabytes (%d to %d, default: %d)", nMinDbCache, nMaxDbCache, nDefaultDbCache), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-dbcompression", strprintf("Compress the table files of the block index, the name database and the transaction index as they are (re)written. "
+            "Warning: Older versions cannot read the databases once this has been enabled (default: %u)", DEFAULT_DB_COMPRESSION), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-debuglogfile=<file>", strprintf("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (-nodebuglogfile to disable; default: %s)", DEFAULT_DEBUGLOGFILE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", false, OptionsCategory::OPTIONS);
@@ -369,9 +385,14 @@ void SetupServerArgs()
     gArgs.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), true, OptionsCategory::OPTIONS);
-    gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+    gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d). "
+        "The transactions of large blocks are checked by another set of threads, see -parblockcheck",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-parblockcheck=<n>", strprintf("Set the number of threads for checking the transactions of large blocks before they are connected (0 to %d, 0 = check in the validating thread, -1 = same as -par, default: %d)",
+        MAX_SCRIPTCHECK_THREADS, DEFAULT_BLOCKCHECK_THREADS), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-schedulerthreads=<n>", strprintf("Number of threads servicing background tasks and validation callbacks (default: %d)", DEFAULT_SCHEDULER_THREADS), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-persistsigcache", strprintf("Whether to save the signature and script execution caches on shutdown and load them on restart (default: %u)", DEFAULT_PERSIST_SIGCACHE), false, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), false, OptionsCategory::OPTIONS);
 #else
@@ -380,6 +401,8 @@ void SetupServerArgs()
     gArgs.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-compressblocks=<n>", strprintf("Compress block and undo files once all their blocks are at least <n> blocks deep in the active chain (0 = disable, >=%u). "
+            "Compressed blocks can still be read, but more slowly (default: 0)", MIN_BLOCKS_TO_KEEP), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", false, OptionsCategory::OPTIONS);
 #ifndef WIN32
@@ -388,6 +411,9 @@ void SetupServerArgs()
     hidden_args.emplace_back("-sysperms");
 #endif
     gArgs.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockstatsindex", strprintf("Maintain an index of per-block statistics, used by the getblockstats and getblockstatsrange rpc calls (default: %u)", DEFAULT_BLOCKSTATSINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-namedbcache=<n>", strprintf("Set the cache size of the name database in megabytes (%d to %d, default: %d).  It is taken from -dbcache", 1, nMaxNameDbCache, nDefaultNameDbCache), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-namereadcache=<n>", strprintf("Set the size of the in-memory cache of name lookups in megabytes (%d to %d, default: %d).  It is taken from -dbcache", 0, nMaxNameReadCache, nDefaultNameReadCache), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-namehistory", strprintf("Keep track of the full name history (default: %u)", 0), false, OptionsCategory::OPTIONS);
 
     gArgs.AddArg("-addnode=<ip>", "Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info). This option can be specified multiple times to add multiple nodes.", false, OptionsCategory::CONNECTION);
@@ -473,6 +499,8 @@ void SetupServerArgs()
     gArgs.AddArg("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-deprecatedrpc=<method>", "Allows deprecated RPC method(s) to be used", true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages", true, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-replayblocks=<path>", "Replay the blocks from a blk?????.dat file or a directory of them on top of the current chainstate with networking disabled, write a report of the validation timings and stop", false, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-replayreport=<file>", "Write the report of -replayblocks to <file> (default: replay-<time>.json in the data directory)", false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", DEFAULT_STOPAFTERBLOCKIMPORT), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-stopatheight", strprintf("Stop running after reaching the given height in the main chain (default: %u)", DEFAULT_STOPATHEIGHT), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-limitancestorcount=<n>", strprintf("Do not accept transactions if number of in-mempool ancestors is <n> or more (default: %u)", DEFAULT_ANCESTOR_LIMIT), true, OptionsCategory::DEBUG_TEST);
@@ -484,10 +512,14 @@ void SetupServerArgs()
         "If <category> is not supplied or if <category> = 1, output all debugging information. <category> can be: " + ListLogCategories() + ".", false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-debugexclude=<category>", strprintf("Exclude debugging information for a category. Can be used in conjunction with -debug=1 to output debug logs for all categories except one or more specified categories."), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-help-debug", "Print help message with debugging options and exit", false, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-lockstats", strprintf("Collect lock contention statistics, see getlockstats (default: %u)", DEFAULT_LOCK_STATS), true, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-logasync", strprintf("Write the debug log from a background thread, dropping messages if it falls behind (default: %u)", DEFAULT_LOGASYNC), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logips", strprintf("Include IP addresses in debug output (default: %u)", DEFAULT_LOGIPS), false, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-lograte=<n>", strprintf("Log at most <n> messages per second for each debug category, 0 for no limit (default: %u)", DEFAULT_LOGRATE), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimestamps", strprintf("Prepend debug output with timestamp (default: %u)", DEFAULT_LOGTIMESTAMPS), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)", true, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-maxauxpowcachesize=<n>", strprintf("Limit size of the cache of verified auxpows to <n> MiB (default: %u)", DEFAULT_MAX_AUXPOW_CACHE_SIZE), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-maxsigcachesize=<n>", strprintf("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-maxtxfee=<amt>", strprintf("Maximum total fees (in %s) to use in a single wallet transaction or raw transaction; setting this too low may abort large transactions (default: %s)",
@@ -650,7 +682,7 @@ static void CleanupBlockRevFiles()
     }
 }
 
-static void ThreadImport(std::vector<fs::path> vImportFiles)
+static void ThreadImport(std::vector<fs::path> vImportFiles, std::vector<fs::path> vReplayFiles)
 {
     const CChainParams& chainparams = Params();
     RenameThread("xaya-loadblk");
@@ -713,6 +745,20 @@ static void ThreadImport(std::vector<fs::path> vImportFiles)
         return;
     }
 
+    // -replayblocks=
+    if (!vReplayFiles.empty()) {
+        BlockReplayStats stats;
+        if (!ReplayBlockFiles(chainparams, vReplayFiles, stats)) {
+            LogPrintf("Warning: Block replay did not complete\n");
+        }
+        const fs::path pathReport = AbsPathForConfigVal(gArgs.GetArg("-replayreport", strprintf("replay-%d.json", GetTime())));
+        if (WriteBlockReplayReport(pathReport, BlockReplayReport(stats))) {
+            LogPrintf("Wrote replay report to %s\n", pathReport.string());
+        }
+        StartShutdown();
+        return;
+    }
+
     if (gArgs.GetBoolArg("-stopafterblockimport", DEFAULT_STOPAFTERBLOCKIMPORT)) {
         LogPrintf("Stopping after block import\n");
         StartShutdown();
@@ -775,6 +821,12 @@ void InitParameterInteraction()
             LogPrintf("%s: parameter interaction: -whitebind set -> setting -listen=1\n", __func__);
     }
 
+    if (gArgs.IsArgSet("-replayblocks")) {
+        // replayed blocks must not be mixed with blocks from the network
+        if (gArgs.SoftSetArg("-connect", "0"))
+            LogPrintf("%s: parameter interaction: -replayblocks set -> setting -connect=0\n", __func__);
+    }
+
     if (gArgs.IsArgSet("-connect")) {
         // when only connecting to trusted nodes, do not seed via DNS, or listen by default
         if (gArgs.SoftSetBoolArg("-dnsseed", false))
@@ -862,6 +914,7 @@ void InitLogging()
     g_logger->m_print_to_console = gArgs.GetBoolArg("-printtoconsole", !gArgs.GetBoolArg("-daemon", false));
     g_logger->m_log_timestamps = gArgs.GetBoolArg("-logtimestamps", DEFAULT_LOGTIMESTAMPS);
     g_logger->m_log_time_micros = gArgs.GetBoolArg("-logtimemicros", DEFAULT_LOGTIMEMICROS);
+    g_logger->m_rate_limit = std::max<int64_t>(0, gArgs.GetArg("-lograte", DEFAULT_LOGRATE));
 
     fLogIPs = gArgs.GetBoolArg("-logips", DEFAULT_LOGIPS);
 
@@ -962,6 +1015,8 @@ bool AppInitParameterInteraction()
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (gArgs.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX))
+            return InitError(_("Prune mode is incompatible with -blockstatsindex."));
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -1019,6 +1074,7 @@ bool AppInitParameterInteraction()
         mempool.setSanityCheck(1.0 / ratio);
     }
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
+    g_lock_stats_enabled = gArgs.GetBoolArg("-lockstats", DEFAULT_LOCK_STATS);
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
 
     hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
@@ -1065,6 +1121,15 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // Like nScriptCheckThreads, this includes the validating thread itself.
+    nBlockCheckThreads = gArgs.GetArg("-parblockcheck", DEFAULT_BLOCKCHECK_THREADS);
+    if (nBlockCheckThreads < 0)
+        nBlockCheckThreads = nScriptCheckThreads;
+    else if (nBlockCheckThreads <= 1)
+        nBlockCheckThreads = 0;
+    else if (nBlockCheckThreads > MAX_SCRIPTCHECK_THREADS)
+        nBlockCheckThreads = MAX_SCRIPTCHECK_THREADS;
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = gArgs.GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1083,6 +1148,12 @@ bool AppInitParameterInteraction()
         fPruneMode = true;
     }
 
+    const int64_t nCompressBlocksArg = gArgs.GetArg("-compressblocks", 0);
+    if (nCompressBlocksArg < 0 || (nCompressBlocksArg > 0 && nCompressBlocksArg < MIN_BLOCKS_TO_KEEP)) {
+        return InitError(strprintf(_("Block file compression must be disabled or configured with a depth of at least %d."), MIN_BLOCKS_TO_KEEP));
+    }
+    nCompressBlocksDepth = std::min<int64_t>(nCompressBlocksArg, std::numeric_limits<int>::max());
+
     nConnectTimeout = gArgs.GetArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0) {
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
@@ -1226,6 +1297,9 @@ bool AppInitMain(InitInterfaces& interfaces)
                                        g_logger->m_file_path.string()));
         }
     }
+    if (gArgs.GetBoolArg("-logasync", DEFAULT_LOGASYNC)) {
+        g_logger->StartAsync();
+    }
 
     if (!g_logger->m_log_timestamps)
         LogPrintf("Startup time: %s\n", FormatISO8601DateTime(GetTime()));
@@ -1257,16 +1331,28 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitAuxpowCache();
+    if (gArgs.GetBoolArg("-persistsigcache", DEFAULT_PERSIST_SIGCACHE)) {
+        LoadValidationCaches();
+    }
+    fValidationCachesInitialized = true;
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
+    LogPrintf("Using %u threads for block transaction checks\n", nBlockCheckThreads);
+    if (nBlockCheckThreads) {
+        for (int i=0; i<nBlockCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadBlockCheck);
+    }
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler threads
+    const int nSchedulerThreads = std::max<int64_t>(1, gArgs.GetArg("-schedulerthreads", DEFAULT_SCHEDULER_THREADS));
     CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
-    threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    for (int i = 0; i < nSchedulerThreads; ++i)
+        threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
 
     GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
     GetMainSignals().RegisterWithMempoolSignals(mempool);
@@ -1321,7 +1407,7 @@ bool AppInitMain(InitInterfaces& interfaces)
     CConnman& connman = *g_connman;
 
     peerLogic.reset(new PeerLogicValidation(&connman, scheduler, gArgs.GetBoolArg("-enablebip61", DEFAULT_ENABLE_BIP61)));
-    RegisterValidationInterface(peerLogic.get());
+    RegisterValidationInterface(peerLogic.get(), "net_processing");
 
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
@@ -1413,7 +1499,7 @@ bool AppInitMain(InitInterfaces& interfaces)
     g_zmq_notification_interface = CZMQNotificationInterface::Create();
 
     if (g_zmq_notification_interface) {
-        RegisterValidationInterface(g_zmq_notification_interface);
+        RegisterValidationInterface(g_zmq_notification_interface, "zmq");
     }
 #endif
     uint64_t nMaxOutboundLimit = 0; //unlimited unless -maxuploadtarget is set
@@ -1436,6 +1522,16 @@ bool AppInitMain(InitInterfaces& interfaces)
     nTotalCache -= nBlockTreeDBCache;
     int64_t nTxIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxTxIndexCache << 20 : 0);
     nTotalCache -= nTxIndexCache;
+    int64_t nBlockStatsIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX) ? MAX_BLOCKSTATSINDEX_CACHE << 20 : 0);
+    nTotalCache -= nBlockStatsIndexCache;
+    int64_t nNameDBCache = gArgs.GetArg("-namedbcache", nDefaultNameDbCache) << 20;
+    nNameDBCache = std::max<int64_t>(nNameDBCache, 1 << 20);
+    nNameDBCache = std::min(nNameDBCache, std::min(nTotalCache / 2, nMaxNameDbCache << 20));
+    nTotalCache -= nNameDBCache;
+    int64_t nNameReadCache = gArgs.GetArg("-namereadcache", nDefaultNameReadCache) << 20;
+    nNameReadCache = std::max<int64_t>(nNameReadCache, 0);
+    nNameReadCache = std::min(nNameReadCache, std::min(nTotalCache / 4, nMaxNameReadCache << 20));
+    nTotalCache -= nNameReadCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1446,8 +1542,12 @@ bool AppInitMain(InitInterfaces& interfaces)
     if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         LogPrintf("* Using %.1fMiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
     }
+    if (gArgs.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX)) {
+        LogPrintf("* Using %.1fMiB for block stats index database\n", nBlockStatsIndexCache * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
-    LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for name database\n", nNameDBCache * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for in-memory name lookup cache\n", nNameReadCache * (1.0 / 1024 / 1024));
 
     bool fLoaded = false;
     while (!fLoaded && !ShutdownRequested()) {
@@ -1519,7 +1619,20 @@ bool AppInitMain(InitInterfaces& interfaces)
                 // At this point we're either in reindex or we've loaded a useful
                 // block tree into mapBlockIndex!
 
-                pcoinsdbview.reset(new CCoinsViewDB(nCoinDBCache, false, fReset || fReindexChainState));
+                // If we are about to (re)build the chainstate or are far
+                // behind, open it for the initial sync.  Its larger write
+                // buffers are taken from the in-memory UTXO cache.
+                const bool fInitialSync = fReset || fReindexChainState || pindexBestHeader == nullptr
+                                          || pindexBestHeader->GetBlockTime() < GetTime() - nMaxTipAge;
+                const int64_t nCoinDBWriteBuffer = fInitialSync ? std::min(nInitialSyncDbWriteBuffer << 20, nTotalCache / 8) : 0;
+                nCoinCacheUsage = nTotalCache - 2 * nCoinDBWriteBuffer;
+                if (fInitialSync) {
+                    LogPrintf("Opening the chainstate for the initial sync with %.1fMiB write buffer\n", nCoinDBWriteBuffer * (1.0 / 1024 / 1024));
+                }
+                // Logged only here, as the write buffers reduce it.
+                LogPrintf("Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
+
+                pcoinsdbview.reset(new CCoinsViewDB(nCoinDBCache, nNameDBCache, false, fReset || fReindexChainState, nCoinDBWriteBuffer));
                 pcoinscatcher.reset(new CCoinsViewErrorCatcher(pcoinsdbview.get()));
 
                 // If necessary, upgrade from older database format.
@@ -1529,6 +1642,12 @@ bool AppInitMain(InitInterfaces& interfaces)
                     break;
                 }
 
+                // Finish a name database commit that was interrupted.
+                if (!pcoinsdbview->RecoverNameDB()) {
+                    strLoadError = _("The name database does not match the chainstate. You will need to rebuild the database using -reindex-chainstate.");
+                    break;
+                }
+
                 // ReplayBlocks is a no-op if we cleared the coinsviewdb with -reindex or -reindex-chainstate
                 if (!ReplayBlocks(chainparams, pcoinsdbview.get())) {
                     strLoadError = _("Unable to replay blocks. You will need to rebuild the database using -reindex-chainstate.");
@@ -1537,6 +1656,7 @@ bool AppInitMain(InitInterfaces& interfaces)
 
                 // The on-disk coinsdb is now in a good state, create the cache
                 pcoinsTip.reset(new CCoinsViewCache(pcoinscatcher.get()));
+                pcoinsTip->SetNameReadCacheSize(nNameReadCache);
 
                 bool is_coinsview_empty = fReset || fReindexChainState || pcoinsTip->GetBestBlock().IsNull();
                 if (!is_coinsview_empty) {
@@ -1631,6 +1751,10 @@ bool AppInitMain(InitInterfaces& interfaces)
         g_txindex = MakeUnique<TxIndex>(nTxIndexCache, false, fReindex);
         g_txindex->Start();
     }
+    if (gArgs.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX)) {
+        g_blockstatsindex = MakeUnique<BlockStatsIndex>(nBlockStatsIndexCache, false, fReindex);
+        g_blockstatsindex->Start();
+    }
 
     // ********************************************************* Step 9: load wallet
     for (const auto& client : interfaces.chain_clients) {
@@ -1652,6 +1776,12 @@ bool AppInitMain(InitInterfaces& interfaces)
         }
     }
 
+    // Compress old block files in the background, one at a time.
+    if (nCompressBlocksDepth > 0) {
+        LogPrintf("Compressing block files with all blocks at least %d deep\n", nCompressBlocksDepth);
+        scheduler.scheduleEvery([] { CompressOldBlockFile(); }, BLOCKFILE_COMPRESS_INTERVAL * 1000, CScheduler::Priority::LOW);
+    }
+
     // ********************************************************* Step 11: import blocks
 
     if (!CheckDiskSpace(/* additional_bytes */ 0, /* blocks_dir */ false)) {
@@ -1679,7 +1809,19 @@ bool AppInitMain(InitInterfaces& interfaces)
         vImportFiles.push_back(strFile);
     }
 
-    threadGroup.create_thread(std::bind(&ThreadImport, vImportFiles));
+    std::vector<fs::path> vReplayFiles;
+    if (gArgs.IsArgSet("-replayblocks")) {
+        const fs::path pathReplay = gArgs.GetArg("-replayblocks", "");
+        if (!fs::exists(pathReplay)) {
+            return InitError(strprintf(_("Replay path %s does not exist"), pathReplay.string()));
+        }
+        vReplayFiles = GetBlockReplayFiles(pathReplay);
+        if (vReplayFiles.empty()) {
+            return InitError(strprintf(_("No block files found in %s"), pathReplay.string()));
+        }
+    }
+
+    threadGroup.create_thread(std::bind(&ThreadImport, vImportFiles, vReplayFiles));
 
     // Wait for genesis block to be processed
     {
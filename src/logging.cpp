@@ -4,8 +4,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <logging.h>
+#include <util/system.h>
 #include <util/time.h>
 
+#include <cassert>
+#include <chrono>
+
 const char * const DEFAULT_DEBUGLOGFILE = "debug.log";
 
 /**
@@ -30,6 +34,94 @@ static int FileWriteStr(const std::string &str, FILE *fp)
     return fwrite(str.data(), 1, str.size(), fp);
 }
 
+/** How often the asynchronous writer wakes up when nobody signals it.  */
+static constexpr std::chrono::milliseconds ASYNC_LOG_WRITE_INTERVAL{50};
+
+/**
+ * Bounded lock-free queue of log records, which can be filled from any
+ * number of threads and is drained by a single consumer (the writer thread).
+ * Each slot carries a sequence number that tells producers and the consumer
+ * whose turn it is, so that neither needs a lock.
+ */
+class BCLog::LogRingBuffer
+{
+private:
+    struct Slot
+    {
+        std::atomic<size_t> seq;
+        std::string data;
+    };
+
+    const std::unique_ptr<Slot[]> m_slots;
+    const size_t m_mask;
+
+    std::atomic<size_t> m_enqueue_pos{0};
+    std::atomic<size_t> m_dequeue_pos{0};
+
+public:
+    explicit LogRingBuffer(const size_t capacity)
+        : m_slots(new Slot[capacity]), m_mask(capacity - 1)
+    {
+        assert(capacity >= 2 && (capacity & m_mask) == 0);
+        for (size_t i = 0; i < capacity; ++i) {
+            m_slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t Capacity() const { return m_mask + 1; }
+
+    /** Returns the (approximate) number of records in the buffer.  */
+    size_t Size() const
+    {
+        return m_enqueue_pos.load(std::memory_order_relaxed) - m_dequeue_pos.load(std::memory_order_relaxed);
+    }
+
+    /** Adds a record, returns false if the buffer is full.  */
+    bool Push(std::string&& str)
+    {
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = m_slots[pos & m_mask];
+            const size_t seq = slot.seq.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.data = std::move(str);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** Takes the oldest record, returns false if the buffer is empty.
+     *  Must only be called from one thread at a time.  */
+    bool Pop(std::string& str)
+    {
+        const size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        Slot& slot = m_slots[pos & m_mask];
+        if (slot.seq.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        str = std::move(slot.data);
+        slot.data = std::string();
+        slot.seq.store(pos + m_mask + 1, std::memory_order_release);
+        m_dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+BCLog::Logger::Logger() = default;
+
+BCLog::Logger::~Logger()
+{
+    StopAsync();
+}
+
 bool BCLog::Logger::OpenDebugLog()
 {
     std::lock_guard<std::mutex> scoped_lock(m_file_mutex);
@@ -140,6 +232,16 @@ bool GetLogCategory(BCLog::LogFlags& flag, const std::string& str)
     return false;
 }
 
+static std::string LogCategoryToStr(const BCLog::LogFlags category)
+{
+    for (const CLogCategoryDesc& category_desc : LogCategories) {
+        if (category_desc.flag == category) {
+            return category_desc.category;
+        }
+    }
+    return "";
+}
+
 std::string ListLogCategories()
 {
     std::string ret;
@@ -204,10 +306,29 @@ void BCLog::Logger::LogPrintStr(const std::string &str)
 {
     std::string strTimestamped = LogTimestampStr(str);
 
+    ++m_async_producers;
+    if (m_async) {
+        if (!m_ring->Push(std::move(strTimestamped))) {
+            ++m_dropped;
+        } else if (m_ring->Size() >= m_ring->Capacity() / 2) {
+            m_writer_cv.notify_one();
+        }
+        --m_async_producers;
+        return;
+    }
+    --m_async_producers;
+
+    WriteToOutputs(strTimestamped);
+    if (m_print_to_console) {
+        fflush(stdout);
+    }
+}
+
+void BCLog::Logger::WriteToOutputs(const std::string& strTimestamped)
+{
     if (m_print_to_console) {
         // print to console
         fwrite(strTimestamped.data(), 1, strTimestamped.size(), stdout);
-        fflush(stdout);
     }
     if (m_print_to_file) {
         std::lock_guard<std::mutex> scoped_lock(m_file_mutex);
@@ -233,6 +354,106 @@ void BCLog::Logger::LogPrintStr(const std::string &str)
     }
 }
 
+void BCLog::Logger::DrainRingBuffer()
+{
+    std::string str;
+    bool wrote = false;
+    while (m_ring->Pop(str)) {
+        WriteToOutputs(str);
+        wrote = true;
+    }
+
+    const uint64_t dropped = m_dropped;
+    if (dropped > m_dropped_reported) {
+        std::string msg = strprintf("[%d log messages dropped, the buffer was full]\n", dropped - m_dropped_reported);
+        if (m_log_timestamps) {
+            msg = FormatISO8601DateTime(GetTime()) + ' ' + msg;
+        }
+        WriteToOutputs(msg);
+        m_dropped_reported = dropped;
+        wrote = true;
+    }
+
+    if (wrote && m_print_to_console) {
+        fflush(stdout);
+    }
+}
+
+void BCLog::Logger::WriterThread()
+{
+    RenameThread("bitcoin-logger");
+
+    std::unique_lock<std::mutex> lock(m_writer_mutex);
+    while (!m_stop_writer) {
+        m_writer_cv.wait_for(lock, ASYNC_LOG_WRITE_INTERVAL);
+        lock.unlock();
+        DrainRingBuffer();
+        lock.lock();
+    }
+}
+
+void BCLog::Logger::StartAsync(const size_t capacity)
+{
+    assert(!m_async && !m_writer_thread.joinable());
+
+    m_ring.reset(new LogRingBuffer(capacity));
+    m_dropped_reported = m_dropped;
+    {
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        m_stop_writer = false;
+    }
+    m_writer_thread = std::thread(&BCLog::Logger::WriterThread, this);
+    m_async = true;
+}
+
+void BCLog::Logger::StopAsync()
+{
+    if (!m_writer_thread.joinable()) return;
+
+    m_async = false;
+    {
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        m_stop_writer = true;
+    }
+    m_writer_cv.notify_one();
+    m_writer_thread.join();
+
+    /* Threads that saw m_async before we cleared it may still be pushing
+       their records.  Wait for them, so that nothing is lost.  */
+    while (m_async_producers > 0) {
+        std::this_thread::yield();
+    }
+    DrainRingBuffer();
+}
+
+bool BCLog::Logger::CheckRateLimit(const LogFlags category)
+{
+    const unsigned int limit = m_rate_limit.load(std::memory_order_relaxed);
+    if (limit == 0 || category == BCLog::NONE) return true;
+
+    unsigned int index = 0;
+    while ((category & (uint32_t{1} << index)) == 0) ++index;
+    RateLimitState& state = m_rate_limits[index];
+
+    /* Messages are counted in windows of one second.  The first message in a
+       new window resets the counter and reports what was suppressed in the
+       previous one.  */
+    const int64_t now = GetTimeMillis() / 1000;
+    int64_t window = state.window.load(std::memory_order_relaxed);
+    if (window != now && state.window.compare_exchange_strong(window, now)) {
+        state.count = 0;
+        const uint64_t suppressed = state.suppressed.exchange(0);
+        if (suppressed > 0) {
+            LogPrintStr(strprintf("Suppressed %d log messages in category %s (-lograte=%u)\n",
+                                  suppressed, LogCategoryToStr(category), limit));
+        }
+    }
+
+    if (state.count.fetch_add(1, std::memory_order_relaxed) < limit) return true;
+    ++state.suppressed;
+    return false;
+}
+
 void BCLog::Logger::ShrinkDebugFile()
 {
     // Amount of debug.log to save at end when shrinking (must fit in memory)
@@ -11,14 +11,22 @@
 
 #include <atomic>
 #include <cstdint>
+#include <condition_variable>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 static const bool DEFAULT_LOGTIMEMICROS = false;
 static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
+static const bool DEFAULT_LOGASYNC      = false;
+/** Default for -lograte, 0 means no limit.  */
+static const unsigned int DEFAULT_LOGRATE = 0;
+/** Number of records the asynchronous log buffer holds, must be a power of two.  */
+static const size_t ASYNC_LOG_BUFFER_SIZE = 1 << 13;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
@@ -58,6 +66,8 @@ namespace BCLog {
         ALL         = ~(uint32_t)0,
     };
 
+    class LogRingBuffer;
+
     class Logger
     {
     private:
@@ -65,6 +75,33 @@ namespace BCLog {
         std::mutex m_file_mutex;
         std::list<std::string> m_msgs_before_open;
 
+        /**
+         * When asynchronous logging is running, LogPrintStr only pushes the
+         * timestamped records to m_ring, and m_writer_thread writes them to
+         * the actual outputs.  m_async_producers counts the threads that are
+         * currently in LogPrintStr, so that StopAsync can make sure no record
+         * is left behind in the buffer.
+         */
+        std::unique_ptr<LogRingBuffer> m_ring;
+        std::thread m_writer_thread;
+        std::atomic<bool> m_async{false};
+        std::atomic<int> m_async_producers{0};
+        std::atomic<uint64_t> m_dropped{0};
+        /** Value of m_dropped up to which drops have been written to the log. */
+        uint64_t m_dropped_reported = 0;
+        std::mutex m_writer_mutex;
+        std::condition_variable m_writer_cv;
+        bool m_stop_writer = false;
+
+        /** Per-category state for the rate limiting of LogPrint.  */
+        struct RateLimitState
+        {
+            std::atomic<int64_t> window{0};
+            std::atomic<uint32_t> count{0};
+            std::atomic<uint64_t> suppressed{0};
+        };
+        RateLimitState m_rate_limits[32];
+
         /**
          * m_started_new_line is a state variable that will suppress printing of
          * the timestamp when multiple calls are made that don't end in a
@@ -77,6 +114,16 @@ namespace BCLog {
 
         std::string LogTimestampStr(const std::string& str);
 
+        /** Writes a timestamped record to the console and/or the file.  */
+        void WriteToOutputs(const std::string& str);
+
+        /** Writes all records in the ring buffer and reports drops.  */
+        void DrainRingBuffer();
+
+        void WriterThread();
+
+        bool CheckRateLimit(LogFlags category);
+
     public:
         bool m_print_to_console = false;
         bool m_print_to_file = false;
@@ -87,9 +134,38 @@ namespace BCLog {
         fs::path m_file_path;
         std::atomic<bool> m_reopen_file{false};
 
+        /** Maximum number of LogPrint messages per category and second, 0 for no limit. */
+        std::atomic<unsigned int> m_rate_limit{DEFAULT_LOGRATE};
+
+        Logger();
+        ~Logger();
+
         /** Send a string to the log output */
         void LogPrintStr(const std::string &str);
 
+        /**
+         * Starts writing the log from a background thread.  Records are
+         * buffered in a ring of the given capacity (a power of two), and
+         * dropped if it is full.
+         */
+        void StartAsync(size_t capacity = ASYNC_LOG_BUFFER_SIZE);
+        /** Stops the background thread and writes all pending records. */
+        void StopAsync();
+        bool IsAsync() const { return m_async; }
+
+        /** Returns the number of records dropped because the buffer was full. */
+        uint64_t GetDroppedMessages() const { return m_dropped; }
+
+        /**
+         * Checks the rate limit for a message in the given category and
+         * returns true if it may be logged.
+         */
+        bool AcceptRateLimited(LogFlags category)
+        {
+            if (m_rate_limit.load(std::memory_order_relaxed) == 0) return true;
+            return CheckRateLimit(category);
+        }
+
         /** Returns whether logs will be written to any output */
         bool Enabled() const { return m_print_to_console || m_print_to_file; }
 
@@ -149,7 +225,7 @@ static inline void LogPrintf(const char* fmt, const Args&... args)
 template <typename... Args>
 static inline void LogPrint(const BCLog::LogFlags& category, const Args&... args)
 {
-    if (LogAcceptCategory((category))) {
+    if (LogAcceptCategory((category)) && g_logger->AcceptRateLimited(category)) {
         LogPrintf(args...);
     }
 }
@@ -4,6 +4,7 @@
 
 #include <names/common.h>
 
+#include <memusage.h>
 #include <script/names.h>
 
 bool fNameHistory = false;
@@ -56,10 +57,18 @@ private:
   CNameCache::EntryMap::const_iterator cacheIter;
 
   /* Call the base iterator's next() routine to fill in the internal
-     "cache" for the next entry.  This already skips entries that are
-     marked as deleted in the cache.  */
+     "cache" for the next entry.  The base iterator's filter already
+     skips entries that are changed in the cache.  */
   void advanceBaseIterator ();
 
+  /* Move the cache iterator forward to the next entry that matches
+     the filter (if it is not already at one).  */
+  void skipFilteredCacheEntries ();
+
+  /* Filter used for the base iterator.  It drops all names that are
+     deleted or updated in the cache, before their data is read.  */
+  bool baseFilter (const valtype& name, unsigned height) const;
+
 public:
 
   /**
@@ -81,6 +90,13 @@ public:
 CCacheNameIterator::CCacheNameIterator (const CNameCache& c, CNameIterator* b)
   : cache(c), base(b)
 {
+  /* The base filter refers to our own filter, so that it also applies
+     any filter that is set on this iterator later on.  */
+  base->setFilter ([this] (const valtype& name, const unsigned height)
+    {
+      return baseFilter (name, height);
+    });
+
   /* Add a seek-to-start to ensure that everything is consistent.  This call
      may be superfluous if we seek to another position afterwards anyway,
      but it should also not hurt too much.  */
@@ -92,19 +108,36 @@ CCacheNameIterator::~CCacheNameIterator ()
   delete base;
 }
 
+bool
+CCacheNameIterator::baseFilter (const valtype& name,
+                                const unsigned height) const
+{
+  if (cache.isDeleted (name) || cache.entries.count (name) > 0)
+    return false;
+
+  return matches (name, height);
+}
+
 void
 CCacheNameIterator::advanceBaseIterator ()
 {
   assert (baseHasMore);
-  do
-    baseHasMore = base->next (baseName, baseData);
-  while (baseHasMore && cache.isDeleted (baseName));
+  baseHasMore = base->next (baseName, baseData);
+}
+
+void
+CCacheNameIterator::skipFilteredCacheEntries ()
+{
+  while (cacheIter != cache.entries.end ()
+          && !matches (cacheIter->first, cacheIter->second.getHeight ()))
+    ++cacheIter;
 }
 
 void
 CCacheNameIterator::seek (const valtype& start)
 {
   cacheIter = cache.entries.lower_bound (start);
+  skipFilteredCacheEntries ();
   base->seek (start);
 
   baseHasMore = true;
@@ -119,7 +152,9 @@ CCacheNameIterator::next (valtype& name, CNameData& data)
   if (!baseHasMore && cacheIter == cache.entries.end ())
     return false;
 
-  /* Determine which source to use for the next.  */
+  /* Determine which source to use for the next.  Since the base iterator
+     skips all names that are in the cache, both are never at the
+     same name.  */
   bool useBase;
   if (!baseHasMore)
     useBase = false;
@@ -127,30 +162,18 @@ CCacheNameIterator::next (valtype& name, CNameData& data)
     useBase = true;
   else
     {
-      /* A special case is when both iterators are equal.  In this case,
-         we want to use the cached version.  We also have to advance
-         the base iterator.  */
-      if (baseName == cacheIter->first)
-        advanceBaseIterator ();
-
-      /* Due to advancing the base iterator above, it may happen that
-         no more base entries are present.  Handle this gracefully.  */
-      if (!baseHasMore)
-        useBase = false;
-      else
-        {
-          assert (baseName != cacheIter->first);
-
-          CNameCache::NameComparator cmp;
-          useBase = cmp (baseName, cacheIter->first);
-        }
+      assert (baseName != cacheIter->first);
+
+      CNameCache::NameComparator cmp;
+      useBase = cmp (baseName, cacheIter->first);
     }
 
-  /* Use the correct source now and advance it.  */
+  /* Use the correct source now and advance it.  The base entry is
+     overwritten when advancing anyway, so it can be moved out.  */
   if (useBase)
     {
-      name = baseName;
-      data = baseData;
+      name = std::move (baseName);
+      data = std::move (baseData);
       advanceBaseIterator ();
     }
   else
@@ -158,6 +181,7 @@ CCacheNameIterator::next (valtype& name, CNameData& data)
       name = cacheIter->first;
       data = cacheIter->second;
       ++cacheIter;
+      skipFilteredCacheEntries ();
     }
 
   return true;
@@ -247,3 +271,131 @@ CNameCache::apply (const CNameCache& cache)
         = cache.history.begin (); i != cache.history.end (); ++i)
     setHistory (i->first, i->second);
 }
+
+/* ************************************************************************** */
+/* CNameReadCache.  */
+
+size_t
+CNameReadCache::entryUsage (const valtype& name, const Entry& entry)
+{
+  /* The list node holds two pointers for the links and one for the key.  */
+  return memusage::MallocUsage (sizeof (memusage::stl_tree_node<EntryMap::value_type>))
+          + memusage::MallocUsage (3 * sizeof (void*))
+          + memusage::DynamicUsage (name)
+          + memusage::DynamicUsage (entry.data.getValue ())
+          + memusage::DynamicUsage (entry.data.getAddress ());
+}
+
+void
+CNameReadCache::erase (const EntryMap::iterator mit)
+{
+  usage -= entryUsage (mit->first, mit->second);
+  lru.erase (mit->second.lru);
+  entries.erase (mit);
+}
+
+void
+CNameReadCache::shrink ()
+{
+  while (usage > maxUsage)
+    {
+      assert (!lru.empty ());
+      erase (entries.find (*lru.back ()));
+    }
+}
+
+void
+CNameReadCache::setMaxUsage (const size_t n)
+{
+  maxUsage = n;
+  shrink ();
+}
+
+bool
+CNameReadCache::get (const valtype& name, bool& found, CNameData& data)
+{
+  if (!isEnabled ())
+    return false;
+
+  const EntryMap::iterator mit = entries.find (name);
+  if (mit == entries.end ())
+    {
+      ++misses;
+      return false;
+    }
+
+  ++hits;
+  lru.splice (lru.begin (), lru, mit->second.lru);
+  found = mit->second.found;
+  if (found)
+    data = mit->second.data;
+
+  return true;
+}
+
+void
+CNameReadCache::add (const valtype& name, const CNameData* data)
+{
+  if (!isEnabled ())
+    return;
+
+  invalidate (name);
+
+  Entry entry;
+  entry.found = (data != nullptr);
+  if (entry.found)
+    entry.data = *data;
+
+  const size_t entrySize = entryUsage (name, entry);
+  if (entrySize > maxUsage)
+    return;
+
+  const EntryMap::iterator mit
+      = entries.insert (std::make_pair (name, entry)).first;
+  lru.push_front (&mit->first);
+  mit->second.lru = lru.begin ();
+  usage += entrySize;
+
+  shrink ();
+}
+
+void
+CNameReadCache::invalidate (const valtype& name)
+{
+  const EntryMap::iterator mit = entries.find (name);
+  if (mit != entries.end ())
+    erase (mit);
+}
+
+void
+CNameReadCache::invalidate (const CNameCache& changes)
+{
+  if (entries.empty ())
+    return;
+
+  for (const auto& entry : changes.entries)
+    invalidate (entry.first);
+  for (const auto& name : changes.deleted)
+    invalidate (name);
+}
+
+void
+CNameReadCache::clear ()
+{
+  entries.clear ();
+  lru.clear ();
+  usage = 0;
+}
+
+CNameReadCache::Stats
+CNameReadCache::getStats () const
+{
+  Stats res;
+  res.entries = entries.size ();
+  res.usage = usage;
+  res.maxUsage = maxUsage;
+  res.hits = hits;
+  res.misses = misses;
+
+  return res;
+}
@@ -10,6 +10,8 @@
 #include <script/script.h>
 #include <serialize.h>
 
+#include <functional>
+#include <list>
 #include <map>
 #include <set>
 
@@ -58,6 +60,24 @@ public:
     READWRITE (*(CScriptBase*)(&addr));
   }
 
+  /**
+   * Deserialisation target that reads just the height of a serialised
+   * CNameData, skipping over the value and not reading the rest.  This
+   * allows to filter database entries without copying their data.
+   */
+  struct HeightOnly
+  {
+    unsigned nHeight;
+
+    template<typename Stream>
+      void
+      Unserialize (Stream& s)
+    {
+      s.ignore (ReadCompactSize (s));
+      s >> nHeight;
+    }
+  };
+
   /* Compare for equality.  */
   friend inline bool
   operator== (const CNameData& a, const CNameData& b)
@@ -203,11 +223,45 @@ public:
 class CNameIterator
 {
 
+public:
+
+  /**
+   * Predicate on a name and its height, which decides whether an entry
+   * is returned from the iteration.  Implementations apply it before they
+   * copy out (or even read) the rest of the name's data, so that entries
+   * which do not match are cheap to skip.
+   */
+  typedef std::function<bool (const valtype& name, unsigned height)> Filter;
+
+protected:
+
+  /** The current filter.  If empty, all entries are returned.  */
+  Filter filter;
+
+  /* Check an entry against the filter.  */
+  inline bool
+  matches (const valtype& name, const unsigned height) const
+  {
+    return !filter || filter (name, height);
+  }
+
 public:
 
   // Virtual destructor in case subclasses need them.
   virtual ~CNameIterator ();
 
+  /**
+   * Restrict the iteration to names that match the given filter.  Passing
+   * an empty function removes the filter again.  The filter takes effect
+   * with the next call to seek().
+   * @param f The filter to use.
+   */
+  inline void
+  setFilter (const Filter& f)
+  {
+    filter = f;
+  }
+
   /**
    * Seek to a given lower bound.
    * @param start The name to seek to.
@@ -277,9 +331,22 @@ private:
   std::map<valtype, CNameHistory> history;
 
   friend class CCacheNameIterator;
+  friend class CNameReadCache;
 
 public:
 
+  /* The cache is serialised as the redo record of a pending name database
+     commit, see CCoinsViewDB::BatchWrite.  */
+  ADD_SERIALIZE_METHODS;
+
+  template<typename Stream, typename Operation>
+    inline void SerializationOp (Stream& s, Operation ser_action)
+  {
+    READWRITE (entries);
+    READWRITE (deleted);
+    READWRITE (history);
+  }
+
   inline void
   clear ()
   {
@@ -352,4 +419,114 @@ public:
 
 };
 
+/* ************************************************************************** */
+/* CNameReadCache.  */
+
+/**
+ * Bounded cache of name lookups in a backing view.  In contrast to
+ * CNameCache, this holds clean entries (including the fact that a name
+ * does not exist) as they were read, and evicts the least-recently used
+ * ones once its estimated memory usage exceeds the configured limit.
+ * It does not see changes made to the backing view, so its owner has to
+ * invalidate names whenever it writes them.
+ */
+class CNameReadCache
+{
+
+public:
+
+  /** Statistics about the cache's use.  */
+  struct Stats
+  {
+    size_t entries;
+    size_t usage;
+    size_t maxUsage;
+    uint64_t hits;
+    uint64_t misses;
+  };
+
+private:
+
+  /** Names in order of their last use, most recent first.  The pointers
+      point to the keys in the entry map, which are stable.  */
+  typedef std::list<const valtype*> LruList;
+
+  struct Entry
+  {
+    /** Whether or not the name exists in the backing view.  */
+    bool found;
+    CNameData data;
+    LruList::iterator lru;
+  };
+
+  typedef std::map<valtype, Entry> EntryMap;
+
+  EntryMap entries;
+  LruList lru;
+
+  /** Estimated memory usage of all entries.  */
+  size_t usage;
+  /** Maximum memory usage.  If zero, the cache is disabled.  */
+  size_t maxUsage;
+
+  uint64_t hits;
+  uint64_t misses;
+
+  /** Estimates the memory used by an entry.  */
+  static size_t entryUsage (const valtype& name, const Entry& entry);
+
+  void erase (EntryMap::iterator mit);
+
+  /** Evicts least-recently used entries until the usage is in bounds.  */
+  void shrink ();
+
+public:
+
+  CNameReadCache ()
+    : usage(0), maxUsage(0), hits(0), misses(0)
+  {}
+
+  CNameReadCache (const CNameReadCache&) = delete;
+  void operator= (const CNameReadCache&) = delete;
+
+  inline bool
+  isEnabled () const
+  {
+    return maxUsage > 0;
+  }
+
+  /**
+   * Sets the maximum memory usage, evicting entries as needed.  Zero
+   * disables the cache.
+   */
+  void setMaxUsage (size_t n);
+
+  /**
+   * Looks up a name.
+   * @param name The name to look up.
+   * @param found Set to whether the name exists in the backing view.
+   * @param data Set to the name's data if it exists.
+   * @return True iff the name is in the cache.
+   */
+  bool get (const valtype& name, bool& found, CNameData& data);
+
+  /**
+   * Adds the result of a lookup in the backing view.
+   * @param name The name that was looked up.
+   * @param data The name's data, or null if it does not exist.
+   */
+  void add (const valtype& name, const CNameData* data);
+
+  /* Remove a name that is being changed from the cache.  */
+  void invalidate (const valtype& name);
+
+  /* Remove all names changed in the given record from the cache.  */
+  void invalidate (const CNameCache& changes);
+
+  void clear ();
+
+  Stats getStats () const;
+
+};
+
 #endif // H_BITCOIN_NAMES_COMMON
@@ -127,10 +127,11 @@ CNameMemPool::removeConflicts (const CTransaction& tx)
 
   for (const auto& txout : tx.vout)
     {
-      const CNameScript nameOp(txout.scriptPubKey);
+      const CNameScriptView nameOp(txout.scriptPubKey);
       if (nameOp.isNameOp () && nameOp.getNameOp () == OP_NAME_REGISTER)
         {
-          const valtype& name = nameOp.getOpName ();
+          const valtype name(nameOp.getOpName ().begin (),
+                             nameOp.getOpName ().end ());
           const NameTxMap::const_iterator mit = mapNameRegs.find (name);
           if (mit != mapNameRegs.end ())
             {
@@ -210,15 +211,16 @@ CNameMemPool::checkTx (const CTransaction& tx) const
 
   for (const auto& txout : tx.vout)
     {
-      const CNameScript nameOp(txout.scriptPubKey);
+      const CNameScriptView nameOp(txout.scriptPubKey);
       if (!nameOp.isNameOp ())
         continue;
 
+      const valtype name(nameOp.getOpName ().begin (),
+                         nameOp.getOpName ().end ());
       switch (nameOp.getNameOp ())
         {
         case OP_NAME_REGISTER:
           {
-            const valtype& name = nameOp.getOpName ();
             if (registersName (name))
               return false;
             break;
@@ -226,7 +228,6 @@ CNameMemPool::checkTx (const CTransaction& tx) const
 
         case OP_NAME_UPDATE:
           {
-            const valtype& name = nameOp.getOpName ();
             if (updatesName (name))
               return false;
             break;
@@ -340,6 +341,25 @@ IsValueValid (const valtype& value, CValidationState& state)
   return true;
 }
 
+std::map<std::string, UniValue>
+GetMovesPerGame (const UniValue& value)
+{
+  std::map<std::string, UniValue> res;
+  if (!value.isObject ())
+    return res;
+
+  const UniValue& g = value["g"];
+  if (!g.isObject ())
+    return res;
+
+  const std::vector<std::string>& keys = g.getKeys ();
+  const std::vector<UniValue>& values = g.getValues ();
+  for (size_t i = 0; i < keys.size (); ++i)
+    res.emplace (keys[i], values[i]);
+
+  return res;
+}
+
 bool
 CheckNameTransaction (const CTransaction& tx, unsigned nHeight,
                       const CCoinsView& view,
@@ -353,7 +373,7 @@ CheckNameTransaction (const CTransaction& tx, unsigned nHeight,
      a name operation.  */
 
   int nameIn = -1;
-  CNameScript nameOpIn;
+  CNameScriptView nameOpIn;
   Coin coinIn;
   for (unsigned i = 0; i < tx.vin.size (); ++i)
     {
@@ -364,23 +384,24 @@ CheckNameTransaction (const CTransaction& tx, unsigned nHeight,
                                       __func__, txid),
                           REJECT_INVALID, "bad-txns-inputs-missingorspent");
 
-      const CNameScript op(coin.out.scriptPubKey);
-      if (op.isNameOp ())
+      if (CNameScriptView (coin.out.scriptPubKey).isNameOp ())
         {
           if (nameIn != -1)
             return state.Invalid (error ("%s: multiple name inputs into"
                                          " transaction %s", __func__, txid));
           nameIn = i;
-          nameOpIn = op;
-          coinIn = coin;
+          coinIn = std::move (coin);
         }
     }
+  /* The views point into coinIn and tx, which both outlive them.  */
+  if (nameIn != -1)
+    nameOpIn = CNameScriptView (coinIn.out.scriptPubKey);
 
   int nameOut = -1;
-  CNameScript nameOpOut;
+  CNameScriptView nameOpOut;
   for (unsigned i = 0; i < tx.vout.size (); ++i)
     {
-      const CNameScript op(tx.vout[i].scriptPubKey);
+      const CNameScriptView op(tx.vout[i].scriptPubKey);
       if (op.isNameOp ())
         {
           if (nameOut != -1)
@@ -419,14 +440,17 @@ CheckNameTransaction (const CTransaction& tx, unsigned nHeight,
   else if (nameIn == -1)
     return state.Invalid (error ("CheckNameTransaction: update without"
                                  " previous name input"));
-  const valtype& name = nameOpOut.getOpName ();
+  const valtype name(nameOpOut.getOpName ().begin (),
+                     nameOpOut.getOpName ().end ());
+  const valtype value(nameOpOut.getOpValue ().begin (),
+                      nameOpOut.getOpValue ().end ());
 
   if (!IsNameValid (name, state))
     {
       error ("%s: Name is invalid: %s", __func__, FormatStateMessage (state));
       return false;
     }
-  if (!IsValueValid (nameOpOut.getOpValue (), state))
+  if (!IsValueValid (value, state))
     {
       error ("%s: Value is invalid: %s", __func__, FormatStateMessage (state));
       return false;
@@ -440,7 +464,7 @@ CheckNameTransaction (const CTransaction& tx, unsigned nHeight,
         return state.Invalid (error ("CheckNameTransaction: NAME_UPDATE with"
                                      " prev input that is no update"));
 
-      if (name != nameOpIn.getOpName ())
+      if (MakeSpan (name) != nameOpIn.getOpName ())
         return state.Invalid (error ("%s: NAME_UPDATE name mismatch to prev tx"
                                      " found in %s", __func__, txid));
 
@@ -485,8 +509,11 @@ ApplyNameTransaction (const CTransaction& tx, unsigned nHeight,
 
   for (unsigned i = 0; i < tx.vout.size (); ++i)
     {
+      if (!CNameScriptView (tx.vout[i].scriptPubKey).isNameOp ())
+        continue;
+
       const CNameScript op(tx.vout[i].scriptPubKey);
-      if (op.isNameOp () && op.isAnyUpdate ())
+      if (op.isAnyUpdate ())
         {
           const valtype& name = op.getOpName ();
           LogPrint (BCLog::NAMES, "Updating name at height %d: %s\n",
@@ -23,6 +23,7 @@ class CCoinsViewCache;
 class CTxMemPool;
 class CTxMemPoolEntry;
 class CValidationState;
+class UniValue;
 
 /** The amount of coins to lock in created transactions.  */
 static constexpr CAmount NAME_LOCKED_AMOUNT = COIN / 100;
@@ -241,6 +242,16 @@ bool IsNameValid (const valtype& name, CValidationState& state);
  */
 bool IsValueValid (const valtype& value, CValidationState& state);
 
+/**
+ * Extracts the moves for each game from the "g" object of a (parsed) name
+ * value.  JSON objects may contain the same key more than once; in that case
+ * only the first move for the game is returned.  This defines which moves
+ * are sent out by -zmqpubgameblocks and counted in the block stats.
+ * @param value The name value, which should be a JSON object.
+ * @return The move of each game.
+ */
+std::map<std::string, UniValue> GetMovesPerGame (const UniValue& value);
+
 /**
  * Check a transaction according to the additional Namecoin rules.  This
  * ensures that all name operations (if any) are valid and that it has
@@ -50,6 +50,20 @@ public:
 
 };
 
+/** Reads or writes the transactions of a block.  When reading, their hashes
+ *  are computed in one batch instead of one by one. */
+template <typename Stream>
+inline void SerReadWriteTransactions(Stream& s, const std::vector<CTransactionRef>& vtx, CSerActionSerialize)
+{
+    ::Serialize(s, vtx);
+}
+
+template <typename Stream>
+inline void SerReadWriteTransactions(Stream& s, std::vector<CTransactionRef>& vtx, CSerActionUnserialize)
+{
+    UnserializeTransactions(s, vtx);
+}
+
 class CBlock : public CBlockHeader
 {
 public:
@@ -75,7 +89,7 @@ public:
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
         READWRITEAS(CBlockHeader, *this);
-        READWRITE(vtx);
+        SerReadWriteTransactions(s, vtx, ser_action);
     }
 
     void SetNull()
@@ -101,6 +115,15 @@ public:
     std::string ToString() const;
 };
 
+/** Unserialize a block like operator>> does, but with the transactions
+ *  allocated from the given arena (if not null). */
+template <typename Stream>
+void UnserializeBlock(Stream& s, CBlock& block, const std::shared_ptr<MonotonicArena>& arena)
+{
+    s >> static_cast<CBlockHeader&>(block);
+    UnserializeTransactions(s, block.vtx, arena);
+}
+
 /** Describes a place in the block chain to another node such that if the
  * other node doesn't have the same branch, it can find a recent common trunk.
  * The further back it is, the further before the fork it may be.
@@ -0,0 +1,261 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <primitives/blockview.h>
+
+#include <crypto/common.h>
+#include <hash.h>
+#include <serialize.h>
+
+#include <cstring>
+#include <ios>
+
+namespace
+{
+
+/** Minimal deserialization stream reading from a span without copying. */
+class SpanReader
+{
+private:
+    const int m_type;
+    const int m_version;
+    Span<const unsigned char> m_data;
+    size_t m_pos = 0;
+
+public:
+    SpanReader(int type, int version, Span<const unsigned char> data)
+        : m_type(type), m_version(version), m_data(data)
+    {}
+
+    int GetType() const { return m_type; }
+    int GetVersion() const { return m_version; }
+    size_t GetPos() const { return m_pos; }
+
+    void ignore(size_t size)
+    {
+        if (size > static_cast<size_t>(m_data.size()) - m_pos) {
+            throw std::ios_base::failure("SpanReader: end of data");
+        }
+        m_pos += size;
+    }
+
+    void read(char* dst, size_t size)
+    {
+        const size_t pos = m_pos;
+        ignore(size);
+        memcpy(dst, m_data.data() + pos, size);
+    }
+
+    template <typename T>
+    SpanReader& operator>>(T&& obj)
+    {
+        ::Unserialize(*this, obj);
+        return *this;
+    }
+};
+
+/** Decodes a CompactSize from data that is known to be valid. */
+uint64_t DecodeCompactSize(const unsigned char*& pos)
+{
+    const unsigned char first = *pos++;
+    uint64_t res;
+    if (first < 253) {
+        return first;
+    } else if (first == 253) {
+        res = ReadLE16(pos);
+        pos += 2;
+    } else if (first == 254) {
+        res = ReadLE32(pos);
+        pos += 4;
+    } else {
+        res = ReadLE64(pos);
+        pos += 8;
+    }
+    return res;
+}
+
+/** Skips over a CompactSize length-prefixed byte string. */
+void SkipBytes(SpanReader& s)
+{
+    s.ignore(ReadCompactSize(s));
+}
+
+/** Skips over count inputs. */
+void SkipInputs(SpanReader& s, uint64_t count)
+{
+    for (uint64_t i = 0; i < count; ++i) {
+        s.ignore(32 + 4);
+        SkipBytes(s);
+        s.ignore(4);
+    }
+}
+
+/** Skips over count outputs. */
+void SkipOutputs(SpanReader& s, uint64_t count)
+{
+    for (uint64_t i = 0; i < count; ++i) {
+        s.ignore(8);
+        SkipBytes(s);
+    }
+}
+
+} // namespace
+
+template <>
+void CTxViewIterator<CTxInView>::Parse()
+{
+    const unsigned char* pos = m_pos;
+    memcpy(m_cur.prevout.hash.begin(), pos, 32);
+    m_cur.prevout.n = ReadLE32(pos + 32);
+    pos += 36;
+    const uint64_t len = DecodeCompactSize(pos);
+    m_cur.scriptSig = Span<const unsigned char>(pos, len);
+    pos += len;
+    m_cur.nSequence = ReadLE32(pos);
+    m_next = pos + 4;
+}
+
+template <>
+void CTxViewIterator<CTxOutView>::Parse()
+{
+    const unsigned char* pos = m_pos;
+    m_cur.nValue = static_cast<CAmount>(ReadLE64(pos));
+    pos += 8;
+    const uint64_t len = DecodeCompactSize(pos);
+    m_cur.scriptPubKey = Span<const unsigned char>(pos, len);
+    m_next = pos + len;
+}
+
+int32_t CTransactionView::GetVersion() const
+{
+    return static_cast<int32_t>(ReadLE32(m_data.data()));
+}
+
+uint32_t CTransactionView::GetLockTime() const
+{
+    return ReadLE32(m_data.end() - 4);
+}
+
+uint256 CTransactionView::GetHash() const
+{
+    if (!m_has_witness) {
+        return GetWitnessHash();
+    }
+
+    uint256 res;
+    CHash256()
+        .Write(m_data.data(), 4)
+        .Write(m_data.data() + m_stripped_begin, m_stripped_end - m_stripped_begin)
+        .Write(m_data.end() - 4, 4)
+        .Finalize(res.begin());
+    return res;
+}
+
+uint256 CTransactionView::GetWitnessHash() const
+{
+    uint256 res;
+    CHash256().Write(m_data.data(), m_data.size()).Finalize(res.begin());
+    return res;
+}
+
+CTransactionRef CTransactionView::ToTransaction() const
+{
+    SpanReader s(SER_NETWORK, m_version, m_data);
+    return MakeTransactionRef(CMutableTransaction(deserialize, s));
+}
+
+CBlockView::CBlockView(Span<const unsigned char> data, const int version)
+    : m_data(data), m_version(version)
+{
+    ParseHeader();
+}
+
+CBlockView::CBlockView(std::vector<unsigned char>&& data, const int version)
+    : m_owned(std::move(data)), m_data(m_owned.data(), m_owned.size()), m_version(version)
+{
+    ParseHeader();
+}
+
+void CBlockView::ParseHeader()
+{
+    SpanReader s(SER_NETWORK, m_version, m_data);
+    s >> m_header;
+    m_txs_pos = s.GetPos();
+}
+
+const std::vector<CTransactionView>& CBlockView::GetTransactions() const
+{
+    if (m_parsed) {
+        return m_txs;
+    }
+
+    // This follows the structure of UnserializeTransaction, just without
+    // decoding anything beyond the counts.
+    const bool allow_witness = !(m_version & SERIALIZE_TRANSACTION_NO_WITNESS);
+    SpanReader s(SER_NETWORK, m_version, m_data);
+    s.ignore(m_txs_pos);
+
+    std::vector<CTransactionView> txs;
+    const uint64_t count = ReadCompactSize(s);
+    for (uint64_t i = 0; i < count; ++i) {
+        CTransactionView tx;
+        tx.m_version = m_version;
+        const size_t start = s.GetPos();
+
+        s.ignore(4);
+        unsigned char flags = 0;
+        tx.m_stripped_begin = s.GetPos() - start;
+        tx.m_num_inputs = ReadCompactSize(s);
+        tx.m_inputs_pos = s.GetPos() - start;
+        SkipInputs(s, tx.m_num_inputs);
+        if (tx.m_num_inputs == 0 && allow_witness) {
+            s >> flags;
+            if (flags != 0) {
+                tx.m_stripped_begin = s.GetPos() - start;
+                tx.m_num_inputs = ReadCompactSize(s);
+                tx.m_inputs_pos = s.GetPos() - start;
+                SkipInputs(s, tx.m_num_inputs);
+                tx.m_num_outputs = ReadCompactSize(s);
+            }
+        } else {
+            tx.m_num_outputs = ReadCompactSize(s);
+        }
+        tx.m_outputs_pos = s.GetPos() - start;
+        SkipOutputs(s, tx.m_num_outputs);
+        tx.m_stripped_end = s.GetPos() - start;
+
+        if ((flags & 1) && allow_witness) {
+            flags ^= 1;
+            for (size_t j = 0; j < tx.m_num_inputs; ++j) {
+                const uint64_t items = ReadCompactSize(s);
+                for (uint64_t k = 0; k < items; ++k) {
+                    SkipBytes(s);
+                }
+                tx.m_has_witness |= (items > 0);
+            }
+            if (!tx.m_has_witness) {
+                throw std::ios_base::failure("Superfluous witness record");
+            }
+        }
+        if (flags) {
+            throw std::ios_base::failure("Unknown transaction optional data");
+        }
+        s.ignore(4);
+
+        tx.m_data = m_data.subspan(start, s.GetPos() - start);
+        txs.push_back(tx);
+    }
+
+    m_txs = std::move(txs);
+    m_parsed = true;
+    return m_txs;
+}
+
+CBlock CBlockView::ToBlock() const
+{
+    CBlock block;
+    SpanReader s(SER_NETWORK, m_version, m_data);
+    s >> block;
+    return block;
+}
@@ -0,0 +1,179 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_PRIMITIVES_BLOCKVIEW_H
+#define BITCOIN_PRIMITIVES_BLOCKVIEW_H
+
+#include <amount.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <span.h>
+#include <uint256.h>
+#include <version.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+/** Read-only view of a serialized transaction input. */
+struct CTxInView
+{
+    COutPoint prevout;
+    Span<const unsigned char> scriptSig;
+    uint32_t nSequence = 0;
+};
+
+/** Read-only view of a serialized transaction output. */
+struct CTxOutView
+{
+    CAmount nValue = 0;
+    Span<const unsigned char> scriptPubKey;
+
+    /** Returns a copy of the script, for code that needs a CScript. */
+    CScript GetScript() const { return CScript(scriptPubKey.begin(), scriptPubKey.end()); }
+};
+
+/**
+ * Forward iterator over the inputs or outputs of a CTransactionView.  The
+ * entries are decoded while iterating, from data that has already been
+ * validated when the transaction was located in its block.
+ */
+template <typename T>
+class CTxViewIterator
+{
+private:
+    const unsigned char* m_pos;
+    const unsigned char* m_next = nullptr;
+    size_t m_left;
+    T m_cur;
+
+    /** Decodes the entry at m_pos into m_cur and sets m_next past it. */
+    void Parse();
+
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef const T& reference;
+
+    CTxViewIterator(const unsigned char* pos, size_t count) : m_pos(pos), m_left(count)
+    {
+        if (m_left > 0) Parse();
+    }
+
+    const T& operator*() const { return m_cur; }
+    const T* operator->() const { return &m_cur; }
+
+    CTxViewIterator& operator++()
+    {
+        m_pos = m_next;
+        if (--m_left > 0) Parse();
+        return *this;
+    }
+
+    bool operator==(const CTxViewIterator& o) const { return m_left == o.m_left; }
+    bool operator!=(const CTxViewIterator& o) const { return m_left != o.m_left; }
+};
+
+template <typename T>
+class CTxViewRange
+{
+private:
+    const unsigned char* m_begin;
+    size_t m_count;
+
+public:
+    CTxViewRange(const unsigned char* begin, size_t count) : m_begin(begin), m_count(count) {}
+
+    CTxViewIterator<T> begin() const { return CTxViewIterator<T>(m_begin, m_count); }
+    CTxViewIterator<T> end() const { return CTxViewIterator<T>(nullptr, 0); }
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+};
+
+/** Read-only view of one transaction inside a CBlockView. */
+class CTransactionView
+{
+private:
+    Span<const unsigned char> m_data;
+    int m_version = 0;
+    bool m_has_witness = false;
+    /** Range of the serialization that is also in the witness-stripped form
+     *  (everything except version, witness marker, witnesses and lock time). */
+    size_t m_stripped_begin = 0;
+    size_t m_stripped_end = 0;
+    size_t m_inputs_pos = 0;
+    size_t m_num_inputs = 0;
+    size_t m_outputs_pos = 0;
+    size_t m_num_outputs = 0;
+
+    friend class CBlockView;
+
+public:
+    Span<const unsigned char> GetSerialization() const { return m_data; }
+
+    int32_t GetVersion() const;
+    uint32_t GetLockTime() const;
+    bool HasWitness() const { return m_has_witness; }
+
+    /** Computes the txid and wtxid; they are not cached. */
+    uint256 GetHash() const;
+    uint256 GetWitnessHash() const;
+
+    CTxViewRange<CTxInView> Inputs() const { return CTxViewRange<CTxInView>(m_data.data() + m_inputs_pos, m_num_inputs); }
+    CTxViewRange<CTxOutView> Outputs() const { return CTxViewRange<CTxOutView>(m_data.data() + m_outputs_pos, m_num_outputs); }
+
+    /** Deserializes the full transaction. */
+    CTransactionRef ToTransaction() const;
+};
+
+/**
+ * Read-only view of a serialized block.  Only the header is decoded up
+ * front.  The transactions are located on first access, which validates
+ * their encoding, but are not deserialized; their inputs and outputs are
+ * decoded while iterating over them.  Full CTransaction or CBlock objects
+ * are only built on request.
+ *
+ * This is meant for consumers that just scan a block, for instance one
+ * read with ReadRawBlockFromDisk.  The view is not thread-safe.
+ */
+class CBlockView
+{
+private:
+    std::vector<unsigned char> m_owned;
+    Span<const unsigned char> m_data;
+    int m_version;
+
+    CBlockHeader m_header;
+    size_t m_txs_pos;
+
+    mutable bool m_parsed = false;
+    mutable std::vector<CTransactionView> m_txs;
+
+    void ParseHeader();
+
+public:
+    /** Constructs a view of data, which must outlive it.  Throws
+     *  std::ios_base::failure if the header cannot be decoded. */
+    explicit CBlockView(Span<const unsigned char> data, int version = PROTOCOL_VERSION);
+    /** Constructs a view that owns its data. */
+    explicit CBlockView(std::vector<unsigned char>&& data, int version = PROTOCOL_VERSION);
+
+    CBlockView(const CBlockView&) = delete;
+    CBlockView& operator=(const CBlockView&) = delete;
+
+    const CBlockHeader& GetHeader() const { return m_header; }
+    Span<const unsigned char> GetSerialization() const { return m_data; }
+
+    /** Returns the transactions, locating them first if not yet done.
+     *  Throws std::ios_base::failure if they are malformed. */
+    const std::vector<CTransactionView>& GetTransactions() const;
+
+    /** Deserializes the full block. */
+    CBlock ToBlock() const;
+};
+
+#endif // BITCOIN_PRIMITIVES_BLOCKVIEW_H
@@ -5,8 +5,11 @@
 
 #include <primitives/transaction.h>
 
+#include <crypto/sha256.h>
 #include <hash.h>
 #include <script/names.h>
+#include <streams.h>
+#include <support/allocators/monotonic.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
 
@@ -80,6 +83,56 @@ uint256 CTransaction::ComputeWitnessHash() const
 CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nLockTime(0), hash{}, m_witness_hash{} {}
 CTransaction::CTransaction(const CMutableTransaction& tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
 CTransaction::CTransaction(CMutableTransaction&& tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
+CTransaction::CTransaction(CMutableTransaction&& tx, const KnownHashes& hashes) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{hashes.hash}, m_witness_hash{hashes.witness_hash} {}
+
+void MakeTransactionRefs(std::vector<CMutableTransaction>& txs, std::vector<CTransactionRef>& out, const std::shared_ptr<MonotonicArena>& arena)
+{
+    static_assert(sizeof(uint256) == CSHA256::OUTPUT_SIZE, "hashes are written directly into a uint256 array");
+
+    // Serialize everything that needs hashing into one buffer:  First the
+    // stripped transactions for the txids, then the full serialization of
+    // those with a witness (for the others, the wtxid equals the txid).
+    std::vector<unsigned char> data;
+    std::vector<size_t> offsets;
+    offsets.reserve(2 * txs.size() + 1);
+    std::vector<size_t> witness_index(txs.size(), 0);
+    for (const auto& tx : txs) {
+        offsets.push_back(data.size());
+        CVectorWriter(SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS, data, data.size()) << tx;
+    }
+    for (size_t i = 0; i < txs.size(); ++i) {
+        if (!txs[i].HasWitness()) {
+            witness_index[i] = i;
+            continue;
+        }
+        witness_index[i] = offsets.size();
+        offsets.push_back(data.size());
+        CVectorWriter(SER_GETHASH, 0, data, data.size()) << txs[i];
+    }
+    offsets.push_back(data.size());
+
+    const size_t count = offsets.size() - 1;
+    std::vector<const unsigned char*> inputs(count);
+    std::vector<size_t> lengths(count);
+    for (size_t i = 0; i < count; ++i) {
+        inputs[i] = data.data() + offsets[i];
+        lengths[i] = offsets[i + 1] - offsets[i];
+    }
+    std::vector<uint256> hashes(count);
+    SHA256DMulti(hashes.data()->begin(), inputs.data(), lengths.data(), count);
+
+    // The transactions and their control blocks are allocated together,
+    // either on the heap or in the arena.
+    out.reserve(out.size() + txs.size());
+    for (size_t i = 0; i < txs.size(); ++i) {
+        const CTransaction::KnownHashes known(hashes[i], hashes[witness_index[i]]);
+        if (arena) {
+            out.push_back(std::allocate_shared<const CTransaction>(monotonic_allocator<CTransaction>(arena), std::move(txs[i]), known));
+        } else {
+            out.push_back(std::make_shared<const CTransaction>(std::move(txs[i]), known));
+        }
+    }
+}
 
 CAmount CTransaction::GetValueOut(bool fExcludeNames) const
 {
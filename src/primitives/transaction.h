@@ -12,6 +12,8 @@
 #include <serialize.h>
 #include <uint256.h>
 
+class MonotonicArena;
+
 static const int SERIALIZE_TRANSACTION_NO_WITNESS = 0x40000000;
 
 /** An outpoint - a combination of a transaction hash and an index n into its vout */
@@ -294,6 +296,25 @@ private:
     uint256 ComputeWitnessHash() const;
 
 public:
+    /** Hashes of a transaction that are already known.  Only
+     *  MakeTransactionRefs can create them, so that nothing else constructs
+     *  a transaction with hashes that are not its own. */
+    class KnownHashes
+    {
+    private:
+        const uint256& hash;
+        const uint256& witness_hash;
+
+        KnownHashes(const uint256& hash_in, const uint256& witness_hash_in) : hash(hash_in), witness_hash(witness_hash_in) {}
+
+        friend class CTransaction;
+        friend void MakeTransactionRefs(std::vector<CMutableTransaction>& txs, std::vector<std::shared_ptr<const CTransaction>>& out, const std::shared_ptr<MonotonicArena>& arena);
+    };
+
+    /** Convert a CMutableTransaction into a CTransaction with already known
+     *  hashes.  This is public so that std::make_shared can use it. */
+    CTransaction(CMutableTransaction&& tx, const KnownHashes& hashes);
+
     /** Construct a CTransaction that qualifies as IsNull() */
     CTransaction();
 
@@ -405,4 +426,24 @@ typedef std::shared_ptr<const CTransaction> CTransactionRef;
 static inline CTransactionRef MakeTransactionRef() { return std::make_shared<const CTransaction>(); }
 template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
 
+/** Convert all of txs into CTransactionRefs appended to out, computing their
+ *  txids and wtxids together with SHA256DMulti.  txs is left in a moved-from
+ *  state.  If arena is set, the transaction objects are allocated from it
+ *  instead of the heap, and the arena stays alive as long as any of them. */
+void MakeTransactionRefs(std::vector<CMutableTransaction>& txs, std::vector<CTransactionRef>& out, const std::shared_ptr<MonotonicArena>& arena = nullptr);
+
+/** Unserialize a vector of transactions, like the generic vector
+ *  deserialization would, but with all hashes computed in one batch. */
+template <typename Stream>
+void UnserializeTransactions(Stream& s, std::vector<CTransactionRef>& vtx, const std::shared_ptr<MonotonicArena>& arena = nullptr)
+{
+    vtx.clear();
+    const uint64_t count = ReadCompactSize(s);
+    std::vector<CMutableTransaction> txs;
+    for (uint64_t i = 0; i < count; ++i) {
+        txs.emplace_back(deserialize, s);
+    }
+    MakeTransactionRefs(txs, vtx, arena);
+}
+
 #endif // BITCOIN_PRIMITIVES_TRANSACTION_H
@@ -17,6 +17,7 @@
 #include <rpc/names.h>
 #include <rpc/server.h>
 #include <streams.h>
+#include <support/allocators/monotonic.h>
 #include <sync.h>
 #include <txmempool.h>
 #include <util/strencodings.h>
@@ -269,7 +270,7 @@ static bool rest_block(HTTPRequest* req,
         if (IsBlockPruned(pblockindex))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), std::make_shared<MonotonicArena>()))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
@@ -639,9 +640,13 @@ static bool rest_name(HTTPRequest* req, const std::string& strURIPart)
                        "Invalid encoded name: " + encodedName);
 
     CNameData data;
-    if (!pcoinsTip->GetName(plainName, data))
-        return RESTERR(req, HTTP_NOT_FOUND,
-                       EncodeNameForMessage (plainName) + " not found");
+    {
+        // GetName updates the name read cache of pcoinsTip.
+        LOCK(cs_main);
+        if (!pcoinsTip->GetName(plainName, data))
+            return RESTERR(req, HTTP_NOT_FOUND,
+                           EncodeNameForMessage (plainName) + " not found");
+    }
 
     switch (rf)
     {
@@ -14,6 +14,7 @@
 #include <consensus/validation.h>
 #include <core_io.h>
 #include <hash.h>
+#include <index/blockstatsindex.h>
 #include <index/txindex.h>
 #include <key_io.h>
 #include <policy/feerate.h>
@@ -28,6 +29,7 @@
 #include <script/descriptor.h>
 #include <script/names.h>
 #include <streams.h>
+#include <support/allocators/monotonic.h>
 #include <sync.h>
 #include <txdb.h>
 #include <txmempool.h>
@@ -35,6 +37,7 @@
 #include <util/system.h>
 #include <validation.h>
 #include <validationinterface.h>
+#include <validationstats.h>
 #include <versionbitsinfo.h>
 #include <warnings.h>
 
@@ -849,7 +852,7 @@ static CBlock GetBlockChecked(const CBlockIndex* pblockindex)
         throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
     }
 
-    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) {
+    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), std::make_shared<MonotonicArena>())) {
         // Block not found on disk. This could be because we have the block
         // header in our index but don't have the block (for example if a
         // non-whitelisted node sends us an unrequested long chain of valid
@@ -1328,6 +1331,18 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             "  \"pruneheight\": xxxxxx,        (numeric) lowest-height complete block stored (only present if pruning is enabled)\n"
             "  \"automatic_pruning\": xx,      (boolean) whether automatic pruning is enabled (only present if pruning is enabled)\n"
             "  \"prune_target_size\": xxxxxx,  (numeric) the target size used by pruning (only present if automatic pruning is enabled)\n"
+            "  \"dbcompaction\": {             (object) compaction of the chainstate deferred during the initial sync\n"
+            "     \"status\": \"xxxx\",          (string) one of \"none\" (not deferred), \"deferred\", \"running\", \"finished\", \"interrupted\"\n"
+            "     \"progress\": xxxx,          (numeric) progress of the compaction [0..1]\n"
+            "  },\n"
+            "  \"namereadcache\": {            (object) in-memory cache of name lookups (only present if enabled)\n"
+            "     \"entries\": xxxx,           (numeric) the number of cached names\n"
+            "     \"usage\": xxxx,             (numeric) the estimated memory usage in bytes\n"
+            "     \"maxusage\": xxxx,          (numeric) the memory limit in bytes (see -namereadcache)\n"
+            "     \"hits\": xxxx,              (numeric) the number of lookups answered from the cache\n"
+            "     \"misses\": xxxx,            (numeric) the number of lookups that went to the database\n"
+            "     \"hitrate\": xxxx,           (numeric) the fraction of lookups answered from the cache [0..1]\n"
+            "  },\n"
             "  \"softforks\": [                (array) status of softforks in progress\n"
             "     {\n"
             "        \"id\": \"xxxx\",           (string) name of softfork\n"
@@ -1391,6 +1406,42 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
         }
     }
 
+    double compaction_progress;
+    const CCoinsViewDB::CompactionState compaction = pcoinsdbview->GetCompactionProgress(compaction_progress);
+    UniValue dbcompaction(UniValue::VOBJ);
+    switch (compaction) {
+    case CCoinsViewDB::CompactionState::NONE:
+        dbcompaction.pushKV("status", "none");
+        break;
+    case CCoinsViewDB::CompactionState::DEFERRED:
+        dbcompaction.pushKV("status", "deferred");
+        break;
+    case CCoinsViewDB::CompactionState::RUNNING:
+        dbcompaction.pushKV("status", "running");
+        break;
+    case CCoinsViewDB::CompactionState::FINISHED:
+        dbcompaction.pushKV("status", "finished");
+        break;
+    case CCoinsViewDB::CompactionState::INTERRUPTED:
+        dbcompaction.pushKV("status", "interrupted");
+        break;
+    }
+    dbcompaction.pushKV("progress", compaction_progress);
+    obj.pushKV("dbcompaction", dbcompaction);
+
+    const CNameReadCache::Stats nameStats = pcoinsTip->GetNameReadCacheStats();
+    if (nameStats.maxUsage > 0) {
+        UniValue namereadcache(UniValue::VOBJ);
+        namereadcache.pushKV("entries", static_cast<uint64_t>(nameStats.entries));
+        namereadcache.pushKV("usage", static_cast<uint64_t>(nameStats.usage));
+        namereadcache.pushKV("maxusage", static_cast<uint64_t>(nameStats.maxUsage));
+        namereadcache.pushKV("hits", nameStats.hits);
+        namereadcache.pushKV("misses", nameStats.misses);
+        const uint64_t lookups = nameStats.hits + nameStats.misses;
+        namereadcache.pushKV("hitrate", lookups > 0 ? static_cast<double>(nameStats.hits) / lookups : 0.0);
+        obj.pushKV("namereadcache", namereadcache);
+    }
+
     const Consensus::Params& consensusParams = Params().GetConsensus();
     UniValue softforks(UniValue::VARR);
     UniValue bip9_softforks(UniValue::VOBJ);
@@ -1759,22 +1810,6 @@ static UniValue getchaintxstats(const JSONRPCRequest& request)
     return ret;
 }
 
-template<typename T>
-static T CalculateTruncatedMedian(std::vector<T>& scores)
-{
-    size_t size = scores.size();
-    if (size == 0) {
-        return 0;
-    }
-
-    std::sort(scores.begin(), scores.end());
-    if (size % 2 == 0) {
-        return (scores[size / 2 - 1] + scores[size / 2]) / 2;
-    } else {
-        return scores[size / 2];
-    }
-}
-
 void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight)
 {
     if (scores.empty()) {
@@ -1812,8 +1847,94 @@ static inline bool SetHasKeys(const std::set<T>& set, const Tk& key, const Args&
     return (set.count(key) != 0) || SetHasKeys(set, args...);
 }
 
-// outpoint (needed for the utxo index) + nHeight + fCoinBase
-static constexpr size_t PER_UTXO_OVERHEAD = sizeof(COutPoint) + sizeof(uint32_t) + sizeof(bool);
+/** Converts the game moves of block stats to a JSON object.  */
+static UniValue GameMovesToJSON(const CBlockStats& stats)
+{
+    UniValue game_moves(UniValue::VOBJ);
+    for (const auto& entry : stats.game_moves) {
+        game_moves.pushKV(entry.first, entry.second);
+    }
+    return game_moves;
+}
+
+/** Converts indexed block stats to the getblockstats result.  */
+static UniValue BlockStatsToJSON(const CBlockStats& stats, const CBlockIndex* pindex)
+{
+    const int64_t non_coinbase = stats.txs - 1;
+
+    UniValue feerates_res(UniValue::VARR);
+    for (int64_t i = 0; i < NUM_GETBLOCKSTATS_PERCENTILES; i++) {
+        feerates_res.push_back(stats.feerate_percentiles[i]);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("algo", PowAlgoToString(stats.algo));
+    ret.pushKV("avgfee", (non_coinbase > 0) ? stats.totalfee / non_coinbase : 0);
+    ret.pushKV("avgfeerate", stats.total_weight ? (stats.totalfee * WITNESS_SCALE_FACTOR) / stats.total_weight : 0); // Unit: sat/vbyte
+    ret.pushKV("avgtxsize", (non_coinbase > 0) ? stats.total_size / non_coinbase : 0);
+    ret.pushKV("blockhash", pindex->GetBlockHash().GetHex());
+    ret.pushKV("feerate_percentiles", feerates_res);
+    ret.pushKV("game_moves", GameMovesToJSON(stats));
+    ret.pushKV("height", (int64_t)pindex->nHeight);
+    ret.pushKV("ins", stats.inputs);
+    ret.pushKV("maxfee", stats.maxfee);
+    ret.pushKV("maxfeerate", stats.maxfeerate);
+    ret.pushKV("maxtxsize", stats.maxtxsize);
+    ret.pushKV("medianfee", stats.medianfee);
+    ret.pushKV("mediantime", pindex->GetMedianTimePast());
+    ret.pushKV("mediantxsize", stats.mediantxsize);
+    ret.pushKV("minfee", stats.minfee);
+    ret.pushKV("minfeerate", stats.minfeerate);
+    ret.pushKV("mintxsize", stats.mintxsize);
+    ret.pushKV("name_registrations", stats.name_registrations);
+    ret.pushKV("name_updates", stats.name_updates);
+    ret.pushKV("outs", stats.outputs);
+    ret.pushKV("subsidy", GetBlockSubsidy(pindex->nHeight, Params().GetConsensus()));
+    ret.pushKV("swtotal_size", stats.swtotal_size);
+    ret.pushKV("swtotal_weight", stats.swtotal_weight);
+    ret.pushKV("swtxs", stats.swtxs);
+    ret.pushKV("time", pindex->GetBlockTime());
+    ret.pushKV("total_out", stats.total_out);
+    ret.pushKV("total_size", stats.total_size);
+    ret.pushKV("total_weight", stats.total_weight);
+    ret.pushKV("totalfee", stats.totalfee);
+    ret.pushKV("txs", stats.txs);
+    ret.pushKV("utxo_increase", stats.outputs - stats.inputs);
+    ret.pushKV("utxo_size_inc", stats.utxo_size_inc);
+    return ret;
+}
+
+/** Returns the selected stats from a full getblockstats result.  */
+static UniValue SelectBlockStats(const UniValue& all, const std::set<std::string>& stats)
+{
+    if (stats.empty()) {
+        return all;
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    for (const std::string& stat : stats) {
+        const UniValue& value = all[stat];
+        if (value.isNull()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid selected statistic %s", stat));
+        }
+        ret.pushKV(stat, value);
+    }
+    return ret;
+}
+
+/** Parses the optional list of selected stats of getblockstats.  */
+static std::set<std::string> ParseSelectedStats(const UniValue& param)
+{
+    std::set<std::string> stats;
+    if (!param.isNull()) {
+        const UniValue stats_univalue = param.get_array();
+        for (unsigned int i = 0; i < stats_univalue.size(); i++) {
+            const std::string stat = stats_univalue[i].get_str();
+            stats.insert(stat);
+        }
+    }
+    return stats;
+}
 
 static UniValue getblockstats(const JSONRPCRequest& request)
 {
@@ -1822,7 +1943,9 @@ static UniValue getblockstats(const JSONRPCRequest& request)
             RPCHelpMan{"getblockstats",
                 "\nCompute per block statistics for a given window. All amounts are in satoshis.\n"
                 "It won't work for some heights with pruning.\n"
-                "It won't work without -txindex for utxo_size_inc, *fee or *feerate stats.\n",
+                "It won't work without -txindex for utxo_size_inc, *fee or *feerate stats.\n"
+                "With -blockstatsindex, all stats are read from the index once it has\n"
+                "processed the block.\n",
                 {
                     {"hash_or_height", RPCArg::Type::NUM, /* opt */ false, /* default_val */ "", "The block hash or height of the target block", "", {"", "string or numeric"}},
                     {"stats", RPCArg::Type::ARR, /* opt */ true, /* default_val */ "all values", "Values to plot (see result below)",
@@ -1835,6 +1958,7 @@ static UniValue getblockstats(const JSONRPCRequest& request)
                 .ToString() +
             "\nResult:\n"
             "{                           (json object)\n"
+            "  \"algo\": \"xxxx\",          (string) The mining algorithm\n"
             "  \"avgfee\": xxxxx,          (numeric) Average fee in the block\n"
             "  \"avgfeerate\": xxxxx,      (numeric) Average feerate (in satoshis per virtual byte)\n"
             "  \"avgtxsize\": xxxxx,       (numeric) Average transaction size\n"
@@ -1846,6 +1970,7 @@ static UniValue getblockstats(const JSONRPCRequest& request)
             "      \"75th_percentile_feerate\",      (numeric) The 75th percentile feerate\n"
             "      \"90th_percentile_feerate\",      (numeric) The 90th percentile feerate\n"
             "  ],\n"
+            "  \"game_moves\": {...},      (json object) Number of moves per game ID\n"
             "  \"height\": xxxxx,          (numeric) The height of the block\n"
             "  \"ins\": xxxxx,             (numeric) The number of inputs (excluding coinbase)\n"
             "  \"maxfee\": xxxxx,          (numeric) Maximum fee in the block\n"
@@ -1857,6 +1982,8 @@ static UniValue getblockstats(const JSONRPCRequest& request)
             "  \"minfee\": xxxxx,          (numeric) Minimum fee in the block\n"
             "  \"minfeerate\": xxxxx,      (numeric) Minimum feerate (in satoshis per virtual byte)\n"
             "  \"mintxsize\": xxxxx,       (numeric) Minimum transaction size\n"
+            "  \"name_registrations\": xxxxx, (numeric) The number of name registrations\n"
+            "  \"name_updates\": xxxxx,    (numeric) The number of name updates\n"
             "  \"outs\": xxxxx,            (numeric) The number of outputs\n"
             "  \"subsidy\": xxxxx,         (numeric) The block subsidy\n"
             "  \"swtotal_size\": xxxxx,    (numeric) Total size of all segwit transactions\n"
@@ -1904,13 +2031,11 @@ static UniValue getblockstats(const JSONRPCRequest& request)
 
     assert(pindex != nullptr);
 
-    std::set<std::string> stats;
-    if (!request.params[1].isNull()) {
-        const UniValue stats_univalue = request.params[1].get_array();
-        for (unsigned int i = 0; i < stats_univalue.size(); i++) {
-            const std::string stat = stats_univalue[i].get_str();
-            stats.insert(stat);
-        }
+    const std::set<std::string> stats = ParseSelectedStats(request.params[1]);
+
+    CBlockStats indexed_stats;
+    if (g_blockstatsindex && g_blockstatsindex->LookupStats(pindex, indexed_stats)) {
+        return SelectBlockStats(BlockStatsToJSON(indexed_stats, pindex), stats);
     }
 
     const CBlock block = GetBlockChecked(pindex);
@@ -1926,6 +2051,7 @@ static UniValue getblockstats(const JSONRPCRequest& request)
         SetHasKeys(stats, "total_size", "avgtxsize", "mintxsize", "maxtxsize", "swtotal_size");
     const bool do_calculate_weight = do_all || SetHasKeys(stats, "total_weight", "avgfeerate", "swtotal_weight", "avgfeerate", "feerate_percentiles", "minfeerate", "maxfeerate");
     const bool do_calculate_sw = do_all || SetHasKeys(stats, "swtxs", "swtotal_size", "swtotal_weight");
+    const bool do_name_stats = do_all || SetHasKeys(stats, "name_registrations", "name_updates", "game_moves");
 
     if (loop_inputs && !g_txindex) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "One or more of the selected stats requires -txindex enabled");
@@ -1950,10 +2076,15 @@ static UniValue getblockstats(const JSONRPCRequest& request)
     std::vector<CAmount> fee_array;
     std::vector<std::pair<CAmount, int64_t>> feerate_array;
     std::vector<int64_t> txsize_array;
+    CBlockStats name_stats;
 
     for (const auto& tx : block.vtx) {
         outputs += tx->vout.size();
 
+        if (do_name_stats) {
+            AddNameStats(*tx, name_stats);
+        }
+
         CAmount tx_total_out = 0;
         if (loop_outputs) {
             for (const CTxOut& out : tx->vout) {
@@ -2036,11 +2167,13 @@ static UniValue getblockstats(const JSONRPCRequest& request)
     }
 
     UniValue ret_all(UniValue::VOBJ);
+    ret_all.pushKV("algo", PowAlgoToString(block.pow.getCoreAlgo()));
     ret_all.pushKV("avgfee", (block.vtx.size() > 1) ? totalfee / (block.vtx.size() - 1) : 0);
     ret_all.pushKV("avgfeerate", total_weight ? (totalfee * WITNESS_SCALE_FACTOR) / total_weight : 0); // Unit: sat/vbyte
     ret_all.pushKV("avgtxsize", (block.vtx.size() > 1) ? total_size / (block.vtx.size() - 1) : 0);
     ret_all.pushKV("blockhash", pindex->GetBlockHash().GetHex());
     ret_all.pushKV("feerate_percentiles", feerates_res);
+    ret_all.pushKV("game_moves", GameMovesToJSON(name_stats));
     ret_all.pushKV("height", (int64_t)pindex->nHeight);
     ret_all.pushKV("ins", inputs);
     ret_all.pushKV("maxfee", maxfee);
@@ -2052,6 +2185,8 @@ static UniValue getblockstats(const JSONRPCRequest& request)
     ret_all.pushKV("minfee", (minfee == MAX_MONEY) ? 0 : minfee);
     ret_all.pushKV("minfeerate", (minfeerate == MAX_MONEY) ? 0 : minfeerate);
     ret_all.pushKV("mintxsize", mintxsize == MAX_BLOCK_SERIALIZED_SIZE ? 0 : mintxsize);
+    ret_all.pushKV("name_registrations", name_stats.name_registrations);
+    ret_all.pushKV("name_updates", name_stats.name_updates);
     ret_all.pushKV("outs", outputs);
     ret_all.pushKV("subsidy", GetBlockSubsidy(pindex->nHeight, Params().GetConsensus()));
     ret_all.pushKV("swtotal_size", swtotal_size);
@@ -2066,18 +2201,80 @@ static UniValue getblockstats(const JSONRPCRequest& request)
     ret_all.pushKV("utxo_increase", outputs - inputs);
     ret_all.pushKV("utxo_size_inc", utxo_size_inc);
 
-    if (do_all) {
-        return ret_all;
+    return SelectBlockStats(ret_all, stats);
+}
+
+static UniValue getblockstatsrange(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 2 || request.params.size() > 3) {
+        throw std::runtime_error(
+            RPCHelpMan{"getblockstatsrange",
+                "\nReturns the per block statistics of getblockstats for a range of blocks\n"
+                "in the main chain.  The stats are read from the block stats index, so this\n"
+                "requires -blockstatsindex.\n",
+                {
+                    {"from", RPCArg::Type::NUM, /* opt */ false, /* default_val */ "", "The height of the first block"},
+                    {"to", RPCArg::Type::NUM, /* opt */ false, /* default_val */ "", "The height of the last block"},
+                    {"stats", RPCArg::Type::ARR, /* opt */ true, /* default_val */ "all values", "Values to plot (see getblockstats)",
+                        {
+                            {"height", RPCArg::Type::STR, /* opt */ true, /* default_val */ "", "Selected statistic"},
+                            {"time", RPCArg::Type::STR, /* opt */ true, /* default_val */ "", "Selected statistic"},
+                        },
+                        "stats"},
+                }}
+                .ToString() +
+            "\nResult:\n"
+            "[                           (json array)\n"
+            "  {...},                    (json object) The stats of each block as returned by getblockstats\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockstatsrange", "1000 2000 '[\"height\",\"txs\"]'")
+            + HelpExampleRpc("getblockstatsrange", "1000, 2000, [\"height\",\"txs\"]")
+        );
     }
 
-    UniValue ret(UniValue::VOBJ);
-    for (const std::string& stat : stats) {
-        const UniValue& value = ret_all[stat];
-        if (value.isNull()) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid selected statistic %s", stat));
+    if (!g_blockstatsindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "getblockstatsrange requires -blockstatsindex");
+    }
+    const bool synced = g_blockstatsindex->BlockUntilSyncedToCurrentChain();
+
+    const int from = request.params[0].get_int();
+    const int to = request.params[1].get_int();
+    const std::set<std::string> stats = ParseSelectedStats(request.params[2]);
+
+    std::vector<const CBlockIndex*> blocks;
+    {
+        LOCK(cs_main);
+        const int current_tip = chainActive.Height();
+        if (from < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Start height %d is negative", from));
+        }
+        if (to < from) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("End height %d is before start height %d", to, from));
+        }
+        if (to > current_tip) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("End height %d after current tip %d", to, current_tip));
+        }
+
+        blocks.reserve(to - from + 1);
+        for (int height = from; height <= to; ++height) {
+            blocks.push_back(chainActive[height]);
         }
-        ret.pushKV(stat, value);
     }
+
+    UniValue ret(UniValue::VARR);
+    for (const CBlockIndex* pindex : blocks) {
+        CBlockStats block_stats;
+        if (!g_blockstatsindex->LookupStats(pindex, block_stats)) {
+            if (!synced) {
+                throw JSONRPCError(RPC_MISC_ERROR, strprintf("Block stats index has not yet processed block %d", pindex->nHeight));
+            }
+            throw JSONRPCError(RPC_INTERNAL_ERROR, strprintf("No stats found in the index for block %d", pindex->nHeight));
+        }
+        ret.push_back(SelectBlockStats(BlockStatsToJSON(block_stats, pindex), stats));
+    }
+
     return ret;
 }
 
@@ -2328,6 +2525,91 @@ UniValue scantxoutset(const JSONRPCRequest& request)
     return result;
 }
 
+UniValue validationStatsToJSON()
+{
+    UniValue res(UniValue::VOBJ);
+    for (const auto& stats : g_validation_stats.GetStats()) {
+        UniValue lifetime(UniValue::VOBJ);
+        lifetime.pushKV("count", stats.count);
+        lifetime.pushKV("total", stats.total_us);
+        lifetime.pushKV("average", stats.count == 0 ? 0 : stats.total_us / static_cast<int64_t>(stats.count));
+        lifetime.pushKV("max", stats.max_us);
+
+        UniValue histogram(UniValue::VARR);
+        for (size_t i = 0; i < stats.histogram.size(); ++i) {
+            UniValue bucket(UniValue::VOBJ);
+            if (i + 1 < stats.histogram.size())
+                bucket.pushKV("below", uint64_t{1} << i);
+            bucket.pushKV("count", stats.histogram[i]);
+            histogram.push_back(bucket);
+        }
+        lifetime.pushKV("histogram", histogram);
+
+        UniValue recent(UniValue::VOBJ);
+        recent.pushKV("count", stats.recent_count);
+        recent.pushKV("average", stats.recent_count == 0 ? 0 : stats.recent_total_us / static_cast<int64_t>(stats.recent_count));
+        recent.pushKV("median", stats.recent_median_us);
+        recent.pushKV("p90", stats.recent_p90_us);
+        recent.pushKV("p99", stats.recent_p99_us);
+        recent.pushKV("max", stats.recent_max_us);
+
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("lifetime", lifetime);
+        obj.pushKV("recent", recent);
+        res.pushKV(stats.name, obj);
+    }
+    return res;
+}
+
+static UniValue getvalidationstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            RPCHelpMan{"getvalidationstats",
+                "Returns the time spent in the stages of block validation, both since startup and\n"
+                "over the last " + std::to_string(VALIDATION_STATS_WINDOW) + " samples.  All times are in microseconds.\n",
+                {
+                    {"reset", RPCArg::Type::BOOL, /* opt */ true, /* default_val */ "false", "Reset all statistics after returning them"},
+                }}
+                .ToString() +
+            "\nResult:\n"
+            "{\n"
+            "  \"xxxx\": {                 (object) Statistics for the stage with the given name\n"
+            "    \"lifetime\": {\n"
+            "      \"count\": xxx,         (numeric) Number of samples\n"
+            "      \"total\": xxx,         (numeric) Total time spent in the stage\n"
+            "      \"average\": xxx,       (numeric) Average time per sample\n"
+            "      \"max\": xxx,           (numeric) Longest sample\n"
+            "      \"histogram\": [        (array) Number of samples per duration bucket\n"
+            "        {\n"
+            "          \"below\": xxx,     (numeric) Upper bound of the bucket (missing for the last)\n"
+            "          \"count\": xxx      (numeric) Number of samples in the bucket\n"
+            "        }, ...\n"
+            "      ]\n"
+            "    },\n"
+            "    \"recent\": {\n"
+            "      \"count\": xxx,         (numeric) Number of recent samples\n"
+            "      \"average\": xxx,       (numeric) Average time per sample\n"
+            "      \"median\": xxx,        (numeric) Median time\n"
+            "      \"p90\": xxx,           (numeric) 90th percentile\n"
+            "      \"p99\": xxx,           (numeric) 99th percentile\n"
+            "      \"max\": xxx            (numeric) Longest sample\n"
+            "    }\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getvalidationstats", "")
+            + HelpExampleRpc("getvalidationstats", "true")
+        );
+
+    const UniValue res = validationStatsToJSON();
+
+    if (!request.params[0].isNull() && request.params[0].get_bool())
+        g_validation_stats.Reset();
+
+    return res;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -2335,6 +2617,8 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      {} },
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        {"nblocks", "blockhash"} },
     { "blockchain",         "getblockstats",          &getblockstats,          {"hash_or_height", "stats"} },
+    { "blockchain",         "getblockstatsrange",     &getblockstatsrange,     {"from", "to", "stats"} },
+    { "blockchain",         "getvalidationstats",     &getvalidationstats,     {"reset"} },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       {} },
     { "blockchain",         "getblockcount",          &getblockcount,          {} },
     { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
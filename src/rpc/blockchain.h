@@ -5,9 +5,11 @@
 #ifndef BITCOIN_RPC_BLOCKCHAIN_H
 #define BITCOIN_RPC_BLOCKCHAIN_H
 
+#include <algorithm>
 #include <vector>
 #include <stdint.h>
 #include <amount.h>
+#include <primitives/transaction.h>
 
 class CBlock;
 class CBlockIndex;
@@ -16,6 +18,9 @@ class JSONRPCRequest;
 
 static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
 
+// outpoint (needed for the utxo index) + nHeight + fCoinBase
+static constexpr size_t PER_UTXO_OVERHEAD = sizeof(COutPoint) + sizeof(uint32_t) + sizeof(bool);
+
 /**
  * Returns the numeric difficulty for the given nBits.
  */
@@ -36,9 +41,29 @@ UniValue mempoolToJSON(bool fVerbose = false);
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex);
 
+/** Block validation stage timings to JSON, as returned by getvalidationstats */
+UniValue validationStatsToJSON();
+
 /** Used by getblockstats to get feerates at different percentiles by weight  */
 void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight);
 
+/** Used by getblockstats to get the truncated median fee and size  */
+template<typename T>
+T CalculateTruncatedMedian(std::vector<T>& scores)
+{
+    size_t size = scores.size();
+    if (size == 0) {
+        return 0;
+    }
+
+    std::sort(scores.begin(), scores.end());
+    if (size % 2 == 0) {
+        return (scores[size / 2 - 1] + scores[size / 2]) / 2;
+    } else {
+        return scores[size / 2];
+    }
+}
+
 UniValue getdifficulty(const JSONRPCRequest& request);
 
 #endif
@@ -130,6 +130,9 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "verifychain", 1, "nblocks" },
     { "getblockstats", 0, "hash_or_height" },
     { "getblockstats", 1, "stats" },
+    { "getblockstatsrange", 0, "from" },
+    { "getblockstatsrange", 1, "to" },
+    { "getblockstatsrange", 2, "stats" },
     { "pruneblockchain", 0, "height" },
     { "keypoolrefill", 0, "newsize" },
     { "getrawmempool", 0, "verbose" },
@@ -146,6 +149,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "bumpfee", 1, "options" },
     { "logging", 0, "include" },
     { "logging", 1, "exclude" },
+    { "getlockstats", 0, "reset" },
+    { "getvalidationstats", 0, "reset" },
     { "disconnectnode", 1, "nodeid" },
     { "name_show", 1, "options" },
     { "name_history", 1, "options" },
@@ -7,6 +7,7 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <logging.h>
+#include <primitives/blockview.h>
 #include <random.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
@@ -93,17 +94,35 @@ SendUpdatesOneBlock (const std::set<std::string>& trackedGames,
                      const std::string& reqtoken,
                      const CBlockIndex* pindex)
 {
-  CBlock blk;
-  if (!ReadBlockFromDisk (blk, pindex, Params ().GetConsensus ()))
+  /* The notifications only need to scan the block's outputs, so we do not
+     fully deserialise it but just work on a view of the raw data.  */
+  std::vector<unsigned char> data;
+  if (!ReadRawBlockFromDisk (data, pindex, Params ().MessageStart ()))
     {
       LogPrint (BCLog::GAME, "Reading block %s failed, ignoring\n",
                 pindex->GetBlockHash ().GetHex ());
       return;
     }
 
-  auto* notifier = GetGameBlocksNotifier ();
-  notifier->SendBlockNotifications (trackedGames, commandPrefix, reqtoken,
-                                    blk, pindex);
+  try
+    {
+      const CBlockView blk(std::move (data));
+      if (blk.GetHeader ().GetHash () != pindex->GetBlockHash ())
+        {
+          LogPrint (BCLog::GAME, "Block data for %s does not match, ignoring\n",
+                    pindex->GetBlockHash ().GetHex ());
+          return;
+        }
+
+      auto* notifier = GetGameBlocksNotifier ();
+      notifier->SendBlockNotifications (trackedGames, commandPrefix, reqtoken,
+                                        blk, pindex);
+    }
+  catch (const std::ios_base::failure& exc)
+    {
+      LogPrint (BCLog::GAME, "Decoding block %s failed, ignoring: %s\n",
+                pindex->GetBlockHash ().GetHex (), exc.what ());
+    }
 }
 #endif // ENABLE_ZMQ
 
@@ -16,11 +16,15 @@
 #include <rpc/blockchain.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
+#include <sync.h>
 #include <timedata.h>
 #include <util/system.h>
 #include <util/strencodings.h>
+#include <validationinterface.h>
 #include <warnings.h>
 
+#include <algorithm>
+#include <map>
 #include <stdint.h>
 #ifdef HAVE_MALLOC_INFO
 #include <malloc.h>
@@ -350,6 +354,138 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
     }
 }
 
+static UniValue getvalidationqueueinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            RPCHelpMan{"getvalidationqueueinfo",
+                "Returns information about the background callback queues of the validation interface subscribers.\n",
+                {}}
+                .ToString() +
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"name\": \"xxxx\",         (string) The subscriber's name\n"
+            "    \"pending\": xxxxx,         (numeric) Number of callbacks waiting in the queue\n"
+            "    \"maxpending\": xxxxx,      (numeric) Highest number of callbacks that were waiting at any time\n"
+            "    \"processed\": xxxxx,       (numeric) Number of callbacks processed so far\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getvalidationqueueinfo", "")
+            + HelpExampleRpc("getvalidationqueueinfo", "")
+        );
+
+    UniValue res(UniValue::VARR);
+    for (const auto& stats : GetMainSignals().GetQueueStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", stats.name);
+        obj.pushKV("pending", static_cast<uint64_t>(stats.pending));
+        obj.pushKV("maxpending", static_cast<uint64_t>(stats.max_pending));
+        obj.pushKV("processed", stats.processed);
+        res.push_back(obj);
+    }
+
+    return res;
+}
+
+static UniValue getlockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            RPCHelpMan{"getlockstats",
+                "Returns lock contention statistics per LOCK() site, ordered by total time spent waiting.\n"
+                "Acquisition counts are estimated from sampling.  Only sites that have been locked are included.\n",
+                {
+                    {"reset", RPCArg::Type::BOOL, /* opt */ true, /* default_val */ "false", "Reset all statistics after returning them"},
+                }}
+                .ToString() +
+            "\nResult:\n"
+            "{\n"
+            "  \"enabled\": true|false,    (boolean) Whether statistics are being collected (-lockstats)\n"
+            "  \"sites\": [\n"
+            "    {\n"
+            "      \"lock\": \"xxxx\",        (string) The locked mutex, as written in the source\n"
+            "      \"location\": \"xxxx\",    (string) Source file and line of the LOCK()\n"
+            "      \"acquisitions\": xxx,    (numeric) Estimated number of acquisitions\n"
+            "      \"contentions\": xxx,     (numeric) Number of acquisitions that had to wait\n"
+            "      \"totalwait\": xxx,       (numeric) Total time spent waiting in microseconds\n"
+            "      \"maxwait\": xxx,         (numeric) Longest wait in microseconds\n"
+            "      \"histogram\": [          (array) Number of waits per duration bucket\n"
+            "        {\n"
+            "          \"below\": xxx,       (numeric) Upper bound of the bucket in microseconds (missing for the last)\n"
+            "          \"count\": xxx        (numeric) Number of waits in the bucket\n"
+            "        }, ...\n"
+            "      ]\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getlockstats", "")
+            + HelpExampleRpc("getlockstats", "true")
+        );
+
+    /* Sites with the same location (e.g. in headers included from
+       multiple translation units) are merged.  */
+    std::map<std::pair<std::string, int>, LockSiteStats> sites;
+    for (auto& stats : GetLockStats()) {
+        const auto key = std::make_pair(stats.file, stats.line);
+        auto mit = sites.find(key);
+        if (mit == sites.end()) {
+            sites.emplace(key, std::move(stats));
+            continue;
+        }
+        LockSiteStats& merged = mit->second;
+        merged.acquisitions += stats.acquisitions;
+        merged.contentions += stats.contentions;
+        merged.total_wait_us += stats.total_wait_us;
+        merged.max_wait_us = std::max(merged.max_wait_us, stats.max_wait_us);
+        for (size_t i = 0; i < merged.histogram.size(); ++i)
+            merged.histogram[i] += stats.histogram[i];
+    }
+
+    std::vector<const LockSiteStats*> sorted;
+    for (const auto& entry : sites)
+        sorted.push_back(&entry.second);
+    std::sort(sorted.begin(), sorted.end(),
+              [] (const LockSiteStats* a, const LockSiteStats* b) {
+                  return a->total_wait_us > b->total_wait_us;
+              });
+
+    UniValue arr(UniValue::VARR);
+    for (const LockSiteStats* stats : sorted) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("lock", stats->name);
+        obj.pushKV("location", strprintf("%s:%d", stats->file, stats->line));
+        obj.pushKV("acquisitions", stats->acquisitions);
+        obj.pushKV("contentions", stats->contentions);
+        obj.pushKV("totalwait", stats->total_wait_us);
+        obj.pushKV("maxwait", stats->max_wait_us);
+
+        UniValue histogram(UniValue::VARR);
+        for (size_t i = 0; i < stats->histogram.size(); ++i) {
+            UniValue bucket(UniValue::VOBJ);
+            if (i + 1 < stats->histogram.size())
+                bucket.pushKV("below", uint64_t{1} << i);
+            bucket.pushKV("count", stats->histogram[i]);
+            histogram.push_back(bucket);
+        }
+        obj.pushKV("histogram", histogram);
+
+        arr.push_back(obj);
+    }
+
+    if (!request.params[0].isNull() && request.params[0].get_bool())
+        ResetLockStats();
+
+    UniValue res(UniValue::VOBJ);
+    res.pushKV("enabled", g_lock_stats_enabled.load());
+    res.pushKV("sites", arr);
+
+    return res;
+}
+
 static void EnableOrDisableLogCategories(UniValue cats, bool enable) {
     cats = cats.get_array();
     for (unsigned int i = 0; i < cats.size(); ++i) {
@@ -459,6 +595,8 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
     { "control",            "logging",                &logging,                {"include", "exclude"}},
+    { "control",            "getvalidationqueueinfo", &getvalidationqueueinfo, {}},
+    { "control",            "getlockstats",           &getlockstats,           {"reset"}},
     { "util",               "validateaddress",        &validateaddress,        {"address"} },
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys","address_type"} },
     { "util",               "verifymessage",          &verifymessage,          {"address","signature","message"} },
@@ -647,21 +647,21 @@ name_scan (const JSONRPCRequest& request)
   if (maxConf >= 0)
     minHeight = chainActive.Height () - maxConf + 1;
 
-  valtype name;
-  CNameData data;
+  /* The filters are applied by the iterator itself, so that names which
+     do not match are skipped without copying their data.  */
   std::unique_ptr<CNameIterator> iter(pcoinsTip->IterateNames ());
-  for (iter->seek (start); count > 0 && iter->next (name, data); )
+  iter->setFilter ([&] (const valtype& name, const unsigned h)
     {
-      const int height = data.getHeight ();
+      const int height = h;
       if (height > maxHeight)
-        continue;
+        return false;
       if (minHeight >= 0 && height < minHeight)
-        continue;
+        return false;
 
       if (name.size () < prefix.size ())
-        continue;
+        return false;
       if (!std::equal (prefix.begin (), prefix.end (), name.begin ()))
-        continue;
+        return false;
 
       if (haveRegexp)
         {
@@ -670,17 +670,21 @@ name_scan (const JSONRPCRequest& request)
               const std::string nameStr = EncodeName (name, NameEncoding::UTF8);
               boost::xpressive::smatch matches;
               if (!boost::xpressive::regex_search (nameStr, matches, regexp))
-                continue;
+                return false;
             }
           catch (const InvalidNameString& exc)
             {
-              continue;
+              return false;
             }
         }
 
-      res.push_back (getNameInfo (options, name, data, wallet));
-      --count;
-    }
+      return true;
+    });
+
+  valtype name;
+  CNameData data;
+  for (iter->seek (start); count > 0 && iter->next (name, data); --count)
+    res.push_back (getNameInfo (options, name, data, wallet));
 
   return res;
 }
@@ -749,8 +753,10 @@ name_pending (const JSONRPCRequest& request)
       for (size_t n = 0; n < tx->vout.size (); ++n)
         {
           const auto& txOut = tx->vout[n];
+          if (!CNameScript::isNameScript (txOut.scriptPubKey))
+            continue;
           const CNameScript op(txOut.scriptPubKey);
-          if (!op.isNameOp () || !op.isAnyUpdate ())
+          if (!op.isAnyUpdate ())
             continue;
 
           UniValue obj = getNameInfo (options,
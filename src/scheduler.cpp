@@ -7,10 +7,11 @@
 #include <random.h>
 #include <reverselock.h>
 
+#include <algorithm>
 #include <assert.h>
 #include <utility>
 
-CScheduler::CScheduler() : nThreadsServicingQueue(0), stopRequested(false), stopWhenEmpty(false)
+CScheduler::CScheduler() : nThreadsServicingQueue(0), nLowPriorityRunning(0), stopRequested(false), stopWhenEmpty(false)
 {
 }
 
@@ -29,6 +30,40 @@ static boost::system_time toPosixTime(const boost::chrono::system_clock::time_po
 }
 #endif
 
+size_t CScheduler::queueSize() const
+{
+    size_t result = 0;
+    for (const auto& queue : taskQueues)
+        result += queue.size();
+    return result;
+}
+
+bool CScheduler::nextTask(const boost::chrono::system_clock::time_point& now, int& queue) const
+{
+    // LOW tasks may only use all but one of the servicing threads.
+    const bool lowAllowed = nLowPriorityRunning < std::max(1, nThreadsServicingQueue - 1);
+
+    queue = -1;
+    for (int i = 0; i < NUM_PRIORITIES; ++i) {
+        if (taskQueues[i].empty())
+            continue;
+        if (static_cast<Priority>(i) == Priority::LOW && !lowAllowed)
+            continue;
+
+        // The highest priority task that is due wins.  If none is due yet,
+        // we take the one that is due first.
+        const auto& t = taskQueues[i].begin()->first;
+        if (t <= now) {
+            queue = i;
+            return true;
+        }
+        if (queue == -1 || t < taskQueues[queue].begin()->first)
+            queue = i;
+    }
+
+    return queue != -1;
+}
+
 void CScheduler::serviceQueue()
 {
     boost::unique_lock<boost::mutex> lock(newTaskMutex);
@@ -37,49 +72,63 @@ void CScheduler::serviceQueue()
     // newTaskMutex is locked throughout this loop EXCEPT
     // when the thread is waiting or when the user's function
     // is called.
+    int queue;
     while (!shouldStop()) {
         try {
-            if (!shouldStop() && taskQueue.empty()) {
+            if (!shouldStop() && !nextTask(boost::chrono::system_clock::now(), queue)) {
                 reverse_lock<boost::unique_lock<boost::mutex> > rlock(lock);
                 // Use this chance to get a tiny bit more entropy
                 RandAddSeedSleep();
             }
-            while (!shouldStop() && taskQueue.empty()) {
+            while (!shouldStop() && !nextTask(boost::chrono::system_clock::now(), queue)) {
                 // Wait until there is something to do.
                 newTaskScheduled.wait(lock);
             }
 
             // Wait until either there is a new task, or until
             // the time of the first item on the queue:
+            bool due = false;
+            while (!shouldStop() && nextTask(boost::chrono::system_clock::now(), queue)) {
+                const boost::chrono::system_clock::time_point timeToWaitFor = taskQueues[queue].begin()->first;
+                if (timeToWaitFor <= boost::chrono::system_clock::now()) {
+                    due = true;
+                    break;
+                }
 
 // wait_until needs boost 1.50 or later; older versions have timed_wait:
 #if BOOST_VERSION < 105000
-            while (!shouldStop() && !taskQueue.empty() &&
-                   newTaskScheduled.timed_wait(lock, toPosixTime(taskQueue.begin()->first))) {
-                // Keep waiting until timeout
-            }
+                newTaskScheduled.timed_wait(lock, toPosixTime(timeToWaitFor));
 #else
-            // Some boost versions have a conflicting overload of wait_until that returns void.
-            // Explicitly use a template here to avoid hitting that overload.
-            while (!shouldStop() && !taskQueue.empty()) {
-                boost::chrono::system_clock::time_point timeToWaitFor = taskQueue.begin()->first;
-                if (newTaskScheduled.wait_until<>(lock, timeToWaitFor) == boost::cv_status::timeout)
-                    break; // Exit loop after timeout, it means we reached the time of the event
-            }
+                // Some boost versions have a conflicting overload of wait_until that returns void.
+                // Explicitly use a template here to avoid hitting that overload.
+                newTaskScheduled.wait_until<>(lock, timeToWaitFor);
 #endif
+            }
             // If there are multiple threads, the queue can empty while we're waiting (another
             // thread may service the task we were waiting on).
-            if (shouldStop() || taskQueue.empty())
+            if (shouldStop() || !due)
                 continue;
 
-            Function f = taskQueue.begin()->second;
-            taskQueue.erase(taskQueue.begin());
+            Function f = taskQueues[queue].begin()->second;
+            taskQueues[queue].erase(taskQueues[queue].begin());
 
-            {
+            const bool isLow = static_cast<Priority>(queue) == Priority::LOW;
+            if (isLow)
+                ++nLowPriorityRunning;
+            try {
                 // Unlock before calling f, so it can reschedule itself or another task
                 // without deadlocking:
                 reverse_lock<boost::unique_lock<boost::mutex> > rlock(lock);
                 f();
+            } catch (...) {
+                if (isLow)
+                    --nLowPriorityRunning;
+                throw;
+            }
+            if (isLow) {
+                --nLowPriorityRunning;
+                // Another thread may be waiting for LOW tasks to be allowed again.
+                newTaskScheduled.notify_one();
             }
         } catch (...) {
             --nThreadsServicingQueue;
@@ -102,41 +151,46 @@ void CScheduler::stop(bool drain)
     newTaskScheduled.notify_all();
 }
 
-void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t)
+void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t, Priority priority)
 {
     {
         boost::unique_lock<boost::mutex> lock(newTaskMutex);
-        taskQueue.insert(std::make_pair(t, f));
+        taskQueues[static_cast<int>(priority)].insert(std::make_pair(t, f));
     }
     newTaskScheduled.notify_one();
 }
 
-void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaMilliSeconds)
+void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaMilliSeconds, Priority priority)
 {
-    schedule(f, boost::chrono::system_clock::now() + boost::chrono::milliseconds(deltaMilliSeconds));
+    schedule(f, boost::chrono::system_clock::now() + boost::chrono::milliseconds(deltaMilliSeconds), priority);
 }
 
-static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaMilliSeconds)
+static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaMilliSeconds, CScheduler::Priority priority)
 {
     f();
-    s->scheduleFromNow(std::bind(&Repeat, s, f, deltaMilliSeconds), deltaMilliSeconds);
+    s->scheduleFromNow(std::bind(&Repeat, s, f, deltaMilliSeconds, priority), deltaMilliSeconds, priority);
 }
 
-void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaMilliSeconds)
+void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaMilliSeconds, Priority priority)
 {
-    scheduleFromNow(std::bind(&Repeat, this, f, deltaMilliSeconds), deltaMilliSeconds);
+    scheduleFromNow(std::bind(&Repeat, this, f, deltaMilliSeconds, priority), deltaMilliSeconds, priority);
 }
 
 size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
                              boost::chrono::system_clock::time_point &last) const
 {
     boost::unique_lock<boost::mutex> lock(newTaskMutex);
-    size_t result = taskQueue.size();
-    if (!taskQueue.empty()) {
-        first = taskQueue.begin()->first;
-        last = taskQueue.rbegin()->first;
+    bool found = false;
+    for (const auto& queue : taskQueues) {
+        if (queue.empty())
+            continue;
+        if (!found || queue.begin()->first < first)
+            first = queue.begin()->first;
+        if (!found || queue.rbegin()->first > last)
+            last = queue.rbegin()->first;
+        found = true;
     }
-    return result;
+    return queueSize();
 }
 
 bool CScheduler::AreThreadsServicingQueue() const {
@@ -154,7 +208,9 @@ void SingleThreadedSchedulerClient::MaybeScheduleProcessQueue() {
         if (m_are_callbacks_running) return;
         if (m_callbacks_pending.empty()) return;
     }
-    m_pscheduler->schedule(std::bind(&SingleThreadedSchedulerClient::ProcessQueue, this));
+    std::shared_ptr<void> owner = m_owner.lock();
+    m_pscheduler->schedule([this, owner] { ProcessQueue(); },
+                           boost::chrono::system_clock::now(), m_priority);
 }
 
 void SingleThreadedSchedulerClient::ProcessQueue() {
@@ -210,3 +266,8 @@ size_t SingleThreadedSchedulerClient::CallbacksPending() {
     LOCK(m_cs_callbacks_pending);
     return m_callbacks_pending.size();
 }
+
+bool SingleThreadedSchedulerClient::IsIdle() {
+    LOCK(m_cs_callbacks_pending);
+    return m_callbacks_pending.empty() && !m_are_callbacks_running;
+}
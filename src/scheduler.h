@@ -12,7 +12,9 @@
 //
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
+#include <array>
 #include <map>
+#include <memory>
 
 #include <sync.h>
 
@@ -33,6 +35,13 @@
 // delete t;
 // delete s; // Must be done after thread is interrupted/joined.
 //
+// Any number of threads may run serviceQueue.  Tasks that must not run
+// concurrently with each other should go through a
+// SingleThreadedSchedulerClient, which serializes them.
+//
+
+/** Default number of threads servicing the scheduler (-schedulerthreads). */
+static const int DEFAULT_SCHEDULER_THREADS = 2;
 
 class CScheduler
 {
@@ -42,18 +51,30 @@ public:
 
     typedef std::function<void()> Function;
 
+    // Priority classes of tasks.  If several tasks are due, those with the
+    // highest priority run first.  LOW is meant for periodic maintenance
+    // (dumping peers, compacting the wallet, ...); such tasks are never run
+    // on the last thread that is free, so that they do not delay validation
+    // callbacks when there is more than one thread servicing the queue.
+    enum class Priority {
+        HIGH,
+        NORMAL,
+        LOW,
+    };
+
     // Call func at/after time t
-    void schedule(Function f, boost::chrono::system_clock::time_point t=boost::chrono::system_clock::now());
+    void schedule(Function f, boost::chrono::system_clock::time_point t=boost::chrono::system_clock::now(),
+                  Priority priority=Priority::NORMAL);
 
     // Convenience method: call f once deltaSeconds from now
-    void scheduleFromNow(Function f, int64_t deltaMilliSeconds);
+    void scheduleFromNow(Function f, int64_t deltaMilliSeconds, Priority priority=Priority::NORMAL);
 
     // Another convenience method: call f approximately
     // every deltaSeconds forever, starting deltaSeconds from now.
     // To be more precise: every time f is finished, it
     // is rescheduled to run deltaSeconds later. If you
     // need more accurate scheduling, don't use this method.
-    void scheduleEvery(Function f, int64_t deltaMilliSeconds);
+    void scheduleEvery(Function f, int64_t deltaMilliSeconds, Priority priority=Priority::NORMAL);
 
     // To keep things as simple as possible, there is no unschedule.
 
@@ -75,13 +96,25 @@ public:
     bool AreThreadsServicingQueue() const;
 
 private:
-    std::multimap<boost::chrono::system_clock::time_point, Function> taskQueue;
+    typedef std::multimap<boost::chrono::system_clock::time_point, Function> TaskQueue;
+    static constexpr int NUM_PRIORITIES = static_cast<int>(Priority::LOW) + 1;
+
+    // One queue per priority class, indexed by the Priority value.
+    std::array<TaskQueue, NUM_PRIORITIES> taskQueues;
     boost::condition_variable newTaskScheduled;
     mutable boost::mutex newTaskMutex;
     int nThreadsServicingQueue;
+    int nLowPriorityRunning;
     bool stopRequested;
     bool stopWhenEmpty;
-    bool shouldStop() const { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
+
+    size_t queueSize() const;
+    bool shouldStop() const { return stopRequested || (stopWhenEmpty && queueSize() == 0); }
+
+    // Finds the queue whose first task should run next on this thread.
+    // Returns false if there is none (taking into account that LOW tasks may
+    // not be allowed to run at the moment).  Requires newTaskMutex.
+    bool nextTask(const boost::chrono::system_clock::time_point& now, int& queue) const;
 };
 
 /**
@@ -97,16 +130,20 @@ private:
 class SingleThreadedSchedulerClient {
 private:
     CScheduler *m_pscheduler;
+    const CScheduler::Priority m_priority;
 
     CCriticalSection m_cs_callbacks_pending;
     std::list<std::function<void ()>> m_callbacks_pending GUARDED_BY(m_cs_callbacks_pending);
     bool m_are_callbacks_running GUARDED_BY(m_cs_callbacks_pending) = false;
+    /** If set, scheduled processing of the queue holds a reference to it.  */
+    std::weak_ptr<void> m_owner;
 
     void MaybeScheduleProcessQueue();
     void ProcessQueue();
 
 public:
-    explicit SingleThreadedSchedulerClient(CScheduler *pschedulerIn) : m_pscheduler(pschedulerIn) {}
+    explicit SingleThreadedSchedulerClient(CScheduler *pschedulerIn, CScheduler::Priority priority = CScheduler::Priority::HIGH)
+        : m_pscheduler(pschedulerIn), m_priority(priority) {}
 
     /**
      * Add a callback to be executed. Callbacks are executed serially
@@ -121,6 +158,17 @@ public:
     void EmptyQueue();
 
     size_t CallbacksPending();
+
+    /** Returns true if no callbacks are pending or currently running.  */
+    bool IsIdle();
+
+    /**
+     * Sets an object owning this client, which is kept alive by the scheduled
+     * processing of the queue.  With this, the owner can be released while
+     * processing is still scheduled.  Must be called before any callbacks
+     * are added.
+     */
+    void SetOwner(std::weak_ptr<void> owner) { m_owner = std::move(owner); }
 };
 
 #endif
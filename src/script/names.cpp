@@ -4,54 +4,130 @@
 
 #include <script/names.h>
 
+#include <crypto/common.h>
 #include <uint256.h>
 
-CNameScript::CNameScript (const CScript& script)
+namespace
+{
+
+/**
+ * Reads the next opcode from [pc, end) without copying push data.  This
+ * mirrors GetScriptOp, including where pc ends up if it fails.
+ */
+bool
+ReadScriptOp (const unsigned char*& pc, const unsigned char* end,
+              opcodetype& opcodeRet, Span<const unsigned char>& data)
+{
+  opcodeRet = OP_INVALIDOPCODE;
+  data = Span<const unsigned char> ();
+  if (pc >= end)
+    return false;
+
+  const unsigned int opcode = *pc++;
+  if (opcode <= OP_PUSHDATA4)
+    {
+      unsigned int nSize = 0;
+      if (opcode < OP_PUSHDATA1)
+        nSize = opcode;
+      else if (opcode == OP_PUSHDATA1)
+        {
+          if (end - pc < 1)
+            return false;
+          nSize = *pc++;
+        }
+      else if (opcode == OP_PUSHDATA2)
+        {
+          if (end - pc < 2)
+            return false;
+          nSize = ReadLE16 (pc);
+          pc += 2;
+        }
+      else if (opcode == OP_PUSHDATA4)
+        {
+          if (end - pc < 4)
+            return false;
+          nSize = ReadLE32 (pc);
+          pc += 4;
+        }
+      if (static_cast<unsigned int> (end - pc) < nSize)
+        return false;
+      data = Span<const unsigned char> (pc, nSize);
+      pc += nSize;
+    }
+
+  opcodeRet = static_cast<opcodetype> (opcode);
+  return true;
+}
+
+} // anonymous namespace
+
+CNameScriptView::CNameScriptView (const Span<const unsigned char> script)
   : op(OP_NOP), address(script)
 {
-  opcodetype nameOp;
-  CScript::const_iterator pc = script.begin ();
-  if (!script.GetOp (pc, nameOp))
+  if (!MaybeNameScript (script))
     return;
 
+  const unsigned char* pc = script.begin ();
+  const unsigned char* const end = script.end ();
+  const opcodetype nameOp = static_cast<opcodetype> (*pc++);
+
   opcodetype opcode;
+  Span<const unsigned char> data;
+  unsigned numArgs = 0;
   while (true)
     {
-      valtype vch;
-
-      if (!script.GetOp (pc, opcode, vch))
+      if (!ReadScriptOp (pc, end, opcode, data))
         return;
       if (opcode == OP_DROP || opcode == OP_2DROP || opcode == OP_NOP)
         break;
       if (!(opcode >= 0 && opcode <= OP_PUSHDATA4))
         return;
 
-      args.push_back (vch);
+      /* Both name operations take exactly two arguments, so there is
+         no need to parse any further.  */
+      switch (numArgs++)
+        {
+        case 0:
+          name = data;
+          break;
+        case 1:
+          value = data;
+          break;
+        default:
+          return;
+        }
     }
+  if (numArgs != 2)
+    return;
 
-  // Move the pc to after any DROP or NOP.
+  /* Move the pc to after any DROP or NOP.  This (including the final
+     decrement) matches what CNameScript always did.  */
   while (opcode == OP_DROP || opcode == OP_2DROP || opcode == OP_NOP)
-    if (!script.GetOp (pc, opcode))
+    if (!ReadScriptOp (pc, end, opcode, data))
       break;
   pc--;
 
-  /* Now, we have the args and the operation.  Check if we have indeed
-     a valid name operation and valid argument counts.  Only now set the
-     op and address members, if everything is valid.  */
-  switch (nameOp)
-    {
-    case OP_NAME_REGISTER:
-    case OP_NAME_UPDATE:
-      if (args.size () != 2)
-        return;
-      break;
+  op = nameOp;
+  address = Span<const unsigned char> (pc, end);
+}
 
-    default:
+CNameScript::CNameScript (const CScript& script)
+  : op(OP_NOP)
+{
+  const CNameScriptView view(script);
+  if (!view.isNameOp ())
+    {
+      address = script;
       return;
     }
 
-  op = nameOp;
-  address = CScript (pc, script.end ());
+  op = view.getNameOp ();
+  address = view.getAddressScript ();
+
+  const Span<const unsigned char> name = view.getOpName ();
+  const Span<const unsigned char> value = view.getOpValue ();
+  args.emplace_back (name.begin (), name.end ());
+  args.emplace_back (value.begin (), value.end ());
 }
 
 CScript
@@ -73,3 +149,36 @@ CNameScript::buildNameUpdate (const CScript& addr, const valtype& name,
 
   return prefix + addr;
 }
+
+bool
+IsPayToScriptHashBytes (const Span<const unsigned char> script)
+{
+  return script.size () == 23
+          && script[0] == OP_HASH160
+          && script[1] == 0x14
+          && script[22] == OP_EQUAL;
+}
+
+bool
+IsPayToWitnessScriptHashBytes (const Span<const unsigned char> script)
+{
+  return script.size () == 34
+          && script[0] == OP_0
+          && script[1] == 0x20;
+}
+
+bool
+IsWitnessProgramBytes (const Span<const unsigned char> script,
+                       int& version, std::vector<unsigned char>& program)
+{
+  if (script.size () < 4 || script.size () > 42)
+    return false;
+  if (script[0] != OP_0 && (script[0] < OP_1 || script[0] > OP_16))
+    return false;
+  if (script[1] + 2 != script.size ())
+    return false;
+
+  version = CScript::DecodeOP_N (static_cast<opcodetype> (script[0]));
+  program.assign (script.begin () + 2, script.end ());
+  return true;
+}
@@ -6,9 +6,126 @@
 #define H_BITCOIN_SCRIPT_NAMES
 
 #include <script/script.h>
+#include <span.h>
 
 class uint160;
 
+/**
+ * Non-owning variant of CNameScript.  The address, name and value are
+ * returned as spans into the parsed script, which must thus outlive the
+ * view.  Parsing does not allocate, and scripts that are obviously not
+ * name operations are rejected after looking at their first two bytes.
+ * Use this where scripts are only inspected, e.g. when scanning all
+ * outputs of a transaction for name operations.
+ */
+class CNameScriptView
+{
+
+private:
+
+  /** The type of operation.  OP_NOP if no (valid) name op.  */
+  opcodetype op;
+
+  /** The non-name part, i. e., the address.  */
+  Span<const unsigned char> address;
+
+  /** The name and value arguments.  */
+  Span<const unsigned char> name;
+  Span<const unsigned char> value;
+
+public:
+
+  inline CNameScriptView ()
+    : op(OP_NOP)
+  {}
+
+  /**
+   * Parse a script and determine whether it is a valid name script.
+   * The result is the same as for CNameScript.
+   * @param script The ordinary script to parse.
+   */
+  explicit CNameScriptView (Span<const unsigned char> script);
+
+  explicit inline CNameScriptView (const CScript& script)
+    : CNameScriptView (Span<const unsigned char> (script.data (),
+                                                  script.size ()))
+  {}
+
+  /* Avoid views of temporaries.  */
+  explicit CNameScriptView (CScript&&) = delete;
+
+  inline bool
+  isNameOp () const
+  {
+    return op != OP_NOP;
+  }
+
+  /**
+   * Return the name operation.  Do not call if this is not a name script.
+   * @return The name operation opcode.
+   */
+  inline opcodetype
+  getNameOp () const
+  {
+    assert (isNameOp ());
+    return op;
+  }
+
+  inline bool
+  isAnyUpdate () const
+  {
+    assert (isNameOp ());
+    return true;
+  }
+
+  /**
+   * Return the non-name part of the script.  For scripts that are no
+   * name operation, this is the whole script.
+   */
+  inline Span<const unsigned char>
+  getAddress () const
+  {
+    return address;
+  }
+
+  /** Return a copy of the address part, for code that needs a CScript.  */
+  inline CScript
+  getAddressScript () const
+  {
+    return CScript (address.begin (), address.end ());
+  }
+
+  inline Span<const unsigned char>
+  getOpName () const
+  {
+    assert (isNameOp ());
+    return name;
+  }
+
+  inline Span<const unsigned char>
+  getOpValue () const
+  {
+    assert (isNameOp ());
+    return value;
+  }
+
+  /**
+   * Fast check whether a script may be a name operation.  This only looks
+   * at the first two bytes:  If it returns false, the script is certainly
+   * not a name script.  If it returns true, it has to be parsed to know.
+   * @param script The script to check.
+   * @return False if the script cannot be a name operation.
+   */
+  static inline bool
+  MaybeNameScript (const Span<const unsigned char> script)
+  {
+    return script.size () >= 2
+            && (script[0] == OP_NAME_REGISTER || script[0] == OP_NAME_UPDATE)
+            && script[1] <= OP_PUSHDATA4;
+  }
+
+};
+
 /**
  * A script parsed for name operations.  This can be initialised
  * from a "standard" script, and will then determine if this is
@@ -160,7 +277,7 @@ public:
   static inline bool
   isNameScript (const CScript& script)
   {
-    const CNameScript op(script);
+    const CNameScriptView op(script);
     return op.isNameOp ();
   }
 
@@ -186,4 +303,13 @@ public:
 
 };
 
+/* The checks for the script templates that may follow a name prefix, on
+   raw script bytes.  They are used by the corresponding CScript methods and
+   allow to check the address part of a CNameScriptView in place.  */
+
+bool IsPayToScriptHashBytes (Span<const unsigned char> script);
+bool IsPayToWitnessScriptHashBytes (Span<const unsigned char> script);
+bool IsWitnessProgramBytes (Span<const unsigned char> script,
+                            int& version, std::vector<unsigned char>& program);
+
 #endif // H_BITCOIN_SCRIPT_NAMES
@@ -195,57 +195,34 @@ unsigned int CScript::GetSigOpCount(const CScript& scriptSig) const
     return subscript.GetSigOpCount(true);
 }
 
-bool CScript::IsPayToScriptHash(bool allowNames) const
+namespace {
+
+/** Returns the script with a name prefix (if any) stripped off.  */
+Span<const unsigned char> StripNamePrefix(const CScript& script, const bool allowNames)
 {
-    // Extra-fast test for pay-to-script-hash CScripts:
+    const Span<const unsigned char> bytes(script.data(), script.size());
     if (!allowNames)
-        return (this->size() == 23 &&
-                (*this)[0] == OP_HASH160 &&
-                (*this)[1] == 0x14 &&
-                (*this)[22] == OP_EQUAL);
+        return bytes;
+    return CNameScriptView(bytes).getAddress();
+}
+
+} // namespace
 
-    // Strip off a name prefix if present.
-    const CNameScript nameOp(*this);
-    return nameOp.getAddress().IsPayToScriptHash(false);
+bool CScript::IsPayToScriptHash(bool allowNames) const
+{
+    return IsPayToScriptHashBytes(StripNamePrefix(*this, allowNames));
 }
 
 bool CScript::IsPayToWitnessScriptHash(bool allowNames) const
 {
-    // Extra-fast test for pay-to-witness-script-hash CScripts:
-    if (!allowNames)
-        return (this->size() == 34 &&
-                (*this)[0] == OP_0 &&
-                (*this)[1] == 0x20);
-
-    // Strip off a name prefix if present.
-    const CNameScript nameOp(*this);
-    return nameOp.getAddress().IsPayToWitnessScriptHash(false);
+    return IsPayToWitnessScriptHashBytes(StripNamePrefix(*this, allowNames));
 }
 
 // A witness program is any valid CScript that consists of a 1-byte push opcode
 // followed by a data push between 2 and 40 bytes.
 bool CScript::IsWitnessProgram(const bool allowNames, int& version, std::vector<unsigned char>& program) const
 {
-    // Strip off a name prefix if present.
-    if (allowNames)
-      {
-        const CNameScript nameOp(*this);
-        return nameOp.getAddress().IsWitnessProgram(false, version, program);
-      }
-
-    // Handle the case without name prefix.
-    if (this->size() < 4 || this->size() > 42) {
-        return false;
-    }
-    if ((*this)[0] != OP_0 && ((*this)[0] < OP_1 || (*this)[0] > OP_16)) {
-        return false;
-    }
-    if ((size_t)((*this)[1] + 2) == this->size()) {
-        version = DecodeOP_N((opcodetype)(*this)[0]);
-        program = std::vector<unsigned char>(this->begin() + 2, this->end());
-        return true;
-    }
-    return false;
+    return IsWitnessProgramBytes(StripNamePrefix(*this, allowNames), version, program);
 }
 
 bool CScript::IsPushOnly(const_iterator pc) const
@@ -53,4 +53,13 @@ public:
 
 void InitSignatureCache();
 
+/** Copies the salt and all live entries of the signature cache.  */
+void GetSignatureCacheSnapshot(uint256& nonce, std::vector<uint256>& entries);
+/**
+ * Replaces the salt of the signature cache and inserts the given entries
+ * (computed with that salt).  Entries that are already in the cache become
+ * useless, so this should be done before the cache is used.
+ */
+void RestoreSignatureCacheSnapshot(const uint256& nonce, const std::vector<uint256>& entries);
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -90,22 +90,24 @@ txnouttype Solver(const CScript& scriptPubKey, std::vector<std::vector<unsigned
 {
     vSolutionsRet.clear();
 
-    // If we have a name script, strip the prefix
-    const CNameScript nameOp(scriptPubKey);
-    const CScript& script = nameOp.getAddress();
+    // If we have a name script, strip the prefix.  The pay-to-script-hash
+    // and witness checks work on the address part in place; it is only
+    // copied into its own script for the remaining templates below.
+    const CNameScriptView nameOp(scriptPubKey);
+    const Span<const unsigned char> address = nameOp.getAddress();
 
     // Shortcut for pay-to-script-hash, which are more constrained than the other types:
     // it is always OP_HASH160 20 [20 byte hash] OP_EQUAL
-    if (script.IsPayToScriptHash(false))
+    if (IsPayToScriptHashBytes(address))
     {
-        std::vector<unsigned char> hashBytes(script.begin()+2, script.begin()+22);
+        std::vector<unsigned char> hashBytes(address.begin()+2, address.begin()+22);
         vSolutionsRet.push_back(hashBytes);
         return TX_SCRIPTHASH;
     }
 
     int witnessversion;
     std::vector<unsigned char> witnessprogram;
-    if (script.IsWitnessProgram(false, witnessversion, witnessprogram)) {
+    if (IsWitnessProgramBytes(address, witnessversion, witnessprogram)) {
         if (witnessversion == 0 && witnessprogram.size() == WITNESS_V0_KEYHASH_SIZE) {
             vSolutionsRet.push_back(witnessprogram);
             return TX_WITNESS_V0_KEYHASH;
@@ -135,6 +137,11 @@ txnouttype Solver(const CScript& scriptPubKey, std::vector<std::vector<unsigned
         return TX_NULL_DATA;
     }
 
+    CScript stripped;
+    if (nameOp.isNameOp())
+        stripped = nameOp.getAddressScript();
+    const CScript& script = nameOp.isNameOp() ? stripped : scriptPubKey;
+
     std::vector<unsigned char> data;
     if (MatchPayToPubkey(script, data)) {
         vSolutionsRet.push_back(std::move(data));
@@ -0,0 +1,100 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_MONOTONIC_H
+#define BITCOIN_SUPPORT_ALLOCATORS_MONOTONIC_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+/**
+ * Memory arena that hands out memory from large chunks and never frees
+ * individual allocations.  Everything is released at once when the arena
+ * is destroyed.  This is meant for many small, short-lived objects that all
+ * die together, like the transactions of a block read for a single RPC call.
+ *
+ * Allocating is not thread-safe; freeing is a no-op and thus always is.
+ */
+class MonotonicArena
+{
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    explicit MonotonicArena(size_t chunk_size = DEFAULT_CHUNK_SIZE)
+        : m_chunk_size(chunk_size)
+    {}
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    void* Allocate(size_t bytes, size_t align)
+    {
+        uintptr_t pos = (reinterpret_cast<uintptr_t>(m_cur) + align - 1) & ~(uintptr_t)(align - 1);
+        if (m_cur == nullptr || pos + bytes > reinterpret_cast<uintptr_t>(m_end)) {
+            const size_t size = std::max(m_chunk_size, bytes + align);
+            m_chunks.emplace_back(new char[size]);
+            m_cur = m_chunks.back().get();
+            m_end = m_cur + size;
+            m_allocated += size;
+            pos = (reinterpret_cast<uintptr_t>(m_cur) + align - 1) & ~(uintptr_t)(align - 1);
+        }
+        m_cur = reinterpret_cast<char*>(pos + bytes);
+        return reinterpret_cast<void*>(pos);
+    }
+
+    /** Total size of the chunks allocated so far. */
+    size_t AllocatedBytes() const { return m_allocated; }
+
+private:
+    const size_t m_chunk_size;
+    std::vector<std::unique_ptr<char[]>> m_chunks;
+    char* m_cur = nullptr;
+    char* m_end = nullptr;
+    size_t m_allocated = 0;
+};
+
+/**
+ * Allocator that takes its memory from a shared MonotonicArena.  Every copy
+ * of the allocator keeps the arena alive, so objects whose control block
+ * holds one (like those created through std::allocate_shared) can safely
+ * outlive everything else referring to the arena.
+ */
+template <typename T>
+struct monotonic_allocator {
+    typedef T value_type;
+
+    std::shared_ptr<MonotonicArena> arena;
+
+    explicit monotonic_allocator(std::shared_ptr<MonotonicArena> arena_in) noexcept : arena(std::move(arena_in)) {}
+    template <typename U>
+    monotonic_allocator(const monotonic_allocator<U>& a) noexcept : arena(a.arena)
+    {
+    }
+
+    template <typename _Other>
+    struct rebind {
+        typedef monotonic_allocator<_Other> other;
+    };
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(arena->Allocate(sizeof(T) * n, alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        // Memory is only released together with the arena.
+    }
+
+    template <typename U>
+    bool operator==(const monotonic_allocator<U>& o) const noexcept { return arena == o.arena; }
+    template <typename U>
+    bool operator!=(const monotonic_allocator<U>& o) const noexcept { return arena != o.arena; }
+};
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_MONOTONIC_H
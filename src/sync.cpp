@@ -2,6 +2,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
 #include <sync.h>
 
 #include <logging.h>
@@ -9,6 +13,7 @@
 
 #include <stdio.h>
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <set>
@@ -24,6 +29,148 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+std::atomic<bool> g_lock_stats_enabled{DEFAULT_LOCK_STATS};
+
+namespace
+{
+
+/** Number of slots in the lock site table.  This must be a power of two and
+ *  comfortably larger than the number of LOCK() sites in the code.  */
+constexpr size_t LOCK_SITE_SLOTS = 2048;
+
+/**
+ * Statistics for one LOCK() site.  Slots are claimed on first use and never
+ * released, so that they can be accessed without any locking.
+ */
+struct LockSite
+{
+    enum : int { EMPTY = 0, CLAIMING = 1, READY = 2 };
+    std::atomic<int> state{EMPTY};
+
+    const char* name = nullptr;
+    const char* file = nullptr;
+    int line = 0;
+
+    std::atomic<uint64_t> sampled_acquisitions{0};
+    std::atomic<uint64_t> contentions{0};
+    std::atomic<uint64_t> total_wait_us{0};
+    std::atomic<uint64_t> max_wait_us{0};
+    std::atomic<uint64_t> histogram[LOCK_STATS_BUCKETS];
+
+    LockSite()
+    {
+        for (auto& bucket : histogram) bucket = 0;
+    }
+};
+
+LockSite g_lock_sites[LOCK_SITE_SLOTS];
+
+/**
+ * Finds (or claims) the slot for the given site.  Returns nullptr if the
+ * table is full.
+ */
+LockSite* LookupLockSite(const char* pszName, const char* pszFile, int nLine)
+{
+    size_t hash = reinterpret_cast<uintptr_t>(pszFile) ^ (static_cast<size_t>(nLine) * 0x9E3779B97F4A7C15ULL);
+    hash ^= hash >> 17;
+
+    for (size_t probe = 0; probe < LOCK_SITE_SLOTS; ++probe) {
+        LockSite& site = g_lock_sites[(hash + probe) & (LOCK_SITE_SLOTS - 1)];
+
+        int state = site.state.load(std::memory_order_acquire);
+        if (state == LockSite::EMPTY) {
+            if (site.state.compare_exchange_strong(state, LockSite::CLAIMING, std::memory_order_acq_rel)) {
+                site.name = pszName;
+                site.file = pszFile;
+                site.line = nLine;
+                site.state.store(LockSite::READY, std::memory_order_release);
+                return &site;
+            }
+        }
+        while (state == LockSite::CLAIMING) {
+            std::this_thread::yield();
+            state = site.state.load(std::memory_order_acquire);
+        }
+
+        if (site.file == pszFile && site.line == nLine) {
+            return &site;
+        }
+    }
+
+    return nullptr;
+}
+
+} // anonymous namespace
+
+void RecordLockAcquisition(const char* pszName, const char* pszFile, int nLine)
+{
+#ifdef HAVE_THREAD_LOCAL
+    static thread_local unsigned int counter = 0;
+    if (++counter % LOCK_STATS_SAMPLE_RATE != 0) {
+        return;
+    }
+    LockSite* site = LookupLockSite(pszName, pszFile, nLine);
+    if (site != nullptr) {
+        site->sampled_acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+#endif
+}
+
+void RecordLockContention(const char* pszName, const char* pszFile, int nLine, int64_t wait_us)
+{
+    LockSite* site = LookupLockSite(pszName, pszFile, nLine);
+    if (site == nullptr) {
+        return;
+    }
+
+    const uint64_t wait = std::max<int64_t>(wait_us, 0);
+    site->contentions.fetch_add(1, std::memory_order_relaxed);
+    site->total_wait_us.fetch_add(wait, std::memory_order_relaxed);
+    uint64_t max_wait = site->max_wait_us.load(std::memory_order_relaxed);
+    while (wait > max_wait && !site->max_wait_us.compare_exchange_weak(max_wait, wait, std::memory_order_relaxed));
+
+    unsigned int bucket = 0;
+    while (bucket + 1 < LOCK_STATS_BUCKETS && (wait >> bucket) > 0) {
+        ++bucket;
+    }
+    site->histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<LockSiteStats> GetLockStats()
+{
+    std::vector<LockSiteStats> result;
+    for (const LockSite& site : g_lock_sites) {
+        if (site.state.load(std::memory_order_acquire) != LockSite::READY) {
+            continue;
+        }
+
+        LockSiteStats stats;
+        stats.name = site.name;
+        stats.file = site.file;
+        stats.line = site.line;
+        stats.acquisitions = site.sampled_acquisitions.load(std::memory_order_relaxed) * LOCK_STATS_SAMPLE_RATE;
+        stats.contentions = site.contentions.load(std::memory_order_relaxed);
+        stats.total_wait_us = site.total_wait_us.load(std::memory_order_relaxed);
+        stats.max_wait_us = site.max_wait_us.load(std::memory_order_relaxed);
+        for (const auto& bucket : site.histogram) {
+            stats.histogram.push_back(bucket.load(std::memory_order_relaxed));
+        }
+        result.push_back(std::move(stats));
+    }
+    return result;
+}
+
+void ResetLockStats()
+{
+    for (LockSite& site : g_lock_sites) {
+        site.sampled_acquisitions = 0;
+        site.contentions = 0;
+        site.total_wait_us = 0;
+        site.max_wait_us = 0;
+        for (auto& bucket : site.histogram) bucket = 0;
+    }
+}
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
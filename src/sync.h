@@ -8,9 +8,13 @@
 
 #include <threadsafety.h>
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <string>
 #include <thread>
 #include <mutex>
+#include <vector>
 
 
 ////////////////////////////////////////////////
@@ -113,6 +117,46 @@ typedef AnnotatedMixin<std::mutex> Mutex;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/**
+ * Lock contention statistics.  Whenever a LOCK() has to wait for its mutex,
+ * the time spent waiting is recorded for the source location of the LOCK()
+ * in a fixed-size, lock-free table.  Acquisitions themselves are only
+ * sampled (one in LOCK_STATS_SAMPLE_RATE per thread) to estimate how often
+ * each site locks.  This is cheap enough to stay enabled in production
+ * builds; it can be turned off with -lockstats=0.
+ */
+static const bool DEFAULT_LOCK_STATS = true;
+static const unsigned int LOCK_STATS_SAMPLE_RATE = 64;
+/** Number of buckets in the wait time histograms.  Bucket i counts waits
+ *  of less than 2^i microseconds (and at least 2^(i-1)), the last bucket
+ *  all longer waits.  */
+static const unsigned int LOCK_STATS_BUCKETS = 20;
+
+extern std::atomic<bool> g_lock_stats_enabled;
+
+void RecordLockAcquisition(const char* pszName, const char* pszFile, int nLine);
+void RecordLockContention(const char* pszName, const char* pszFile, int nLine, int64_t wait_us);
+
+/** Contention statistics of a single LOCK() site.  */
+struct LockSiteStats
+{
+    std::string name;
+    std::string file;
+    int line;
+    /** Estimated number of acquisitions (from sampling).  */
+    uint64_t acquisitions;
+    /** Number of acquisitions that had to wait.  */
+    uint64_t contentions;
+    uint64_t total_wait_us;
+    uint64_t max_wait_us;
+    std::vector<uint64_t> histogram;
+};
+
+/** Returns the statistics of all LOCK() sites that have been recorded.  */
+std::vector<LockSiteStats> GetLockStats();
+/** Resets all lock statistics to zero.  */
+void ResetLockStats();
+
 /** Wrapper around std::unique_lock style lock for Mutex. */
 template <typename Mutex, typename Base = typename Mutex::UniqueLock>
 class SCOPED_LOCKABLE UniqueLock : public Base
@@ -121,14 +165,22 @@ private:
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(Base::mutex()));
-#ifdef DEBUG_LOCKCONTENTION
+        const bool stats = g_lock_stats_enabled.load(std::memory_order_relaxed);
         if (!Base::try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
             PrintLockContention(pszName, pszFile, nLine);
 #endif
-            Base::lock();
-#ifdef DEBUG_LOCKCONTENTION
+            if (stats) {
+                const auto start = std::chrono::steady_clock::now();
+                Base::lock();
+                const auto wait = std::chrono::steady_clock::now() - start;
+                RecordLockContention(pszName, pszFile, nLine, std::chrono::duration_cast<std::chrono::microseconds>(wait).count());
+            } else {
+                Base::lock();
+            }
         }
-#endif
+        if (stats)
+            RecordLockAcquisition(pszName, pszFile, nLine);
     }
 
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
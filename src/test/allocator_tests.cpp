@@ -4,6 +4,7 @@
 
 #include <util/system.h>
 
+#include <support/allocators/monotonic.h>
 #include <support/allocators/secure.h>
 #include <test/test_bitcoin.h>
 
@@ -233,4 +234,44 @@ BOOST_AUTO_TEST_CASE(lockedpool_tests_live)
     BOOST_CHECK(pool.stats().used == initial.used);
 }
 
+BOOST_AUTO_TEST_CASE(monotonic_arena_tests)
+{
+    MonotonicArena arena(256);
+    BOOST_CHECK_EQUAL(arena.AllocatedBytes(), 0U);
+
+    // Allocations are aligned and do not overlap.
+    char* a = static_cast<char*>(arena.Allocate(3, 1));
+    uint64_t* b = static_cast<uint64_t*>(arena.Allocate(sizeof(uint64_t), alignof(uint64_t)));
+    BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(b) % alignof(uint64_t), 0U);
+    BOOST_CHECK(reinterpret_cast<char*>(b) >= a + 3);
+    BOOST_CHECK_EQUAL(arena.AllocatedBytes(), 256U);
+
+    // Requests that do not fit start a new chunk, large ones get their own.
+    arena.Allocate(250, 1);
+    BOOST_CHECK_EQUAL(arena.AllocatedBytes(), 512U);
+    arena.Allocate(1000, 8);
+    BOOST_CHECK_EQUAL(arena.AllocatedBytes(), 512U + 1008U);
+}
+
+BOOST_AUTO_TEST_CASE(monotonic_allocator_lifetime)
+{
+    auto arena = std::make_shared<MonotonicArena>();
+    std::weak_ptr<MonotonicArena> weak = arena;
+
+    std::shared_ptr<int> value = std::allocate_shared<int>(monotonic_allocator<int>(arena), 42);
+    {
+        // Containers hold a copy of the allocator (and thus the arena) for
+        // as long as they exist.
+        std::vector<int, monotonic_allocator<int>> vec{monotonic_allocator<int>(arena)};
+        vec.assign(100, 1);
+    }
+
+    // The objects keep the arena alive on their own.
+    arena.reset();
+    BOOST_CHECK(!weak.expired());
+    BOOST_CHECK_EQUAL(*value, 42);
+    value.reset();
+    BOOST_CHECK(weak.expired());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -361,6 +361,55 @@ BOOST_FIXTURE_TEST_CASE (check_auxpow, BasicTestingSetup)
   BOOST_CHECK (builder2.get ().check (hashAux, ourChainId, params));
 }
 
+BOOST_FIXTURE_TEST_CASE (auxpow_cache, BasicTestingSetup)
+{
+  const Consensus::Params& params = Params ().GetConsensus ();
+  CAuxpowBuilder builder;
+
+  const uint256 hashAux = ArithToUint256 (arith_uint256(54321));
+  const int32_t ourChainId = params.nAuxpowChainId;
+  const unsigned height = 3;
+  const int nonce = 42;
+
+  const int index = CAuxPow::getExpectedIndex (nonce, ourChainId, height);
+  const valtype auxRoot = builder.buildAuxpowChain (hashAux, height, index);
+  const valtype data
+    = CAuxpowBuilder::buildCoinbaseData (true, auxRoot, height, nonce);
+  builder.setCoinbase (CScript () << data);
+
+  CAuxPowForTest auxpow(builder.parentBlock.vtx[0]);
+  static_cast<CAuxPow&> (auxpow) = builder.get ();
+  BOOST_CHECK (auxpow.checkUncached (hashAux, ourChainId, params));
+
+  /* Check twice, so that the second time hits the cache.  */
+  BOOST_CHECK (auxpow.check (hashAux, ourChainId, params));
+  BOOST_CHECK (auxpow.check (hashAux, ourChainId, params));
+
+  /* The cached result must not apply to anything else.  */
+  uint256 modifiedAux(hashAux);
+  tamperWith (modifiedAux);
+  BOOST_CHECK (!auxpow.check (modifiedAux, ourChainId, params));
+  BOOST_CHECK (!auxpow.check (hashAux, ourChainId + 1, params));
+
+  CAuxPowForTest modified(auxpow);
+  modified.nChainIndex = index ^ 1;
+  BOOST_CHECK (!modified.check (hashAux, ourChainId, params));
+
+  modified = auxpow;
+  tamperWith (modified.vChainMerkleBranch[0]);
+  BOOST_CHECK (!modified.check (hashAux, ourChainId, params));
+
+  modified = auxpow;
+  tamperWith (modified.coinbaseTx.hashBlock);
+  BOOST_CHECK (modified.check (hashAux, ourChainId, params));
+  tamperWith (modified.parentBlock.hashMerkleRoot);
+  BOOST_CHECK (!modified.check (hashAux, ourChainId, params));
+
+  modified = auxpow;
+  modified.coinbaseTx.vMerkleBranch.push_back (uint256 ());
+  BOOST_CHECK (!modified.check (hashAux, ourChainId, params));
+}
+
 /* ************************************************************************** */
 
 /**
@@ -163,6 +163,11 @@ BOOST_AUTO_TEST_CASE(blockfilters_json_test)
         BlockFilter computed_filter_basic(BlockFilterType::BASIC, block, block_undo);
         BOOST_CHECK(computed_filter_basic.GetFilter().GetEncoded() == filter_basic);
 
+        const CBlockView block_view(ParseHex(test[2].get_str()));
+        BlockFilter view_filter_basic(BlockFilterType::BASIC, block_view, block_undo);
+        BOOST_CHECK(view_filter_basic.GetFilter().GetEncoded() == filter_basic);
+        BOOST_CHECK_EQUAL(view_filter_basic.GetBlockHash(), computed_filter_basic.GetBlockHash());
+
         uint256 computed_header_basic = computed_filter_basic.ComputeHeader(prev_filter_header_basic);
         BOOST_CHECK(computed_header_basic == filter_header_basic);
     }
@@ -0,0 +1,156 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockreplay.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <consensus/merkle.h>
+#include <miner.h>
+#include <streams.h>
+#include <test/test_bitcoin.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+
+struct RegtestingSetup : public TestingSetup
+{
+    RegtestingSetup() : TestingSetup(CBaseChainParams::REGTEST) {}
+};
+
+/** Returns a valid coinbase-only block on top of prev.  */
+std::shared_ptr<const CBlock> CreateBlock(const CBlock& prev, const int n)
+{
+    CScript pubKey;
+    pubKey << n << OP_TRUE;
+
+    auto ptemplate = BlockAssembler(Params()).CreateNewBlock(PowAlgo::NEOSCRYPT, pubKey);
+    auto pblock = std::make_shared<CBlock>(ptemplate->block);
+    pblock->hashPrevBlock = prev.GetHash();
+    pblock->nTime = prev.nTime + 1;
+
+    CMutableTransaction txCoinbase(*pblock->vtx[0]);
+    txCoinbase.vout.resize(1);
+    txCoinbase.vin[0].scriptWitness.SetNull();
+    pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
+    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+
+    auto& fakeHeader = pblock->pow.initFakeHeader(*pblock);
+    while (!pblock->pow.checkProofOfWork(fakeHeader, Params().GetConsensus())) {
+        ++fakeHeader.nNonce;
+    }
+
+    return pblock;
+}
+
+/** Writes the blocks to path in the format of the block files, with some
+ *  garbage in front that has to be skipped.  */
+void WriteBlockFile(const fs::path& path, const std::vector<std::shared_ptr<const CBlock>>& blocks)
+{
+    CAutoFile fileout(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!fileout.IsNull());
+    fileout << std::string("garbage");
+    for (const auto& block : blocks) {
+        const unsigned int nSize = GetSerializeSize(*block, fileout.GetVersion());
+        fileout << Params().MessageStart() << nSize << *block;
+    }
+}
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE(blockreplay_tests, RegtestingSetup)
+
+BOOST_AUTO_TEST_CASE(blockreplay_files)
+{
+    const fs::path dir = SetDataDir("blockreplay_files") / "replay";
+    fs::create_directories(dir);
+    for (const std::string name : {"blk00001.dat", "blk00000.dat", "rev00000.dat", "blk0.dat", "other.txt"}) {
+        WriteBlockFile(dir / name, {});
+    }
+
+    const std::vector<fs::path> files = GetBlockReplayFiles(dir);
+    BOOST_REQUIRE_EQUAL(files.size(), 2);
+    BOOST_CHECK(files[0] == dir / "blk00000.dat");
+    BOOST_CHECK(files[1] == dir / "blk00001.dat");
+
+    const std::vector<fs::path> single = GetBlockReplayFiles(dir / "other.txt");
+    BOOST_REQUIRE_EQUAL(single.size(), 1);
+    BOOST_CHECK(single[0] == dir / "other.txt");
+}
+
+BOOST_AUTO_TEST_CASE(blockreplay_chain)
+{
+    const fs::path dir = SetDataDir("blockreplay_chain");
+
+    std::vector<std::shared_ptr<const CBlock>> blocks;
+    std::shared_ptr<const CBlock> prev = std::make_shared<const CBlock>(Params().GenesisBlock());
+    for (int i = 0; i < 20; ++i) {
+        blocks.push_back(CreateBlock(*prev, i));
+        prev = blocks.back();
+    }
+
+    // The first file has two blocks out of order, and one block that only
+    // comes in the second file.
+    std::vector<std::shared_ptr<const CBlock>> first(blocks.begin(), blocks.begin() + 10);
+    std::swap(first[3], first[4]);
+    first.push_back(blocks[15]);
+    std::vector<std::shared_ptr<const CBlock>> second(blocks.begin() + 10, blocks.begin() + 15);
+    second.insert(second.end(), blocks.begin() + 16, blocks.end());
+
+    const std::vector<fs::path> files = {dir / "blk00000.dat", dir / "blk00001.dat"};
+    WriteBlockFile(files[0], first);
+    WriteBlockFile(files[1], second);
+
+    BlockReplayStats stats;
+    BOOST_CHECK(ReplayBlockFiles(Params(), files, stats));
+    BOOST_CHECK_EQUAL(stats.blocks, 20);
+    BOOST_CHECK_EQUAL(stats.accepted, 20);
+    BOOST_CHECK_EQUAL(stats.rejected, 0);
+    BOOST_CHECK_EQUAL(stats.orphans, 0);
+    BOOST_CHECK_EQUAL(stats.start_height, 0);
+    BOOST_CHECK_EQUAL(stats.end_height, 20);
+    BOOST_CHECK(stats.end_tip == blocks.back()->GetHash());
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(chainActive.Tip()->GetBlockHash() == blocks.back()->GetHash());
+    }
+
+    const UniValue report = BlockReplayReport(stats);
+    BOOST_CHECK_EQUAL(report["chain"].get_str(), "regtest");
+    BOOST_CHECK_EQUAL(report["files"].size(), 2);
+    BOOST_CHECK_EQUAL(report["blocks"].get_int(), 20);
+    BOOST_CHECK_EQUAL(report["endheight"].get_int(), 20);
+    const UniValue& stages = report["stages"];
+    for (const std::string stage : {"replayread", "replaydeserialize", "checkblock", "connecttip"}) {
+        BOOST_CHECK_EQUAL(stages[stage]["lifetime"]["count"].get_int(), 20);
+    }
+
+    const fs::path pathReport = dir / "report.json";
+    BOOST_CHECK(WriteBlockReplayReport(pathReport, report));
+    fsbridge::ifstream file(pathReport);
+    const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    UniValue read;
+    BOOST_CHECK(read.read(content));
+    BOOST_CHECK_EQUAL(read.write(), report.write());
+
+    // Replaying again does not change anything, while a block whose parent
+    // is missing is counted as orphan.
+    WriteBlockFile(files[1], {blocks[5], CreateBlock(*CreateBlock(*prev, 100), 101)});
+    BOOST_CHECK(ReplayBlockFiles(Params(), {files[1]}, stats));
+    BOOST_CHECK_EQUAL(stats.blocks, 2);
+    BOOST_CHECK_EQUAL(stats.accepted, 0);
+    BOOST_CHECK_EQUAL(stats.orphans, 1);
+    BOOST_CHECK_EQUAL(stats.start_height, 20);
+    BOOST_CHECK_EQUAL(stats.end_height, 20);
+
+    BOOST_CHECK(!ReplayBlockFiles(Params(), {dir / "missing.dat"}, stats));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
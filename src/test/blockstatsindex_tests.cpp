@@ -0,0 +1,88 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <index/blockstatsindex.h>
+#include <names/encoding.h>
+#include <script/names.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(blockstatsindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(blockstatsindex_initial_sync, TestChain100Setup)
+{
+    BlockStatsIndex index(1 << 20, true);
+
+    CBlockStats stats;
+    BOOST_CHECK(!index.LookupStats(chainActive.Tip(), stats));
+    BOOST_CHECK(!index.BlockUntilSyncedToCurrentChain());
+
+    index.Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // All blocks so far contain just their coinbase.
+    for (int height = 0; height <= chainActive.Height(); ++height) {
+        BOOST_REQUIRE(index.LookupStats(chainActive[height], stats));
+        BOOST_CHECK_EQUAL(stats.txs, 1);
+        BOOST_CHECK_EQUAL(stats.inputs, 0);
+        BOOST_CHECK_EQUAL(stats.totalfee, 0);
+        BOOST_CHECK_EQUAL(stats.name_registrations, 0);
+    }
+
+    // Spend a coinbase into a name registration that also sends a move
+    // to two games.  The ID of one game is repeated, which still counts
+    // as a single move (as with -zmqpubgameblocks).
+    const CTransaction& prev = *m_coinbase_txns[0];
+    const CScript& prev_script = prev.vout[0].scriptPubKey;
+    const CScript addr = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    const CAmount fee = 10000;
+    const CAmount locked = COIN / 100;
+
+    CMutableTransaction mtx;
+    mtx.vin.emplace_back(COutPoint(prev.GetHash(), 0));
+    const valtype name = DecodeName("p/domob", NameEncoding::ASCII);
+    const valtype value = DecodeName("{\"g\":{\"a\":1,\"b\":2,\"a\":3}}", NameEncoding::ASCII);
+    mtx.vout.emplace_back(locked, CNameScript::buildNameRegister(addr, name, value));
+    mtx.vout.emplace_back(prev.vout[0].nValue - locked - fee, addr);
+
+    std::vector<unsigned char> sig;
+    const uint256 hash = SignatureHash(prev_script, mtx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_REQUIRE(coinbaseKey.Sign(hash, sig));
+    sig.push_back(static_cast<unsigned char>(SIGHASH_ALL));
+    mtx.vin[0].scriptSig << sig;
+
+    const CBlock block = CreateAndProcessBlock({mtx}, prev_script);
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block.GetHash());
+    BOOST_CHECK(index.BlockUntilSyncedToCurrentChain());
+
+    BOOST_REQUIRE(index.LookupStats(chainActive.Tip(), stats));
+    BOOST_CHECK_EQUAL(stats.txs, 2);
+    BOOST_CHECK_EQUAL(stats.inputs, 1);
+    BOOST_CHECK_EQUAL(stats.outputs, static_cast<int64_t>(block.vtx[0]->vout.size() + 2));
+    BOOST_CHECK_EQUAL(stats.totalfee, fee);
+    BOOST_CHECK_EQUAL(stats.minfee, fee);
+    BOOST_CHECK_EQUAL(stats.maxfee, fee);
+    BOOST_CHECK_EQUAL(stats.total_size, block.vtx[1]->GetTotalSize());
+    BOOST_CHECK(stats.algo == PowAlgo::NEOSCRYPT);
+    BOOST_CHECK_EQUAL(stats.name_registrations, 1);
+    BOOST_CHECK_EQUAL(stats.name_updates, 0);
+    BOOST_CHECK_EQUAL(stats.game_moves.size(), 2U);
+    BOOST_CHECK_EQUAL(stats.game_moves["a"], 1);
+    BOOST_CHECK_EQUAL(stats.game_moves["b"], 1);
+
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
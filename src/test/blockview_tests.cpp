@@ -0,0 +1,142 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <primitives/blockview.h>
+
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <streams.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <ios>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(blockview_tests, BasicTestingSetup)
+
+namespace
+{
+
+CBlock
+RandomBlock()
+{
+    CBlock block;
+    block.nVersion = 42;
+    block.hashPrevBlock = InsecureRand256();
+    block.nTime = InsecureRand32();
+    block.pow.setCoreAlgo(PowAlgo::NEOSCRYPT);
+    block.pow.initFakeHeader(block);
+
+    for (int i = 0; i < 10; ++i) {
+        CMutableTransaction mtx;
+        mtx.nVersion = i;
+        mtx.nLockTime = InsecureRand32();
+        mtx.vin.resize(1 + InsecureRandRange(3));
+        for (auto& in : mtx.vin) {
+            in.prevout = COutPoint(InsecureRand256(), InsecureRand32());
+            in.scriptSig = CScript() << g_insecure_rand_ctx.randbytes(InsecureRandRange(300));
+            in.nSequence = InsecureRand32();
+            if (i % 2 == 0) {
+                in.scriptWitness.stack.push_back(g_insecure_rand_ctx.randbytes(InsecureRandRange(100)));
+            }
+        }
+        mtx.vout.resize(InsecureRandRange(4));
+        for (auto& out : mtx.vout) {
+            out.nValue = InsecureRandRange(MAX_MONEY);
+            out.scriptPubKey = CScript() << g_insecure_rand_ctx.randbytes(InsecureRandRange(50));
+        }
+        block.vtx.push_back(MakeTransactionRef(std::move(mtx)));
+    }
+
+    return block;
+}
+
+std::vector<unsigned char>
+Serialize(const CBlock& block)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(matches_deserialized_block)
+{
+    const CBlock block = RandomBlock();
+    const CBlockView view(Serialize(block));
+
+    BOOST_CHECK_EQUAL(view.GetHeader().GetHash(), block.GetHash());
+    const auto& txs = view.GetTransactions();
+    BOOST_REQUIRE_EQUAL(txs.size(), block.vtx.size());
+
+    for (size_t i = 0; i < txs.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        const CTransactionView& txv = txs[i];
+
+        BOOST_CHECK_EQUAL(txv.GetHash(), tx.GetHash());
+        BOOST_CHECK_EQUAL(txv.GetWitnessHash(), tx.GetWitnessHash());
+        BOOST_CHECK_EQUAL(txv.HasWitness(), tx.HasWitness());
+        BOOST_CHECK_EQUAL(txv.GetVersion(), tx.nVersion);
+        BOOST_CHECK_EQUAL(txv.GetLockTime(), tx.nLockTime);
+        BOOST_CHECK_EQUAL(txv.GetSerialization().size(), GetSerializeSize(tx, PROTOCOL_VERSION));
+
+        BOOST_REQUIRE_EQUAL(txv.Inputs().size(), tx.vin.size());
+        size_t j = 0;
+        for (const auto& in : txv.Inputs()) {
+            BOOST_CHECK(in.prevout == tx.vin[j].prevout);
+            BOOST_CHECK(CScript(in.scriptSig.begin(), in.scriptSig.end()) == tx.vin[j].scriptSig);
+            BOOST_CHECK_EQUAL(in.nSequence, tx.vin[j].nSequence);
+            ++j;
+        }
+        BOOST_CHECK_EQUAL(j, tx.vin.size());
+
+        BOOST_REQUIRE_EQUAL(txv.Outputs().size(), tx.vout.size());
+        j = 0;
+        for (const auto& out : txv.Outputs()) {
+            BOOST_CHECK(CTxOut(out.nValue, out.GetScript()) == tx.vout[j]);
+            ++j;
+        }
+        BOOST_CHECK_EQUAL(j, tx.vout.size());
+
+        BOOST_CHECK_EQUAL(txv.ToTransaction()->GetWitnessHash(), tx.GetWitnessHash());
+    }
+
+    const CBlock copy = view.ToBlock();
+    BOOST_CHECK_EQUAL(copy.vtx.size(), block.vtx.size());
+    BOOST_CHECK(Serialize(copy) == Serialize(block));
+}
+
+BOOST_AUTO_TEST_CASE(without_witness)
+{
+    const CBlock block = RandomBlock();
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    ss << block;
+    const std::vector<unsigned char> data(ss.begin(), ss.end());
+
+    const CBlockView view(MakeSpan(data), PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    const auto& txs = view.GetTransactions();
+    BOOST_REQUIRE_EQUAL(txs.size(), block.vtx.size());
+    for (size_t i = 0; i < txs.size(); ++i) {
+        BOOST_CHECK(!txs[i].HasWitness());
+        BOOST_CHECK_EQUAL(txs[i].GetHash(), block.vtx[i]->GetHash());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(malformed)
+{
+    const CBlock block = RandomBlock();
+    std::vector<unsigned char> data = Serialize(block);
+
+    // Truncated data is only detected once the transactions are accessed.
+    data.resize(data.size() - 1);
+    const CBlockView truncated(std::move(data));
+    BOOST_CHECK_EQUAL(truncated.GetHeader().GetHash(), block.GetHash());
+    BOOST_CHECK_THROW(truncated.GetTransactions(), std::ios_base::failure);
+
+    BOOST_CHECK_THROW(CBlockView(std::vector<unsigned char>(10, 0)), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
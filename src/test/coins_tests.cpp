@@ -7,9 +7,11 @@
 #include <consensus/validation.h>
 #include <script/standard.h>
 #include <test/test_bitcoin.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <util/strencodings.h>
+#include <util/time.h>
 #include <validation.h>
 
 #include <map>
@@ -848,4 +850,39 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_deferred_compaction)
+{
+    double progress;
+
+    CCoinsViewDB normal(1 << 20, 1 << 20, true);
+    BOOST_CHECK(!normal.IsCompactionDeferred());
+    BOOST_CHECK(normal.GetCompactionProgress(progress) == CCoinsViewDB::CompactionState::NONE);
+
+    CCoinsViewDB view(1 << 20, 1 << 20, true, false, 1 << 20);
+    BOOST_CHECK(view.IsCompactionDeferred());
+    BOOST_CHECK(view.GetCompactionProgress(progress) == CCoinsViewDB::CompactionState::DEFERRED);
+    BOOST_CHECK_EQUAL(progress, 0.0);
+
+    CCoinsViewCache cache(&view);
+    for (int i = 0; i < 1000; ++i) {
+        Coin coin;
+        coin.out.nValue = i + 1;
+        coin.out.scriptPubKey.assign(InsecureRandBits(6), 0);
+        cache.AddCoin(COutPoint(InsecureRand256(), 0), std::move(coin), false);
+    }
+    cache.SetBestBlock(InsecureRand256());
+    BOOST_REQUIRE(cache.Flush());
+
+    view.StartDeferredCompaction();
+    BOOST_CHECK(!view.IsCompactionDeferred());
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    const int64_t time_start = GetTimeMillis();
+    while (view.GetCompactionProgress(progress) != CCoinsViewDB::CompactionState::FINISHED) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(10);
+    }
+    BOOST_CHECK_EQUAL(progress, 1.0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <compressedfile.h>
+#include <consensus/validation.h>
+#include <random.h>
+#include <test/test_bitcoin.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+
+/** Writes data to a file at path.  */
+void WriteFile(const fs::path& path, const std::vector<unsigned char>& data)
+{
+    FILE* file = fsbridge::fopen(path, "wb");
+    BOOST_REQUIRE(file != nullptr);
+    BOOST_REQUIRE_EQUAL(fwrite(data.data(), 1, data.size(), file), data.size());
+    fclose(file);
+}
+
+/**
+ * Returns somewhat compressible test data:  records of 64 bytes, whose
+ * first quarter is random and the rest repeats the previous record.
+ */
+std::vector<unsigned char> GetTestData(const size_t len)
+{
+    std::vector<unsigned char> res(len);
+    for (size_t i = 0; i < len; ++i) {
+        res[i] = i < 64 || i % 64 < 16 ? InsecureRandBits(8) : res[i - 64];
+    }
+    return res;
+}
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE(compressedfile_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(compressedfile_roundtrip)
+{
+    const fs::path dir = SetDataDir("compressedfile_roundtrip");
+    const fs::path plain = dir / "plain.dat";
+    const fs::path compressed = dir / "plain.cdat";
+
+    for (const size_t len : {size_t(0), size_t(1000), size_t(CCompressedFile::FRAME_SIZE), size_t(5 * CCompressedFile::FRAME_SIZE + 123)}) {
+        const std::vector<unsigned char> data = GetTestData(len);
+        WriteFile(plain, data);
+        BOOST_REQUIRE(CCompressedFile::Create(plain, compressed));
+        if (len > 1000) {
+            BOOST_CHECK(fs::file_size(compressed) < len);
+        }
+
+        CCompressedFile file(compressed);
+        BOOST_REQUIRE(!file.IsNull());
+        BOOST_CHECK_EQUAL(file.GetSize(), len);
+
+        // Read random ranges, many of them crossing frame boundaries.
+        for (int i = 0; i < 100 && len > 0; ++i) {
+            const size_t offset = InsecureRandRange(len);
+            const size_t n = InsecureRandRange(std::min<size_t>(len - offset, 3 * CCompressedFile::FRAME_SIZE) + 1);
+            std::vector<unsigned char> out(n);
+            BOOST_REQUIRE(file.Read(offset, out.data(), n));
+            BOOST_CHECK(std::equal(out.begin(), out.end(), data.begin() + offset));
+        }
+        unsigned char byte;
+        BOOST_CHECK(!file.Read(len, &byte, 1));
+
+        FILE* extracted = tmpfile();
+        BOOST_REQUIRE(extracted != nullptr);
+        BOOST_CHECK(file.Extract(extracted));
+        std::vector<unsigned char> out(len + 1);
+        rewind(extracted);
+        BOOST_CHECK_EQUAL(fread(out.data(), 1, out.size(), extracted), len);
+        fclose(extracted);
+        out.resize(len);
+        BOOST_CHECK(out == data);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(compressedfile_corrupt)
+{
+    const fs::path dir = SetDataDir("compressedfile_corrupt");
+    const fs::path plain = dir / "plain.dat";
+    const fs::path compressed = dir / "plain.cdat";
+
+    const std::vector<unsigned char> data = GetTestData(3 * CCompressedFile::FRAME_SIZE);
+    WriteFile(plain, data);
+    BOOST_REQUIRE(CCompressedFile::Create(plain, compressed));
+
+    // Flip a byte near the end, i.e. in the last frame.
+    FILE* file = fsbridge::fopen(compressed, "r+b");
+    BOOST_REQUIRE(file != nullptr);
+    BOOST_REQUIRE(fseek(file, -100, SEEK_END) == 0);
+    const int byte = fgetc(file);
+    BOOST_REQUIRE(fseek(file, -100, SEEK_END) == 0);
+    fputc(byte ^ 0x42, file);
+    fclose(file);
+
+    CCompressedFile corrupted(compressed);
+    BOOST_REQUIRE(!corrupted.IsNull());
+    std::vector<unsigned char> out(100);
+    BOOST_CHECK(corrupted.Read(0, out.data(), out.size()));
+    BOOST_CHECK(!corrupted.Extract(nullptr));
+
+    BOOST_CHECK(CCompressedFile(dir / "missing.cdat").IsNull());
+    BOOST_CHECK(CCompressedFile(plain).IsNull());
+}
+
+BOOST_FIXTURE_TEST_CASE(compressedfile_blockfiles, TestChain100Setup)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    FlushStateToDisk();
+
+    const CDiskBlockPos pos(0, 0);
+    BOOST_REQUIRE(CompressBlockFile(0));
+    BOOST_CHECK(IsBlockFileCompressed(pos));
+    BOOST_CHECK(!fs::exists(GetBlockPosFilename(pos, "blk")));
+    BOOST_CHECK(fs::exists(GetCompressedBlockPosFilename(pos, "rev")));
+
+    for (int height = 1; height <= chainActive.Height(); height += 7) {
+        const CBlockIndex* pindex = chainActive[height];
+        CBlock block;
+        BOOST_CHECK(ReadBlockFromDisk(block, pindex, params));
+        BOOST_CHECK(block.GetHash() == pindex->GetBlockHash());
+
+        std::vector<uint8_t> raw;
+        BOOST_CHECK(ReadRawBlockFromDisk(raw, pindex, Params().MessageStart()));
+        CDataStream stream(raw, SER_NETWORK, PROTOCOL_VERSION);
+        CBlock rawBlock;
+        stream >> rawBlock;
+        BOOST_CHECK(rawBlock.GetHash() == pindex->GetBlockHash());
+
+        CBlockUndo undo;
+        BOOST_CHECK(UndoReadFromDisk(undo, pindex));
+        BOOST_CHECK_EQUAL(undo.vtxundo.size(), block.vtx.size() - 1);
+    }
+
+    // Whole-file readers get the decompressed content.
+    FILE* file = OpenBlockFile(pos, true);
+    BOOST_REQUIRE(file != nullptr);
+    CMessageHeader::MessageStartChars start;
+    BOOST_CHECK_EQUAL(fread(start, 1, sizeof(start), file), sizeof(start));
+    BOOST_CHECK(memcmp(start, Params().MessageStart(), sizeof(start)) == 0);
+    fclose(file);
+    BOOST_CHECK(IsBlockFileCompressed(pos));
+
+    // New blocks are written to the file again, which decompresses it.
+    CreateAndProcessBlock({}, CScript() << OP_TRUE);
+    BOOST_CHECK(!IsBlockFileCompressed(pos));
+    BOOST_CHECK(fs::exists(GetBlockPosFilename(pos, "blk")));
+    BOOST_CHECK(!fs::exists(GetCompressedBlockPosFilename(pos, "blk")));
+
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, chainActive.Tip(), params));
+    BOOST_CHECK(ReadBlockFromDisk(block, chainActive[50], params));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
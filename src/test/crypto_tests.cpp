@@ -562,4 +562,25 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256dmulti)
+{
+    for (int i = 0; i <= 32; ++i) {
+        std::vector<std::vector<unsigned char>> in(i);
+        std::vector<const unsigned char*> inputs;
+        std::vector<size_t> lengths;
+        for (auto& msg : in) {
+            // Cover messages of up to a few blocks, including all paddings.
+            msg = g_insecure_rand_ctx.randbytes(InsecureRandRange(300));
+            inputs.push_back(msg.data());
+            lengths.push_back(msg.size());
+        }
+        std::vector<unsigned char> out1(32 * i), out2(32 * i);
+        for (int j = 0; j < i; ++j) {
+            CHash256().Write(in[j].data(), in[j].size()).Finalize(out1.data() + 32 * j);
+        }
+        SHA256DMulti(out2.data(), inputs.data(), lengths.data(), i);
+        BOOST_CHECK(out1 == out2);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
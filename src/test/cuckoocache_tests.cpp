@@ -362,4 +362,32 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
 }
 
+/** Check that a snapshot of the live elements can be restored into a fresh
+ * cache and does not contain erased elements.
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_snapshot)
+{
+    SeedInsecureRand(true);
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc{};
+    const uint32_t n = cc.setup_bytes(1 << 20) / 4;
+    std::vector<uint256> hashes;
+    for (uint32_t i = 0; i < n; ++i) {
+        hashes.push_back(InsecureRand256());
+        cc.insert(hashes.back());
+    }
+    for (uint32_t i = 0; i < n / 2; ++i)
+        BOOST_CHECK(cc.contains(hashes[i], true));
+
+    std::vector<uint256> snapshot;
+    cc.for_each_live([&snapshot](const uint256& e) { snapshot.push_back(e); });
+    BOOST_CHECK_EQUAL(snapshot.size(), n - n / 2);
+
+    CuckooCache::cache<uint256, SignatureCacheHasher> restored{};
+    restored.setup_bytes(1 << 20);
+    for (const uint256& e : snapshot)
+        restored.insert(e);
+    for (uint32_t i = 0; i < n; ++i)
+        BOOST_CHECK_EQUAL(restored.contains(hashes[i], false), i >= n / 2);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,112 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <dbcompress/snappy.h>
+#include <random.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+namespace
+{
+
+std::string Compress(const std::string& input)
+{
+    std::string res(snappy::MaxCompressedLength(input.size()), '\0');
+    size_t len;
+    snappy::RawCompress(input.data(), input.size(), &res[0], &len);
+    BOOST_REQUIRE(len <= res.size());
+    res.resize(len);
+    return res;
+}
+
+bool Uncompress(const std::string& compressed, std::string& output)
+{
+    size_t len;
+    if (!snappy::GetUncompressedLength(compressed.data(), compressed.size(), &len)) {
+        return false;
+    }
+    output.assign(len, '\0');
+    return snappy::RawUncompress(compressed.data(), compressed.size(), &output[0]);
+}
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE(dbcompress_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(snappy_vectors)
+{
+    // Hand-encoded according to the format description.
+    const struct {
+        std::string compressed;
+        std::string expected;
+    } tests[] = {
+        {std::string("\x00", 1), ""},
+        {std::string("\x03\x08" "abc", 5), "abc"},
+        // Literal "a" and an overlapping copy of 9 bytes at offset 1.
+        {std::string("\x0a\x00" "a" "\x15\x01", 5), "aaaaaaaaaa"},
+        // Literal "abcd" and a 2-byte offset copy of 6 bytes at offset 4.
+        {std::string("\x0a\x0c" "abcd" "\x16\x04\x00", 9), "abcdabcdab"},
+        // A 4-byte offset copy.
+        {std::string("\x06\x08" "xyz" "\x0b\x03\x00\x00\x00", 10), "xyzxyz"},
+        // Literal with a one-byte length (61 bytes).
+        {std::string("\x3d\xf0\x3c", 3) + std::string(61, 'q'), std::string(61, 'q')},
+    };
+
+    for (const auto& test : tests) {
+        std::string output;
+        BOOST_CHECK(Uncompress(test.compressed, output));
+        BOOST_CHECK_EQUAL(output, test.expected);
+    }
+
+    BOOST_CHECK_EQUAL(Compress(""), std::string("\x00", 1));
+    BOOST_CHECK_EQUAL(Compress("abc"), std::string("\x03\x08" "abc", 5));
+    BOOST_CHECK_EQUAL(Compress("aaaaaaaaaa"), std::string("\x0a\x00" "a" "\x15\x01", 5));
+}
+
+BOOST_AUTO_TEST_CASE(snappy_roundtrip)
+{
+    for (int i = 0; i < 200; ++i) {
+        const size_t len = InsecureRandRange(i < 100 ? 300 : 200000);
+        std::string input(len, '\0');
+        const bool random = i % 2 == 0;
+        for (size_t j = 0; j < len; ++j) {
+            if (random || j < 64) {
+                input[j] = static_cast<char>(InsecureRandBits(8));
+            } else {
+                // Repeat earlier data at varying distances.
+                input[j] = input[j - 1 - InsecureRandRange(64)];
+            }
+        }
+
+        const std::string compressed = Compress(input);
+        std::string output;
+        BOOST_CHECK(Uncompress(compressed, output));
+        BOOST_CHECK(output == input);
+        if (!random && len >= 1000) {
+            BOOST_CHECK(compressed.size() < len);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(snappy_corrupt)
+{
+    std::string output;
+
+    // Truncated length and truncated data.
+    BOOST_CHECK(!Uncompress(std::string("\x80", 1), output));
+    BOOST_CHECK(!Uncompress(std::string("\x05\x10" "abc", 5), output));
+    // Too short or too long output for the length.
+    BOOST_CHECK(!Uncompress(std::string("\x04\x08" "abc", 5), output));
+    BOOST_CHECK(!Uncompress(std::string("\x02\x08" "abc", 5), output));
+    // Copies with zero offset or reaching before the start.
+    BOOST_CHECK(!Uncompress(std::string("\x05\x00" "a" "\x01\x00", 5), output));
+    BOOST_CHECK(!Uncompress(std::string("\x05\x00" "a" "\x01\x02", 5), output));
+    // Truncated copy.
+    BOOST_CHECK(!Uncompress(std::string("\x05\x00" "a" "\x02\x01", 5), output));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
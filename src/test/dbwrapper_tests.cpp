@@ -120,6 +120,35 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
 }
 
 // Test that we do not obfuscation if there is existing data.
+BOOST_AUTO_TEST_CASE(dbwrapper_iterator_in_place)
+{
+    for (const bool obfuscate : {false, true}) {
+        fs::path ph = SetDataDir(std::string("dbwrapper_iterator_in_place").append(obfuscate ? "_true" : "_false"));
+        CDBWrapper dbw(ph, (1 << 20), true, false, obfuscate);
+
+        const std::vector<unsigned char> in(1000, 0x42);
+        const uint32_t num = 0x12345678;
+        BOOST_CHECK(dbw.Write('j', std::make_pair(in, num)));
+
+        std::unique_ptr<CDBIterator> it(const_cast<CDBWrapper&>(dbw).NewIterator());
+        it->Seek('j');
+
+        std::pair<std::vector<unsigned char>, uint32_t> res;
+        BOOST_REQUIRE(it->GetValueInPlace(res));
+        BOOST_CHECK(res.first == in);
+        BOOST_CHECK_EQUAL(res.second, num);
+
+        // Reading just a prefix of the value works as well.
+        std::vector<unsigned char> prefix;
+        BOOST_REQUIRE(it->GetValueInPlace(prefix));
+        BOOST_CHECK(prefix == in);
+
+        // Reading past the end fails.
+        std::pair<std::pair<std::vector<unsigned char>, uint32_t>, uint32_t> tooLong;
+        BOOST_CHECK(!it->GetValueInPlace(tooLong));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(existing_data_no_obfuscate)
 {
     // We're going to share this fs::path between two wrappers
@@ -317,6 +346,87 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
+// Returns the total size of the table files of a database.
+static uintmax_t GetTableFilesSize(const fs::path& path)
+{
+    uintmax_t size = 0;
+    for (fs::directory_iterator it(path); it != fs::directory_iterator(); ++it) {
+        if (it->path().extension() == ".ldb") {
+            size += fs::file_size(it->path());
+        }
+    }
+    return size;
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_compression)
+{
+    uintmax_t table_size[2];
+    for (const bool compression : {false, true}) {
+        fs::path ph = SetDataDir(std::string("dbwrapper_compression").append(compression ? "_true" : "_false"));
+        DBTuning tuning;
+        tuning.compression = compression;
+
+        std::unique_ptr<CDBWrapper> dbw = MakeUnique<CDBWrapper>(ph, (1 << 20), false, true, false, tuning);
+        for (uint32_t i = 0; i < 1000; ++i) {
+            const std::string value = strprintf("{\"g\":{\"game\":{\"move\":%u}}}", i);
+            BOOST_CHECK(dbw->Write(std::make_pair('v', i), value));
+        }
+        // Force all data into table files.
+        dbw->CompactRange(std::make_pair('v', uint32_t(0)), std::make_pair('v', uint32_t(1000)));
+        dbw.reset();
+        table_size[compression] = GetTableFilesSize(ph);
+
+        // Reading works when the data comes from the (compressed) tables.
+        dbw = MakeUnique<CDBWrapper>(ph, (1 << 20), false, false, false, tuning);
+        for (uint32_t i = 0; i < 1000; ++i) {
+            std::string value;
+            BOOST_CHECK(dbw->Read(std::make_pair('v', i), value));
+            BOOST_CHECK_EQUAL(value, strprintf("{\"g\":{\"game\":{\"move\":%u}}}", i));
+        }
+    }
+    BOOST_CHECK(table_size[false] > 0);
+    BOOST_CHECK(table_size[true] < table_size[false]);
+}
 
+BOOST_AUTO_TEST_CASE(dbwrapper_compression_existing)
+{
+    // A database written without compression (as by older versions) still
+    // opens and reads with compression enabled, and vice versa.
+    fs::path ph = SetDataDir("dbwrapper_compression_existing");
+    DBTuning plain;
+    DBTuning compressed;
+    compressed.compression = true;
+
+    std::unique_ptr<CDBWrapper> dbw = MakeUnique<CDBWrapper>(ph, (1 << 20), false, true, false, plain);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        BOOST_CHECK(dbw->Write(std::make_pair('v', i), strprintf("{\"g\":{\"game\":{\"move\":%u}}}", i)));
+    }
+    dbw->CompactRange(std::make_pair('v', uint32_t(0)), std::make_pair('v', uint32_t(1000)));
+    dbw.reset();
+    const uintmax_t plain_size = GetTableFilesSize(ph);
+
+    // Reopen with compression and add more data.  Compacting rewrites the
+    // old tables compressed.
+    dbw = MakeUnique<CDBWrapper>(ph, (1 << 20), false, false, false, compressed);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        std::string value;
+        BOOST_CHECK(dbw->Read(std::make_pair('v', i), value));
+        BOOST_CHECK_EQUAL(value, strprintf("{\"g\":{\"game\":{\"move\":%u}}}", i));
+    }
+    for (uint32_t i = 1000; i < 2000; ++i) {
+        BOOST_CHECK(dbw->Write(std::make_pair('v', i), strprintf("{\"g\":{\"game\":{\"move\":%u}}}", i)));
+    }
+    dbw->CompactRange(std::make_pair('v', uint32_t(0)), std::make_pair('v', uint32_t(2000)));
+    dbw.reset();
+    BOOST_CHECK(GetTableFilesSize(ph) < 2 * plain_size);
+
+    // Turning compression off again still reads the compressed tables.
+    dbw = MakeUnique<CDBWrapper>(ph, (1 << 20), false, false, false, plain);
+    for (uint32_t i = 0; i < 2000; ++i) {
+        std::string value;
+        BOOST_CHECK(dbw->Read(std::make_pair('v', i), value));
+        BOOST_CHECK_EQUAL(value, strprintf("{\"g\":{\"game\":{\"move\":%u}}}", i));
+    }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
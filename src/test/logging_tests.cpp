@@ -0,0 +1,118 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <logging.h>
+
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(logging_tests, BasicTestingSetup)
+
+namespace
+{
+
+/** Sets up a logger that writes (without timestamps) to a file in the
+ *  test's data directory.  */
+class FileLogger
+{
+public:
+    BCLog::Logger logger;
+
+    explicit FileLogger(const fs::path& path)
+    {
+        logger.m_file_path = path / "debug.log";
+        logger.m_print_to_file = true;
+        logger.m_log_timestamps = false;
+        BOOST_REQUIRE(logger.OpenDebugLog());
+    }
+
+    std::string Read() const
+    {
+        std::ifstream in(logger.m_file_path.string());
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(async_keeps_order)
+{
+    FileLogger file(SetDataDir("logging_async_keeps_order"));
+    file.logger.StartAsync(16);
+    BOOST_CHECK(file.logger.IsAsync());
+
+    std::string expected;
+    for (int i = 0; i < 10; ++i) {
+        const std::string line = strprintf("line %d\n", i);
+        file.logger.LogPrintStr(line);
+        expected += line;
+    }
+
+    file.logger.StopAsync();
+    BOOST_CHECK(!file.logger.IsAsync());
+    BOOST_CHECK_EQUAL(file.Read(), expected);
+    BOOST_CHECK_EQUAL(file.logger.GetDroppedMessages(), 0);
+
+    /* Afterwards, logging is synchronous again.  */
+    file.logger.LogPrintStr("sync\n");
+    BOOST_CHECK_EQUAL(file.Read(), expected + "sync\n");
+}
+
+BOOST_AUTO_TEST_CASE(async_multiple_threads)
+{
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 1000;
+
+    FileLogger file(SetDataDir("logging_async_multiple_threads"));
+    file.logger.StartAsync(1 << 14);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&file, t] () {
+            for (int i = 0; i < PER_THREAD; ++i) {
+                file.logger.LogPrintStr(strprintf("%d %d\n", t, i));
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    file.logger.StopAsync();
+
+    const std::string content = file.Read();
+    const size_t lines = std::count(content.begin(), content.end(), '\n');
+    BOOST_CHECK_EQUAL(lines + file.logger.GetDroppedMessages(), THREADS * PER_THREAD);
+}
+
+BOOST_AUTO_TEST_CASE(rate_limit)
+{
+    BCLog::Logger logger;
+
+    /* Without a limit, everything is accepted.  */
+    for (int i = 0; i < 100; ++i) {
+        BOOST_CHECK(logger.AcceptRateLimited(BCLog::NAMES));
+    }
+
+    /* The limit applies per category.  Since a new one-second window may
+       start during the test, at most twice the limit can be accepted.  */
+    logger.m_rate_limit = 10;
+    int accepted_names = 0;
+    int accepted_game = 0;
+    for (int i = 0; i < 100; ++i) {
+        if (logger.AcceptRateLimited(BCLog::NAMES)) ++accepted_names;
+        if (logger.AcceptRateLimited(BCLog::GAME)) ++accepted_game;
+    }
+    BOOST_CHECK_GE(accepted_names, 10);
+    BOOST_CHECK_LE(accepted_names, 20);
+    BOOST_CHECK_GE(accepted_game, 10);
+    BOOST_CHECK_LE(accepted_game, 20);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
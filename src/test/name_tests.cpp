@@ -11,6 +11,7 @@
 #include <policy/policy.h>
 #include <primitives/transaction.h>
 #include <script/names.h>
+#include <streams.h>
 #include <txdb.h>
 #include <txmempool.h>
 #include <undo.h>
@@ -115,6 +116,59 @@ BOOST_AUTO_TEST_CASE (name_scripts)
   BOOST_CHECK (opUpdate.getOpValue () == value);
 }
 
+BOOST_AUTO_TEST_CASE (name_script_view)
+{
+  const CScript addr = getTestAddress ();
+  const valtype name = DecodeName ("x/my-cool-name", NameEncoding::ASCII);
+  const valtype value = DecodeName (val ("42!"), NameEncoding::ASCII);
+
+  BOOST_CHECK (!CNameScriptView::MaybeNameScript (MakeSpan (addr)));
+  const CNameScriptView viewNone(addr);
+  BOOST_CHECK (!viewNone.isNameOp ());
+  BOOST_CHECK (viewNone.getAddress () == MakeSpan (addr));
+
+  const CScript script = CNameScript::buildNameUpdate (addr, name, value);
+  BOOST_CHECK (CNameScriptView::MaybeNameScript (MakeSpan (script)));
+  const CNameScriptView view(script);
+  BOOST_CHECK (view.isNameOp ());
+  BOOST_CHECK (view.getNameOp () == OP_NAME_UPDATE);
+  BOOST_CHECK (view.getAddressScript () == addr);
+  BOOST_CHECK (valtype (view.getOpName ().begin (), view.getOpName ().end ())
+                == name);
+  BOOST_CHECK (valtype (view.getOpValue ().begin (), view.getOpValue ().end ())
+                == value);
+
+  /* The view refers to the original script's bytes.  */
+  BOOST_CHECK (view.getAddress ().end () == script.data () + script.size ());
+
+  /* Truncate the script at every position.  Up to the final OP_DROP of the
+     prefix, the result must be rejected.  */
+  const size_t prefixLen = script.size () - addr.size ();
+  for (size_t len = 0; len <= script.size (); ++len)
+    {
+      const CScript truncated(script.begin (), script.begin () + len);
+      const CNameScriptView cur(truncated);
+      const CNameScript full(truncated);
+      BOOST_CHECK_EQUAL (cur.isNameOp (), len + 1 >= prefixLen);
+      BOOST_CHECK_EQUAL (full.isNameOp (), cur.isNameOp ());
+      BOOST_CHECK_EQUAL (CNameScript::isNameScript (truncated),
+                         cur.isNameOp ());
+      if (len > prefixLen)
+        BOOST_CHECK (cur.getAddressScript ()
+                      == CScript (addr.begin (),
+                                  addr.begin () + (len - prefixLen)));
+    }
+
+  /* Too many or too few arguments.  */
+  CScript bad;
+  bad << OP_NAME_UPDATE << name << value << value << OP_2DROP << OP_2DROP;
+  BOOST_CHECK (!CNameScriptView (bad).isNameOp ());
+  bad = CScript ();
+  bad << OP_NAME_REGISTER << name << OP_DROP;
+  bad += addr;
+  BOOST_CHECK (!CNameScriptView (bad).isNameOp ());
+}
+
 /* ************************************************************************** */
 
 BOOST_AUTO_TEST_CASE (name_database)
@@ -151,6 +205,158 @@ BOOST_AUTO_TEST_CASE (name_database)
   BOOST_CHECK (!view.GetName (name1, data2));
   BOOST_CHECK (view.Flush ());
   BOOST_CHECK (!view.GetName (name1, data2));
+
+  /* The name database is committed together with the coins.  */
+  BOOST_CHECK (pcoinsdbview->RecoverNameDB ());
+}
+
+BOOST_AUTO_TEST_CASE (name_database_upgrade_without_names)
+{
+  /* The databases are reopened below, so use their own data directory
+     instead of the one with the global chainstate.  */
+  const std::string oldDatadir = gArgs.GetArg ("-datadir", "");
+  const fs::path datadir = fs::path (oldDatadir) / "upgrade";
+  fs::create_directories (datadir);
+  gArgs.ForceSetArg ("-datadir", datadir.string ());
+  ClearDatadirCache ();
+
+  const uint256 hashBlock = uint256S ("42");
+  {
+    CCoinsViewDB db(1 << 20, 1 << 20);
+
+    /* An empty chainstate needs no marker yet.  */
+    BOOST_CHECK (db.Upgrade ());
+    BOOST_CHECK (db.RecoverNameDB ());
+
+    CCoinsMap coins;
+    BOOST_CHECK (db.BatchWrite (coins, hashBlock, CNameCache ()));
+    BOOST_CHECK (db.RecoverNameDB ());
+  }
+
+  /* Turn this into a chainstate without any names from before the name
+     database, which only has the best block in the coin database.  The key
+     is DB_BEST_BLOCK from txdb.cpp.  */
+  {
+    CDBWrapper nameDb(GetDataDir () / "namestate", 1 << 20);
+    BOOST_CHECK (nameDb.Erase ('B', true));
+  }
+
+  /* The upgrade must mark the name database as being at that block, even
+     though there is nothing to move over.  */
+  {
+    CCoinsViewDB db(1 << 20, 1 << 20);
+    BOOST_CHECK (!db.RecoverNameDB ());
+    BOOST_CHECK (db.Upgrade ());
+    BOOST_CHECK (db.RecoverNameDB ());
+    BOOST_CHECK (db.GetBestBlock () == hashBlock);
+  }
+
+  gArgs.ForceSetArg ("-datadir", oldDatadir);
+  ClearDatadirCache ();
+}
+
+BOOST_AUTO_TEST_CASE (name_read_cache)
+{
+  const valtype name1 = DecodeName ("x/read-cache-1", NameEncoding::ASCII);
+  const valtype name2 = DecodeName ("x/read-cache-2", NameEncoding::ASCII);
+  const valtype value = DecodeName (val ("my-value"), NameEncoding::ASCII);
+  const CScript updateScript
+      = CNameScript::buildNameUpdate (getTestAddress (), name1, value);
+
+  CNameData data1, data2, res;
+  data1.fromScript (10, COutPoint (uint256 (), 1), CNameScript (updateScript));
+  data2.fromScript (20, COutPoint (uint256 (), 2), CNameScript (updateScript));
+
+  CCoinsViewCache view(pcoinsTip.get ());
+  view.SetBestBlock (pcoinsTip->GetBestBlock ());
+  view.SetNameReadCacheSize (1 << 20);
+
+  /* Negative lookups are cached as well.  */
+  BOOST_CHECK (!view.GetName (name1, res));
+  BOOST_CHECK (!view.GetName (name1, res));
+  CNameReadCache::Stats stats = view.GetNameReadCacheStats ();
+  BOOST_CHECK_EQUAL (stats.entries, 1);
+  BOOST_CHECK_EQUAL (stats.hits, 1);
+  BOOST_CHECK_EQUAL (stats.misses, 1);
+  BOOST_CHECK (stats.usage > 0 && stats.usage <= stats.maxUsage);
+
+  /* Changes made through the view invalidate the entry, also once they
+     are flushed to the base view.  */
+  view.SetName (name1, data1, false);
+  BOOST_CHECK (view.Flush ());
+  BOOST_CHECK (view.GetName (name1, res));
+  BOOST_CHECK (res == data1);
+  BOOST_CHECK (view.GetName (name1, res));
+  BOOST_CHECK (res == data1);
+
+  /* Same for changes coming in from a child view.  */
+  {
+    CCoinsViewCache child(&view);
+    child.SetName (name1, data2, false);
+    BOOST_CHECK (child.Flush ());
+  }
+  BOOST_CHECK (view.Flush ());
+  BOOST_CHECK (view.GetName (name1, res));
+  BOOST_CHECK (res == data2);
+
+  view.DeleteName (name1);
+  BOOST_CHECK (view.Flush ());
+  BOOST_CHECK (!view.GetName (name1, res));
+
+  /* Lowering the limit evicts the least-recently used entries.  */
+  BOOST_CHECK (!view.GetName (name2, res));
+  BOOST_CHECK_EQUAL (view.GetNameReadCacheStats ().entries, 2);
+  view.SetNameReadCacheSize (view.GetNameReadCacheStats ().usage - 1);
+  stats = view.GetNameReadCacheStats ();
+  BOOST_CHECK_EQUAL (stats.entries, 1);
+  const uint64_t hits = stats.hits;
+  BOOST_CHECK (!view.GetName (name2, res));
+  BOOST_CHECK_EQUAL (view.GetNameReadCacheStats ().hits, hits + 1);
+
+  view.SetNameReadCacheSize (0);
+  stats = view.GetNameReadCacheStats ();
+  BOOST_CHECK_EQUAL (stats.entries, 0);
+  BOOST_CHECK_EQUAL (stats.usage, 0);
+}
+
+BOOST_AUTO_TEST_CASE (name_cache_serialisation)
+{
+  /* The history is only allowed with -namehistory.  */
+  fNameHistory = true;
+
+  const valtype name1 = DecodeName ("x/name-1", NameEncoding::ASCII);
+  const valtype name2 = DecodeName ("x/name-2", NameEncoding::ASCII);
+  const valtype value = DecodeName (val ("my-value"), NameEncoding::ASCII);
+  const CScript updateScript
+      = CNameScript::buildNameUpdate (getTestAddress (), name1, value);
+
+  CNameData data;
+  data.fromScript (42, COutPoint (uint256 (), 1), CNameScript (updateScript));
+  CNameHistory history;
+  history.push (data);
+
+  CNameCache cache;
+  cache.set (name1, data);
+  cache.setHistory (name1, history);
+  cache.remove (name2);
+
+  CDataStream stream(SER_DISK, PROTOCOL_VERSION);
+  stream << cache;
+  CNameCache restored;
+  stream >> restored;
+  BOOST_CHECK (stream.empty ());
+
+  CNameData data2;
+  BOOST_CHECK (restored.get (name1, data2));
+  BOOST_CHECK (data2 == data);
+  BOOST_CHECK (!restored.get (name2, data2));
+  BOOST_CHECK (restored.isDeleted (name2));
+
+  CNameHistory history2;
+  BOOST_CHECK (restored.getHistory (name1, history2));
+  BOOST_CHECK (history2.getData () == history.getData ());
+
+  fNameHistory = false;
 }
 
 /* ************************************************************************** */
@@ -359,6 +565,27 @@ NameIterationTester::verify (const CCoinsView& view) const
       else
         start = remaining.front ().first;
     }
+
+  /* Filter on both the name and the height (which is the counter value
+     for the test data).  */
+  const CNameIterator::Filter filter
+      = [] (const valtype& name, const unsigned height)
+        {
+          return height % 2 == 0 || name.size () == 3;
+        };
+  EntryList expected;
+  for (const auto& entry : data)
+    if (filter (entry.first, entry.second.getHeight ()))
+      expected.push_back (entry);
+
+  iter->setFilter (filter);
+  iter->seek (valtype ());
+  BOOST_CHECK (getNamesFromIterator (*iter) == expected);
+
+  iter->setFilter (CNameIterator::Filter ());
+  iter->seek (valtype ());
+  BOOST_CHECK (getNamesFromIterator (*iter)
+                == EntryList (data.begin (), data.end ()));
 }
 
 void
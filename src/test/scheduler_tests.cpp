@@ -10,6 +10,11 @@
 #include <boost/thread.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+
 BOOST_AUTO_TEST_SUITE(scheduler_tests)
 
 static void microTask(CScheduler& s, boost::mutex& mutex, int& counter, int delta, boost::chrono::system_clock::time_point rescheduleTime)
@@ -155,4 +160,65 @@ BOOST_AUTO_TEST_CASE(singlethreadedscheduler_ordered)
     BOOST_CHECK_EQUAL(counter2, 100);
 }
 
+BOOST_AUTO_TEST_CASE(priorities)
+{
+    CScheduler scheduler;
+    std::string order;
+
+    const auto due = boost::chrono::system_clock::now() - boost::chrono::seconds(1);
+    scheduler.schedule([&order] { order += 'l'; }, due, CScheduler::Priority::LOW);
+    scheduler.schedule([&order] { order += 'n'; }, due, CScheduler::Priority::NORMAL);
+    scheduler.schedule([&order] { order += 'h'; }, due, CScheduler::Priority::HIGH);
+
+    // A task that is not yet due does not block lower priorities.
+    scheduler.scheduleFromNow([&order] { order += 'H'; }, 100, CScheduler::Priority::HIGH);
+
+    // Process everything on this thread.
+    scheduler.stop(true);
+    scheduler.serviceQueue();
+
+    BOOST_CHECK_EQUAL(order, "hnlH");
+}
+
+BOOST_AUTO_TEST_CASE(low_priority_leaves_thread_free)
+{
+    CScheduler scheduler;
+
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<int> lowRunning{0};
+    std::atomic<int> lowStarted{0};
+    std::atomic<int> maxLowRunning{0};
+
+    auto lowTask = [&, released] {
+        ++lowStarted;
+        const int running = ++lowRunning;
+        int expected = maxLowRunning;
+        while (running > expected && !maxLowRunning.compare_exchange_weak(expected, running)) {}
+        released.wait();
+        --lowRunning;
+    };
+    scheduler.schedule(lowTask, boost::chrono::system_clock::now(), CScheduler::Priority::LOW);
+    scheduler.schedule(lowTask, boost::chrono::system_clock::now(), CScheduler::Priority::LOW);
+
+    boost::thread_group threads;
+    for (int i = 0; i < 2; ++i) {
+        threads.create_thread(std::bind(&CScheduler::serviceQueue, &scheduler));
+    }
+
+    // While a LOW task blocks one thread, the other one is still free for
+    // HIGH tasks, but not for the second LOW task.
+    std::promise<void> highDone;
+    scheduler.schedule([&highDone] { highDone.set_value(); }, boost::chrono::system_clock::now(), CScheduler::Priority::HIGH);
+    BOOST_CHECK(highDone.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    BOOST_CHECK(lowStarted <= 1);
+
+    release.set_value();
+    scheduler.stop(true);
+    threads.join_all();
+
+    BOOST_CHECK_EQUAL(lowStarted, 2);
+    BOOST_CHECK_EQUAL(maxLowRunning, 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
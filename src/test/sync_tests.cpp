@@ -7,6 +7,9 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <future>
+#include <thread>
+
 namespace {
 template <typename MutexType>
 void TestPotentialDeadLockDetected(MutexType& mutex1, MutexType& mutex2)
@@ -49,4 +52,48 @@ BOOST_AUTO_TEST_CASE(potential_deadlock_detected)
     #endif
 }
 
+BOOST_AUTO_TEST_CASE(lock_contention_stats)
+{
+    const bool prev = g_lock_stats_enabled;
+    g_lock_stats_enabled = true;
+    ResetLockStats();
+
+    Mutex mutex;
+    std::promise<void> locked;
+    std::promise<void> release;
+    std::thread holder([&] {
+        LOCK(mutex);
+        locked.set_value();
+        release.get_future().wait();
+        MilliSleep(10);
+    });
+    locked.get_future().wait();
+    release.set_value();
+    const int line = __LINE__ + 1;
+    { LOCK(mutex); }
+    holder.join();
+
+    bool found = false;
+    for (const auto& stats : GetLockStats()) {
+        if (stats.line != line || stats.file != __FILE__) continue;
+        found = true;
+        BOOST_CHECK_EQUAL(stats.name, "mutex");
+        BOOST_CHECK_EQUAL(stats.contentions, 1U);
+        BOOST_CHECK(stats.max_wait_us > 0);
+        BOOST_CHECK_EQUAL(stats.total_wait_us, stats.max_wait_us);
+        BOOST_CHECK_EQUAL(stats.histogram.size(), LOCK_STATS_BUCKETS);
+        uint64_t total = 0;
+        for (const auto count : stats.histogram) total += count;
+        BOOST_CHECK_EQUAL(total, 1U);
+    }
+    BOOST_CHECK(found);
+
+    ResetLockStats();
+    for (const auto& stats : GetLockStats()) {
+        BOOST_CHECK_EQUAL(stats.contentions, 0U);
+    }
+
+    g_lock_stats_enabled = prev;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -19,6 +19,7 @@
 #include <script/sign.h>
 #include <script/script_error.h>
 #include <script/standard.h>
+#include <streams.h>
 #include <util/strencodings.h>
 
 #include <map>
@@ -503,6 +504,38 @@ SignatureData CombineSignatures(const CMutableTransaction& input1, const CMutabl
     return sigdata;
 }
 
+BOOST_AUTO_TEST_CASE(batched_hashes)
+{
+    std::vector<CTransactionRef> txs;
+    for (int i = 0; i < 20; ++i) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1 + InsecureRandRange(3));
+        for (auto& in : mtx.vin) {
+            in.prevout = COutPoint(InsecureRand256(), InsecureRand32());
+            in.scriptSig = CScript() << g_insecure_rand_ctx.randbytes(InsecureRandRange(200));
+            if (i % 3 == 0) {
+                in.scriptWitness.stack.push_back(g_insecure_rand_ctx.randbytes(InsecureRandRange(100)));
+            }
+        }
+        mtx.vout.resize(1);
+        mtx.vout[0].nValue = InsecureRandRange(MAX_MONEY);
+        txs.push_back(MakeTransactionRef(std::move(mtx)));
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << txs;
+    std::vector<CTransactionRef> batched;
+    UnserializeTransactions(ss, batched);
+
+    BOOST_CHECK(ss.empty());
+    BOOST_REQUIRE_EQUAL(batched.size(), txs.size());
+    for (size_t i = 0; i < txs.size(); ++i) {
+        BOOST_CHECK_EQUAL(batched[i]->GetHash(), txs[i]->GetHash());
+        BOOST_CHECK_EQUAL(batched[i]->GetWitnessHash(), txs[i]->GetWitnessHash());
+        BOOST_CHECK_EQUAL(batched[i]->HasWitness(), i % 3 == 0);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(test_witness)
 {
     CBasicKeyStore keystore, keystore2;
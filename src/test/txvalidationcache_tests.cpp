@@ -9,8 +9,10 @@
 #include <pubkey.h>
 #include <txmempool.h>
 #include <random.h>
+#include <script/sigcache.h>
 #include <script/standard.h>
 #include <script/sign.h>
+#include <streams.h>
 #include <test/test_bitcoin.h>
 #include <util/time.h>
 #include <core_io.h>
@@ -368,4 +370,60 @@ BOOST_FIXTURE_TEST_CASE(checkinputs_test, TestChain100Setup)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(validation_cache_persistence, TestingSetup)
+{
+    // Make sure that the signature cache has some entries.
+    uint256 nonce;
+    std::vector<uint256> entries;
+    GetSignatureCacheSnapshot(nonce, entries);
+    std::vector<uint256> extra;
+    for (int i = 0; i < 10; ++i) {
+        extra.push_back(InsecureRand256());
+    }
+    RestoreSignatureCacheSnapshot(nonce, extra);
+
+    std::vector<uint256> before;
+    GetSignatureCacheSnapshot(nonce, before);
+    BOOST_CHECK(before.size() >= extra.size());
+    std::sort(before.begin(), before.end());
+
+    BOOST_REQUIRE(DumpValidationCaches());
+
+    // Start over with an empty cache and a fresh nonce, so that the
+    // comparison below only passes if the entries are actually loaded.
+    InitSignatureCache();
+    RestoreSignatureCacheSnapshot(InsecureRand256(), {});
+    std::vector<uint256> cleared;
+    uint256 clearedNonce;
+    GetSignatureCacheSnapshot(clearedNonce, cleared);
+    BOOST_REQUIRE(cleared.empty());
+    BOOST_REQUIRE(clearedNonce != nonce);
+
+    BOOST_CHECK(LoadValidationCaches());
+
+    uint256 restoredNonce;
+    std::vector<uint256> after;
+    GetSignatureCacheSnapshot(restoredNonce, after);
+    std::sort(after.begin(), after.end());
+    BOOST_CHECK(restoredNonce == nonce);
+    BOOST_CHECK(after == before);
+
+    // A corrupted file is rejected.
+    const fs::path path = GetDataDir() / "sigcache.dat";
+    {
+        CAutoFile file(fsbridge::fopen(path, "r+b"), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(!file.IsNull());
+        BOOST_REQUIRE(fseek(file.Get(), 60, SEEK_SET) == 0);
+        char byte;
+        file.read(&byte, 1);
+        byte ^= 0xff;
+        BOOST_REQUIRE(fseek(file.Get(), 60, SEEK_SET) == 0);
+        file.write(&byte, 1);
+    }
+    BOOST_CHECK(!LoadValidationCaches());
+
+    fs::remove(path);
+    BOOST_CHECK(!LoadValidationCaches());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -186,4 +186,85 @@ BOOST_AUTO_TEST_CASE(processnewblock_signals_ordering)
     BOOST_CHECK_EQUAL(sub.m_expected_tip, chainActive.Tip()->GetBlockHash());
 }
 
+namespace
+{
+
+/** Builds a block with a coinbase and num_txs transactions spending random
+ *  outputs, each paying to the given script.  */
+CBlock BlockWithTransactions(const int num_txs, const CScript& script)
+{
+    CBlock block;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << 1 << OP_0;
+    coinbase.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    block.vtx.push_back(MakeTransactionRef(std::move(coinbase)));
+
+    for (int i = 0; i < num_txs; ++i) {
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+        mtx.vin.emplace_back(COutPoint(InsecureRand256(), 1));
+        mtx.vout.emplace_back(COIN, script);
+        block.vtx.push_back(MakeTransactionRef(std::move(mtx)));
+    }
+    // The PoW data is not checked, but must be present for serialisation.
+    block.pow.initFakeHeader(block);
+
+    return block;
+}
+
+/** Runs CheckBlock without and with parallel transaction checks and
+ *  verifies that the results are the same.  */
+bool CheckBlockBothWays(const CBlock& block, CValidationState& state)
+{
+    const int nThreads = nBlockCheckThreads;
+    BOOST_REQUIRE(nThreads > 0);
+
+    nBlockCheckThreads = 0;
+    CValidationState serialState;
+    const bool serial = CheckBlock(block, serialState, Params().GetConsensus(), false, false);
+    nBlockCheckThreads = nThreads;
+
+    const bool parallel = CheckBlock(block, state, Params().GetConsensus(), false, false);
+    BOOST_CHECK_EQUAL(parallel, serial);
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), serialState.GetRejectReason());
+    BOOST_CHECK_EQUAL(state.GetDebugMessage(), serialState.GetDebugMessage());
+
+    return parallel;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(checkblock_parallel)
+{
+    const int num_txs = 2 * MIN_PARALLEL_CHECKBLOCK_TXS;
+    CValidationState state;
+
+    CBlock block = BlockWithTransactions(num_txs, CScript() << OP_TRUE);
+    BOOST_CHECK(CheckBlockBothWays(block, state));
+
+    // With several invalid transactions, the first one is reported.
+    CMutableTransaction mtx(*block.vtx[80]);
+    mtx.vin[1] = mtx.vin[0];
+    block.vtx[80] = MakeTransactionRef(mtx);
+    mtx = CMutableTransaction(*block.vtx[90]);
+    mtx.vout[0].nValue = -1;
+    block.vtx[90] = MakeTransactionRef(mtx);
+    BOOST_CHECK(!CheckBlockBothWays(block, state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-txns-inputs-duplicate");
+    BOOST_CHECK(state.GetDebugMessage().find(block.vtx[80]->GetHash().ToString()) != std::string::npos);
+
+    // The sigops of all transactions are counted.
+    CScript manySigOps;
+    for (unsigned i = 0; i <= MAX_BLOCK_SIGOPS_COST / WITNESS_SCALE_FACTOR / num_txs; ++i) {
+        manySigOps << OP_CHECKSIG;
+    }
+    block = BlockWithTransactions(num_txs, manySigOps);
+    state = CValidationState();
+    BOOST_CHECK(!CheckBlockBothWays(block, state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-blk-sigops");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,129 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <validationinterface.h>
+
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, TestingSetup)
+
+namespace
+{
+
+class TipRecorder : public CValidationInterface
+{
+public:
+    std::vector<int> heights;
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override
+    {
+        heights.push_back(pindexNew->nHeight);
+    }
+};
+
+/** Blocks in its callback until it is released.  */
+class BlockingSubscriber : public CValidationInterface
+{
+public:
+    std::promise<void> started;
+    std::shared_future<void> release;
+    std::atomic<bool> finished{false};
+
+    explicit BlockingSubscriber(std::shared_future<void> releaseIn) : release(std::move(releaseIn)) {}
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override
+    {
+        started.set_value();
+        release.wait();
+        finished = true;
+    }
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(per_subscriber_queues)
+{
+    std::vector<CBlockIndex> indices(20);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i].nHeight = i;
+    }
+
+    TipRecorder first, second;
+    RegisterValidationInterface(&first, "first");
+    RegisterValidationInterface(&second, "second");
+
+    for (size_t i = 0; i < 10; ++i) {
+        GetMainSignals().UpdatedBlockTip(&indices[i], nullptr, false);
+    }
+    SyncWithValidationInterfaceQueue();
+
+    UnregisterValidationInterface(&second);
+    for (size_t i = 10; i < indices.size(); ++i) {
+        GetMainSignals().UpdatedBlockTip(&indices[i], nullptr, false);
+    }
+    SyncWithValidationInterfaceQueue();
+
+    BOOST_CHECK_EQUAL(first.heights.size(), indices.size());
+    for (size_t i = 0; i < first.heights.size(); ++i) {
+        BOOST_CHECK_EQUAL(first.heights[i], static_cast<int>(i));
+    }
+    BOOST_CHECK_EQUAL(second.heights.size(), 10U);
+
+    bool found = false;
+    for (const auto& stats : GetMainSignals().GetQueueStats()) {
+        BOOST_CHECK(stats.name != "second");
+        if (stats.name == "first") {
+            found = true;
+            BOOST_CHECK_EQUAL(stats.pending, 0U);
+            BOOST_CHECK(stats.max_pending >= 1);
+            BOOST_CHECK(stats.processed >= indices.size());
+        }
+    }
+    BOOST_CHECK(found);
+    BOOST_CHECK_EQUAL(GetMainSignals().CallbacksPending(), 0U);
+
+    UnregisterValidationInterface(&first);
+}
+
+BOOST_AUTO_TEST_CASE(sync_waits_for_unregistered)
+{
+    CBlockIndex index;
+    std::promise<void> release;
+    BlockingSubscriber subscriber(release.get_future().share());
+    RegisterValidationInterface(&subscriber, "blocking");
+
+    GetMainSignals().UpdatedBlockTip(&index, nullptr, false);
+    subscriber.started.get_future().wait();
+    UnregisterValidationInterface(&subscriber);
+
+    // The callback is still running, so syncing has to wait for it even
+    // though the subscriber is no longer registered.
+    std::atomic<bool> synced{false};
+    std::thread syncer([&synced] {
+        SyncWithValidationInterfaceQueue();
+        synced = true;
+    });
+    MilliSleep(100);
+    BOOST_CHECK(!synced);
+
+    release.set_value();
+    syncer.join();
+    BOOST_CHECK(synced);
+    BOOST_CHECK(subscriber.finished);
+
+    // Afterwards, the retired queue is dropped and syncing returns directly.
+    SyncWithValidationInterfaceQueue();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
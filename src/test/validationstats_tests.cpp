@@ -0,0 +1,98 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <validationstats.h>
+
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validationstats_tests, BasicTestingSetup)
+
+namespace
+{
+
+ValidationStageStats
+GetStage(const ValidationStats& registry, const ValidationStage stage)
+{
+    const std::string name = ValidationStats::GetStageName(stage);
+    for (const auto& stats : registry.GetStats()) {
+        if (stats.name == name) return stats;
+    }
+    BOOST_ERROR("stage not found: " << name);
+    return ValidationStageStats();
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(lifetime_totals)
+{
+    ValidationStats registry(10);
+    BOOST_CHECK_EQUAL(registry.Record(ValidationStage::CONNECT, 5), 5);
+    BOOST_CHECK_EQUAL(registry.Record(ValidationStage::CONNECT, 100), 105);
+    BOOST_CHECK_EQUAL(registry.Record(ValidationStage::FLUSH, 7), 7);
+
+    const auto connect = GetStage(registry, ValidationStage::CONNECT);
+    BOOST_CHECK_EQUAL(connect.count, 2);
+    BOOST_CHECK_EQUAL(connect.total_us, 105);
+    BOOST_CHECK_EQUAL(connect.max_us, 100);
+
+    BOOST_CHECK_EQUAL(GetStage(registry, ValidationStage::NAMES).count, 0);
+    BOOST_CHECK_EQUAL(registry.GetStats().size(), NUM_VALIDATION_STAGES);
+}
+
+BOOST_AUTO_TEST_CASE(histogram)
+{
+    ValidationStats registry(10);
+    registry.Record(ValidationStage::CHECK, 0);
+    registry.Record(ValidationStage::CHECK, 1);
+    registry.Record(ValidationStage::CHECK, 3);
+    registry.Record(ValidationStage::CHECK, 4);
+    registry.Record(ValidationStage::CHECK, int64_t{1} << 40);
+
+    const auto check = GetStage(registry, ValidationStage::CHECK);
+    BOOST_REQUIRE_EQUAL(check.histogram.size(), VALIDATION_STATS_BUCKETS);
+    BOOST_CHECK_EQUAL(check.histogram[0], 1);
+    BOOST_CHECK_EQUAL(check.histogram[1], 1);
+    BOOST_CHECK_EQUAL(check.histogram[2], 1);
+    BOOST_CHECK_EQUAL(check.histogram[3], 1);
+    BOOST_CHECK_EQUAL(check.histogram.back(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(recent_window)
+{
+    ValidationStats registry(10);
+
+    /* The first samples are large, but get pushed out of the window.  */
+    for (int i = 0; i < 5; ++i) {
+        registry.Record(ValidationStage::VERIFY, 1000);
+    }
+    for (int i = 1; i <= 10; ++i) {
+        registry.Record(ValidationStage::VERIFY, i);
+    }
+
+    const auto verify = GetStage(registry, ValidationStage::VERIFY);
+    BOOST_CHECK_EQUAL(verify.count, 15);
+    BOOST_CHECK_EQUAL(verify.max_us, 1000);
+    BOOST_CHECK_EQUAL(verify.recent_count, 10);
+    BOOST_CHECK_EQUAL(verify.recent_total_us, 55);
+    BOOST_CHECK_EQUAL(verify.recent_median_us, 5);
+    BOOST_CHECK_EQUAL(verify.recent_p90_us, 9);
+    BOOST_CHECK_EQUAL(verify.recent_max_us, 10);
+}
+
+BOOST_AUTO_TEST_CASE(reset)
+{
+    ValidationStats registry(10);
+    registry.Record(ValidationStage::ZMQ_GAMES, 42);
+    registry.Reset();
+
+    const auto games = GetStage(registry, ValidationStage::ZMQ_GAMES);
+    BOOST_CHECK_EQUAL(games.count, 0);
+    BOOST_CHECK_EQUAL(games.total_us, 0);
+    BOOST_CHECK_EQUAL(games.recent_count, 0);
+    BOOST_CHECK_EQUAL(registry.Record(ValidationStage::ZMQ_GAMES, 1), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -15,8 +15,11 @@
 #include <uint256.h>
 #include <util/system.h>
 #include <ui_interface.h>
+#include <util/time.h>
 #include <validation.h>
 
+#include <functional>
+
 #include <stdint.h>
 
 #include <boost/thread.hpp>
@@ -28,6 +31,7 @@ static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_NAME = 'n';
 static const char DB_NAME_HISTORY = 'h';
+static const char DB_PENDING_NAMES = 'N';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
@@ -57,10 +61,136 @@ struct CoinEntry {
     }
 };
 
+/**
+ * Redo record of the name changes of a commit, stored in the coin database
+ * under DB_PENDING_NAMES until they have been applied to the name database.
+ * It is read back as std::pair<uint256, CNameCache>.
+ */
+struct PendingNamesEntry {
+    const uint256& hashBlock;
+    const CNameCache& names;
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        s << hashBlock;
+        s << names;
+    }
+};
+
+/**
+ * Tuning of the name database:  Its working set is small and hot, so most
+ * of the cache goes to the block cache, with small blocks for the random
+ * point reads and small table files to keep compactions short.
+ */
+DBTuning GetNameDBTuning(size_t nCacheSize)
+{
+    DBTuning tuning;
+    tuning.block_cache_size = nCacheSize / 4 * 3;
+    tuning.write_buffer_size = nCacheSize / 8;
+    tuning.block_size = 1024;
+    tuning.max_file_size = 1 << 20;
+    // Name values are mostly JSON, which compresses well.
+    tuning.compression = gArgs.GetBoolArg("-dbcompression", DEFAULT_DB_COMPRESSION);
+    return tuning;
+}
+
+/**
+ * Tuning of the coin database during the initial sync.  Larger write
+ * buffers and table files mean fewer level-0 files per flushed amount of
+ * data, and thus fewer compactions and write stalls.
+ */
+DBTuning GetInitialSyncTuning(size_t nWriteBuffer)
+{
+    DBTuning tuning;
+    if (nWriteBuffer > 0) {
+        tuning.write_buffer_size = nWriteBuffer;
+        tuning.max_file_size = 8 << 20;
+    }
+    return tuning;
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true)
+/** The deferred compaction compacts the coins in 256 steps by the first byte
+ *  of their txid, then the rest of the coin database and the name database
+ *  in 256 steps each by the first byte of their keys.  */
+constexpr int COMPACTION_STEPS = 3 * 256;
+
+/** The block index is compressed as well with -dbcompression.  Its records
+ *  repeat mostly the same version, bits and algo fields, so the table blocks
+ *  compress despite the hashes in them.  */
+DBTuning GetBlockTreeDBTuning()
 {
+    DBTuning tuning;
+    tuning.compression = gArgs.GetBoolArg("-dbcompression", DEFAULT_DB_COMPRESSION);
+    return tuning;
+}
+
+}
+
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, size_t nNameCacheSize, bool fMemory, bool fWipe, size_t nInitialSyncWriteBuffer)
+    : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true, GetInitialSyncTuning(nInitialSyncWriteBuffer)),
+      // A compressed name database is not obfuscated, as that would defeat
+      // the compression.  The same values are in the block files in plain
+      // anyway.  This only matters when the database is created.
+      nameDb(GetDataDir() / "namestate", nNameCacheSize, fMemory, fWipe, !gArgs.GetBoolArg("-dbcompression", DEFAULT_DB_COMPRESSION), GetNameDBTuning(nNameCacheSize)),
+      m_compaction_state(nInitialSyncWriteBuffer > 0 ? CompactionState::DEFERRED : CompactionState::NONE)
+{
+}
+
+CCoinsViewDB::~CCoinsViewDB()
+{
+    m_interrupt_compaction = true;
+    if (m_compaction_thread.joinable()) {
+        m_compaction_thread.join();
+    }
+}
+
+void CCoinsViewDB::StartDeferredCompaction()
+{
+    CompactionState expected = CompactionState::DEFERRED;
+    if (!m_compaction_state.compare_exchange_strong(expected, CompactionState::RUNNING)) {
+        return;
+    }
+    m_compaction_thread = std::thread(&TraceThread<std::function<void()>>, "dbcompact",
+                                      std::bind(&CCoinsViewDB::ThreadCompact, this));
+}
+
+void CCoinsViewDB::ThreadCompact()
+{
+    LogPrintf("Initial sync done, compacting the chainstate database\n");
+    const int64_t nStart = GetTimeMillis();
+
+    for (int i = 0; i < COMPACTION_STEPS; ++i) {
+        if (m_interrupt_compaction) {
+            LogPrintf("Compaction of the chainstate database interrupted\n");
+            m_compaction_state = CompactionState::INTERRUPTED;
+            return;
+        }
+        if (i < 256) {
+            // The last range ends at the first key after all coins.
+            const std::pair<char, unsigned char> begin(DB_COIN, i);
+            const std::pair<char, unsigned char> end(i < 255 ? DB_COIN : DB_COIN + 1, i < 255 ? i + 1 : 0);
+            db.CompactRange(begin, end);
+        } else if (i < 2 * 256) {
+            // The coins themselves are done already.
+            if (i - 256 != static_cast<unsigned char>(DB_COIN)) {
+                db.CompactPrefix(i - 256);
+            }
+        } else {
+            nameDb.CompactPrefix(i - 2 * 256);
+        }
+        ++m_compaction_steps;
+    }
+
+    LogPrintf("Compacted the chainstate database in %.2fs\n", (GetTimeMillis() - nStart) * 0.001);
+    m_compaction_state = CompactionState::FINISHED;
+}
+
+CCoinsViewDB::CompactionState CCoinsViewDB::GetCompactionProgress(double& progress) const
+{
+    // Read the state first, so that FINISHED always comes with full progress.
+    const CompactionState state = m_compaction_state;
+    progress = static_cast<double>(m_compaction_steps) / COMPACTION_STEPS;
+    return state;
 }
 
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
@@ -87,12 +217,12 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::GetName(const valtype &name, CNameData& data) const {
-    return db.Read(std::make_pair(DB_NAME, name), data);
+    return nameDb.Read(std::make_pair(DB_NAME, name), data);
 }
 
 bool CCoinsViewDB::GetNameHistory(const valtype &name, CNameHistory& data) const {
     assert (fNameHistory);
-    return db.Read(std::make_pair(DB_NAME_HISTORY, name), data);
+    return nameDb.Read(std::make_pair(DB_NAME_HISTORY, name), data);
 }
 
 class CDbNameIterator : public CNameIterator
@@ -128,23 +258,37 @@ void CDbNameIterator::seek(const valtype& start) {
 }
 
 bool CDbNameIterator::next(valtype& name, CNameData& data) {
-    if (!iter->Valid())
-        return false;
+    for (; iter->Valid(); iter->Next()) {
+        std::pair<char, valtype> key;
+        if (!iter->GetKey(key) || key.first != DB_NAME)
+            return false;
+
+        // For the filter, only the height is de-obfuscated and read, and
+        // the value before it skipped.  Thus the data of entries that are
+        // filtered out is neither copied nor de-obfuscated.
+        if (filter) {
+            CNameData::HeightOnly height;
+            if (!iter->GetValueInPlace(height))
+                return error("%s : failed to read height from iterator", __func__);
+            if (!matches(key.second, height.nHeight))
+                continue;
+        }
 
-    std::pair<char, valtype> key;
-    if (!iter->GetKey(key) || key.first != DB_NAME)
-        return false;
-    name = key.second;
+        // The full data is read in place as well, so that it is not copied
+        // into a temporary stream first.
+        name = std::move(key.second);
+        if (!iter->GetValueInPlace(data))
+            return error("%s : failed to read data from iterator", __func__);
 
-    if (!iter->GetValue(data))
-        return error("%s : failed to read data from iterator", __func__);
+        iter->Next ();
+        return true;
+    }
 
-    iter->Next ();
-    return true;
+    return false;
 }
 
 CNameIterator* CCoinsViewDB::IterateNames() const {
-    return new CDbNameIterator(db);
+    return new CDbNameIterator(nameDb);
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, const CNameCache &names) {
@@ -171,6 +315,9 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, con
     // interrupting after partial writes from multiple independent reorgs.
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
+    // Also record the name changes with it, so that they can be redone
+    // if we crash before they are written to the name database.
+    batch.Write(DB_PENDING_NAMES, PendingNamesEntry{hashBlock, names});
 
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
@@ -198,16 +345,75 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, con
         }
     }
 
-    names.writeBatch(batch);
-
     // In the last batch, mark the database as consistent with hashBlock again.
     batch.Erase(DB_HEAD_BLOCKS);
     batch.Write(DB_BEST_BLOCK, hashBlock);
 
     LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
-    bool ret = db.WriteBatch(batch);
+    // The redo record must be durable before the name database is written,
+    // or a crash could leave names ahead of the coins without a way back.
+    bool ret = db.WriteBatch(batch, true);
     LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
-    return ret;
+    if (!ret) {
+        return false;
+    }
+
+    // Second phase:  Apply the name changes and drop the redo record.
+    if (!WriteNames(names, hashBlock)) {
+        return false;
+    }
+    return db.Erase(DB_PENDING_NAMES);
+}
+
+bool CCoinsViewDB::WriteNames(const CNameCache& names, const uint256& hashBlock)
+{
+    CDBBatch batch(nameDb);
+    names.writeBatch(batch);
+    batch.Write(DB_BEST_BLOCK, hashBlock);
+
+    LogPrint(BCLog::COINDB, "Writing name batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
+    // This must be durable before the redo record is erased.
+    return nameDb.WriteBatch(batch, true);
+}
+
+uint256 CCoinsViewDB::GetTargetBlock() const
+{
+    const uint256 hashBest = GetBestBlock();
+    if (!hashBest.IsNull()) {
+        return hashBest;
+    }
+    const std::vector<uint256> heads = GetHeadBlocks();
+    if (!heads.empty()) {
+        return heads[0];
+    }
+    return uint256();
+}
+
+bool CCoinsViewDB::RecoverNameDB()
+{
+    std::pair<uint256, CNameCache> pending;
+    if (db.Read(DB_PENDING_NAMES, pending)) {
+        LogPrintf("Applying pending name changes for block %s\n", pending.first.ToString());
+        if (!WriteNames(pending.second, pending.first)) {
+            return false;
+        }
+        if (!db.Erase(DB_PENDING_NAMES, true)) {
+            return false;
+        }
+    }
+
+    const uint256 hashCoins = GetTargetBlock();
+    uint256 hashNames;
+    if (!nameDb.Read(DB_BEST_BLOCK, hashNames)) {
+        hashNames.SetNull();
+    }
+
+    if (hashNames != hashCoins) {
+        return error("%s: name database is at block %s, but coin database at %s",
+                     __func__, hashNames.ToString(), hashCoins.ToString());
+    }
+
+    return true;
 }
 
 size_t CCoinsViewDB::EstimateSize() const
@@ -215,7 +421,7 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.IsArgSet("-blocksdir") ? GetDataDir() / "blocks" / "index" : GetBlocksDir() / "index", nCacheSize, fMemory, fWipe) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.IsArgSet("-blocksdir") ? GetDataDir() / "blocks" / "index" : GetBlocksDir() / "index", nCacheSize, fMemory, fWipe, false, GetBlockTreeDBTuning()) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -309,10 +515,10 @@ bool CCoinsViewDB::ValidateNameDB() const
        only need read operations on it, use a const-cast to get around
        that restriction.  */
     std::unique_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
-    pcursor->SeekToFirst();
+    pcursor->Seek(DB_COIN);
 
-    /* Loop over the total database and read interesting
-       things to memory.  We later use that to check
+    /* Loop over the coins and the total name database and read
+       interesting things to memory.  We later use that to check
        everything against each other.  */
 
     std::set<valtype> namesInDB;
@@ -323,32 +529,38 @@ bool CCoinsViewDB::ValidateNameDB() const
     {
         boost::this_thread::interruption_point();
         char chType;
-        if (!pcursor->GetKey(chType))
-            continue;
+        if (!pcursor->GetKey(chType) || chType != DB_COIN)
+            break;
 
-        switch (chType)
-        {
-        case DB_COIN:
-        {
-            Coin coin;
-            if (!pcursor->GetValue(coin))
-                return error("%s : failed to read coin", __func__);
+        Coin coin;
+        if (!pcursor->GetValue(coin))
+            return error("%s : failed to read coin", __func__);
 
-            if (!coin.out.IsNull())
+        if (!coin.out.IsNull())
+        {
+            const CNameScriptView nameOp(coin.out.scriptPubKey);
+            if (nameOp.isNameOp() && nameOp.isAnyUpdate())
             {
-                const CNameScript nameOp(coin.out.scriptPubKey);
-                if (nameOp.isNameOp() && nameOp.isAnyUpdate())
-                {
-                    const valtype& name = nameOp.getOpName();
-                    if (namesInUTXO.count(name) > 0)
-                        return error("%s : name %s duplicated in UTXO set",
-                                     __func__, EncodeNameForMessage(name));
-                    namesInUTXO.insert(nameOp.getOpName());
-                }
+                const valtype name(nameOp.getOpName().begin(), nameOp.getOpName().end());
+                if (namesInUTXO.count(name) > 0)
+                    return error("%s : name %s duplicated in UTXO set",
+                                 __func__, EncodeNameForMessage(name));
+                namesInUTXO.insert(name);
             }
-            break;
         }
+    }
+
+    pcursor.reset(const_cast<CDBWrapper*>(&nameDb)->NewIterator());
+    pcursor->SeekToFirst();
+    for (; pcursor->Valid(); pcursor->Next())
+    {
+        boost::this_thread::interruption_point();
+        char chType;
+        if (!pcursor->GetKey(chType))
+            continue;
 
+        switch (chType)
+        {
         case DB_NAME:
         {
             std::pair<char, valtype> key;
@@ -542,13 +754,99 @@ public:
     }
 };
 
+/**
+ * Copies all entries with the given key prefix from one database to
+ * another.  Returns the number of entries copied, or -1 on error.
+ */
+template <typename Value>
+int64_t CopyEntries(CDBWrapper& from, CDBWrapper& to, const char prefix)
+{
+    std::unique_ptr<CDBIterator> pcursor(from.NewIterator());
+    CDBBatch batch(to);
+    int64_t count = 0;
+    std::pair<char, valtype> key;
+    Value value;
+    for (pcursor->Seek(prefix); pcursor->Valid(); pcursor->Next()) {
+        boost::this_thread::interruption_point();
+        if (!pcursor->GetKey(key) || key.first != prefix) {
+            break;
+        }
+        if (!pcursor->GetValue(value)) {
+            error("%s: cannot read entry of type '%c'", __func__, prefix);
+            return -1;
+        }
+        batch.Write(key, value);
+        ++count;
+        if (batch.SizeEstimate() > (1 << 24)) {
+            to.WriteBatch(batch);
+            batch.Clear();
+        }
+    }
+    to.WriteBatch(batch);
+    return count;
+}
+
+/** Erases all entries with the given key prefix from a database.  */
+void EraseEntries(CDBWrapper& db, const char prefix)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    CDBBatch batch(db);
+    std::pair<char, valtype> key;
+    for (pcursor->Seek(prefix); pcursor->Valid(); pcursor->Next()) {
+        if (!pcursor->GetKey(key) || key.first != prefix) {
+            break;
+        }
+        batch.Erase(key);
+        if (batch.SizeEstimate() > (1 << 24)) {
+            db.WriteBatch(batch);
+            batch.Clear();
+        }
+    }
+    db.WriteBatch(batch);
+}
+
+}
+
+bool CCoinsViewDB::UpgradeNames()
+{
+    const int64_t countNames = CopyEntries<CNameData>(db, nameDb, DB_NAME);
+    const int64_t countHistory = CopyEntries<CNameHistory>(db, nameDb, DB_NAME_HISTORY);
+    if (countNames < 0 || countHistory < 0) {
+        return false;
+    }
+    const uint256 hashTarget = GetTargetBlock();
+    if (countNames == 0 && countHistory == 0) {
+        // Nothing to move, but a chainstate from before the name database
+        // (e.g. one without any names yet) still needs the marker.
+        uint256 hashNames;
+        if (hashTarget.IsNull() || nameDb.Read(DB_BEST_BLOCK, hashNames)) {
+            return true;
+        }
+        return nameDb.Write(DB_BEST_BLOCK, hashTarget, true);
+    }
+    LogPrintf("Moved %d names and %d history entries to the name database\n", countNames, countHistory);
+
+    // The copy is complete once the marker is written.  Until the old entries
+    // are erased as well, the copy is simply redone on the next start.
+    if (!nameDb.Write(DB_BEST_BLOCK, hashTarget, true)) {
+        return false;
+    }
+    EraseEntries(db, DB_NAME);
+    EraseEntries(db, DB_NAME_HISTORY);
+    db.CompactRange(DB_NAME_HISTORY, static_cast<char>(DB_NAME + 1));
+    return true;
 }
 
 /** Upgrade the database from older formats.
  *
- * Currently implemented: from the per-tx utxo model (0.8..0.14.x) to per-txout.
+ * Currently implemented: from the per-tx utxo model (0.8..0.14.x) to per-txout,
+ * and from names stored in the coin database to the separate name database.
  */
 bool CCoinsViewDB::Upgrade() {
+    if (!UpgradeNames()) {
+        return false;
+    }
+
     std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
     pcursor->Seek(std::make_pair(DB_COINS, uint256()));
     if (!pcursor->Valid()) {
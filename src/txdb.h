@@ -11,9 +11,11 @@
 #include <chain.h>
 #include <primitives/block.h>
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -39,14 +41,80 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
-
-/** CCoinsView backed by the coin database (chainstate/) */
+//! -namedbcache default (MiB)
+static const int64_t nDefaultNameDbCache = 16;
+//! max. -namedbcache (MiB)
+static const int64_t nMaxNameDbCache = 1024;
+//! -namereadcache default (MiB)
+static const int64_t nDefaultNameReadCache = 8;
+//! max. -namereadcache (MiB)
+static const int64_t nMaxNameReadCache = 1024;
+//! Write buffer of the coin database during the initial sync (MiB)
+static const int64_t nInitialSyncDbWriteBuffer = 32;
+//! -dbcompression default
+static const bool DEFAULT_DB_COMPRESSION = false;
+
+/**
+ * CCoinsView backed by the coin database (chainstate/) and the name
+ * database (namestate/).
+ *
+ * Names are kept in their own LevelDB instance, so that their small random
+ * reads are served from a dedicated cache and do not compete with the
+ * compactions of the much larger (and colder) coin data.  Both databases
+ * are committed together in two phases:  The name changes of a flush are
+ * first written as a redo record into the coin database, atomically with
+ * its head-block marker.  Once the coins are committed, the changes are
+ * applied to the name database and the record is erased.  If the node
+ * crashes in between, RecoverNameDB applies the record again.
+ *
+ * When opened for the initial sync, the coin database uses a larger write
+ * buffer and larger table files, so that the frequent flushes create fewer
+ * level-0 files (and thus fewer compactions and write stalls).  A full
+ * compaction of both databases is deferred until the sync is done, and
+ * then run in a background thread by StartDeferredCompaction.
+ */
 class CCoinsViewDB final : public CCoinsView
 {
+public:
+    /** State of the deferred compaction.  */
+    enum class CompactionState {
+        NONE,
+        DEFERRED,
+        RUNNING,
+        FINISHED,
+        INTERRUPTED,
+    };
+
 protected:
     CDBWrapper db;
+    CDBWrapper nameDb;
+
+    std::atomic<CompactionState> m_compaction_state;
+    //! Number of compaction steps done so far
+    std::atomic<int> m_compaction_steps{0};
+    std::atomic<bool> m_interrupt_compaction{false};
+    std::thread m_compaction_thread;
+
+    void ThreadCompact();
+
+    /** Applies name changes to the name database and marks it as being
+     *  at hashBlock.  */
+    bool WriteNames(const CNameCache& names, const uint256& hashBlock);
+    /** Returns the block the coin database is at, or is about to be
+     *  replayed to.  */
+    uint256 GetTargetBlock() const;
+    /** Moves names stored in the coin database by older versions over to
+     *  the name database.  */
+    bool UpgradeNames();
+
 public:
-    explicit CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    /**
+     * @param[in] nInitialSyncWriteBuffer  If non-zero, open the coin database
+     *                                     for the initial sync with this write
+     *                                     buffer size.
+     */
+    explicit CCoinsViewDB(size_t nCacheSize, size_t nNameCacheSize, bool fMemory = false, bool fWipe = false, size_t nInitialSyncWriteBuffer = 0);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -61,6 +129,16 @@ public:
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
+    //! Finish an interrupted commit of the name database and check that it
+    //! matches the coin database.  Returns false if they are inconsistent.
+    bool RecoverNameDB();
+
+    //! Whether a compaction is waiting for the end of the initial sync.
+    bool IsCompactionDeferred() const { return m_compaction_state == CompactionState::DEFERRED; }
+    //! Starts the deferred compaction in a background thread.
+    void StartDeferredCompaction();
+    //! Returns the state of the deferred compaction and its progress [0..1].
+    CompactionState GetCompactionProgress(double& progress) const;
     size_t EstimateSize() const override;
 };
 
@@ -39,12 +39,11 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
 
     for (const auto& txOut : _tx->vout)
     {
-        const CNameScript curNameOp(txOut.scriptPubKey);
-        if (!curNameOp.isNameOp())
+        if (!CNameScriptView(txOut.scriptPubKey).isNameOp())
             continue;
 
         assert(!nameOp.isNameOp());
-        nameOp = curNameOp;
+        nameOp = CNameScript(txOut.scriptPubKey);
     }
 }
 
@@ -10,10 +10,12 @@
 #include <chainparams.h>
 #include <checkpoints.h>
 #include <checkqueue.h>
+#include <compressedfile.h>
 #include <consensus/consensus.h>
 #include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
 #include <cuckoocache.h>
 #include <hash.h>
 #include <index/txindex.h>
@@ -39,8 +41,10 @@
 #include <util/moneystr.h>
 #include <util/strencodings.h>
 #include <validationinterface.h>
+#include <validationstats.h>
 #include <warnings.h>
 
+#include <errno.h>
 #include <future>
 #include <sstream>
 
@@ -215,6 +219,7 @@ Mutex g_best_block_mutex;
 std::condition_variable g_best_block_cv;
 uint256 g_best_block;
 int nScriptCheckThreads = 0;
+int nBlockCheckThreads = 0;
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fHavePruned = false;
@@ -225,6 +230,7 @@ bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
+int nCompressBlocksDepth = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 bool fEnableReplacement = DEFAULT_ENABLE_REPLACEMENT;
 
@@ -304,6 +310,8 @@ static void FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nManualPr
 static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight);
 bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = nullptr);
 static FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly = false);
+static FILE* OpenDiskFileForRecord(const CDiskBlockPos &pos, const char *prefix, bool& fCompressed);
+static bool ReadCompressedRecord(const CDiskBlockPos &pos, const char *prefix, size_t nExtra, CDataStream& record);
 
 bool CheckFinalTx(const CTransaction &tx, int flags)
 {
@@ -673,10 +681,10 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
            tx validation done below (in CheckInputs) will not be correct.  */
         for (const auto& txout : tx.vout)
         {
-            const CNameScript nameOp(txout.scriptPubKey);
+            const CNameScriptView nameOp(txout.scriptPubKey);
             if (nameOp.isNameOp() && nameOp.isAnyUpdate())
             {
-                const valtype& name = nameOp.getOpName();
+                const valtype name(nameOp.getOpName().begin(), nameOp.getOpName().end());
                 CNameData data;
                 if (view.GetName(name, data))
                     view.SetName(name, data, false);
@@ -1086,19 +1094,39 @@ static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMes
 /* Generic implementation of block reading that can handle
    both a block and its header.  */
 
+template<typename Stream>
+static void UnserializeFromDisk(Stream& filein, CBlockHeader& header, const std::shared_ptr<MonotonicArena>& arena)
+{
+    filein >> header;
+}
+
+template<typename Stream>
+static void UnserializeFromDisk(Stream& filein, CBlock& block, const std::shared_ptr<MonotonicArena>& arena)
+{
+    UnserializeBlock(filein, block, arena);
+}
+
 template<typename T>
-static bool ReadBlockOrHeader(T& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+static bool ReadBlockOrHeader(T& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, const std::shared_ptr<MonotonicArena>& arena = nullptr)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
-
     // Read block
     try {
-        filein >> block;
+        // Open history file to read
+        bool fCompressed;
+        CAutoFile filein(OpenDiskFileForRecord(pos, "blk", fCompressed), SER_DISK, CLIENT_VERSION);
+        if (fCompressed) {
+            CDataStream record(SER_DISK, CLIENT_VERSION);
+            if (!ReadCompressedRecord(pos, "blk", 0, record))
+                return error("ReadBlockFromDisk: Reading compressed block failed for %s", pos.ToString());
+            record.ignore(CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int));
+            UnserializeFromDisk(record, block, arena);
+        } else {
+            if (filein.IsNull())
+                return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+            UnserializeFromDisk(filein, block, arena);
+        }
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
@@ -1112,7 +1140,7 @@ static bool ReadBlockOrHeader(T& block, const CDiskBlockPos& pos, const Consensu
 }
 
 template<typename T>
-static bool ReadBlockOrHeader(T& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+static bool ReadBlockOrHeader(T& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams, const std::shared_ptr<MonotonicArena>& arena = nullptr)
 {
     CDiskBlockPos blockPos;
     {
@@ -1120,7 +1148,7 @@ static bool ReadBlockOrHeader(T& block, const CBlockIndex* pindex, const Consens
         blockPos = pindex->GetBlockPos();
     }
 
-    if (!ReadBlockOrHeader(block, blockPos, consensusParams))
+    if (!ReadBlockOrHeader(block, blockPos, consensusParams, arena))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
@@ -1138,20 +1166,19 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return ReadBlockOrHeader(block, pindex, consensusParams);
 }
 
+bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams, const std::shared_ptr<MonotonicArena>& arena)
+{
+    return ReadBlockOrHeader(block, pindex, consensusParams, arena);
+}
+
 bool ReadBlockHeaderFromDisk(CBlockHeader& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
     return ReadBlockOrHeader(block, pindex, consensusParams);
 }
 
-bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& message_start)
+template<typename Stream>
+static bool ReadRawBlock(Stream& filein, std::vector<uint8_t>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& message_start)
 {
-    CDiskBlockPos hpos = pos;
-    hpos.nPos -= 8; // Seek back 8 bytes for meta header
-    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
-    }
-
     try {
         CMessageHeader::MessageStartChars blk_start;
         unsigned int blk_size;
@@ -1178,6 +1205,26 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CDiskBlockPos& pos,
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& message_start)
+{
+    CDiskBlockPos hpos = pos;
+    hpos.nPos -= 8; // Seek back 8 bytes for meta header
+    bool fCompressed;
+    CAutoFile filein(OpenDiskFileForRecord(hpos, "blk", fCompressed), SER_DISK, CLIENT_VERSION);
+    if (fCompressed) {
+        CDataStream record(SER_DISK, CLIENT_VERSION);
+        if (!ReadCompressedRecord(pos, "blk", 0, record)) {
+            return error("%s: Reading compressed block failed for %s", __func__, pos.ToString());
+        }
+        return ReadRawBlock(record, block, pos, message_start);
+    }
+    if (filein.IsNull()) {
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+    }
+
+    return ReadRawBlock(filein, block, pos, message_start);
+}
+
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start)
 {
     CDiskBlockPos block_pos;
@@ -1527,21 +1574,14 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
-static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
-{
-    CDiskBlockPos pos = pindex->GetUndoPos();
-    if (pos.IsNull()) {
-        return error("%s: no undo data available", __func__);
-    }
-
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("%s: OpenUndoFile failed", __func__);
+} // namespace
 
+template<typename Stream>
+static bool UndoReadFromStream(Stream& filein, CBlockUndo& blockundo, const CBlockIndex *pindex)
+{
     // Read block
     uint256 hashChecksum;
-    CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
+    CHashVerifier<Stream> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
     try {
         verifier << pindex->pprev->GetBlockHash();
         verifier >> blockundo;
@@ -1558,6 +1598,32 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
     return true;
 }
 
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
+{
+    CDiskBlockPos pos = pindex->GetUndoPos();
+    if (pos.IsNull()) {
+        return error("%s: no undo data available", __func__);
+    }
+
+    // Open history file to read
+    bool fCompressed;
+    CAutoFile filein(OpenDiskFileForRecord(pos, "rev", fCompressed), SER_DISK, CLIENT_VERSION);
+    if (fCompressed) {
+        CDataStream record(SER_DISK, CLIENT_VERSION);
+        if (!ReadCompressedRecord(pos, "rev", sizeof(uint256), record))
+            return error("%s: Reading compressed undo data failed", __func__);
+        record.ignore(CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int));
+        return UndoReadFromStream(record, blockundo, pindex);
+    }
+
+    if (filein.IsNull())
+        return error("%s: OpenUndoFile failed", __func__);
+
+    return UndoReadFromStream(filein, blockundo, pindex);
+}
+
+namespace {
+
 /** Abort with a message */
 static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
 {
@@ -1721,6 +1787,47 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+namespace {
+
+/**
+ * Closure representing the context-free checks of one transaction in
+ * CheckBlock.  On success, its legacy sigop count is stored in *pnSigOps.
+ */
+class CTxCheck
+{
+private:
+    const CTransaction* ptx;
+    unsigned int* pnSigOps;
+
+public:
+    CTxCheck() : ptx(nullptr), pnSigOps(nullptr) {}
+    CTxCheck(const CTransaction& tx, unsigned int& nSigOps) : ptx(&tx), pnSigOps(&nSigOps) {}
+
+    bool operator()()
+    {
+        CValidationState state;
+        if (!CheckTransaction(*ptx, state, true))
+            return false;
+        *pnSigOps = GetLegacySigOpCount(*ptx);
+        return true;
+    }
+
+    void swap(CTxCheck& check)
+    {
+        std::swap(ptx, check.ptx);
+        std::swap(pnSigOps, check.pnSigOps);
+    }
+};
+
+} // anonymous namespace
+
+static CCheckQueue<CTxCheck> blockcheckqueue(128);
+
+void ThreadBlockCheck() {
+    RenameThread("bitcoin-blockch");
+    blockcheckqueue.Thread();
+}
+
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
 
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params)
@@ -1799,13 +1906,6 @@ static unsigned int GetBlockScriptFlags(const CBlockIndex* pindex, const Consens
 
 
 
-static int64_t nTimeCheck = 0;
-static int64_t nTimeForks = 0;
-static int64_t nTimeVerify = 0;
-static int64_t nTimeConnect = 0;
-static int64_t nTimeIndex = 0;
-static int64_t nTimeCallbacks = 0;
-static int64_t nTimeTotal = 0;
 static int64_t nBlocksTotal = 0;
 
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
@@ -1878,7 +1978,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         }
     }
 
-    int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
+    int64_t nTime1 = GetTimeMicros(); const int64_t nTimeCheck = g_validation_stats.Record(ValidationStage::CHECK, nTime1 - nTimeStart);
     LogPrint(BCLog::BENCH, "    - Sanity checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime1 - nTimeStart), nTimeCheck * MICRO, nTimeCheck * MILLI / nBlocksTotal);
 
     // Xaya has BIP34 activated from the start, so there's no need for the
@@ -1894,7 +1994,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         nLockTimeFlags |= LOCKTIME_VERIFY_SEQUENCE;
     }
 
-    int64_t nTime2 = GetTimeMicros(); nTimeForks += nTime2 - nTime1;
+    int64_t nTime2 = GetTimeMicros(); const int64_t nTimeForks = g_validation_stats.Record(ValidationStage::FORKS, nTime2 - nTime1);
     LogPrint(BCLog::BENCH, "    - Fork checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime2 - nTime1), nTimeForks * MICRO, nTimeForks * MILLI / nBlocksTotal);
 
     CBlockUndo blockundo;
@@ -1906,6 +2006,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     int nInputs = 0;
     int64_t nSigOpsCost = 0;
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
+    int64_t nTimeNames = 0;
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
     for (unsigned int i = 0; i < block.vtx.size(); i++)
@@ -1965,9 +2066,12 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
             blockundo.vtxundo.push_back(CTxUndo());
         }
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
+        const int64_t nTimeNameStart = GetTimeMicros();
         ApplyNameTransaction(tx, pindex->nHeight, view, blockundo);
+        nTimeNames += GetTimeMicros() - nTimeNameStart;
     }
-    int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
+    g_validation_stats.Record(ValidationStage::NAMES, nTimeNames);
+    int64_t nTime3 = GetTimeMicros(); const int64_t nTimeConnect = g_validation_stats.Record(ValidationStage::CONNECT, nTime3 - nTime2);
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
 
     /* Special rule:  Allow too high payout for genesis blocks.  They are used
@@ -1982,7 +2086,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     if (!control.Wait())
         return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
-    int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
+    int64_t nTime4 = GetTimeMicros(); const int64_t nTimeVerify = g_validation_stats.Record(ValidationStage::VERIFY, nTime4 - nTime2);
     LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime4 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
 
     if (fJustCheck)
@@ -2002,10 +2106,10 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
-    int64_t nTime5 = GetTimeMicros(); nTimeIndex += nTime5 - nTime4;
+    int64_t nTime5 = GetTimeMicros(); const int64_t nTimeIndex = g_validation_stats.Record(ValidationStage::INDEX, nTime5 - nTime4);
     LogPrint(BCLog::BENCH, "    - Index writing: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5 - nTime4), nTimeIndex * MICRO, nTimeIndex * MILLI / nBlocksTotal);
 
-    int64_t nTime6 = GetTimeMicros(); nTimeCallbacks += nTime6 - nTime5;
+    int64_t nTime6 = GetTimeMicros(); const int64_t nTimeCallbacks = g_validation_stats.Record(ValidationStage::CALLBACKS, nTime6 - nTime5);
     LogPrint(BCLog::BENCH, "    - Callbacks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime6 - nTime5), nTimeCallbacks * MICRO, nTimeCallbacks * MILLI / nBlocksTotal);
 
     return true;
@@ -2244,7 +2348,9 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
         bool flushed = view.Flush();
         assert(flushed);
     }
-    LogPrint(BCLog::BENCH, "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * MILLI);
+    const int64_t nTimeDisconnect = GetTimeMicros() - nStart;
+    g_validation_stats.Record(ValidationStage::DISCONNECT_TIP, nTimeDisconnect);
+    LogPrint(BCLog::BENCH, "- Disconnect block: %.2fms\n", nTimeDisconnect * MILLI);
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED))
         return false;
@@ -2276,12 +2382,6 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
     return true;
 }
 
-static int64_t nTimeReadFromDisk = 0;
-static int64_t nTimeConnectTotal = 0;
-static int64_t nTimeFlush = 0;
-static int64_t nTimeChainState = 0;
-static int64_t nTimePostConnect = 0;
-
 struct PerBlockConnectTrace {
     CBlockIndex* pindex = nullptr;
     std::shared_ptr<const CBlock> pblock;
@@ -2377,7 +2477,7 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     }
     const CBlock& blockConnecting = *pthisBlock;
     // Apply the block atomically to the chain state.
-    int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
+    int64_t nTime2 = GetTimeMicros(); const int64_t nTimeReadFromDisk = g_validation_stats.Record(ValidationStage::READ_FROM_DISK, nTime2 - nTime1);
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
     {
@@ -2389,17 +2489,17 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
                 InvalidBlockFound(pindexNew, state);
             return error("%s: ConnectBlock %s failed, %s", __func__, pindexNew->GetBlockHash().ToString(), FormatStateMessage(state));
         }
-        nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
+        nTime3 = GetTimeMicros(); const int64_t nTimeConnectTotal = g_validation_stats.Record(ValidationStage::CONNECT_TOTAL, nTime3 - nTime2);
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
         bool flushed = view.Flush();
         assert(flushed);
     }
-    int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
+    int64_t nTime4 = GetTimeMicros(); const int64_t nTimeFlush = g_validation_stats.Record(ValidationStage::FLUSH, nTime4 - nTime3);
     LogPrint(BCLog::BENCH, "  - Flush: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime4 - nTime3) * MILLI, nTimeFlush * MICRO, nTimeFlush * MILLI / nBlocksTotal);
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED))
         return false;
-    int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
+    int64_t nTime5 = GetTimeMicros(); const int64_t nTimeChainState = g_validation_stats.Record(ValidationStage::CHAINSTATE, nTime5 - nTime4);
     LogPrint(BCLog::BENCH, "  - Writing chainstate: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime5 - nTime4) * MILLI, nTimeChainState * MICRO, nTimeChainState * MILLI / nBlocksTotal);
     // Remove conflicting transactions from the mempool.;
     mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
@@ -2409,7 +2509,8 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     UpdateTip(pindexNew, chainparams);
     CheckNameDB (false);
 
-    int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
+    int64_t nTime6 = GetTimeMicros(); const int64_t nTimePostConnect = g_validation_stats.Record(ValidationStage::POST_CONNECT, nTime6 - nTime5);
+    const int64_t nTimeTotal = g_validation_stats.Record(ValidationStage::CONNECT_TIP, nTime6 - nTime1);
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
 
@@ -2623,10 +2724,12 @@ bool CChainState::ActivateBestChain(CValidationState &state, const CChainParams&
     do {
         boost::this_thread::interruption_point();
 
-        if (GetMainSignals().CallbacksPending() > 10) {
-            // Block until the validation queue drains. This should largely
+        if (GetMainSignals().CallbacksPending() > MAX_PENDING_VALIDATION_CALLBACKS) {
+            // Block until the validation queues drain. This should largely
             // never happen in normal operation, however may happen during
             // reindex, causing memory blowup if we run too far ahead.
+            // Since every subscriber has its own queue, this only waits
+            // noticeably if the slowest subscriber fell behind.
             // Note that if a validationinterface callback ends up calling
             // ActivateBestChain this may lead to a deadlock! We should
             // probably have a DEBUG_LOCKORDER test for this in the future.
@@ -2696,6 +2799,15 @@ bool CChainState::ActivateBestChain(CValidationState &state, const CChainParams&
     } while (pindexNewTip != pindexMostWork);
     CheckBlockIndex(chainparams.GetConsensus());
 
+    // The full compaction of the chainstate is deferred until the initial
+    // sync is done.  Flush everything first, so that it covers all coins.
+    if (pcoinsdbview->IsCompactionDeferred() && !IsInitialBlockDownload()) {
+        if (!FlushStateToDisk(chainparams, state, FlushStateMode::ALWAYS)) {
+            return false;
+        }
+        pcoinsdbview->StartDeferredCompaction();
+    }
+
     // Write changes periodically to disk, after relay.
     if (!FlushStateToDisk(chainparams, state, FlushStateMode::PERIODIC)) {
         return false;
@@ -3020,8 +3132,13 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
 static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
 {
     // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block, consensusParams))
-        return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
+    if (fCheckPOW) {
+        const int64_t nTimeStart = GetTimeMicros();
+        const bool fValid = CheckProofOfWork(block, consensusParams);
+        g_validation_stats.Record(ValidationStage::POW, GetTimeMicros() - nTimeStart);
+        if (!fValid)
+            return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
+    }
 
     return true;
 }
@@ -3038,6 +3155,9 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
     if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW))
         return false;
 
+    // The PoW check is timed separately, so it is not included here.
+    const int64_t nTimeStart = GetTimeMicros();
+
     // Check the merkle root.
     if (fCheckMerkleRoot) {
         bool mutated;
@@ -3069,16 +3189,35 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
         if (block.vtx[i]->IsCoinBase())
             return state.DoS(100, false, REJECT_INVALID, "bad-cb-multiple", false, "more than one coinbase");
 
-    // Check transactions
-    for (const auto& tx : block.vtx)
-        if (!CheckTransaction(*tx, state, true))
-            return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
-                                 strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), state.GetDebugMessage()));
+    // Check transactions.  For large enough blocks, this is first done in
+    // parallel on the block check threads.  If that fails, the serial loop
+    // finds the first invalid transaction, so that the resulting state is
+    // the same as without parallel checks.
+    std::vector<unsigned int> vSigOps(block.vtx.size());
+    bool fTxsChecked = false;
+    if (nBlockCheckThreads && block.vtx.size() >= MIN_PARALLEL_CHECKBLOCK_TXS) {
+        CCheckQueueControl<CTxCheck> control(&blockcheckqueue);
+        std::vector<CTxCheck> vChecks;
+        vChecks.reserve(block.vtx.size());
+        for (size_t i = 0; i < block.vtx.size(); ++i)
+            vChecks.emplace_back(*block.vtx[i], vSigOps[i]);
+        control.Add(vChecks);
+        fTxsChecked = control.Wait();
+    }
+    if (!fTxsChecked) {
+        for (size_t i = 0; i < block.vtx.size(); ++i) {
+            const CTransaction& tx = *block.vtx[i];
+            if (!CheckTransaction(tx, state, true))
+                return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
+                                     strprintf("Transaction check failed (tx hash %s) %s", tx.GetHash().ToString(), state.GetDebugMessage()));
+            vSigOps[i] = GetLegacySigOpCount(tx);
+        }
+    }
 
     unsigned int nSigOps = 0;
-    for (const auto& tx : block.vtx)
+    for (const unsigned int n : vSigOps)
     {
-        nSigOps += GetLegacySigOpCount(*tx);
+        nSigOps += n;
     }
     if (nSigOps * WITNESS_SCALE_FACTOR > MAX_BLOCK_SIGOPS_COST)
         return state.DoS(100, false, REJECT_INVALID, "bad-blk-sigops", false, "out-of-bounds SigOpCount");
@@ -3086,6 +3225,8 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
     if (fCheckPOW && fCheckMerkleRoot)
         block.fChecked = true;
 
+    g_validation_stats.Record(ValidationStage::CHECK_BLOCK, GetTimeMicros() - nTimeStart);
+
     return true;
 }
 
@@ -3611,6 +3752,8 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
         CDiskBlockPos pos(*it, 0);
         fs::remove(GetBlockPosFilename(pos, "blk"));
         fs::remove(GetBlockPosFilename(pos, "rev"));
+        fs::remove(GetCompressedBlockPosFilename(pos, "blk"));
+        fs::remove(GetCompressedBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
     }
 }
@@ -3729,6 +3872,98 @@ bool CheckDiskSpace(uint64_t nAdditionalBytes, bool blocks_dir)
     return true;
 }
 
+bool IsBlockFileCompressed(const CDiskBlockPos &pos)
+{
+    return !fs::exists(GetBlockPosFilename(pos, "blk")) && fs::exists(GetCompressedBlockPosFilename(pos, "blk"));
+}
+
+/** Seeks an opened block or undo file to pos.nPos, closing it on failure.  */
+static FILE* SeekDiskFile(FILE* file, const CDiskBlockPos &pos, const fs::path& path)
+{
+    if (pos.nPos) {
+        if (fseek(file, pos.nPos, SEEK_SET)) {
+            LogPrintf("Unable to seek to position %u of %s\n", pos.nPos, path.string());
+            fclose(file);
+            return nullptr;
+        }
+    }
+    return file;
+}
+
+/**
+ * Opens a block or undo file for reading the record at pos.  If the file
+ * does not exist, fCompressed is set and the record should be read with
+ * ReadCompressedRecord instead.  Opening the file directly (rather than
+ * checking first which of the files exists) also works while the file is
+ * compressed or decompressed concurrently.
+ */
+static FILE* OpenDiskFileForRecord(const CDiskBlockPos &pos, const char *prefix, bool& fCompressed)
+{
+    fCompressed = false;
+    if (pos.IsNull())
+        return nullptr;
+    const fs::path path = GetBlockPosFilename(pos, prefix);
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file) {
+        if (errno == ENOENT)
+            fCompressed = true;
+        else
+            LogPrintf("Unable to open file %s\n", path.string());
+        return nullptr;
+    }
+    return SeekDiskFile(file, pos, path);
+}
+
+/**
+ * Reads the record (block or undo data) at pos from a compressed file.
+ * Like in the normal files, the record is preceded by the message start
+ * and its size, and followed by nExtra bytes (the checksum for undo data).
+ * All of this is returned in record.
+ */
+static bool ReadCompressedRecord(const CDiskBlockPos &pos, const char *prefix, const size_t nExtra, CDataStream& record)
+{
+    const size_t nHeaderSize = CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
+    if (pos.nPos < nHeaderSize)
+        return error("%s: invalid position %s", __func__, pos.ToString());
+
+    CCompressedFile file(GetCompressedBlockPosFilename(pos, prefix));
+    if (file.IsNull())
+        return error("%s: failed to open compressed file for %s", __func__, pos.ToString());
+
+    unsigned char header[nHeaderSize];
+    if (!file.Read(pos.nPos - nHeaderSize, header, nHeaderSize))
+        return false;
+    const uint32_t nSize = ReadLE32(header + CMessageHeader::MESSAGE_START_SIZE);
+    if (nSize > MAX_SIZE)
+        return error("%s: record at %s is too large", __func__, pos.ToString());
+
+    record.resize(nHeaderSize + nSize + nExtra);
+    memcpy(&record[0], header, nHeaderSize);
+    return file.Read(pos.nPos, reinterpret_cast<unsigned char*>(&record[nHeaderSize]), nSize + nExtra);
+}
+
+/** Turns a compressed block or undo file back into a normal one.  */
+static bool DecompressDiskFile(const CDiskBlockPos &pos, const char *prefix)
+{
+    const fs::path path = GetBlockPosFilename(pos, prefix);
+    const fs::path compressedPath = GetCompressedBlockPosFilename(pos, prefix);
+    const fs::path tmp = path.string() + ".new";
+
+    FILE* file = fsbridge::fopen(tmp, "wb");
+    if (!file)
+        return error("%s: failed to open %s", __func__, tmp.string());
+    const bool ok = CCompressedFile(compressedPath).Extract(file) && FileCommit(file);
+    fclose(file);
+    if (!ok || !RenameOver(tmp, path)) {
+        fs::remove(tmp);
+        return error("%s: failed to decompress %s", __func__, compressedPath.string());
+    }
+
+    fs::remove(compressedPath);
+    LogPrintf("Decompressed %s for writing\n", path.string());
+    return true;
+}
+
 static FILE* OpenDiskFile(const CDiskBlockPos &pos, const char *prefix, bool fReadOnly)
 {
     if (pos.IsNull())
@@ -3736,20 +3971,32 @@ static FILE* OpenDiskFile(const CDiskBlockPos &pos, const char *prefix, bool fRe
     fs::path path = GetBlockPosFilename(pos, prefix);
     fs::create_directories(path.parent_path());
     FILE* file = fsbridge::fopen(path, fReadOnly ? "rb": "rb+");
-    if (!file && !fReadOnly)
-        file = fsbridge::fopen(path, "wb+");
+    if (!file && errno == ENOENT) {
+        // Readers of compressed files (other than for single blocks and undo
+        // data, which are read directly) get a temporary decompressed copy.
+        // Writing to a compressed file turns it back into a normal one.
+        const fs::path compressedPath = GetCompressedBlockPosFilename(pos, prefix);
+        if (fReadOnly) {
+            CCompressedFile compressed(compressedPath);
+            if (!compressed.IsNull() && (file = tmpfile()) != nullptr) {
+                if (compressed.Extract(file)) {
+                    rewind(file);
+                } else {
+                    fclose(file);
+                    file = nullptr;
+                }
+            }
+        } else if (!fs::exists(compressedPath)) {
+            file = fsbridge::fopen(path, "wb+");
+        } else if (DecompressDiskFile(pos, prefix)) {
+            file = fsbridge::fopen(path, "rb+");
+        }
+    }
     if (!file) {
         LogPrintf("Unable to open file %s\n", path.string());
         return nullptr;
     }
-    if (pos.nPos) {
-        if (fseek(file, pos.nPos, SEEK_SET)) {
-            LogPrintf("Unable to seek to position %u of %s\n", pos.nPos, path.string());
-            fclose(file);
-            return nullptr;
-        }
-    }
-    return file;
+    return SeekDiskFile(file, pos, path);
 }
 
 FILE* OpenBlockFile(const CDiskBlockPos &pos, bool fReadOnly) {
@@ -3766,6 +4013,103 @@ fs::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix)
     return GetBlocksDir() / strprintf("%s%05u.dat", prefix, pos.nFile);
 }
 
+fs::path GetCompressedBlockPosFilename(const CDiskBlockPos &pos, const char *prefix)
+{
+    return GetBlocksDir() / strprintf("%s%05u.cdat", prefix, pos.nFile);
+}
+
+/**
+ * Writes the compressed copy of a block or undo file next to it, if the file
+ * exists.  The file itself is left in place and still used by readers and
+ * writers, so this does not need cs_main.
+ */
+static bool CreateCompressedDiskFile(const CDiskBlockPos &pos, const char *prefix)
+{
+    const fs::path path = GetBlockPosFilename(pos, prefix);
+    if (!fs::exists(path))
+        return true;
+    return CCompressedFile::Create(path, GetCompressedBlockPosFilename(pos, prefix));
+}
+
+/**
+ * Replaces a block or undo file by the compressed copy written before.  If
+ * the file has been written to in the meantime, the copy is discarded.
+ */
+static bool SwapCompressedDiskFile(const CDiskBlockPos &pos, const char *prefix) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+
+    const fs::path path = GetBlockPosFilename(pos, prefix);
+    const fs::path compressedPath = GetCompressedBlockPosFilename(pos, prefix);
+    if (!fs::exists(path) || !fs::exists(compressedPath))
+        return true;
+
+    const uint64_t nSize = fs::file_size(path);
+    if (CCompressedFile(compressedPath).GetSize() != nSize) {
+        fs::remove(compressedPath);
+        return error("%s: %s changed while being compressed", __func__, path.string());
+    }
+    LogPrintf("Compressed %s from %u to %u bytes\n", path.string(), nSize, fs::file_size(compressedPath));
+    fs::remove(path);
+
+    return true;
+}
+
+bool CompressBlockFile(int nFile)
+{
+    const CDiskBlockPos pos(nFile, 0);
+    try {
+        if (!CreateCompressedDiskFile(pos, "blk") || !CreateCompressedDiskFile(pos, "rev"))
+            return false;
+
+        LOCK(cs_main);
+        bool fPruned;
+        {
+            LOCK(cs_LastBlockFile);
+            fPruned = nFile >= static_cast<int>(vinfoBlockFile.size()) || vinfoBlockFile[nFile].nSize == 0;
+        }
+        if (fPruned) {
+            // UnlinkPrunedFiles may have missed the copies still being written.
+            fs::remove(GetCompressedBlockPosFilename(pos, "blk"));
+            fs::remove(GetCompressedBlockPosFilename(pos, "rev"));
+            return false;
+        }
+        if (!SwapCompressedDiskFile(pos, "blk") || !SwapCompressedDiskFile(pos, "rev"))
+            return false;
+    } catch (const fs::filesystem_error& e) {
+        return error("%s: %s", __func__, e.what());
+    }
+
+    return true;
+}
+
+bool CompressOldBlockFile()
+{
+    // Only the choice of the file needs cs_main; it is compressed without
+    // holding the lock.
+    int nFile = -1;
+    {
+        LOCK(cs_main);
+        if (nCompressBlocksDepth <= 0 || fImporting || fReindex || chainActive.Tip() == nullptr)
+            return false;
+
+        // Only files before the current one are finalized; all their blocks
+        // must be deep enough in the active chain.
+        const int nMaxHeight = chainActive.Height() - nCompressBlocksDepth;
+        LOCK(cs_LastBlockFile);
+        for (int i = 0; i < nLastBlockFile; ++i) {
+            if (vinfoBlockFile[i].nSize == 0 || static_cast<int>(vinfoBlockFile[i].nHeightLast) > nMaxHeight)
+                continue;
+            if (fs::exists(GetBlockPosFilename(CDiskBlockPos(i, 0), "blk"))) {
+                nFile = i;
+                break;
+            }
+        }
+    }
+
+    return nFile >= 0 && CompressBlockFile(nFile);
+}
+
 CBlockIndex * CChainState::InsertBlockIndex(const uint256& hash)
 {
     AssertLockHeld(cs_main);
@@ -4793,6 +5137,132 @@ bool DumpMempool()
     return true;
 }
 
+static const uint64_t SIGCACHE_DUMP_VERSION = 1;
+
+namespace {
+
+void WriteCacheSnapshot(CDataStream& stream, const uint256& nonce, const std::vector<uint256>& entries)
+{
+    stream << nonce << static_cast<uint64_t>(entries.size());
+    for (const uint256& entry : entries) {
+        stream << entry;
+    }
+}
+
+template <typename Stream>
+void ReadCacheSnapshot(Stream& stream, uint256& nonce, std::vector<uint256>& entries)
+{
+    uint64_t num;
+    stream >> nonce >> num;
+    entries.clear();
+    while (num--) {
+        uint256 entry;
+        stream >> entry;
+        entries.push_back(entry);
+    }
+}
+
+} // anonymous namespace
+
+bool LoadValidationCaches()
+{
+    FILE* filestr = fsbridge::fopen(GetDataDir() / "sigcache.dat", "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open signature cache file from disk. Continuing anyway.\n");
+        return false;
+    }
+
+    uint256 sigNonce, scriptNonce;
+    std::vector<uint256> sigEntries, scriptEntries;
+    try {
+        CHashVerifier<CAutoFile> verifier(&file);
+        uint64_t version;
+        int clientVersion;
+        unsigned char pchMsgTmp[4];
+        verifier >> version >> clientVersion >> pchMsgTmp;
+        // Cached results are only valid for the script interpreter that
+        // produced them, so snapshots of other versions are discarded.
+        if (version != SIGCACHE_DUMP_VERSION || clientVersion != CLIENT_VERSION) {
+            LogPrintf("Signature cache file is from a different version, ignoring it\n");
+            return false;
+        }
+        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp))) {
+            return error("%s: Invalid network magic number", __func__);
+        }
+
+        ReadCacheSnapshot(verifier, sigNonce, sigEntries);
+        ReadCacheSnapshot(verifier, scriptNonce, scriptEntries);
+
+        uint256 hashTmp;
+        file >> hashTmp;
+        if (hashTmp != verifier.GetHash()) {
+            return error("%s: Checksum mismatch, data corrupted", __func__);
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize signature cache data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+
+    RestoreSignatureCacheSnapshot(sigNonce, sigEntries);
+    {
+        LOCK(cs_main);
+        scriptExecutionCacheNonce = scriptNonce;
+        for (const uint256& entry : scriptEntries) {
+            scriptExecutionCache.insert(entry);
+        }
+    }
+
+    LogPrintf("Imported validation caches from disk: %u signatures, %u script executions\n", sigEntries.size(), scriptEntries.size());
+    return true;
+}
+
+bool DumpValidationCaches()
+{
+    int64_t start = GetTimeMicros();
+
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    uint256 nonce;
+    std::vector<uint256> entries;
+
+    stream << SIGCACHE_DUMP_VERSION << CLIENT_VERSION << Params().MessageStart();
+    GetSignatureCacheSnapshot(nonce, entries);
+    WriteCacheSnapshot(stream, nonce, entries);
+    const size_t numSigEntries = entries.size();
+    {
+        LOCK(cs_main);
+        nonce = scriptExecutionCacheNonce;
+        entries.clear();
+        scriptExecutionCache.for_each_live([&entries](const uint256& entry) { entries.push_back(entry); });
+    }
+    WriteCacheSnapshot(stream, nonce, entries);
+    const uint256 checksum = Hash(stream.begin(), stream.end());
+
+    int64_t mid = GetTimeMicros();
+
+    try {
+        FILE* filestr = fsbridge::fopen(GetDataDir() / "sigcache.dat.new", "wb");
+        if (!filestr) {
+            return false;
+        }
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        file.write(stream.data(), stream.size());
+        file << checksum;
+        if (!FileCommit(file.Get()))
+            throw std::runtime_error("FileCommit failed");
+        file.fclose();
+        RenameOver(GetDataDir() / "sigcache.dat.new", GetDataDir() / "sigcache.dat");
+        int64_t last = GetTimeMicros();
+        LogPrintf("Dumped validation caches (%u signatures, %u script executions): %gs to copy, %gs to dump\n",
+                  numSigEntries, entries.size(), (mid-start)*MICRO, (last-mid)*MICRO);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump validation caches: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
 //! Guess how far we are in the verification process at the given block index
 //! require cs_main if pindex has not been validated yet (because nChainTx might be unset)
 double GuessVerificationProgress(const ChainTxData& data, const CBlockIndex *pindex) {
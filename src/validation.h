@@ -34,6 +34,7 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CChainParams;
 class CCoinsViewDB;
 class CInv;
@@ -43,6 +44,7 @@ class CBlockPolicyEstimator;
 class CTxInUndo;
 class CTxMemPool;
 class CValidationState;
+class MonotonicArena;
 struct ChainTxData;
 
 struct PrecomputedTransactionData;
@@ -83,6 +85,10 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** -parblockcheck default (number of block check threads, -1 = same as -par) */
+static const int DEFAULT_BLOCKCHECK_THREADS = -1;
+/** Minimum number of transactions in a block for checking them in parallel in CheckBlock */
+static const size_t MIN_PARALLEL_CHECKBLOCK_TXS = 64;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -120,6 +126,9 @@ static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
 static const unsigned int DATABASE_FLUSH_INTERVAL = 24 * 60 * 60;
+/** Maximum number of callbacks pending in any validation interface queue
+ *  before ActivateBestChain blocks for the subscribers to catch up. */
+static const size_t MAX_PENDING_VALIDATION_CALLBACKS = 10;
 /** Maximum length of reject messages. */
 static const unsigned int MAX_REJECT_MESSAGE_LENGTH = 111;
 /** Block download timeout base, expressed in millionths of the block interval (i.e. 10 min) */
@@ -138,6 +147,8 @@ static const bool DEFAULT_TXINDEX = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Default for -persistsigcache */
+static const bool DEFAULT_PERSIST_SIGCACHE = false;
 /** Default for -mempoolreplacement */
 static const bool DEFAULT_ENABLE_REPLACEMENT = true;
 /** Default for using fee filter */
@@ -185,6 +196,7 @@ extern uint256 g_best_block;
 extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
 extern int nScriptCheckThreads;
+extern int nBlockCheckThreads;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
@@ -219,6 +231,10 @@ extern bool fPruneMode;
 extern uint64_t nPruneTarget;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of chainActive.Tip() will not be pruned. */
 static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
+/** Depth below which finalized block files are compressed (0 = never). */
+extern int nCompressBlocksDepth;
+/** Interval (in seconds) at which old block files are checked for compression. */
+static const int64_t BLOCKFILE_COMPRESS_INTERVAL = 10;
 /** Minimum blocks required to signal NODE_NETWORK_LIMITED */
 static const unsigned int NODE_NETWORK_LIMITED_MIN_BLOCKS = 288;
 
@@ -277,6 +293,10 @@ bool CheckDiskSpace(uint64_t nAdditionalBytes = 0, bool blocks_dir = false);
 FILE* OpenBlockFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 /** Translation to a filesystem path */
 fs::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix);
+/** Path of the compressed container (blk?????.cdat) replacing a block or undo file */
+fs::path GetCompressedBlockPosFilename(const CDiskBlockPos &pos, const char *prefix);
+/** Check whether the block file for pos has been compressed */
+bool IsBlockFileCompressed(const CDiskBlockPos &pos);
 /** Import blocks from an external file */
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp = nullptr);
 /** Ensures we have a genesis block in the block tree, possibly writing one to disk. */
@@ -290,6 +310,8 @@ bool LoadChainTip(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_m
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the context-free block check thread */
+void ThreadBlockCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
@@ -319,6 +341,20 @@ void PruneOneBlockFile(const int fileNumber);
  */
 void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
 
+/**
+ *  Compress the block and undo file with the given number.  Blocks and undo
+ *  data in it can still be read; writing to the file decompresses it again.
+ *  cs_main is only taken for replacing the files by their compressed copies.
+ */
+bool CompressBlockFile(int nFile) LOCKS_EXCLUDED(cs_main);
+
+/**
+ *  Compress the oldest uncompressed block file (and its undo file) whose
+ *  blocks are all at least nCompressBlocksDepth deep in the active chain.
+ *  Returns true if a file has been compressed.
+ */
+bool CompressOldBlockFile();
+
 /** Flush all state, indexes and buffers to disk. */
 void FlushStateToDisk();
 /** Prune block files and flush state to disk. */
@@ -419,8 +455,15 @@ void InitScriptExecutionCache();
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Reads a block for a transient, read-only consumer.  Its transactions are
+ *  allocated from the given arena, which is freed as a whole once the last
+ *  of them is gone.  Callers must not keep individual transactions around,
+ *  as each of them pins the entire arena. */
+bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams, const std::shared_ptr<MonotonicArena>& arena);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& message_start);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 bool ReadBlockHeaderFromDisk(CBlockHeader& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
 
 /** Functions for validating blocks and updating the block tree */
@@ -533,6 +576,13 @@ bool DumpMempool();
 /** Load the mempool from disk. */
 bool LoadMempool();
 
+/** Dump the signature and script execution caches (with their salts) to disk. */
+bool DumpValidationCaches();
+
+/** Load the signature and script execution caches from disk.  Must be called
+ *  after they are initialised, but before they are first used.  */
+bool LoadValidationCaches();
+
 //! Check whether the block associated with this index entry is pruned or not.
 inline bool IsBlockPruned(const CBlockIndex* pblockindex)
 {
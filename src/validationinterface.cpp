@@ -11,42 +11,120 @@
 #include <util/system.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <list>
 #include <atomic>
 #include <future>
+#include <unordered_map>
 
 #include <boost/signals2/signal.hpp>
 
+/**
+ * Connections for the callbacks that are invoked synchronously on the
+ * thread generating the event.
+ */
 struct ValidationInterfaceConnections {
-    boost::signals2::scoped_connection UpdatedBlockTip;
-    boost::signals2::scoped_connection TransactionAddedToMempool;
-    boost::signals2::scoped_connection BlockConnected;
-    boost::signals2::scoped_connection BlockDisconnected;
-    boost::signals2::scoped_connection TransactionRemovedFromMempool;
-    boost::signals2::scoped_connection ChainStateFlushed;
     boost::signals2::scoped_connection Broadcast;
     boost::signals2::scoped_connection BlockChecked;
     boost::signals2::scoped_connection NewPoWValidBlock;
 };
 
+/**
+ * The background callback queue of a single subscriber.  Each subscriber has
+ * its own ordered queue, so that a slow consumer (e.g. the wallet) does not
+ * hold up delivery of events to the others.
+ */
+struct ValidationInterfaceQueue {
+    CValidationInterface* const m_subscriber;
+    const std::string m_name;
+    SingleThreadedSchedulerClient m_client;
+    ValidationInterfaceConnections m_conns;
+
+    /** Cleared when the subscriber is unregistered.  Callbacks still in the
+     *  queue at that point are dropped.  */
+    std::atomic<bool> m_active{true};
+
+    std::atomic<uint64_t> m_processed{0};
+    std::atomic<size_t> m_max_pending{0};
+
+    ValidationInterfaceQueue(CValidationInterface* subscriber, const std::string& name, CScheduler* pscheduler)
+        : m_subscriber(subscriber), m_name(name), m_client(pscheduler) {}
+
+    template <typename F>
+    void Add(F func)
+    {
+        ValidationInterfaceQueue* const queue = this;
+        m_client.AddToProcessQueue([queue, func] {
+            if (queue->m_active) {
+                func(*queue->m_subscriber);
+            }
+            ++queue->m_processed;
+        });
+
+        const size_t pending = m_client.CallbacksPending();
+        size_t max_pending = m_max_pending;
+        while (pending > max_pending && !m_max_pending.compare_exchange_weak(max_pending, pending));
+    }
+};
+
 struct MainSignalsInstance {
-    boost::signals2::signal<void (const CBlockIndex *, const CBlockIndex *, bool fInitialDownload)> UpdatedBlockTip;
-    boost::signals2::signal<void (const CTransactionRef &)> TransactionAddedToMempool;
-    boost::signals2::signal<void (const std::shared_ptr<const CBlock> &, const CBlockIndex *pindex, const std::vector<CTransactionRef>&, const std::vector<CTransactionRef>&)> BlockConnected;
-    boost::signals2::signal<void (const std::shared_ptr<const CBlock> &, const CBlockIndex *, const std::vector<CTransactionRef>&)> BlockDisconnected;
-    boost::signals2::signal<void (const CTransactionRef &)> TransactionRemovedFromMempool;
-    boost::signals2::signal<void (const CBlockLocator &)> ChainStateFlushed;
     boost::signals2::signal<void (int64_t nBestBlockTime, CConnman* connman)> Broadcast;
     boost::signals2::signal<void (const CBlock&, const CValidationState&)> BlockChecked;
     boost::signals2::signal<void (const CBlockIndex *, const std::shared_ptr<const CBlock>&)> NewPoWValidBlock;
 
+    CScheduler* const m_pscheduler;
+
     // We are not allowed to assume the scheduler only runs in one thread,
     // but must ensure all callbacks happen in-order, so we end up creating
     // our own queue here :(
+    // This queue is not tied to any subscriber; it is used for
+    // CallFunctionInValidationInterfaceQueue.
     SingleThreadedSchedulerClient m_schedulerClient;
-    std::unordered_map<CValidationInterface*, ValidationInterfaceConnections> m_connMainSignals;
 
-    explicit MainSignalsInstance(CScheduler *pscheduler) : m_schedulerClient(pscheduler) {}
+    CCriticalSection m_cs_queues;
+    std::unordered_map<CValidationInterface*, std::shared_ptr<ValidationInterfaceQueue>> m_queues GUARDED_BY(m_cs_queues);
+    /** Queues of unregistered subscribers that still have callbacks pending
+     *  or running.  They are dropped once they are idle; processing that is
+     *  still scheduled for them keeps them alive by itself.  */
+    std::vector<std::shared_ptr<ValidationInterfaceQueue>> m_retired_queues GUARDED_BY(m_cs_queues);
+
+    explicit MainSignalsInstance(CScheduler *pscheduler) : m_pscheduler(pscheduler), m_schedulerClient(pscheduler) {}
+
+    /** Adds a callback to the queue of every current subscriber.  */
+    template <typename F>
+    void AddToAllQueues(F func)
+    {
+        LOCK(m_cs_queues);
+        for (const auto& entry : m_queues) {
+            entry.second->Add(func);
+        }
+    }
+
+    void Unregister(CValidationInterface* subscriber) EXCLUSIVE_LOCKS_REQUIRED(m_cs_queues)
+    {
+        auto it = m_queues.find(subscriber);
+        if (it == m_queues.end()) {
+            return;
+        }
+        ValidationInterfaceQueue& queue = *it->second;
+        queue.m_active = false;
+        queue.m_conns.Broadcast.disconnect();
+        queue.m_conns.BlockChecked.disconnect();
+        queue.m_conns.NewPoWValidBlock.disconnect();
+        m_retired_queues.push_back(std::move(it->second));
+        m_queues.erase(it);
+        PruneRetiredQueues();
+    }
+
+    /** Drops the retired queues that have no callbacks left.  */
+    void PruneRetiredQueues() EXCLUSIVE_LOCKS_REQUIRED(m_cs_queues)
+    {
+        m_retired_queues.erase(std::remove_if(m_retired_queues.begin(), m_retired_queues.end(),
+                                              [](const std::shared_ptr<ValidationInterfaceQueue>& queue) {
+                                                  return queue->m_client.IsIdle();
+                                              }),
+                               m_retired_queues.end());
+    }
 };
 
 static CMainSignals g_signals;
@@ -68,12 +146,40 @@ void CMainSignals::UnregisterBackgroundSignalScheduler() {
 void CMainSignals::FlushBackgroundCallbacks() {
     if (m_internals) {
         m_internals->m_schedulerClient.EmptyQueue();
+        LOCK(m_internals->m_cs_queues);
+        for (const auto& entry : m_internals->m_queues) {
+            entry.second->m_client.EmptyQueue();
+        }
+        for (const auto& queue : m_internals->m_retired_queues) {
+            queue->m_client.EmptyQueue();
+        }
     }
 }
 
 size_t CMainSignals::CallbacksPending() {
     if (!m_internals) return 0;
-    return m_internals->m_schedulerClient.CallbacksPending();
+    size_t pending = m_internals->m_schedulerClient.CallbacksPending();
+    LOCK(m_internals->m_cs_queues);
+    for (const auto& entry : m_internals->m_queues) {
+        pending = std::max(pending, entry.second->m_client.CallbacksPending());
+    }
+    return pending;
+}
+
+std::vector<ValidationInterfaceQueueStats> CMainSignals::GetQueueStats() {
+    std::vector<ValidationInterfaceQueueStats> result;
+    if (!m_internals) return result;
+    LOCK(m_internals->m_cs_queues);
+    for (const auto& entry : m_internals->m_queues) {
+        const ValidationInterfaceQueue& queue = *entry.second;
+        ValidationInterfaceQueueStats stats;
+        stats.name = queue.m_name;
+        stats.pending = entry.second->m_client.CallbacksPending();
+        stats.max_pending = queue.m_max_pending;
+        stats.processed = queue.m_processed;
+        result.push_back(stats);
+    }
+    return result;
 }
 
 void CMainSignals::RegisterWithMempoolSignals(CTxMemPool& pool) {
@@ -89,32 +195,60 @@ CMainSignals& GetMainSignals()
     return g_signals;
 }
 
-void RegisterValidationInterface(CValidationInterface* pwalletIn) {
-    ValidationInterfaceConnections& conns = g_signals.m_internals->m_connMainSignals[pwalletIn];
-    conns.UpdatedBlockTip = g_signals.m_internals->UpdatedBlockTip.connect(std::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    conns.TransactionAddedToMempool = g_signals.m_internals->TransactionAddedToMempool.connect(std::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, std::placeholders::_1));
-    conns.BlockConnected = g_signals.m_internals->BlockConnected.connect(std::bind(&CValidationInterface::BlockConnected, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
-    conns.BlockDisconnected = g_signals.m_internals->BlockDisconnected.connect(std::bind(&CValidationInterface::BlockDisconnected, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    conns.TransactionRemovedFromMempool = g_signals.m_internals->TransactionRemovedFromMempool.connect(std::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, std::placeholders::_1));
-    conns.ChainStateFlushed = g_signals.m_internals->ChainStateFlushed.connect(std::bind(&CValidationInterface::ChainStateFlushed, pwalletIn, std::placeholders::_1));
-    conns.Broadcast = g_signals.m_internals->Broadcast.connect(std::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, std::placeholders::_1, std::placeholders::_2));
-    conns.BlockChecked = g_signals.m_internals->BlockChecked.connect(std::bind(&CValidationInterface::BlockChecked, pwalletIn, std::placeholders::_1, std::placeholders::_2));
-    conns.NewPoWValidBlock = g_signals.m_internals->NewPoWValidBlock.connect(std::bind(&CValidationInterface::NewPoWValidBlock, pwalletIn, std::placeholders::_1, std::placeholders::_2));
+void RegisterValidationInterface(CValidationInterface* pwalletIn, const std::string& name) {
+    MainSignalsInstance& internals = *g_signals.m_internals;
+    auto queue = std::make_shared<ValidationInterfaceQueue>(pwalletIn, name, internals.m_pscheduler);
+    queue->m_client.SetOwner(queue);
+    ValidationInterfaceConnections& conns = queue->m_conns;
+    conns.Broadcast = internals.Broadcast.connect(std::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, std::placeholders::_1, std::placeholders::_2));
+    conns.BlockChecked = internals.BlockChecked.connect(std::bind(&CValidationInterface::BlockChecked, pwalletIn, std::placeholders::_1, std::placeholders::_2));
+    conns.NewPoWValidBlock = internals.NewPoWValidBlock.connect(std::bind(&CValidationInterface::NewPoWValidBlock, pwalletIn, std::placeholders::_1, std::placeholders::_2));
+
+    LOCK(internals.m_cs_queues);
+    internals.Unregister(pwalletIn);
+    internals.m_queues.emplace(pwalletIn, std::move(queue));
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
-    g_signals.m_internals->m_connMainSignals.erase(pwalletIn);
+    LOCK(g_signals.m_internals->m_cs_queues);
+    g_signals.m_internals->Unregister(pwalletIn);
 }
 
 void UnregisterAllValidationInterfaces() {
     if (!g_signals.m_internals) {
         return;
     }
-    g_signals.m_internals->m_connMainSignals.clear();
+    LOCK(g_signals.m_internals->m_cs_queues);
+    while (!g_signals.m_internals->m_queues.empty()) {
+        g_signals.m_internals->Unregister(g_signals.m_internals->m_queues.begin()->first);
+    }
 }
 
 void CallFunctionInValidationInterfaceQueue(std::function<void ()> func) {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    MainSignalsInstance& internals = *g_signals.m_internals;
+
+    // The function has to wait for the callbacks already queued for every
+    // subscriber.  We add a barrier to each queue (and the general one),
+    // and the last of them to be reached runs the function.  This includes
+    // the queues of unregistered subscribers, since one of their callbacks
+    // may still be running (e.g. before a wallet is deleted).
+    LOCK(internals.m_cs_queues);
+    internals.PruneRetiredQueues();
+    auto remaining = std::make_shared<std::atomic<size_t>>(internals.m_queues.size() + internals.m_retired_queues.size() + 1);
+    auto shared_func = std::make_shared<std::function<void ()>>(std::move(func));
+    auto barrier = [remaining, shared_func] {
+        if (--*remaining == 0) {
+            (*shared_func)();
+        }
+    };
+
+    for (const auto& entry : internals.m_queues) {
+        entry.second->m_client.AddToProcessQueue(barrier);
+    }
+    for (const auto& queue : internals.m_retired_queues) {
+        queue->m_client.AddToProcessQueue(barrier);
+    }
+    internals.m_schedulerClient.AddToProcessQueue(barrier);
 }
 
 void SyncWithValidationInterfaceQueue() {
@@ -129,8 +263,8 @@ void SyncWithValidationInterfaceQueue() {
 
 void CMainSignals::MempoolEntryRemoved(CTransactionRef ptx, MemPoolRemovalReason reason) {
     if (reason != MemPoolRemovalReason::BLOCK && reason != MemPoolRemovalReason::CONFLICT) {
-        m_internals->m_schedulerClient.AddToProcessQueue([ptx, this] {
-            m_internals->TransactionRemovedFromMempool(ptx);
+        m_internals->AddToAllQueues([ptx] (CValidationInterface& subscriber) {
+            subscriber.TransactionRemovedFromMempool(ptx);
         });
     }
 }
@@ -140,32 +274,32 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    m_internals->m_schedulerClient.AddToProcessQueue([pindexNew, pindexFork, fInitialDownload, this] {
-        m_internals->UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
+    m_internals->AddToAllQueues([pindexNew, pindexFork, fInitialDownload] (CValidationInterface& subscriber) {
+        subscriber.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
     });
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef &ptx) {
-    m_internals->m_schedulerClient.AddToProcessQueue([ptx, this] {
-        m_internals->TransactionAddedToMempool(ptx);
+    m_internals->AddToAllQueues([ptx] (CValidationInterface& subscriber) {
+        subscriber.TransactionAddedToMempool(ptx);
     });
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex, const std::shared_ptr<const std::vector<CTransactionRef>>& pvtxConflicted, const std::shared_ptr<const std::vector<CTransactionRef>> &pvNameConflicts) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, pindex, pvtxConflicted, pvNameConflicts, this] {
-        m_internals->BlockConnected(pblock, pindex, *pvtxConflicted, *pvNameConflicts);
+    m_internals->AddToAllQueues([pblock, pindex, pvtxConflicted, pvNameConflicts] (CValidationInterface& subscriber) {
+        subscriber.BlockConnected(pblock, pindex, *pvtxConflicted, *pvNameConflicts);
     });
 }
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindexDelete, const std::shared_ptr<const std::vector<CTransactionRef>> &pvNameConflicts) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, pindexDelete, pvNameConflicts, this] {
-        m_internals->BlockDisconnected(pblock, pindexDelete, *pvNameConflicts);
+    m_internals->AddToAllQueues([pblock, pindexDelete, pvNameConflicts] (CValidationInterface& subscriber) {
+        subscriber.BlockDisconnected(pblock, pindexDelete, *pvNameConflicts);
     });
 }
 
 void CMainSignals::ChainStateFlushed(const CBlockLocator &locator) {
-    m_internals->m_schedulerClient.AddToProcessQueue([locator, this] {
-        m_internals->ChainStateFlushed(locator);
+    m_internals->AddToAllQueues([locator] (CValidationInterface& subscriber) {
+        subscriber.ChainStateFlushed(locator);
     });
 }
 
@@ -11,6 +11,8 @@
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 extern CCriticalSection cs_main;
 class CBlock;
@@ -28,8 +30,11 @@ enum class MemPoolRemovalReason;
 
 // These functions dispatch to one or all registered wallets
 
-/** Register a wallet to receive updates from core */
-void RegisterValidationInterface(CValidationInterface* pwalletIn);
+/**
+ * Register a wallet to receive updates from core.  The name identifies
+ * the subscriber's callback queue in the queue statistics.
+ */
+void RegisterValidationInterface(CValidationInterface* pwalletIn, const std::string& name = "unnamed");
 /** Unregister a wallet from core */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
@@ -68,7 +73,8 @@ void SyncWithValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
  * UpdatedBlockTip() callback may depend on an operation performed in
  * the BlockConnected() callback without worrying about explicit
  * synchronization. No ordering should be assumed across
- * ValidationInterface() subscribers.
+ * ValidationInterface() subscribers; each of them has its own callback
+ * queue, so that a slow subscriber does not delay the others.
  */
 class CValidationInterface {
 protected:
@@ -147,17 +153,30 @@ protected:
      * Notifies listeners that a block which builds directly on our current tip
      * has been received and connected to the headers tree, though not validated yet */
     virtual void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block) {};
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend class CMainSignals;
+    friend void ::RegisterValidationInterface(CValidationInterface*, const std::string&);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
 };
 
+/** Statistics about the background callback queue of one subscriber.  */
+struct ValidationInterfaceQueueStats
+{
+    std::string name;
+    /** Number of callbacks currently waiting to be run.  */
+    size_t pending;
+    /** Highest number of callbacks that were waiting at any time.  */
+    size_t max_pending;
+    /** Number of callbacks run so far.  */
+    uint64_t processed;
+};
+
 struct MainSignalsInstance;
 class CMainSignals {
 private:
     std::unique_ptr<MainSignalsInstance> m_internals;
 
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterface(CValidationInterface*, const std::string&);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
     friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
@@ -172,7 +191,10 @@ public:
     /** Call any remaining callbacks on the calling thread */
     void FlushBackgroundCallbacks();
 
+    /** Returns the number of callbacks pending in the longest queue.  */
     size_t CallbacksPending();
+    /** Returns statistics about each subscriber's callback queue.  */
+    std::vector<ValidationInterfaceQueueStats> GetQueueStats();
 
     /** Register with mempool to call TransactionRemovedFromMempool callbacks */
     void RegisterWithMempoolSignals(CTxMemPool& pool);
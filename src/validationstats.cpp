@@ -0,0 +1,126 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <validationstats.h>
+
+#include <algorithm>
+#include <cassert>
+
+ValidationStats g_validation_stats;
+
+ValidationStats::ValidationStats(size_t window)
+    : m_window(window)
+{
+    assert(m_window > 0);
+}
+
+const char* ValidationStats::GetStageName(const ValidationStage stage)
+{
+    switch (stage) {
+    case ValidationStage::CHECK: return "check";
+    case ValidationStage::FORKS: return "forks";
+    case ValidationStage::CONNECT: return "connect";
+    case ValidationStage::NAMES: return "names";
+    case ValidationStage::VERIFY: return "verify";
+    case ValidationStage::INDEX: return "index";
+    case ValidationStage::CALLBACKS: return "callbacks";
+    case ValidationStage::READ_FROM_DISK: return "readfromdisk";
+    case ValidationStage::CONNECT_TOTAL: return "connecttotal";
+    case ValidationStage::FLUSH: return "flush";
+    case ValidationStage::CHAINSTATE: return "chainstate";
+    case ValidationStage::POST_CONNECT: return "postconnect";
+    case ValidationStage::CONNECT_TIP: return "connecttip";
+    case ValidationStage::DISCONNECT_TIP: return "disconnecttip";
+    case ValidationStage::POW: return "pow";
+    case ValidationStage::CHECK_BLOCK: return "checkblock";
+    case ValidationStage::REPLAY_READ: return "replayread";
+    case ValidationStage::REPLAY_DESERIALIZE: return "replaydeserialize";
+    case ValidationStage::ZMQ: return "zmq";
+    case ValidationStage::ZMQ_GAMES: return "zmqgames";
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
+int64_t ValidationStats::Record(const ValidationStage stage, int64_t micros)
+{
+    micros = std::max<int64_t>(micros, 0);
+
+    LOCK(m_cs);
+    Stage& s = m_stages[static_cast<unsigned int>(stage)];
+
+    ++s.count;
+    s.total_us += micros;
+    s.max_us = std::max(s.max_us, micros);
+
+    unsigned int bucket = 0;
+    while (bucket + 1 < VALIDATION_STATS_BUCKETS && (micros >> bucket) > 0) {
+        ++bucket;
+    }
+    ++s.histogram[bucket];
+
+    if (s.recent.size() < m_window) {
+        s.recent.push_back(micros);
+    } else {
+        s.recent[s.next] = micros;
+        s.next = (s.next + 1) % m_window;
+    }
+
+    return s.total_us;
+}
+
+namespace
+{
+
+/** Returns the given percentile of an already sorted, non-empty list.  */
+int64_t Percentile(const std::vector<int64_t>& sorted, const unsigned int percent)
+{
+    assert(!sorted.empty());
+    const size_t index = (sorted.size() - 1) * percent / 100;
+    return sorted[index];
+}
+
+} // anonymous namespace
+
+std::vector<ValidationStageStats> ValidationStats::GetStats() const
+{
+    std::vector<ValidationStageStats> res;
+
+    LOCK(m_cs);
+    for (unsigned int i = 0; i < NUM_VALIDATION_STAGES; ++i) {
+        const Stage& s = m_stages[i];
+
+        ValidationStageStats stats;
+        stats.name = GetStageName(static_cast<ValidationStage>(i));
+        stats.count = s.count;
+        stats.total_us = s.total_us;
+        stats.max_us = s.max_us;
+        stats.histogram.assign(s.histogram.begin(), s.histogram.end());
+
+        if (!s.recent.empty()) {
+            std::vector<int64_t> sorted(s.recent);
+            std::sort(sorted.begin(), sorted.end());
+
+            stats.recent_count = sorted.size();
+            for (const int64_t val : sorted) {
+                stats.recent_total_us += val;
+            }
+            stats.recent_median_us = Percentile(sorted, 50);
+            stats.recent_p90_us = Percentile(sorted, 90);
+            stats.recent_p99_us = Percentile(sorted, 99);
+            stats.recent_max_us = sorted.back();
+        }
+
+        res.push_back(std::move(stats));
+    }
+
+    return res;
+}
+
+void ValidationStats::Reset()
+{
+    LOCK(m_cs);
+    for (auto& s : m_stages) {
+        s = Stage();
+    }
+}
@@ -0,0 +1,130 @@
+// Copyright (c) 2019 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_VALIDATIONSTATS_H
+#define BITCOIN_VALIDATIONSTATS_H
+
+#include <sync.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** Stages of the block validation pipeline for which timings are kept.  */
+enum class ValidationStage
+{
+    /* Inside ConnectBlock.  */
+    CHECK,
+    FORKS,
+    CONNECT,
+    NAMES,
+    VERIFY,
+    INDEX,
+    CALLBACKS,
+
+    /* Inside ConnectTip.  */
+    READ_FROM_DISK,
+    CONNECT_TOTAL,
+    FLUSH,
+    CHAINSTATE,
+    POST_CONNECT,
+    CONNECT_TIP,
+
+    DISCONNECT_TIP,
+
+    /* Context-free checks of headers and blocks.  POW is recorded for
+       every check, CHECK_BLOCK only for blocks that pass all checks.
+       CHECK_BLOCK excludes the PoW check that CheckBlock also does, so
+       that the stages can be summed.  */
+    POW,
+    CHECK_BLOCK,
+
+    /* Reading blocks from external files with -replayblocks.  */
+    REPLAY_READ,
+    REPLAY_DESERIALIZE,
+
+    /* Block notifications sent out through ZMQ.  */
+    ZMQ,
+    ZMQ_GAMES,
+};
+
+/** Number of entries in ValidationStage.  */
+static constexpr unsigned int NUM_VALIDATION_STAGES = static_cast<unsigned int>(ValidationStage::ZMQ_GAMES) + 1;
+
+/** Number of most recent samples per stage that are kept in full.  */
+static constexpr size_t VALIDATION_STATS_WINDOW = 1000;
+
+/** Number of buckets in the lifetime histograms.  Bucket i counts samples
+ *  of less than 2^i microseconds (and at least 2^(i-1)), the last bucket
+ *  counts everything longer.  */
+static constexpr unsigned int VALIDATION_STATS_BUCKETS = 28;
+
+/** Summary of the collected timings for one validation stage.  */
+struct ValidationStageStats
+{
+    std::string name;
+
+    /* Since startup (or the last reset).  */
+    uint64_t count = 0;
+    int64_t total_us = 0;
+    int64_t max_us = 0;
+    std::vector<uint64_t> histogram;
+
+    /* Over the most recent samples only.  */
+    uint64_t recent_count = 0;
+    int64_t recent_total_us = 0;
+    int64_t recent_median_us = 0;
+    int64_t recent_p90_us = 0;
+    int64_t recent_p99_us = 0;
+    int64_t recent_max_us = 0;
+};
+
+/**
+ * Registry for the durations of the block validation stages.  For each stage
+ * it keeps lifetime totals with a log2 histogram as well as the raw samples
+ * of the last VALIDATION_STATS_WINDOW blocks, from which percentiles are
+ * computed on request.
+ */
+class ValidationStats
+{
+private:
+    struct Stage
+    {
+        uint64_t count = 0;
+        int64_t total_us = 0;
+        int64_t max_us = 0;
+        std::array<uint64_t, VALIDATION_STATS_BUCKETS> histogram{};
+
+        /** Ring buffer of the most recent samples.  */
+        std::vector<int64_t> recent;
+        /** Position in recent where the next sample goes once it is full.  */
+        size_t next = 0;
+    };
+
+    const size_t m_window;
+
+    mutable CCriticalSection m_cs;
+    std::array<Stage, NUM_VALIDATION_STAGES> m_stages GUARDED_BY(m_cs);
+
+public:
+    explicit ValidationStats(size_t window = VALIDATION_STATS_WINDOW);
+
+    ValidationStats(const ValidationStats&) = delete;
+    void operator=(const ValidationStats&) = delete;
+
+    /** Records one sample for the given stage and returns the stage's
+     *  lifetime total, which is what the BENCH log lines print.  */
+    int64_t Record(ValidationStage stage, int64_t micros);
+
+    std::vector<ValidationStageStats> GetStats() const;
+    void Reset();
+
+    /** Returns the name of a stage as used in the RPC interface.  */
+    static const char* GetStageName(ValidationStage stage);
+};
+
+extern ValidationStats g_validation_stats;
+
+#endif // BITCOIN_VALIDATIONSTATS_H
@@ -179,16 +179,16 @@ public:
     /** Database pointer. This is initialized lazily and reset during flushes, so it can be null. */
     std::unique_ptr<Db> m_db;
 
-private:
-    /** BerkeleyDB specific */
-    BerkeleyEnvironment *env;
-    std::string strFile;
-
     /** Return whether this database handle is a dummy for testing.
      * Only to be used at a low level, application should ideally not care
      * about this.
      */
     bool IsDummy() { return env == nullptr; }
+
+private:
+    /** BerkeleyDB specific */
+    BerkeleyEnvironment *env;
+    std::string strFile;
 };
 
 
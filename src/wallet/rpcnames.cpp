@@ -284,15 +284,14 @@ name_list (const JSONRPCRequest& request)
       int nOut = -1;
       for (unsigned i = 0; i < tx.tx->vout.size (); ++i)
         {
-          const CNameScript cur(tx.tx->vout[i].scriptPubKey);
-          if (cur.isNameOp ())
+          if (CNameScript::isNameScript (tx.tx->vout[i].scriptPubKey))
             {
               if (nOut != -1)
                 LogPrintf ("ERROR: wallet contains tx with multiple"
                            " name outputs");
               else
                 {
-                  nameOp = cur;
+                  nameOp = CNameScript (tx.tx->vout[i].scriptPubKey);
                   nOut = i;
                 }
             }
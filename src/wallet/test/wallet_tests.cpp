@@ -452,6 +452,92 @@ BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
     BOOST_CHECK(!wallet->GetKeyFromPool(pubkey, false));
 }
 
+BOOST_FIXTURE_TEST_CASE(wallet_keypool_batched_topup, TestChain100Setup)
+{
+    CKey seed;
+    seed.MakeNewKey(true);
+
+    auto chain = interfaces::MakeChain();
+    std::shared_ptr<CWallet> batched = std::make_shared<CWallet>(*chain, WalletLocation(), WalletDatabase::CreateDummy());
+    std::shared_ptr<CWallet> single = std::make_shared<CWallet>(*chain, WalletLocation(), WalletDatabase::CreateDummy());
+    for (const auto& wallet : {batched, single}) {
+        LOCK(wallet->cs_wallet);
+        wallet->SetMinVersion(FEATURE_LATEST);
+        BOOST_CHECK(wallet->AddKeyPubKey(seed, seed.GetPubKey()));
+        wallet->SetHDSeed(seed.GetPubKey());
+    }
+
+    // Top up across several batches, which reuse the derived chain keys.
+    const unsigned int target = 2 * KEYPOOL_TOPUP_BATCH_SIZE + 10;
+    BOOST_CHECK(batched->TopUpKeyPool(target));
+
+    LOCK2(batched->cs_wallet, single->cs_wallet);
+    BOOST_CHECK_EQUAL(batched->KeypoolCountExternalKeys(), target);
+    BOOST_CHECK_EQUAL(batched->GetKeyPoolSize(), 2 * target);
+
+    // The keys must match those derived one at a time from the seed.
+    const auto& reserve = batched->GetAllReserveKeys();
+    WalletBatch batch(single->GetDBHandle());
+    for (unsigned int i = 0; i < target; ++i) {
+        BOOST_CHECK(reserve.count(single->GenerateNewKey(batch, false).GetID()) > 0);
+        BOOST_CHECK(reserve.count(single->GenerateNewKey(batch, true).GetID()) > 0);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(wallet_keypool_background_topup, TestChain100Setup)
+{
+    gArgs.ForceSetArg("-keypool", "50");
+    gArgs.ForceSetArg("-keypoolmin", "10");
+
+    CKey seed;
+    seed.MakeNewKey(true);
+
+    auto chain = interfaces::MakeChain();
+    std::shared_ptr<CWallet> wallet = std::make_shared<CWallet>(*chain, WalletLocation(), WalletDatabase::CreateMock());
+    {
+        LOCK(wallet->cs_wallet);
+        wallet->SetMinVersion(FEATURE_LATEST);
+        BOOST_CHECK(wallet->AddKeyPubKey(seed, seed.GetPubKey()));
+        wallet->SetHDSeed(seed.GetPubKey());
+    }
+    BOOST_CHECK(wallet->TopUpKeyPool());
+
+    // Handing out keys does not refill the pool synchronously.
+    CPubKey pubkey;
+    for (int i = 0; i < 40; ++i) {
+        BOOST_CHECK(wallet->GetKeyFromPool(pubkey, false));
+    }
+    {
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK_EQUAL(wallet->KeypoolCountExternalKeys(), 10);
+    }
+
+    // The pool reached the low-water mark, so the background refill tops
+    // it up again, and the new keys are written to the database.
+    wallet->TopUpKeyPoolInBackground();
+    {
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK_EQUAL(wallet->KeypoolCountExternalKeys(), 50);
+        BOOST_CHECK_EQUAL(wallet->GetKeyPoolSize(), 100);
+    }
+    WalletBatch batch(wallet->GetDBHandle());
+    CKeyPool keypool;
+    BOOST_CHECK(batch.ReadPool(140, keypool));
+    BOOST_CHECK(!keypool.fInternal);
+    BOOST_CHECK(!batch.ReadPool(141, keypool));
+
+    // Without a request, nothing more happens.
+    BOOST_CHECK(wallet->GetKeyFromPool(pubkey, false));
+    wallet->TopUpKeyPoolInBackground();
+    {
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK_EQUAL(wallet->KeypoolCountExternalKeys(), 49);
+    }
+
+    gArgs.ForceSetArg("-keypool", std::to_string(DEFAULT_KEYPOOL_SIZE));
+    gArgs.ForceSetArg("-keypoolmin", std::to_string(DEFAULT_KEYPOOL_MIN));
+}
+
 // Explicit calculation which is used to test the wallet constant
 // We get the same virtual size due to rounding(weight/4) for both use_max_sig values
 static size_t CalculateNestedKeyhashInputSize(bool use_max_sig)
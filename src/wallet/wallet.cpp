@@ -127,7 +127,7 @@ const CWalletTx* CWallet::GetWalletTx(const uint256& hash) const
     return &(it->second);
 }
 
-CPubKey CWallet::GenerateNewKey(WalletBatch &batch, bool internal)
+CPubKey CWallet::GenerateNewKey(WalletBatch &batch, bool internal, HDChainKeyCache* chain_keys)
 {
     assert(!IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS));
     AssertLockHeld(cs_wallet); // mapKeyMetadata
@@ -141,7 +141,7 @@ CPubKey CWallet::GenerateNewKey(WalletBatch &batch, bool internal)
 
     // use HD key derivation if HD was enabled during wallet creation
     if (IsHDEnabled()) {
-        DeriveNewChildKey(batch, metadata, secret, (CanSupportFeature(FEATURE_HD_SPLIT) ? internal : false));
+        DeriveNewChildKey(batch, metadata, secret, (CanSupportFeature(FEATURE_HD_SPLIT) ? internal : false), chain_keys);
     } else {
         secret.MakeNewKey(fCompressed);
     }
@@ -163,28 +163,38 @@ CPubKey CWallet::GenerateNewKey(WalletBatch &batch, bool internal)
     return pubkey;
 }
 
-void CWallet::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, bool internal)
+void CWallet::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, bool internal, HDChainKeyCache* chain_keys)
 {
     // for now we use a fixed keypath scheme of m/0'/0'/k
-    CKey seed;                     //seed (256bit)
-    CExtKey masterKey;             //hd master key
-    CExtKey accountKey;            //key at m/0'
     CExtKey chainChildKey;         //key at m/0'/0' (external) or m/0'/1' (internal)
     CExtKey childKey;              //key at m/0'/0'/<n>'
 
-    // try to get the seed
-    if (!GetKey(hdChain.seed_id, seed))
-        throw std::runtime_error(std::string(__func__) + ": seed not found");
+    assert(internal ? CanSupportFeature(FEATURE_HD_SPLIT) : true);
+    if (chain_keys != nullptr && chain_keys->have_key[internal]) {
+        chainChildKey = chain_keys->key[internal];
+    } else {
+        CKey seed;                 //seed (256bit)
+        CExtKey masterKey;         //hd master key
+        CExtKey accountKey;        //key at m/0'
 
-    masterKey.SetSeed(seed.begin(), seed.size());
+        // try to get the seed
+        if (!GetKey(hdChain.seed_id, seed))
+            throw std::runtime_error(std::string(__func__) + ": seed not found");
 
-    // derive m/0'
-    // use hardened derivation (child keys >= 0x80000000 are hardened after bip32)
-    masterKey.Derive(accountKey, BIP32_HARDENED_KEY_LIMIT);
+        masterKey.SetSeed(seed.begin(), seed.size());
 
-    // derive m/0'/0' (external chain) OR m/0'/1' (internal chain)
-    assert(internal ? CanSupportFeature(FEATURE_HD_SPLIT) : true);
-    accountKey.Derive(chainChildKey, BIP32_HARDENED_KEY_LIMIT+(internal ? 1 : 0));
+        // derive m/0'
+        // use hardened derivation (child keys >= 0x80000000 are hardened after bip32)
+        masterKey.Derive(accountKey, BIP32_HARDENED_KEY_LIMIT);
+
+        // derive m/0'/0' (external chain) OR m/0'/1' (internal chain)
+        accountKey.Derive(chainChildKey, BIP32_HARDENED_KEY_LIMIT+(internal ? 1 : 0));
+
+        if (chain_keys != nullptr) {
+            chain_keys->key[internal] = chainChildKey;
+            chain_keys->have_key[internal] = true;
+        }
+    }
 
     // derive child key at next index, skip keys already known to the wallet
     do {
@@ -204,8 +214,9 @@ void CWallet::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey
     } while (HaveKey(childKey.key.GetPubKey().GetID()));
     secret = childKey.key;
     metadata.hd_seed_id = hdChain.seed_id;
-    // update the chain model in the database
-    if (!batch.WriteHDChain(hdChain))
+    // update the chain model in the database (batched callers do it once
+    // for the whole batch)
+    if (chain_keys == nullptr && !batch.WriteHDChain(hdChain))
         throw std::runtime_error(std::string(__func__) + ": Writing HD chain model failed");
 }
 
@@ -230,11 +241,11 @@ bool CWallet::AddKeyPubKeyWithDB(WalletBatch &batch, const CKey& secret, const C
     CScript script;
     script = GetScriptForDestination(pubkey.GetID());
     if (HaveWatchOnly(script)) {
-        RemoveWatchOnly(script);
+        RemoveWatchOnlyWithDB(batch, script);
     }
     script = GetScriptForRawPubKey(pubkey);
     if (HaveWatchOnly(script)) {
-        RemoveWatchOnly(script);
+        RemoveWatchOnlyWithDB(batch, script);
     }
 
     if (!IsCrypted()) {
@@ -342,19 +353,25 @@ bool CWallet::AddWatchOnly(const CScript& dest, int64_t nCreateTime)
     return AddWatchOnly(dest);
 }
 
-bool CWallet::RemoveWatchOnly(const CScript &dest)
+bool CWallet::RemoveWatchOnlyWithDB(WalletBatch& batch, const CScript& dest)
 {
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
-    if (!WalletBatch(*database).EraseWatchOnly(dest))
+    if (!batch.EraseWatchOnly(dest))
         return false;
 
     return true;
 }
 
+bool CWallet::RemoveWatchOnly(const CScript &dest)
+{
+    WalletBatch batch(*database);
+    return RemoveWatchOnlyWithDB(batch, dest);
+}
+
 bool CWallet::LoadWatchOnly(const CScript &dest)
 {
     return CCryptoKeyStore::AddWatchOnly(dest);
@@ -2138,8 +2155,7 @@ CAmount CWallet::GetLegacyBalance(const isminefilter& filter, int minDepth) cons
         CAmount debit = wtx.GetDebit(filter);
         const bool outgoing = debit > 0;
         for (const CTxOut& out : wtx.tx->vout) {
-            const CNameScript nameOp(out.scriptPubKey);
-            if (nameOp.isNameOp())
+            if (CNameScript::isNameScript(out.scriptPubKey))
                 continue;
             if (outgoing && IsChange(out)) {
                 debit -= out.nValue;
@@ -3324,6 +3340,96 @@ void CWallet::LoadKeyPool(int64_t nIndex, const CKeyPool &keypool)
         mapKeyMetadata[keyid] = CKeyMetadata(keypool.nTime);
 }
 
+int64_t CWallet::TopUpKeyPoolBatch(unsigned int nTargetSize, int64_t max_keys)
+{
+    AssertLockHeld(cs_wallet);
+
+    // count amount of available keys (internal, external)
+    // make sure the keypool of external and internal keys fits the user selected target (-keypool)
+    int64_t missingExternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - (int64_t)setExternalKeyPool.size(), (int64_t) 0);
+    int64_t missingInternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - (int64_t)setInternalKeyPool.size(), (int64_t) 0);
+
+    if (!IsHDEnabled() || !CanSupportFeature(FEATURE_HD_SPLIT))
+    {
+        // don't create extra internal keys
+        missingInternal = 0;
+    }
+
+    // Split the batch between the two pools, preferring external keys
+    // (which is what getnewaddress and name operations hand out).
+    const int64_t batchExternal = std::min(missingExternal, max_keys);
+    const int64_t batchInternal = std::min(missingInternal, max_keys - batchExternal);
+    if (batchExternal + batchInternal == 0) {
+        return 0;
+    }
+
+    // All keys of the batch are written in a single database transaction,
+    // and the HD chain counters only once at the end.  Everything adding a
+    // key writes through this handle (including the removal of matching
+    // watch-only scripts), so nothing else waits on the transaction's locks.
+    // If anything fails, the destructor of the batch aborts the transaction.
+    WalletBatch batch(*database);
+    const bool fTxn = !database->IsDummy();
+    if (fTxn && !batch.TxnBegin()) {
+        throw std::runtime_error(std::string(__func__) + ": starting database transaction failed");
+    }
+
+    HDChainKeyCache chain_keys;
+    std::vector<std::pair<int64_t, CPubKey>> added;
+    bool internal = false;
+    for (int64_t i = batchInternal + batchExternal; i--;)
+    {
+        if (i < batchInternal) {
+            internal = true;
+        }
+
+        assert(m_max_keypool_index < std::numeric_limits<int64_t>::max()); // How in the hell did you use so many keys?
+        int64_t index = ++m_max_keypool_index;
+
+        CPubKey pubkey(GenerateNewKey(batch, internal, &chain_keys));
+        if (!batch.WritePool(index, CKeyPool(pubkey, internal))) {
+            throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
+        }
+        added.emplace_back(index, pubkey);
+    }
+
+    if (IsHDEnabled() && !batch.WriteHDChain(hdChain)) {
+        throw std::runtime_error(std::string(__func__) + ": writing HD chain model failed");
+    }
+    if (fTxn && !batch.TxnCommit()) {
+        throw std::runtime_error(std::string(__func__) + ": committing keypool batch failed");
+    }
+
+    // Only make the keys available once they are on disk.  The internal
+    // keys are generated last.
+    for (size_t i = 0; i < added.size(); ++i) {
+        const int64_t index = added[i].first;
+        if (i >= static_cast<size_t>(batchExternal)) {
+            setInternalKeyPool.insert(index);
+        } else {
+            setExternalKeyPool.insert(index);
+        }
+        m_pool_key_to_index[added[i].second.GetID()] = index;
+    }
+
+    WalletLogPrintf("keypool added %d keys (%d internal), size=%u (%u internal)\n", batchInternal + batchExternal, batchInternal, setInternalKeyPool.size() + setExternalKeyPool.size() + set_pre_split_keypool.size(), setInternalKeyPool.size());
+
+    return missingExternal + missingInternal - batchExternal - batchInternal;
+}
+
+static unsigned int GetKeyPoolTargetSize(unsigned int kpSize)
+{
+    if (kpSize > 0)
+        return kpSize;
+    return std::max(gArgs.GetArg("-keypool", DEFAULT_KEYPOOL_SIZE), (int64_t) 0);
+}
+
+/** Returns the pool size at which a background refill is requested.  */
+static unsigned int GetKeyPoolLowWater(unsigned int nTargetSize)
+{
+    return std::min<int64_t>(std::max<int64_t>(gArgs.GetArg("-keypoolmin", DEFAULT_KEYPOOL_MIN), 0), nTargetSize);
+}
+
 bool CWallet::TopUpKeyPool(unsigned int kpSize)
 {
     if (IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS)) {
@@ -3336,50 +3442,52 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
             return false;
 
         // Top up key pool
-        unsigned int nTargetSize;
-        if (kpSize > 0)
-            nTargetSize = kpSize;
-        else
-            nTargetSize = std::max(gArgs.GetArg("-keypool", DEFAULT_KEYPOOL_SIZE), (int64_t) 0);
-
-        // count amount of available keys (internal, external)
-        // make sure the keypool of external and internal keys fits the user selected target (-keypool)
-        int64_t missingExternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - (int64_t)setExternalKeyPool.size(), (int64_t) 0);
-        int64_t missingInternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - (int64_t)setInternalKeyPool.size(), (int64_t) 0);
-
-        if (!IsHDEnabled() || !CanSupportFeature(FEATURE_HD_SPLIT))
-        {
-            // don't create extra internal keys
-            missingInternal = 0;
-        }
-        bool internal = false;
-        WalletBatch batch(*database);
-        for (int64_t i = missingInternal + missingExternal; i--;)
-        {
-            if (i < missingInternal) {
-                internal = true;
-            }
+        const unsigned int nTargetSize = GetKeyPoolTargetSize(kpSize);
+        while (TopUpKeyPoolBatch(nTargetSize, KEYPOOL_TOPUP_BATCH_SIZE) > 0);
+    }
+    return true;
+}
 
-            assert(m_max_keypool_index < std::numeric_limits<int64_t>::max()); // How in the hell did you use so many keys?
-            int64_t index = ++m_max_keypool_index;
+bool CWallet::TopUpKeyPoolAfterUnlock()
+{
+    const unsigned int nTargetSize = GetKeyPoolTargetSize(0);
+    if (!TopUpKeyPool(std::max(GetKeyPoolLowWater(nTargetSize), 1u))) {
+        return false;
+    }
+    m_keypool_topup_requested = true;
+    return true;
+}
 
-            CPubKey pubkey(GenerateNewKey(batch, internal));
-            if (!batch.WritePool(index, CKeyPool(pubkey, internal))) {
-                throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
-            }
+void CWallet::TopUpKeyPoolInBackground()
+{
+    // Keys cannot be derived while the wallet is locked.  In that case, the
+    // request is kept and served once the wallet gets unlocked.
+    if (!m_keypool_topup_requested || IsLocked()) {
+        return;
+    }
+    m_keypool_topup_requested = false;
+    if (IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS)) {
+        return;
+    }
 
-            if (internal) {
-                setInternalKeyPool.insert(index);
-            } else {
-                setExternalKeyPool.insert(index);
-            }
-            m_pool_key_to_index[pubkey.GetID()] = index;
+    const unsigned int nTargetSize = GetKeyPoolTargetSize(0);
+    while (true) {
+        LOCK(cs_wallet);
+        if (IsLocked()) {
+            m_keypool_topup_requested = true;
+            break;
         }
-        if (missingInternal + missingExternal > 0) {
-            WalletLogPrintf("keypool added %d keys (%d internal), size=%u (%u internal)\n", missingInternal + missingExternal, missingInternal, setInternalKeyPool.size() + setExternalKeyPool.size() + set_pre_split_keypool.size(), setInternalKeyPool.size());
+        if (TopUpKeyPoolBatch(nTargetSize, KEYPOOL_TOPUP_BATCH_SIZE) == 0) {
+            break;
         }
     }
-    return true;
+}
+
+void MaybeTopUpKeyPools()
+{
+    for (const std::shared_ptr<CWallet>& pwallet : GetWallets()) {
+        pwallet->TopUpKeyPoolInBackground();
+    }
 }
 
 bool CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool, bool fRequestedInternal)
@@ -3389,13 +3497,24 @@ bool CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool, bool fRe
     {
         LOCK(cs_wallet);
 
-        if (!IsLocked())
-            TopUpKeyPool();
-
         bool fReturningInternal = IsHDEnabled() && CanSupportFeature(FEATURE_HD_SPLIT) && fRequestedInternal;
         bool use_split_keypool = set_pre_split_keypool.empty();
         std::set<int64_t>& setKeyPool = use_split_keypool ? (fReturningInternal ? setInternalKeyPool : setExternalKeyPool) : set_pre_split_keypool;
 
+        // Only derive keys synchronously if the pool ran dry.  Otherwise,
+        // refilling is left to the scheduler thread once the pool drops
+        // below the -keypoolmin low-water mark.  For a locked wallet, the
+        // refill is requested as well and happens after unlocking.
+        if (!IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS)) {
+            const unsigned int nTargetSize = GetKeyPoolTargetSize(0);
+            if (!IsLocked()) {
+                while (setKeyPool.empty() && TopUpKeyPoolBatch(nTargetSize, KEYPOOL_TOPUP_BATCH_SIZE) > 0);
+            }
+            if (setKeyPool.size() <= GetKeyPoolLowWater(nTargetSize)) {
+                m_keypool_topup_requested = true;
+            }
+        }
+
         // Get the oldest key
         if (setKeyPool.empty()) {
             return false;
@@ -4288,7 +4407,7 @@ std::shared_ptr<CWallet> CWallet::CreateWalletFromFile(interfaces::Chain& chain,
     uiInterface.LoadWallet(walletInstance);
 
     // Register with the validation interface. It's ok to do this after rescan since we're still holding cs_main.
-    RegisterValidationInterface(walletInstance.get());
+    RegisterValidationInterface(walletInstance.get(), "wallet:" + walletInstance->GetName());
 
     walletInstance->SetBroadcastTransactions(gArgs.GetBoolArg("-walletbroadcast", DEFAULT_WALLETBROADCAST));
 
@@ -56,6 +56,9 @@ void StopWallets();
 //! Close all wallets.
 void UnloadWallets();
 
+//! Refill the keypools of all wallets that requested it in the background.
+void MaybeTopUpKeyPools();
+
 bool AddWallet(const std::shared_ptr<CWallet>& wallet);
 bool RemoveWallet(const std::shared_ptr<CWallet>& wallet);
 bool HasWallets();
@@ -64,6 +67,10 @@ std::shared_ptr<CWallet> GetWallet(const std::string& name);
 
 //! Default for -keypool
 static const unsigned int DEFAULT_KEYPOOL_SIZE = 1000;
+//! Default for -keypoolmin
+static const unsigned int DEFAULT_KEYPOOL_MIN = 100;
+//! Maximum number of keys derived and written in one keypool top-up batch
+static const unsigned int KEYPOOL_TOPUP_BATCH_SIZE = 100;
 //! -paytxfee default
 constexpr CAmount DEFAULT_PAY_TX_FEE = 0;
 //! -fallbackfee default
@@ -646,14 +653,37 @@ private:
     /* the HD chain data model (external chain counters) */
     CHDChain hdChain;
 
-    /* HD derive new child key (on internal or external chain) */
-    void DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, bool internal = false) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    /**
+     * Chain keys (m/0'/0' and m/0'/1') derived once and reused for all child
+     * keys generated within a single keypool top-up batch.
+     */
+    struct HDChainKeyCache
+    {
+        bool have_key[2] = {false, false};
+        CExtKey key[2];
+    };
+
+    /* HD derive new child key (on internal or external chain).  If a chain
+     * key cache is passed in, the chain keys are taken from (and stored in)
+     * it, and writing the updated HD chain to the database is left to the
+     * caller.  */
+    void DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, bool internal = false, HDChainKeyCache* chain_keys = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
     std::set<int64_t> setInternalKeyPool;
     std::set<int64_t> setExternalKeyPool GUARDED_BY(cs_wallet);
     std::set<int64_t> set_pre_split_keypool;
     int64_t m_max_keypool_index GUARDED_BY(cs_wallet) = 0;
     std::map<CKeyID, int64_t> m_pool_key_to_index;
+    /** Set when the keypool dropped below -keypoolmin and should be
+     *  refilled by MaybeTopUpKeyPools.  */
+    std::atomic<bool> m_keypool_topup_requested{false};
+
+    /**
+     * Generates up to max_keys new keys for the keypool (as needed to reach
+     * the target size), deriving the HD chain keys only once.  Returns the number
+     * of keys that are still missing afterwards.
+     */
+    int64_t TopUpKeyPoolBatch(unsigned int nTargetSize, int64_t max_keys) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     std::atomic<uint64_t> m_wallet_flags{0};
 
     int64_t nTimeFirstKey GUARDED_BY(cs_wallet) = 0;
@@ -807,7 +837,7 @@ public:
      * keystore implementation
      * Generate a new key
      */
-    CPubKey GenerateNewKey(WalletBatch& batch, bool internal = false) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    CPubKey GenerateNewKey(WalletBatch& batch, bool internal = false, HDChainKeyCache* chain_keys = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     //! Adds a key to the store, and saves it to disk.
     bool AddKeyPubKey(const CKey& key, const CPubKey &pubkey) override EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     bool AddKeyPubKeyWithDB(WalletBatch &batch,const CKey& key, const CPubKey &pubkey) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
@@ -841,6 +871,8 @@ public:
     //! Adds a watch-only address to the store, and saves it to disk.
     bool AddWatchOnly(const CScript& dest, int64_t nCreateTime) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     bool RemoveWatchOnly(const CScript &dest) override EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    //! Removes a watch-only script, erasing it through the given database handle.
+    bool RemoveWatchOnlyWithDB(WalletBatch& batch, const CScript& dest) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     //! Adds a watch-only address to the store, without saving it to disk (used by LoadWallet)
     bool LoadWatchOnly(const CScript &dest);
 
@@ -944,6 +976,20 @@ public:
     bool NewKeyPool();
     size_t KeypoolCountExternalKeys() EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     bool TopUpKeyPool(unsigned int kpSize = 0);
+    /**
+     * If a refill was requested because the keypool ran below -keypoolmin,
+     * fills it up to -keypool in batches of KEYPOOL_TOPUP_BATCH_SIZE keys.
+     * cs_wallet is released in between batches so that RPCs handing out
+     * addresses are not blocked for the whole refill.  This is what
+     * MaybeTopUpKeyPools runs on the scheduler thread.
+     */
+    void TopUpKeyPoolInBackground();
+    /**
+     * Fills the keypool up to the -keypoolmin low-water mark right away and
+     * requests the background refill for the rest.  This is used after
+     * unlocking, since no keys can be derived while the wallet is locked.
+     */
+    bool TopUpKeyPoolAfterUnlock();
 
     /**
      * Reserves a key from the keypool and sets nIndex to its index
@@ -11,10 +11,14 @@
 #include <logging.h>
 #include <names/common.h>
 #include <names/encoding.h>
+#include <names/main.h>
 #include <primitives/block.h>
+#include <primitives/blockview.h>
 #include <primitives/transaction.h>
 #include <script/names.h>
 #include <script/standard.h>
+#include <util/time.h>
+#include <validationstats.h>
 
 #include <univalue.h>
 
@@ -35,6 +39,58 @@ ZMQGameBlocksNotifier::SendMessage (const std::string& command,
 namespace
 {
 
+/* Accessors that let the code below work on both full transactions and
+   on views into a serialised block.  */
+
+const CTransaction&
+GetTx (const CTransactionRef& tx)
+{
+  return *tx;
+}
+
+const CTransactionView&
+GetTx (const CTransactionView& tx)
+{
+  return tx;
+}
+
+const std::vector<CTxOut>&
+GetOutputs (const CTransaction& tx)
+{
+  return tx.vout;
+}
+
+CTxViewRange<CTxOutView>
+GetOutputs (const CTransactionView& tx)
+{
+  return tx.Outputs ();
+}
+
+const CScript&
+GetScript (const CTxOut& out)
+{
+  return out.scriptPubKey;
+}
+
+CScript
+GetScript (const CTxOutView& out)
+{
+  return out.GetScript ();
+}
+
+Span<const unsigned char>
+GetScriptBytes (const CTxOut& out)
+{
+  return Span<const unsigned char> (out.scriptPubKey.data (),
+                                    out.scriptPubKey.size ());
+}
+
+Span<const unsigned char>
+GetScriptBytes (const CTxOutView& out)
+{
+  return out.scriptPubKey;
+}
+
 /**
  * Helper class that analyses a single transaction and extracts the data
  * from it that is relevant for the ZMQ game notifications.
@@ -60,9 +116,10 @@ private:
 public:
 
   /**
-   * Construct this by analysing a given transaction.
+   * Construct this by analysing a given transaction (or transaction view).
    */
-  explicit TransactionData (const CTransaction& tx);
+  template <typename Tx>
+    explicit TransactionData (const Tx& tx);
 
   TransactionData () = delete;
   TransactionData (const TransactionData&) = delete;
@@ -91,14 +148,15 @@ public:
 
 };
 
-TransactionData::TransactionData (const CTransaction& tx)
+template <typename Tx>
+  TransactionData::TransactionData (const Tx& tx)
 {
   /* Determine if this is a name update at all; if it isn't, then there
      is nothing to do for this transaction.  */
-  CNameScript nameOp;
-  for (const auto& out : tx.vout)
+  CNameScriptView nameOp;
+  for (const auto& out : GetOutputs (tx))
     {
-      nameOp = CNameScript (out.scriptPubKey);
+      nameOp = CNameScriptView (GetScriptBytes (out));
       if (nameOp.isNameOp ())
         break;
     }
@@ -106,8 +164,9 @@ TransactionData::TransactionData (const CTransaction& tx)
     return;
 
   /* Parse the value JSON.  */
-  const std::string valueStr = EncodeName (nameOp.getOpValue (),
-                                           NameEncoding::UTF8);
+  const valtype rawValue(nameOp.getOpValue ().begin (),
+                         nameOp.getOpValue ().end ());
+  const std::string valueStr = EncodeName (rawValue, NameEncoding::UTF8);
   UniValue value;
   if (!value.read (valueStr) || !value.isObject ())
     {
@@ -119,7 +178,9 @@ TransactionData::TransactionData (const CTransaction& tx)
     }
 
   /* Special case:  Handle admin commands.  */
-  const std::string name = EncodeName (nameOp.getOpName (), NameEncoding::UTF8);
+  const valtype rawName(nameOp.getOpName ().begin (),
+                        nameOp.getOpName ().end ());
+  const std::string name = EncodeName (rawName, NameEncoding::UTF8);
   if (name.substr (0, 2) == "g/")
     {
       if (!value.exists ("cmd"))
@@ -137,10 +198,8 @@ TransactionData::TransactionData (const CTransaction& tx)
     return;
 
   /* See if there are actually games mentioned in the update's value.  */
-  if (!value.exists ("g"))
-    return;
-  const UniValue& g = value["g"];
-  if (!g.isObject () || g.empty ())
+  const auto movesPerGame = ::GetMovesPerGame (value);
+  if (movesPerGame.empty ())
     return;
 
   /* Prepare a template object that is the same for all games.  */
@@ -149,14 +208,13 @@ TransactionData::TransactionData (const CTransaction& tx)
   tmpl.pushKV ("name", name.substr (2));
 
   std::map<std::string, CAmount> outAmounts;
-  for (const auto& out : tx.vout)
+  for (const auto& out : GetOutputs (tx))
     {
-      const CNameScript nameOp(out.scriptPubKey);
-      if (nameOp.isNameOp ())
+      if (CNameScriptView (GetScriptBytes (out)).isNameOp ())
         continue;
 
       CTxDestination dest;
-      if (!ExtractDestination (out.scriptPubKey, dest))
+      if (!ExtractDestination (GetScript (out), dest))
         continue;
 
       const std::string addr = EncodeDestination (dest);
@@ -169,20 +227,24 @@ TransactionData::TransactionData (const CTransaction& tx)
   tmpl.pushKV ("out", out);
 
   /* Fill the per-game moves into the template.  */
-  for (const auto& game : g.getKeys ())
+  for (const auto& entry : movesPerGame)
     {
       UniValue obj = tmpl;
-      obj.pushKV ("move", g[game]);
-      moves.emplace (game, obj);
+      obj.pushKV ("move", entry.second);
+      moves.emplace (entry.first, obj);
     }
 }
 
-} // anonymous namespace
-
-bool
-ZMQGameBlocksNotifier::SendBlockNotifications (
-    const std::set<std::string>& games, const std::string& commandPrefix,
-    const std::string& reqtoken, const CBlock& block, const CBlockIndex* pindex)
+/**
+ * Constructs the JSON data of the notifications for each of the given games.
+ * This works on the header plus a range of either CTransactionRef's or
+ * CTransactionView's.
+ */
+template <typename Txs>
+  std::map<std::string, UniValue>
+  BuildNotifications (const std::set<std::string>& games,
+                      const std::string& reqtoken, const CBlockHeader& block,
+                      const Txs& txs, const CBlockIndex* pindex)
 {
   /* Start with an empty array of moves for each game that we track.  */
   std::map<std::string, UniValue> perGameMoves;
@@ -192,9 +254,9 @@ ZMQGameBlocksNotifier::SendBlockNotifications (
 
   /* Add relevant moves for each game from all the transactions.  Also keep
      track of the admin commands for each game, if there are any.  */
-  for (const auto& tx : block.vtx)
+  for (const auto& tx : txs)
     {
-      const TransactionData data(*tx);
+      const TransactionData data(GetTx (tx));
 
       for (const auto& entry : data.GetMovesPerGame ())
         {
@@ -234,8 +296,9 @@ ZMQGameBlocksNotifier::SendBlockNotifications (
   if (!reqtoken.empty ())
     tmpl.pushKV ("reqtoken", reqtoken);
 
-  /* Send notifications for all games with the moves merged into the
+  /* Build notifications for all games with the moves merged into the
      template object.  */
+  std::map<std::string, UniValue> res;
   for (const auto& game : games)
     {
       auto mit = perGameMoves.find (game);
@@ -249,29 +312,77 @@ ZMQGameBlocksNotifier::SendBlockNotifications (
       if (adminCmd != perGameAdminCmds.end ())
         data.pushKV ("cmd", adminCmd->second);
 
-      if (!SendMessage (commandPrefix + " json " + game, data))
-        return false;
+      res.emplace (game, data);
     }
 
+  return res;
+}
+
+} // anonymous namespace
+
+bool
+ZMQGameBlocksNotifier::SendNotifications (
+    const std::string& commandPrefix,
+    const std::map<std::string, UniValue>& perGame)
+{
+  for (const auto& entry : perGame)
+    if (!SendMessage (commandPrefix + " json " + entry.first, entry.second))
+      return false;
+
   return true;
 }
 
+bool
+ZMQGameBlocksNotifier::SendBlockNotifications (
+    const std::set<std::string>& games, const std::string& commandPrefix,
+    const std::string& reqtoken, const CBlock& block, const CBlockIndex* pindex)
+{
+  return SendNotifications (commandPrefix,
+                            BuildNotifications (games, reqtoken, block,
+                                                block.vtx, pindex));
+}
+
+bool
+ZMQGameBlocksNotifier::SendBlockNotifications (
+    const std::set<std::string>& games, const std::string& commandPrefix,
+    const std::string& reqtoken, const CBlockView& block,
+    const CBlockIndex* pindex)
+{
+  return SendNotifications (commandPrefix,
+                            BuildNotifications (games, reqtoken,
+                                                block.GetHeader (),
+                                                block.GetTransactions (),
+                                                pindex));
+}
+
 bool
 ZMQGameBlocksNotifier::NotifyBlockAttached (const CBlock& block,
                                             const CBlockIndex* pindex)
 {
+  const int64_t start = GetTimeMicros ();
+
   LOCK (csTrackedGames);
-  return SendBlockNotifications (trackedGames, PREFIX_ATTACH, "",
-                                 block, pindex);
+  const bool res = SendBlockNotifications (trackedGames, PREFIX_ATTACH, "",
+                                           block, pindex);
+
+  g_validation_stats.Record (ValidationStage::ZMQ_GAMES,
+                             GetTimeMicros () - start);
+  return res;
 }
 
 bool
 ZMQGameBlocksNotifier::NotifyBlockDetached (const CBlock& block,
                                             const CBlockIndex* pindex)
 {
+  const int64_t start = GetTimeMicros ();
+
   LOCK (csTrackedGames);
-  return SendBlockNotifications (trackedGames, PREFIX_DETACH, "",
-                                 block, pindex);
+  const bool res = SendBlockNotifications (trackedGames, PREFIX_DETACH, "",
+                                           block, pindex);
+
+  g_validation_stats.Record (ValidationStage::ZMQ_GAMES,
+                             GetTimeMicros () - start);
+  return res;
 }
 
 UniValue
@@ -8,11 +8,13 @@
 #include <sync.h>
 #include <zmq/zmqpublishnotifier.h>
 
+#include <map>
 #include <set>
 #include <string>
 
 class CBlock;
 class CBlockIndex;
+class CBlockView;
 class UniValue;
 
 /**
@@ -39,6 +41,12 @@ private:
    */
   bool SendMessage (const std::string& command, const UniValue& data);
 
+  /**
+   * Sends out the given JSON data for each game.
+   */
+  bool SendNotifications (const std::string& commandPrefix,
+                          const std::map<std::string, UniValue>& perGame);
+
 public:
 
   ZMQGameBlocksNotifier () = delete;
@@ -55,6 +63,11 @@ public:
                                const std::string& commandPrefix,
                                const std::string& reqtoken,
                                const CBlock& block, const CBlockIndex* pindex);
+  bool SendBlockNotifications (const std::set<std::string>& games,
+                               const std::string& commandPrefix,
+                               const std::string& reqtoken,
+                               const CBlockView& block,
+                               const CBlockIndex* pindex);
 
   bool NotifyBlockAttached (const CBlock& block,
                             const CBlockIndex* pindex) override;
@@ -11,6 +11,8 @@
 #include <validation.h>
 #include <streams.h>
 #include <util/system.h>
+#include <util/time.h>
+#include <validationstats.h>
 
 void zmqError(const char *str)
 {
@@ -193,6 +195,8 @@ void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef&
 
 void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected, const std::vector<CTransactionRef>& vtxConflicted, const std::vector<CTransactionRef>& vNameConflicts)
 {
+    const int64_t nStart = GetTimeMicros();
+
     for (const CTransactionRef& ptx : pblock->vtx) {
         // Do a normal notify for each transaction added in the block
         TransactionAddedToMempool(ptx);
@@ -212,10 +216,14 @@ void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBloc
             i = notifiers.erase(i);
         }
     }
+
+    g_validation_stats.Record(ValidationStage::ZMQ, GetTimeMicros() - nStart);
 }
 
 void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDelete, const std::vector<CTransactionRef>& vNameConflicts)
 {
+    const int64_t nStart = GetTimeMicros();
+
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
@@ -234,6 +242,8 @@ void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CB
         // Do a normal notify for each transaction removed in block disconnection
         TransactionAddedToMempool(ptx);
     }
+
+    g_validation_stats.Record(ValidationStage::ZMQ, GetTimeMicros() - nStart);
 }
 
 CZMQNotificationInterface* g_zmq_notification_interface = nullptr;
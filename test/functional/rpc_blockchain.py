@@ -72,9 +72,11 @@ class BlockchainTest(BitcoinTestFramework):
             'blocks',
             'chain',
             'chainwork',
+            'dbcompaction',
             'headers',
             'initialblockdownload',
             'mediantime',
+            'namereadcache',
             'pruned',
             'size_on_disk',
             'softforks',
@@ -96,6 +98,11 @@ class BlockchainTest(BitcoinTestFramework):
         assert res['pruned']
         assert not res['automatic_pruning']
 
+        # the cached chain is old, so the node is still in the initial sync
+        # and has deferred the compaction of its chainstate
+        assert res['initialblockdownload']
+        assert_equal(res['dbcompaction'], {'status': 'deferred', 'progress': 0})
+
         self.restart_node(0, ['-stopatheight=207'])
         res = self.nodes[0].getblockchaininfo()
         # should have exact keys